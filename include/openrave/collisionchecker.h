@@ -27,7 +27,7 @@ namespace OpenRAVE {
 /// options for collision checker
 enum CollisionOptions
 {
-    CO_Distance = 1, ///< Compute distance measurements, this is usually slow and not all checkers support it.
+    CO_Distance = 1, ///< Compute distance measurements, this is usually slow and not all checkers support it. Checkers that compute the distance between convex hulls (ode, bullet) return a lower bound for non-convex meshes, see \ref CollisionReport::minDistance.
     CO_UseTolerance = 2, ///< not used
     CO_Contacts = 4, ///< Return the contact points of the collision in the \ref CollisionReport. Note that this takes longer to compute.
     CO_RayAnyHit = 8, ///< When performing collision with rays, if this is set, algorithm just returns any hit instead of the closest (can be faster)
@@ -87,7 +87,12 @@ public:
 
     int options; ///< the options that the CollisionReport was called with. It is overwritten by the options set on the collision checker writing the report
     
-    dReal minDistance; ///< minimum distance from last query, filled if CO_Distance option is set
+    /// \brief minimum distance from last query, filled if CO_Distance option is set
+    ///
+    /// It is a lower bound of the true distance when the checker measures it between convex hulls of the geometries.
+    /// In particular, it can be 0 for two non-convex meshes whose hulls overlap without the meshes touching, so a
+    /// query returning no collision with minDistance 0 does not mean the objects are in contact.
+    dReal minDistance;
     int numWithinTol; ///< number of objects within tolerance of this object, filled if CO_UseTolerance option is set
 
     uint8_t nKeepPrevious; ///< if 1, will keep all previous data when resetting the collision checker. otherwise will reset
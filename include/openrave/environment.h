@@ -53,6 +53,29 @@ public:
         return __pUserData;
     }
 
+    /** \brief Used to send special commands to the environment and receive output. <b>[multi-thread safe]</b>
+
+        The following commands are supported:
+        - \b SetPerformanceCounters 0|1 - enables or disables the performance counters, see \ref RaveSetPerformanceCounters
+        - \b GetPerformanceCounters - writes the counters with \ref RaveWritePerformanceCounters
+        - \b ResetPerformanceCounters - sets all counters to zero
+        - \b SetTracing 0|1 [neventsperthread] - enables or disables the trace points, see \ref RaveSetTracing
+        - \b GetChromeTrace - writes the recorded trace events with \ref RaveWriteChromeTrace
+        - \b ClearTrace - removes all recorded trace events
+        - \b SetAsyncLogging 0|1 [repeatlimit] [recordsperthread] - enables or disables asynchronous logging, see \ref RaveSetAsyncLogging
+        - \b AddLogSink file filename|syslog ident|memory maxrecords - adds a log sink, see \ref RaveAddLogSink
+        - \b ClearLogSinks - removes all the log sinks
+        - \b FlushLog - writes the queued log messages, see \ref RaveFlushLog
+        - \b GetLog - writes the messages kept by the memory log sinks
+
+        The counters, traces, and logging are global to the process, so they also include the calls made in the other environments.
+        \param is the input stream containing the command
+        \param os the output stream containing the output
+        \exception openrave_exception Throw if the command is not supported.
+        \return true if the command is successfully processed, otherwise false.
+     */
+    virtual bool SendCommand(std::ostream& os, std::istream& is);
+
     /// \brief Returns the OpenRAVE global state, used for initializing plugins
     virtual UserDataPtr GlobalState() = 0;
 
@@ -1705,6 +1705,8 @@ private:
     /// \param values the values to set the joint angles (ordered by the dof indices)
     /// \param[in] checklimits one of \ref CheckLimitsAction and will excplicitly check the joint limits before setting the values and clamp them.
     /// \param dofindices the dof indices to return the values for. If empty, will compute for all the dofs
+    ///
+    /// When dofindices is set, only the links affected by the DOFs whose values changed are recomputed.
     virtual void SetDOFValues(const std::vector<dReal>& values, uint32_t checklimits = CLA_CheckLimits, const std::vector<int>& dofindices = std::vector<int>());
 
     virtual void SetJointValues(const std::vector<dReal>& values, bool checklimits = true) {
@@ -1943,6 +1945,31 @@ private:
     /// \param adjacentoptions a bitmask of \ref AdjacentOptions values
     virtual const std::set<int>& GetNonAdjacentLinks(int adjacentoptions=0) const;
 
+    /// \brief flat version of the non-adjacent link pairs with a bitmask over all link pairs for constant time membership tests.
+    class OPENRAVE_API NonAdjacentLinkPairs
+    {
+public:
+        NonAdjacentLinkPairs() : _nLinks(0), _nStamp(-1) {
+        }
+
+        /// \brief true if the link pair is in _vpairs, the order of the indices does not matter
+        inline bool IsNonAdjacent(int linkindex0, int linkindex1) const {
+            size_t bit = linkindex0 < linkindex1 ? linkindex0*_nLinks+linkindex1 : linkindex1*_nLinks+linkindex0;
+            return !!(_vmask[bit>>6] & ((uint64_t)1<<(bit&63)));
+        }
+
+        std::vector<int> _vpairs; ///< same pairs as \ref GetNonAdjacentLinks, i|(j<<16) where i<j
+        std::vector<uint64_t> _vmask; ///< bit i*_nLinks+j is set if i|(j<<16) is in _vpairs
+        int _nLinks; ///< number of links of the body when the mask was built
+        int _nStamp; ///< changes every time the pairs are recomputed, can be used by collision checkers to cache data derived from the pairs
+    };
+
+    /// \brief same as \ref GetNonAdjacentLinks except the pairs are returned as a flat array with a bitmask.
+    ///
+    /// The arrays are only rebuilt when the non-adjacent links are recomputed.
+    /// \param adjacentoptions a bitmask of \ref AdjacentOptions values
+    virtual const NonAdjacentLinkPairs& GetNonAdjacentLinkPairs(int adjacentoptions=0) const;
+
     /// \brief return all possible link pairs whose collisions are ignored.
     virtual const std::set<int>& GetAdjacentLinks() const;
 
@@ -1978,6 +2005,27 @@ private:
     /// \param properties a mask of the \ref KinBodyProperty values that the callback should be called for when they change
     virtual UserDataPtr RegisterChangeCallback(uint32_t properties, const boost::function<void()>& callback) const;
 
+    /** \brief Register a callback that is called the first time the update stamp changes after the callbacks were armed.
+
+        Collision checkers and physics engines can use it to keep a queue of the bodies that need to be synchronized
+        instead of comparing the stamps of every body in the environment. The callbacks are armed when registered and
+        by \ref ArmUpdateStampCallbacks. When the stamp changes, all the callbacks are called once and disarmed, so
+        a SetDOFValues call moving many links calls them at most once. Since the callback can be called from
+        within low-level calls like Link::SetTransform, it should be cheap, only record the body, and never modify it.
+        \return the handle of the callback, the callback is unregistered when the handle is destroyed
+     */
+    virtual UserDataPtr RegisterUpdateStampCallback(const boost::function<void()>& callback) const;
+
+    /// \brief Arms the update stamp callbacks so they are called on the next change of the update stamp.
+    ///
+    /// Should be called by the users of \ref RegisterUpdateStampCallback right before they read the state of the body.
+    virtual void ArmUpdateStampCallbacks() const {
+        if( _bHasUpdateStampCallbacks && !_bUpdateStampCallbacksArmed ) {
+            boost::unique_lock< boost::shared_mutex > lock(GetInterfaceMutex());
+            _bUpdateStampCallbacksArmed = !_listRegisteredUpdateStampCallbacks.empty();
+        }
+    }
+
     void Serialize(BaseXMLWriterPtr writer, int options=0) const;
 
     /// \brief A md5 hash unique to the particular kinematic and geometric structure of a KinBody.
@@ -2094,6 +2142,17 @@ protected:
     /// \brief resets cached information dependent on the collision checker (usually called when the collision checker is switched or some big mode is set.
     virtual void _ResetInternalCollisionCache();
 
+    /// \brief increments the update stamp and calls the update stamp callbacks if they are armed
+    inline void _IncrementUpdateStamp() const {
+        ++_nUpdateStampId;
+        if( _bUpdateStampCallbacksArmed ) {
+            _CallUpdateStampCallbacks();
+        }
+    }
+
+    /// \brief disarms and calls all the update stamp callbacks
+    virtual void _CallUpdateStampCallbacks() const;
+
     std::string _name; ///< name of body
     std::vector<JointPtr> _vecjoints; ///< \see GetJoints
     std::vector<JointPtr> _vTopologicallySortedJoints; ///< \see GetDependencyOrderedJoints
@@ -2112,24 +2171,63 @@ protected:
     std::vector< std::pair<std::string, std::string> > _vForcedAdjacentLinks; ///< internally stores forced adjacent links
     std::list<KinBodyWeakPtr> _listAttachedBodies; ///< list of bodies that are directly attached to this body (can have duplicates)
 
+    mutable std::list<UserDataWeakPtr> _listRegisteredUpdateStampCallbacks; ///< \see RegisterUpdateStampCallback
     mutable std::vector<std::list<UserDataWeakPtr> > _vlistRegisteredCallbacks; ///< callbacks to call when particular properties of the body change. _vlistRegisteredCallbacks[index] is the list of change callbacks where 1<<index is part of KinBodyProperty, this makes it easy to find out if any particular bits have callbacks. The registration/de-registration of the lists can happen at any point and does not modify the kinbody state exposed to the user, hence it is mutable.
 
     mutable boost::array<std::set<int>, 4> _setNonAdjacentLinks; ///< contains cached versions of the non-adjacent links depending on values in AdjacentOptions. Declared as mutable since data is cached.
+    mutable boost::array<NonAdjacentLinkPairs, 4> _vNonAdjacentLinkPairs; ///< flat versions of _setNonAdjacentLinks, see \ref GetNonAdjacentLinkPairs. Declared as mutable since data is cached.
+    mutable int _nNonAdjacentLinkStamp; ///< incremented every time any of _setNonAdjacentLinks is recomputed. Declared as mutable since data is cached.
     mutable int _nNonAdjacentLinkCache; ///< specifies what information is currently valid in the AdjacentOptions.  Declared as mutable since data is cached. If 0x80000000 (ie < 0), then everything needs to be recomputed including _setNonAdjacentLinks[0].
     std::vector<Transform> _vInitialLinkTransformations; ///< the initial transformations of each link specifying at least one pose where the robot is collision free
 
     ConfigurationSpecification _spec;
     CollisionCheckerBasePtr _selfcollisionchecker; ///< optional checker to use for self-collisions
 
+    /// \brief temporaries of the recursive newton euler computations, kept so that inverse dynamics does not allocate on every call
+    struct InverseDynamicsCache
+    {
+        std::vector<dReal> vDOFVelocities;
+        std::vector<std::pair<Vector,Vector> > vLinkVelocities, vLinkAccelerations, vLinkForceTorques;
+        std::vector<Vector> vLinkCOMLinearAccelerations, vLinkCOMMomentOfInertia;
+        std::vector<dReal> vLinkMasses; ///< mass of every link
+        std::vector<Vector> vLinkGlobalCOMs; ///< center of mass of every link in the global frame for the current link transforms
+        std::vector<TransformMatrix> vLinkGlobalInertias; ///< inertia of every link around its center of mass in the global frame
+        AccelerationMap externalaccelerations; ///< only holds the base link acceleration (-gravity)
+        std::vector<std::pair<int,dReal> > vpartials;
+    };
+
+    /// \brief temporaries of _ComputeLinkAccelerations
+    struct LinkAccelerationsCache
+    {
+        std::vector<dReal> vtempvalues, veval;
+        std::vector< std::vector<dReal> > vPassiveJointVelocities, vPassiveJointAccelerations;
+        std::vector<uint8_t> vlinkscomputed;
+    };
+
+    // Declared as mutable since they only hold temporaries of const functions. The const functions can be called by
+    // several threads at once, so a call only uses the buffers if it can lock their mutex without waiting, otherwise it
+    // uses buffers of its own.
+    mutable InverseDynamicsCache _inversedynamicscache;
+    mutable LinkAccelerationsCache _linkaccelerationscache;
+    mutable boost::mutex _mutexInverseDynamicsCache, _mutexLinkAccelerationsCache;
+
     int _environmentid; ///< \see GetEnvironmentId
     mutable int _nUpdateStampId; ///< \see GetUpdateStamp
+    // both flags are only changed while holding the interface mutex, but read without it on every stamp change
+#if BOOST_VERSION >= 105300
+    mutable boost::atomic<bool> _bHasUpdateStampCallbacks; ///< true if _listRegisteredUpdateStampCallbacks is not empty
+    mutable boost::atomic<bool> _bUpdateStampCallbacksArmed; ///< true if the update stamp callbacks have to be called on the next stamp change, see \ref ArmUpdateStampCallbacks
+#else
+    mutable volatile bool _bHasUpdateStampCallbacks;
+    mutable volatile bool _bUpdateStampCallbacksArmed;
+#endif
     uint32_t _nParametersChanged; ///< set of parameters that changed and need callbacks
     ManageDataPtr _pManageData;
     uint32_t _nHierarchyComputed; ///< true if the joint heirarchy and other cached information is computed
     bool _bMakeJoinedLinksAdjacent;
 private:
     mutable std::string __hashkinematics;
-    mutable std::vector<dReal> _vTempJoints;
+    mutable std::vector<dReal> _vTempJoints, _vTempPrevJoints;
     virtual const char* GetHash() const {
         return OPENRAVE_KINBODY_HASH;
     }
@@ -2156,6 +2254,7 @@ private:
     friend class SensorSystemBase;
     friend class RaveDatabase;
     friend class ChangeCallbackData;
+    friend class UpdateStampCallbackData;
 };
 
 } // end namespace OpenRAVE
@@ -66,6 +66,9 @@
 
 #include <boost/version.hpp>
 #include <boost/function.hpp>
+#if BOOST_VERSION >= 105300
+#include <boost/atomic.hpp>
+#endif
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -357,6 +360,28 @@ OPENRAVE_API void RaveSetDebugLevel(int level);
 /// Returns the openrave debug level
 OPENRAVE_API int RaveGetDebugLevel();
 
+#define OPENRAVELEVEL_FATALLEVEL 0
+#define OPENRAVELEVEL_ERRORLEVEL 1
+#define OPENRAVELEVEL_WARNLEVEL 2
+#define OPENRAVELEVEL_INFOLEVEL 3
+#define OPENRAVELEVEL_DEBUGLEVEL 4
+#define OPENRAVELEVEL_VERBOSELEVEL 5
+
+/// \brief true if the log messages are queued for the logging thread instead of printed, see \ref RaveSetAsyncLogging
+OPENRAVE_API bool RaveIsAsyncLogging();
+
+/// \brief Sets the source location of the next message logged by the calling thread. Used by \ref RAVEPRINTHEADER when logging asynchronously, always returns 1.
+OPENRAVE_API int RaveSetLogSource(const char* pfilename, int line, const char* pfunction);
+
+/// \brief Queues a message for the logging thread. Returns the size of the message.
+OPENRAVE_API int RaveLogAsync(uint32_t level, const std::string& s);
+
+/// \brief Formats a printf style message on the calling thread and queues it for the logging thread.
+OPENRAVE_API int RaveLogAsyncV(uint32_t level, const char* fmt, va_list list);
+
+/// \brief Formats a wide printf style message on the calling thread and queues it for the logging thread.
+OPENRAVE_API int RaveLogAsyncW(uint32_t level, const wchar_t* fmt, va_list list);
+
 /// extracts only the filename
 inline const char* RaveGetSourceFilename(const char* pfilename)
 {
@@ -380,7 +405,7 @@ inline const char* RaveGetSourceFilename(const char* pfilename)
         /*ChangeTextColor (stdout, 0, OPENRAVECOLOR##LEVEL);*/ \
         va_list list; \
         va_start(list,fmt); \
-        int r = vwprintf(OpenRAVE::RavePrintTransformString(fmt).c_str(), list); \
+        int r = OpenRAVE::RaveIsAsyncLogging() ? OpenRAVE::RaveLogAsyncW(OPENRAVELEVEL ## LEVEL, fmt, list) : vwprintf(OpenRAVE::RavePrintTransformString(fmt).c_str(), list); \
         va_end(list); \
         /*ResetTextColor (stdout);*/ \
         return r; \
@@ -389,6 +414,9 @@ inline const char* RaveGetSourceFilename(const char* pfilename)
 #define DefineRavePrintfA(LEVEL) \
     inline int RavePrintfA ## LEVEL(const std::string& s) \
     { \
+        if( OpenRAVE::RaveIsAsyncLogging() ) { \
+            return OpenRAVE::RaveLogAsync(OPENRAVELEVEL ## LEVEL, s); \
+        } \
         if((s.size() == 0)||(s[s.size()-1] != '\n')) {  \
             printf("%s\n", s.c_str()); \
         } \
@@ -403,7 +431,7 @@ inline const char* RaveGetSourceFilename(const char* pfilename)
         /*ChangeTextColor (stdout, 0, OPENRAVECOLOR##LEVEL);*/ \
         va_list list; \
         va_start(list,fmt); \
-        int r = vprintf(fmt, list); \
+        int r = OpenRAVE::RaveIsAsyncLogging() ? OpenRAVE::RaveLogAsyncV(OPENRAVELEVEL ## LEVEL, fmt, list) : vprintf(fmt, list); \
         va_end(list); \
         /*if( fmt[0] != '\n' ) { printf("\n"); }*/  \
         /*ResetTextColor(stdout);*/ \
@@ -412,6 +440,9 @@ inline const char* RaveGetSourceFilename(const char* pfilename)
 
 inline int RavePrintfA(const std::string& s, uint32_t level)
 {
+    if( RaveIsAsyncLogging() ) {
+        return RaveLogAsync(level, s);
+    }
     if((s.size() == 0)||(s[s.size()-1] != '\n')) { // automatically add a new line
         printf("%s\n", s.c_str());
     }
@@ -431,6 +462,11 @@ DefineRavePrintfA(_INFOLEVEL)
     { \
         va_list list; \
         va_start(list,wfmt); \
+        if( OpenRAVE::RaveIsAsyncLogging() ) { \
+            int r = OpenRAVE::RaveLogAsyncW(OPENRAVELEVEL ## LEVEL, wfmt, list); \
+            va_end(list); \
+            return r; \
+        } \
         /* Allocate memory on the stack to avoid heap fragmentation */ \
         size_t allocsize = wcstombs(NULL, wfmt, 0)+32; \
         char* fmt = (char*)alloca(allocsize); \
@@ -448,6 +484,9 @@ DefineRavePrintfA(_INFOLEVEL)
 // for them.
 inline int RavePrintfA_INFOLEVEL(const std::string& s)
 {
+    if( RaveIsAsyncLogging() ) {
+        return RaveLogAsync(Level_Info, s);
+    }
     if((s.size() == 0)||(s[s.size()-1] != '\n')) {     // automatically add a new line
         printf("%s\n", s.c_str());
     }
@@ -461,7 +500,7 @@ inline int RavePrintfA_INFOLEVEL(const char *fmt, ...)
 {
     va_list list;
     va_start(list,fmt);
-    int r = vprintf(fmt, list);
+    int r = RaveIsAsyncLogging() ? RaveLogAsyncV(Level_Info, fmt, list) : vprintf(fmt, list);
     va_end(list);
     //if( fmt[0] != '\n' ) { printf("\n"); }
     return r;
@@ -470,6 +509,9 @@ inline int RavePrintfA_INFOLEVEL(const char *fmt, ...)
 #define DefineRavePrintfA(LEVEL) \
     inline int RavePrintfA ## LEVEL(const std::string& s) \
     { \
+        if( OpenRAVE::RaveIsAsyncLogging() ) { \
+            return OpenRAVE::RaveLogAsync(OPENRAVELEVEL ## LEVEL, s); \
+        } \
         if((s.size() == 0)||(s[s.size()-1] != '\n')) { \
             printf ("%c[0;%d;%dm%s%c[m\n", 0x1B, OPENRAVECOLOR ## LEVEL + 30,8+40,s.c_str(),0x1B); \
         } \
@@ -483,7 +525,7 @@ inline int RavePrintfA_INFOLEVEL(const char *fmt, ...)
     { \
         va_list list; \
         va_start(list,fmt); \
-        int r = vprintf((ChangeTextColor(0, OPENRAVECOLOR ## LEVEL,8) + std::string(fmt) + ResetTextColor()).c_str(), list); \
+        int r = OpenRAVE::RaveIsAsyncLogging() ? OpenRAVE::RaveLogAsyncV(OPENRAVELEVEL ## LEVEL, fmt, list) : vprintf((ChangeTextColor(0, OPENRAVECOLOR ## LEVEL,8) + std::string(fmt) + ResetTextColor()).c_str(), list); \
         va_end(list); \
         /*if( fmt[0] != '\n' ) { printf("\n"); } */ \
         return r; \
@@ -493,6 +535,9 @@ inline int RavePrintfA_INFOLEVEL(const char *fmt, ...)
 inline int RavePrintfA(const std::string& s, uint32_t level)
 {
     if( (OpenRAVE::RaveGetDebugLevel()&OpenRAVE::Level_OutputMask)>=level ) {
+        if( RaveIsAsyncLogging() ) {
+            return RaveLogAsync(level, s);
+        }
         int color = 0;
         switch(level) {
         case Level_Fatal: color = OPENRAVECOLOR_FATALLEVEL; break;
@@ -536,7 +581,8 @@ DefineRavePrintfA(_WARNLEVEL)
 DefineRavePrintfA(_DEBUGLEVEL)
 DefineRavePrintfA(_VERBOSELEVEL)
 
-#define RAVEPRINTHEADER(LEVEL) OpenRAVE::RavePrintfA ## LEVEL("[%s:%d %s] ", OpenRAVE::RaveGetSourceFilename(__FILE__), __LINE__,  __FUNCTION__)
+/// when logging asynchronously the header is not printed, instead the source location is attached to the next message of the thread
+#define RAVEPRINTHEADER(LEVEL) (OpenRAVE::RaveIsAsyncLogging() ? OpenRAVE::RaveSetLogSource(__FILE__, __LINE__, __FUNCTION__) : OpenRAVE::RavePrintfA ## LEVEL("[%s:%d %s] ", OpenRAVE::RaveGetSourceFilename(__FILE__), __LINE__,  __FUNCTION__))
 
 // different logging levels. The higher the suffix number, the less important the information is.
 // 0 log level logs all the time. OpenRAVE starts up with a log level of 0.
@@ -1315,6 +1361,42 @@ protected:
      */
     static void ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification& targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification& sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized = true);
 
+    /** \brief A \ref ConvertData conversion between two specifications compiled into flat index copies.
+
+        Compiling parses the group names and finds the compatible groups once, so callers converting many points
+        between the same specifications should keep the plan around. Applying the plan is a copy loop. Groups whose
+        values need the environment (defaults taken from the current body state) or a rotation conversion are still
+        converted with \ref ConvertGroupData on every call.
+     */
+    class OPENRAVE_API ConversionPlan
+    {
+public:
+        ConversionPlan();
+        ConversionPlan(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, bool filluninitialized = true);
+
+        /// \brief true if the plan was compiled for the same specifications and options
+        bool IsCompiledFor(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, bool filluninitialized = true) const;
+
+        /// \brief Converts the points, same as \ref ConvertData with the specifications of the plan.
+        void Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints, EnvironmentBaseConstPtr penv) const;
+
+private:
+        /// copies count consecutive values
+        struct CopyRun
+        {
+            int targetoffset, sourceoffset, count;
+        };
+
+        void _AddCopy(int targetoffset, int sourceoffset);
+
+        std::vector<Group> _vtargetgroups, _vsourcegroups; ///< the groups of the compiled specifications
+        int _targetdof, _sourcedof;
+        bool _bFillUninitialized;
+        std::vector<CopyRun> _vcopyruns;
+        std::vector< std::pair<int, dReal> > _vconstants; ///< target offset and the value written to it
+        std::vector< std::pair<int, int> > _vdynamicgroups; ///< target and source group indices converted at every call, the source index is -1 if the target group is filled with defaults
+    };
+
     /// \brief gets the name of the interpolation that represents the derivative of the passed in interpolation.
     ///
     /// For example GetInterpolationDerivative("quadratic") -> "linear"
@@ -2783,6 +2865,189 @@ OPENRAVE_API void RaveSetDataAccess(int accessoptions);
 /// \see RaveSetDataAccess
 OPENRAVE_API int RaveGetDataAccess();
 
+/// \brief the hot APIs that are timed when performance counters are enabled, see \ref RaveSetPerformanceCounters
+enum PerformanceCounterType
+{
+    PCT_CheckCollision=0, ///< EnvironmentBase::CheckCollision between bodies and links
+    PCT_CheckCollisionRay=1, ///< EnvironmentBase::CheckCollision with rays
+    PCT_CheckSelfCollision=2, ///< KinBody::CheckSelfCollision and EnvironmentBase::CheckStandaloneSelfCollision
+    PCT_SetDOFValues=3, ///< KinBody::SetDOFValues
+    PCT_IkSolve=4, ///< IkSolverBase::Solve calls made by RobotBase::Manipulator::FindIKSolution(s)
+    PCT_PlannerCallbacks=5, ///< PlannerBase::_CallCallbacks, called by the planners once per iteration. Only the time spent in the user callbacks is counted, not the planning itself.
+    PCT_TrajectorySample=6, ///< TrajectoryBase::Sample of the default trajectory
+    PCT_NumCounters=7,
+};
+
+/** \brief Enables or disables the performance counters. <b>[multi-thread safe]</b>
+
+    The counters are global to the process and are disabled by default. When disabled each hot API only pays one
+    branch. When enabled every call is timed and added to a block owned by the calling thread, so threads never
+    contend with each other. The blocks are summed when the counters are queried.
+ */
+OPENRAVE_API void RaveSetPerformanceCounters(bool bEnable);
+
+/// \brief true if the performance counters are enabled
+OPENRAVE_API bool RaveIsPerformanceCountersEnabled();
+
+/// \brief Sets all performance counters to zero. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveResetPerformanceCounters();
+
+/// \brief Returns the number of calls and the total time in nanoseconds of each counter summed over all threads. <b>[multi-thread safe]</b>
+///
+/// Both vectors are indexed by \ref PerformanceCounterType.
+OPENRAVE_API void RaveGetPerformanceCounters(std::vector<uint64_t>& vcalls, std::vector<uint64_t>& vnanoseconds);
+
+/// \brief Writes one line per counter with the name, the number of calls, the total time and the mean time. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveWritePerformanceCounters(std::ostream& os);
+
+/// \brief Returns the name of the counter, same as the API it times.
+OPENRAVE_API const char* RaveGetPerformanceCounterName(PerformanceCounterType type);
+
+/// \brief Adds the time between construction and destruction to a performance counter if the counters are enabled.
+class OPENRAVE_API PerformanceCounterTimer
+{
+public:
+    PerformanceCounterTimer(PerformanceCounterType type);
+    ~PerformanceCounterTimer();
+
+private:
+    uint64_t _starttime; ///< 0 if the counters were disabled at construction
+    PerformanceCounterType _type;
+};
+
+/** \brief Enables or disables the recording of the scoped trace points, see \ref RAVE_TRACE_SCOPE. <b>[multi-thread safe]</b>
+
+    Every thread records the scopes it leaves in its own ring buffer, which keeps the last neventsperthread events.
+    The trace points are only compiled when OPENRAVE_TRACING is 1, which is controlled by the OPT_TRACING cmake option.
+    \param neventsperthread the size of the ring buffers created after this call
+ */
+OPENRAVE_API void RaveSetTracing(bool bEnable, int neventsperthread=65536);
+
+/// \brief true if the trace points are recorded
+OPENRAVE_API bool RaveIsTracingEnabled();
+
+/// \brief Removes all recorded trace events. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveClearTrace();
+
+/// \brief Writes the recorded events of all threads as a Chrome trace-event JSON object that can be loaded by chrome://tracing. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveWriteChromeTrace(std::ostream& os);
+
+/// \brief Records the time between construction and destruction as a trace event of the calling thread if tracing is enabled.
+class OPENRAVE_API TraceScope
+{
+public:
+    /// \param name the name of the event. Only the pointer is stored, so it has to be a string literal.
+    TraceScope(const char* name);
+    ~TraceScope();
+
+private:
+    const char* _name;
+    uint64_t _starttime; ///< 0 if tracing was disabled at construction
+};
+
+#if OPENRAVE_TRACING
+#define RAVE_TRACE_CONCAT2(a,b) a ## b
+#define RAVE_TRACE_CONCAT(a,b) RAVE_TRACE_CONCAT2(a,b)
+/// \brief Records the enclosing scope as a trace event named by the string literal, see \ref RaveSetTracing
+#define RAVE_TRACE_SCOPE(name) OpenRAVE::TraceScope RAVE_TRACE_CONCAT(__ravetracescope,__LINE__)(name)
+#else
+#define RAVE_TRACE_SCOPE(name)
+#endif
+
+/// \brief a message logged asynchronously, see \ref RaveSetAsyncLogging
+class OPENRAVE_API LogRecord
+{
+public:
+    LogRecord() : level(0), timestamp(0), threadid(0), line(0) {
+    }
+
+    uint32_t level; ///< \ref DebugLevel of the message
+    uint64_t timestamp; ///< time the message was logged in nanoseconds, see \ref utils::GetNanoPerformanceTime
+    int threadid; ///< index of the thread that logged the message, starting at 1
+    std::string sourcefilename; ///< filename of the log statement without the directory, empty if unknown
+    int line; ///< line of the log statement
+    std::string function; ///< function of the log statement
+    std::string message;
+};
+
+/// \brief Receives the messages drained by the logging thread. Write and Flush are only called by one thread at a time.
+class OPENRAVE_API LogSink
+{
+public:
+    virtual ~LogSink() {
+    }
+
+    virtual void Write(const LogRecord& record) = 0;
+
+    /// \brief called by \ref RaveFlushLog after all the queued messages have been written
+    virtual void Flush() {
+    }
+};
+
+typedef boost::shared_ptr<LogSink> LogSinkPtr;
+
+/// \brief Keeps the last messages in memory. <b>[multi-thread safe]</b>
+class OPENRAVE_API MemoryLogSink : public LogSink
+{
+public:
+    /// \param maxrecords the number of messages kept, the oldest message is removed first
+    MemoryLogSink(size_t maxrecords);
+    virtual ~MemoryLogSink();
+
+    virtual void Write(const LogRecord& record);
+
+    /// \brief returns the kept messages from the oldest to the newest
+    virtual void GetRecords(std::list<LogRecord>& listrecords) const;
+
+    virtual void Clear();
+
+private:
+    mutable boost::mutex _mutex;
+    std::list<LogRecord> _listrecords;
+    size_t _maxrecords;
+};
+
+/** \brief Enables or disables asynchronous logging. <b>[multi-thread safe]</b>
+
+    When enabled, the RAVELOG_* macros still check the debug level first, so disabled levels do not format anything.
+    Enabled levels format the message on the calling thread and push it to a queue owned by that thread without
+    printing, without taking any lock when boost::atomic is available. A logging thread drains the queues of all threads
+    every few milliseconds, backing off to 100ms while nothing is logged, and writes the messages ordered by time to the
+    sinks added with \ref RaveAddLogSink, or to stdout if there are none. Errors and queues filling up wake the logging
+    thread right away. If a thread logs faster than the queues are drained, the messages that do not fit are dropped
+    and counted.
+
+    Disabling the logging waits for the logging thread to write all queued messages.
+    \param nrepeatlimit the maximum number of messages written per second from the same log statement, the rest are counted and reported as one message. 0 writes all messages.
+    \param nrecordsperthread the maximum number of messages waiting in the queue of each thread. The queue of a thread is allocated when it first logs, so the value only applies to threads that have not logged yet.
+ */
+OPENRAVE_API void RaveSetAsyncLogging(bool bEnable, int nrepeatlimit=0, int nrecordsperthread=4096);
+
+/// \brief Adds a sink that receives all the messages written by the logging thread. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveAddLogSink(LogSinkPtr psink);
+
+/// \brief Removes a sink added with \ref RaveAddLogSink. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveRemoveLogSink(LogSinkPtr psink);
+
+/// \brief Removes all the sinks, the messages are then written to stdout. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveClearLogSinks();
+
+/// \brief Returns the added sinks. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveGetLogSinks(std::list<LogSinkPtr>& listsinks);
+
+/// \brief Writes all the messages queued until now to the sinks and flushes them. <b>[multi-thread safe]</b>
+OPENRAVE_API void RaveFlushLog();
+
+/// \brief Writes the message as one line with the level, the source location, and the message.
+OPENRAVE_API void RaveWriteLogRecord(std::ostream& os, const LogRecord& record);
+
+/// \brief Creates a sink that appends one line per message to a file.
+OPENRAVE_API LogSinkPtr RaveCreateFileLogSink(const std::string& filename);
+
+/// \brief Creates a sink that sends the messages to the system logger with the equivalent priority. Uses stderr if there is no system logger.
+/// \param ident the program name prepended to every message by the system logger
+OPENRAVE_API LogSinkPtr RaveCreateSyslogLogSink(const std::string& ident);
+
 //@}
 
 /// \deprecated (11/06/03), use \ref SpaceSamplerBase
@@ -37,6 +37,7 @@ enum ConstraintFilterOptions
     CFO_CheckWithPerturbation=0x00010000, ///< when checking collisions, perturbs all the joint values a little and checks again. This forces the line to be away from grazing collisions.
     CFO_FillCheckedConfiguration=0x00020000, ///< if set, will fill \ref ConstraintFilterReturn::_configurations and \ref ConstraintFilterReturn::_configurationtimes
     CFO_FillCollisionReport=0x00040000, ///< if set, will fill \ref ConstraintFilterReturn::_report if in environment or self-collision
+    CFO_CheckContinuousCollisions=0x00080000, ///< if set, straight-line segments are validated with conservative advancement on the distances returned by the collision checker instead of at every resolution step. Needs a checker supporting CO_Distance.
     CFO_StateSettingError=0x80000000, ///< error when the state setting function (or neighbor function) breaks
     CFO_RecommendedOptions = 0x0000ffff, ///< recommended options that all plugins should use by default
 };
@@ -465,6 +466,8 @@ private:
 public:
         PlannerProgress();
         int _iteration;
+        std::string _stage; ///< name of the stage the planner just finished, empty if the planner does not report stages
+        dReal _stageduration; ///< seconds spent in _stage
     };
 
     PlannerBase(EnvironmentBasePtr penv);
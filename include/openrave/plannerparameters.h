@@ -264,7 +264,7 @@ protected:
 class OPENRAVE_API GraspParameters : public PlannerBase::PlannerParameters
 {
 public:
-    GraspParameters(EnvironmentBasePtr penv) : PlannerBase::PlannerParameters(), fstandoff(0), ftargetroll(0), vtargetdirection(0,0,1), btransformrobot(false), breturntrajectory(false), bonlycontacttarget(true), btightgrasp(false), bavoidcontact(false), fcoarsestep(0.1f), ffinestep(0.001f), ftranslationstepmult(0.1f), fgraspingnoise(0), _penv(penv) {
+    GraspParameters(EnvironmentBasePtr penv) : PlannerBase::PlannerParameters(), fstandoff(0), ftargetroll(0), vtargetdirection(0,0,1), btransformrobot(false), breturntrajectory(false), bonlycontacttarget(true), btightgrasp(false), bavoidcontact(false), fcoarsestep(0.1f), ffinestep(0.001f), ftranslationstepmult(0.1f), fgraspingnoise(0), bconservativeadvancement(false), _penv(penv) {
         _vXMLParameters.push_back("fstandoff");
         _vXMLParameters.push_back("targetbody");
         _vXMLParameters.push_back("ftargetroll");
@@ -282,6 +282,7 @@ public:
         _vXMLParameters.push_back("ftranslationstepmult");
         _vXMLParameters.push_back("fgraspingnoise");
         _vXMLParameters.push_back("vintersectplane");
+        _vXMLParameters.push_back("bconservativeadvancement");
         _bProcessingGrasp = false;
     }
 
@@ -303,6 +304,7 @@ public:
     dReal ftranslationstepmult;     ///< multiplication factor for translational movements of the hand or joints
     dReal fgraspingnoise;     ///< random undeterministic noise to add to the target object, represents the max possible displacement of any point on the object (noise added after global direction and start have been determined)
     Vector vintersectplane; ///< if norm > 0, then the manipulator transform has to be on the plane for grabbing to work. This is mutually exclusive from the standoff.
+    bool bconservativeadvancement; ///< if true, the coarse steps are lengthened to the largest step that cannot bring the moving links into contact, computed from the clearance given by the collision checker's CO_Distance option.
 
 protected:
     EnvironmentBasePtr _penv;     ///< environment target belongs to
@@ -334,6 +336,7 @@ protected:
         O << "<ftranslationstepmult>" << ftranslationstepmult << "</ftranslationstepmult>" << std::endl;
         O << "<fgraspingnoise>" << fgraspingnoise << "</fgraspingnoise>" << std::endl;
         O << "<vintersectplane>" << vintersectplane << "</vintersectplane>" << std::endl;
+        O << "<bconservativeadvancement>" << bconservativeadvancement << "</bconservativeadvancement>" << std::endl;
         if( !(options & 1) ) {
             O << _sExtraParameters << std::endl;
         }
@@ -355,7 +358,7 @@ protected:
             return PE_Support;
         }
 
-        static boost::array<std::string,17> tags = {{"fstandoff","targetbody","ftargetroll","vtargetdirection","vtargetposition","vmanipulatordirection", "btransformrobot","breturntrajectory","bonlycontacttarget","btightgrasp","bavoidcontact","vavoidlinkgeometry","fcoarsestep","ffinestep","ftranslationstepmult","fgraspingnoise","vintersectplane"}};
+        static boost::array<std::string,18> tags = {{"fstandoff","targetbody","ftargetroll","vtargetdirection","vtargetposition","vmanipulatordirection", "btransformrobot","breturntrajectory","bonlycontacttarget","btightgrasp","bavoidcontact","vavoidlinkgeometry","fcoarsestep","ffinestep","ftranslationstepmult","fgraspingnoise","vintersectplane","bconservativeadvancement"}};
         _bProcessingGrasp = find(tags.begin(),tags.end(),name) != tags.end();
         return _bProcessingGrasp ? PE_Support : PE_Pass;
     }
@@ -419,6 +422,9 @@ protected:
             else if( name == "vintersectplane" ) {
                 _ss >> vintersectplane;
             }
+            else if( name == "bconservativeadvancement" ) {
+                _ss >> bconservativeadvancement;
+            }
             else {
                 RAVELOG_WARN(str(boost::format("unknown tag %s\n")%name));
             }
@@ -692,6 +698,8 @@ public:
     dReal ignorefirstcollisionee;     ///< if > 0, will allow the manipulator end effector to be in environment collision for the initial 'ignorefirstcollisionee' seconds of the trajectory. similar to 'ignorefirstcollision'
     dReal ignorelastcollisionee; /// if > 0, will allow the manipulator end effector to get into collision with the environment for the last 'ignorelastcollisionee' seconds of the trajrectory. The kinematics, self collisions, and environment collisions with the other parts of the robot will still be checked
     dReal minimumcompletetime;     ///< specifies the minimum trajectory that must be followed for planner to declare success. If 0, then the entire trajectory has to be followed.
+    int numthreads; ///< if > 0, all end effector poses are checked for collisions in batches by numthreads threads before tracking. If 0, poses are checked one by one.
+    bool predictiksolution; ///< if true, the ik of every pose is started from the jacobian prediction of the previous solution
     TrajectoryBasePtr workspacetraj;     ///< workspace trajectory
 
 protected:
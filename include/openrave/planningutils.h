@@ -204,6 +204,74 @@ protected:
 
 typedef boost::shared_ptr<ActiveDOFTrajectoryRetimer> ActiveDOFTrajectoryRetimerPtr;
 
+/** \brief Retimes or smooths batches of trajectories of the currently set active dofs of the robot on several threads. <b>[multi-thread safe]</b>
+
+    Keeps a pool with one initialized planner for every thread so PlanPaths can be called multiple times without creating new objects.
+    The retimers of the rplanners plugin do not check collisions or set the robot state, so all threads share the environment of the robot
+    when one of them is used. Smoothers and any other planner can set the robot state, so every thread except the calling one plans in its
+    own clone of the environment, which is synchronized at the start of every PlanPaths call.
+ */
+class OPENRAVE_API ActiveDOFTrajectoryBatchPlanner
+{
+public:
+    /**
+       \param robot use the robot's active dofs to initialize the trajectory space
+       \param numthreads the number of threads that plan, including the calling thread
+       \param bsmooth if true, smooths the trajectories while avoiding collisions, otherwise only retimes them
+       \param plannername the name of the planner to use. If empty, will use the default smoother or trajectory re-timer.
+       \param plannerparameters XML string to be appended to PlannerBase::PlannerParameters::_sExtraParameters passed in to the planner.
+     **/
+    ActiveDOFTrajectoryBatchPlanner(RobotBasePtr robot, int numthreads, bool bsmooth=false, const std::string& plannername="", const std::string& plannerparameters="");
+    virtual ~ActiveDOFTrajectoryBatchPlanner();
+
+    /// \brief Plans all the trajectories. <b>[multi-thread safe]</b>
+    ///
+    /// \param vtrajectories the trajectories in the environment of the robot that initially contain the input points, they are modified to contain the new timed data.
+    /// \param vstatuses filled with the PlannerStatus of every trajectory. PS_Failed if the planner threw an exception.
+    /// \param hastimestamps if true, use the already initialized timestamps of the trajectories. Only used for retiming.
+    virtual void PlanPaths(const std::vector<TrajectoryBasePtr>& vtrajectories, std::vector<PlannerStatus>& vstatuses, bool hastimestamps=false);
+
+    virtual int GetNumThreads() const {
+        return (int)_vworkers.size();
+    }
+
+protected:
+    /// \brief the planner of one thread
+    class PlannerWorker
+    {
+public:
+        EnvironmentBasePtr penv; ///< the clone of the environment if planning on a thread other than the calling one with a planner that can set the robot state
+        RobotBasePtr probot;
+        PlannerBasePtr planner;
+        PlannerBase::PlannerParametersPtr parameters; ///< necessary because SetRobotActiveJoints builds functions that hold weak_ptr to the parameters
+        TrajectoryBasePtr ptrajclone; ///< holds the trajectories while they are planned in penv
+    };
+    typedef boost::shared_ptr<PlannerWorker> PlannerWorkerPtr;
+
+    class BatchWork;
+    typedef boost::shared_ptr<BatchWork> BatchWorkPtr;
+
+    /// \brief synchronizes the cloned environments and initializes the planners whose robot or parameters changed
+    void _InitPlanners();
+    void _InitPlanner(PlannerWorkerPtr worker, RobotBasePtr probot);
+    void _PlanWorker(PlannerWorkerPtr worker, BatchWorkPtr work);
+    void _OnRobotChanged();
+
+    RobotBasePtr _robot;
+    bool _bsmooth;
+    bool _bCloneEnvironments; ///< if true, the threads other than the calling one plan in clones of the environment
+    std::string _plannername, _plannerparameters;
+    std::vector<PlannerWorkerPtr> _vworkers;
+    std::vector<int> _vRobotActiveIndices;
+    int _nRobotAffineDOF;
+    Vector _vRobotRotationAxis;
+    bool _hastimestamps;
+    bool _bParametersChanged; ///< if true, all planners have to be initialized again
+    UserDataPtr _changehandler; ///< tracks changes for the robot and re-initializes parameters
+};
+
+typedef boost::shared_ptr<ActiveDOFTrajectoryBatchPlanner> ActiveDOFTrajectoryBatchPlannerPtr;
+
 /** \brief Retime the trajectory points consisting of affine transformation values while avoiding collisions. <b>[multi-thread safe]</b>
 
     Collision is not checked. Every waypoint in the trajectory is guaranteed to be hit.
@@ -388,6 +456,95 @@ public:
  */
 OPENRAVE_API void GetDHParameters(std::vector<DHParameter>&vparameters, KinBodyConstPtr pbody);
 
+/** \brief Cache of configuration-space edges checked by \ref DynamicsCollisionConstraint::Check
+
+    When set as the user data "edgevaliditycache" of the first body checked by a DynamicsCollisionConstraint, every
+    constraint created for that body shares the cache, so repeated planning queries in the same scene do not step
+    through identical edges again. An edge is identified by its end points, velocities, time, the check options,
+    the configuration resolution, and the full state of the checked bodies at the start of the edge. The results are
+    reused for the same or a smaller interval.
+
+    All edges are discarded as soon as any other body of the environment changes its update stamp, any link of any body
+    is enabled or disabled, the set of bodies or grabbed bodies changes, or the collision checker of the environment or
+    the self-collision checkers of the checked bodies or their options change. Geometry changes that do not move a body
+    are not detected, call \ref Clear in that case. The bodies are watched with update stamp and change callbacks, so
+    the environment is only scanned again after one of them was called.
+ */
+class OPENRAVE_API EdgeValidityCache : public UserData
+{
+public:
+    /// \param maxedges the maximum number of edges stored, the cache is cleared when it is full
+    EdgeValidityCache(size_t maxedges=100000);
+    virtual ~EdgeValidityCache() {
+        _listcallbackhandles.clear();
+    }
+
+    /// \brief returns the cache set on the body or an empty pointer
+    static boost::shared_ptr<EdgeValidityCache> GetBodyCache(KinBodyConstPtr pbody);
+
+    /// \brief removes all edges, the statistics are kept
+    virtual void Clear();
+
+    virtual size_t GetNumEdges() const {
+        return _mapedges.size();
+    }
+    virtual uint64_t GetNumHits() const {
+        return _nHits;
+    }
+    virtual uint64_t GetNumMisses() const {
+        return _nMisses;
+    }
+    virtual void ResetStatistics() {
+        _nHits = 0;
+        _nMisses = 0;
+    }
+
+    /// \brief clears the edges if any body besides the checked bodies and the bodies they grab moved, any link enable state, or any checker changed since the last call
+    virtual void UpdateEnvironmentState(EnvironmentBasePtr penv, const std::list<KinBodyPtr>& listCheckBodies);
+
+    /// \brief looks up an edge
+    ///
+    /// \param interval the interval that is being checked
+    /// \param bValidOnly if true, only edges that were found valid are returned
+    /// \param ret filled with the return code of Check if the edge is found
+    virtual bool Find(const std::vector<dReal>& vedgekey, IntervalType interval, bool bValidOnly, int& ret);
+
+    /// \brief stores the return code of Check for an edge
+    virtual void Insert(const std::vector<dReal>& vedgekey, IntervalType interval, int ret);
+
+protected:
+    /// \brief returns the end points checked by the interval: 1 for the start, 2 for the end
+    static int _GetIntervalMask(IntervalType interval);
+
+    /// \brief called by the body and environment callbacks, the environment is scanned on the next \ref UpdateEnvironmentState
+    virtual void _SetEnvironmentChanged();
+
+    struct EdgeResult
+    {
+        EdgeResult() : validmask(-1), invalidmask(-1), ret(0) {
+        }
+        int validmask; ///< end points covered by the largest interval found valid, -1 if never valid
+        int invalidmask; ///< end points covered by the smallest interval found invalid, -1 if never invalid
+        int ret; ///< return code of the invalid check
+    };
+
+    std::map<std::vector<dReal>, EdgeResult> _mapedges;
+    std::vector<int> _vstamps, _vnewstamps; ///< environment id, update stamp of every other body, link enable states of all bodies, and checker options
+    std::vector<uint8_t> _venablestates;
+    std::vector<CollisionCheckerBaseWeakPtr> _vcheckers; ///< the checkers the edges were checked with
+    std::vector<CollisionCheckerBasePtr> _vnewcheckers;
+    std::vector<KinBodyPtr> _vbodies, _vgrabbed;
+    std::vector<int> _vcheckstamps, _vnewcheckstamps; ///< environment ids of the checked bodies and checker options, compared on every call
+    EnvironmentBaseWeakPtr _penv; ///< the environment the callbacks are registered with
+    boost::mutex _mutexchanged; ///< protects _bEnvironmentChanged, the callbacks can be called from any thread
+    bool _bEnvironmentChanged; ///< true if the environment has to be scanned again
+    std::list<UserDataPtr> _listcallbackhandles; ///< callbacks registered by the last scan of the environment
+    size_t _maxedges;
+    uint64_t _nHits, _nMisses;
+};
+
+typedef boost::shared_ptr<EdgeValidityCache> EdgeValidityCachePtr;
+
 /** \brief dynamics and collision checking with linear interpolation
 
     For any joints with maxtorque > 0, uses KinBody::ComputeInverseDynamics to check if the necessary torque exceeds the max torque. Max torque is always called via GetMaxTorque
@@ -423,6 +580,14 @@ public:
     virtual void SetUserCheckFunction(const boost::function<bool() >& usercheckfn, bool bCallAfterCheckCollision=false);
 
     /// \brief checks line collision. Uses the constructor's self-collisions
+    ///
+    /// If the first body has an \ref EdgeValidityCache, it is consulted before stepping through the edge. The cache is not
+    /// used when the checked configurations are requested or when user check functions are set.
+    ///
+    /// If options contain \ref CFO_CheckContinuousCollisions and the segment is a straight line without velocities, the
+    /// distance to the closest obstacle and a bound on how far the bodies move are used to skip the states that cannot
+    /// be in collision. This relies on the distances of the checker, and obstacles are only found down to a small fraction
+    /// of the resolution step. Segments that cannot be advanced this way are stepped through as usual.
     virtual int Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options = 0xffff, ConstraintFilterReturnPtr filterreturn = ConstraintFilterReturnPtr());
 
     CollisionReportPtr GetReport() const {
@@ -430,6 +595,9 @@ public:
     }
 
 protected:
+    /// \brief steps through the edge without consulting the edge cache, see \ref Check
+    virtual int _Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn);
+
     /// \brief checks an already set state
     ///
     /// \param options should already be masked with _filtermask
@@ -441,8 +609,23 @@ protected:
     virtual int _SetAndCheckState(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& vdofvalues, const std::vector<dReal>& vdofvelocities, const std::vector<dReal>& vdofaccels, int options, ConstraintFilterReturnPtr filterreturn);
     virtual void _PrintOnFailure(const std::string& prefix);
 
+    /// \brief validates the straight line from q0 to q0+dQ with conservative advancement, see \ref CFO_CheckContinuousCollisions
+    ///
+    /// \param fminstep the resolution step along the line. Every advance is at least 1% of it, so obstacles thinner than that can be missed when the clearance is 0
+    /// \param options should already be masked with _filtermask
+    /// \return false if the segment cannot be advanced this way and has to be stepped through, otherwise ret is filled
+    virtual bool _CheckContinuous(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& q0, dReal fminstep, int options, ConstraintFilterReturnPtr filterreturn, int& ret);
+
+    /// \brief upper bound of how far any point of each check body moves when the configuration moves by vdelta from the current state
+    ///
+    /// \return false if the configuration is not made of joint values of the check bodies, or the bodies have mimic joints
+    virtual bool _ComputeMotionBounds(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& vdelta, std::vector<dReal>& vbounds);
+
     PlannerBase::PlannerParametersWeakPtr _parameters;
     std::vector<dReal> _vtempconfig, _vtempvelconfig, dQ, _vtempveldelta, _vtempaccelconfig, _vperturbedvalues, _vcoeff2, _vcoeff1; ///< in configuration space
+    std::vector<dReal> _vedgekey, _vbodyvalues; ///< for looking up edges in the EdgeValidityCache
+    std::vector<dReal> _vmotionbounds, _vbodydofdelta; ///< for conservative advancement
+    std::vector<AABB> _vlinkboxes; ///< for conservative advancement
     CollisionReportPtr _report;
     std::list<KinBodyPtr> _listCheckBodies;
     int _filtermask;
@@ -88,6 +88,7 @@ public:
             return ST_Camera;
         }
         std::vector<uint8_t> vimagedata;         ///< rgb image data, if camera only outputs in grayscale, fill each channel with the same value
+        std::vector<float> vdepthdata; ///< if not empty, the depth along the optical axis of every pixel in meters, 0 where nothing is visible
         virtual bool serialize(std::ostream& O) const;
     };
 
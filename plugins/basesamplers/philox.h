@@ -0,0 +1,277 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 The OpenRAVE Contributors
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef SAMPLER_PHILOX
+#define SAMPLER_PHILOX
+
+#include <openrave/openrave.h>
+#include <boost/bind.hpp>
+using namespace OpenRAVE;
+using namespace std;
+
+/** \brief Counter-based Philox4x32-10 sampler.
+
+    The n^th value of a stream is a pure function of (seed, stream, n), so workers can be given independent streams
+    from the same seed and can jump to any position of a stream in constant time. Values are generated in blocks of 4
+    and the sequence returned is independent of how many samples are requested per call.
+ */
+class PhiloxSampler : public SpaceSamplerBase
+{
+public:
+    PhiloxSampler(EnvironmentBasePtr penv,std::istream& sinput) : SpaceSamplerBase(penv), _dof(1), _stream(0), _counter(0), _bufferindex(4)
+    {
+        __description = ":Interface Author: The OpenRAVE Contributors\n\n\
+Counter-based Philox4x32-10 random sampler from Salmon et al., \"Parallel Random Numbers: As Easy as 1, 2, 3\", SC11. Every value is a function of (seed, stream, counter), which allows reproducible independent streams per thread and constant-time jump-ahead.\n\n\
+The stream index can optionally be given at creation time, ie \"Philox 3\".";
+        RegisterCommand("SetStream",boost::bind(&PhiloxSampler::_SetStreamCommand,this,_1,_2),
+                        "Sets the stream index (key) and resets the counter. All streams of the same seed are independent of each other.");
+        RegisterCommand("GetStream",boost::bind(&PhiloxSampler::_GetStreamCommand,this,_1,_2),
+                        "Returns the stream index.");
+        RegisterCommand("Skip",boost::bind(&PhiloxSampler::_SkipCommand,this,_1,_2),
+                        "Advances the stream by N uint32 values in constant time.");
+        RegisterCommand("GetCounter",boost::bind(&PhiloxSampler::_GetCounterCommand,this,_1,_2),
+                        "Returns the number of uint32 values consumed from the stream so far.");
+        RegisterCommand("SetCounter",boost::bind(&PhiloxSampler::_SetCounterCommand,this,_1,_2),
+                        "Sets the position in the stream as the number of uint32 values already consumed.");
+        uint32_t stream = 0;
+        if( !!(sinput >> stream) ) {
+            _stream = stream;
+        }
+        _key[0] = 0;
+        _key[1] = _stream;
+    }
+
+    void SetSeed(uint32_t seed) {
+        _key[0] = seed;
+        _key[1] = _stream;
+        _SetPosition(0);
+    }
+
+    void SetSpaceDOF(int dof) {
+        BOOST_ASSERT(dof > 0); _dof = dof;
+    }
+    int GetDOF() const {
+        return _dof;
+    }
+    int GetNumberOfValues() const {
+        return _dof;
+    }
+
+    bool Supports(SampleDataType type) const {
+        return true;
+    }
+
+    void GetLimits(std::vector<dReal>& vLowerLimit, std::vector<dReal>& vUpperLimit) const
+    {
+        vLowerLimit.resize(_dof);
+        vUpperLimit.resize(_dof);
+        for(int i = 0; i < _dof; ++i) {
+            vLowerLimit[i] = 0;
+            vUpperLimit[i] = 1;
+        }
+    }
+
+    void GetLimits(std::vector<uint32_t>& vLowerLimit, std::vector<uint32_t>& vUpperLimit) const
+    {
+        vLowerLimit.resize(_dof);
+        vUpperLimit.resize(_dof);
+        for(int i = 0; i < _dof; ++i) {
+            vLowerLimit[i] = 0;
+            vUpperLimit[i] = 0xffffffff;
+        }
+    }
+
+    int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
+    {
+        samples.resize(_dof*num);
+        if( samples.size() == 0 ) {
+            return (int)num;
+        }
+        dReal foffset, fmult;
+        switch(interval) {
+        case IT_Open: foffset = 0.5; fmult = 1.0/4294967296.0; break;
+        case IT_OpenStart: foffset = 1.0; fmult = 1.0/4294967296.0; break;
+        case IT_OpenEnd: foffset = 0; fmult = 1.0/4294967296.0; break;
+        case IT_Closed: foffset = 0; fmult = 1.0/4294967295.0; break;
+        default:
+            throw OPENRAVE_EXCEPTION_FORMAT0("invalid interval", ORE_InvalidArguments);
+        }
+        _vtempuint.resize(samples.size());
+        _Generate(&_vtempuint[0], _vtempuint.size());
+        for(size_t i = 0; i < samples.size(); ++i) {
+            samples[i] = ((dReal)_vtempuint[i] + foffset)*fmult;
+        }
+        return (int)num;
+    }
+
+    dReal SampleSequenceOneReal(IntervalType interval=IT_Closed)
+    {
+        OPENRAVE_ASSERT_OP_FORMAT0(GetDOF(),==,1,"sample can only be 1 dof", ORE_InvalidState);
+        uint32_t value = _GenerateOne();
+        switch(interval) {
+        case IT_Open:
+            return (((dReal)value) + 0.5f)*(1.0f/4294967296.0f);
+        case IT_OpenStart:
+            return (((dReal)value) + 1.0f)*(1.0f/4294967296.0f);
+        case IT_OpenEnd:
+            return (dReal)value*(1.0f/4294967296.0f);
+        case IT_Closed:
+            return (dReal)value*(1.0f/4294967295.0f);
+        default:
+            throw OPENRAVE_EXCEPTION_FORMAT0("invalid interval", ORE_InvalidArguments);
+        }
+        return 0;
+    }
+
+    int SampleSequence(std::vector<uint32_t>& samples, size_t num)
+    {
+        samples.resize(_dof*num);
+        if( samples.size() > 0 ) {
+            _Generate(&samples[0], samples.size());
+        }
+        return (int)num;
+    }
+
+    virtual uint32_t SampleSequenceOneUInt32()
+    {
+        OPENRAVE_ASSERT_OP_FORMAT0(GetDOF(),==,1,"sample can only be 1 dof", ORE_InvalidState);
+        return _GenerateOne();
+    }
+
+protected:
+    bool _SetStreamCommand(std::ostream& sout, std::istream& sinput)
+    {
+        uint32_t stream = 0;
+        sinput >> stream;
+        if( !sinput ) {
+            return false;
+        }
+        _stream = stream;
+        _key[1] = _stream;
+        _SetPosition(0);
+        return true;
+    }
+
+    bool _GetStreamCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sout << _stream;
+        return !!sout;
+    }
+
+    bool _SkipCommand(std::ostream& sout, std::istream& sinput)
+    {
+        uint64_t num = 0;
+        sinput >> num;
+        if( !sinput ) {
+            return false;
+        }
+        _SetPosition(_GetPosition() + num);
+        return true;
+    }
+
+    bool _GetCounterCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sout << _GetPosition();
+        return !!sout;
+    }
+
+    bool _SetCounterCommand(std::ostream& sout, std::istream& sinput)
+    {
+        uint64_t position = 0;
+        sinput >> position;
+        if( !sinput ) {
+            return false;
+        }
+        _SetPosition(position);
+        return true;
+    }
+
+    /// \brief number of uint32 values consumed from the stream
+    inline uint64_t _GetPosition() const {
+        // _counter always points to the block after the one stored in _buffer
+        return 4*_counter - (4-_bufferindex);
+    }
+
+    inline void _SetPosition(uint64_t position) {
+        _counter = position/4;
+        _bufferindex = 4;
+        if( position % 4 ) {
+            _Block(_counter, _buffer);
+            ++_counter;
+            _bufferindex = position % 4;
+        }
+    }
+
+    inline uint32_t _GenerateOne() {
+        if( _bufferindex >= 4 ) {
+            _Block(_counter, _buffer);
+            ++_counter;
+            _bufferindex = 0;
+        }
+        return _buffer[_bufferindex++];
+    }
+
+    /// \brief fills out with the next num values, full blocks are written directly without going through _buffer
+    void _Generate(uint32_t* out, size_t num)
+    {
+        size_t index = 0;
+        while(index < num && _bufferindex < 4) {
+            out[index++] = _buffer[_bufferindex++];
+        }
+        for(; index+4 <= num; index += 4) {
+            _Block(_counter, out+index);
+            ++_counter;
+        }
+        while(index < num) {
+            out[index++] = _GenerateOne();
+        }
+    }
+
+    static inline void _MulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+        uint64_t product = (uint64_t)a*(uint64_t)b;
+        hi = (uint32_t)(product>>32);
+        lo = (uint32_t)product;
+    }
+
+    /// \brief computes the 4 values of block blockindex with 10 Philox rounds
+    inline void _Block(uint64_t blockindex, uint32_t* out) const
+    {
+        uint32_t ctr[4] = { (uint32_t)blockindex, (uint32_t)(blockindex>>32), 0, 0 };
+        uint32_t key0 = _key[0], key1 = _key[1];
+        for(int round = 0; round < 10; ++round) {
+            uint32_t hi0, lo0, hi1, lo1;
+            _MulHiLo(0xD2511F53, ctr[0], hi0, lo0);
+            _MulHiLo(0xCD9E8D57, ctr[2], hi1, lo1);
+            ctr[0] = hi1^ctr[1]^key0;
+            ctr[1] = lo1;
+            ctr[2] = hi0^ctr[3]^key1;
+            ctr[3] = lo0;
+            key0 += 0x9E3779B9;
+            key1 += 0xBB67AE85;
+        }
+        out[0] = ctr[0]; out[1] = ctr[1]; out[2] = ctr[2]; out[3] = ctr[3];
+    }
+
+    int _dof;
+    uint32_t _stream; ///< stream index, used as the second word of the key
+    uint32_t _key[2];
+    uint64_t _counter; ///< index of the next block to generate
+    uint32_t _buffer[4]; ///< values of block _counter-1
+    int _bufferindex; ///< next unused value in _buffer, 4 if empty
+    std::vector<uint32_t> _vtempuint;
+};
+
+#endif
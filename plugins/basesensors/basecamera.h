@@ -17,6 +17,7 @@
 #define OPENRAVE_BASECAMERA_H
 
 #include <boost/lexical_cast.hpp>
+#include "softwarerasterizer.h"
 
 class BaseCameraSensor : public SensorBase
 {
@@ -35,7 +36,7 @@ public:
                 }
                 return PE_Ignore;
             }
-            static boost::array<string, 18> tags = { { "sensor", "kk", "width", "height", "framerate", "power", "color", "focal_length","image_dimensions","intrinsic","measurement_time", "format", "distortion_model", "distortion_coeffs", "sensor_reference", "target_region", "gain", "hardware_id"}};
+            static boost::array<string, 20> tags = { { "sensor", "kk", "width", "height", "framerate", "power", "color", "focal_length","image_dimensions","intrinsic","measurement_time", "format", "distortion_model", "distortion_coeffs", "sensor_reference", "target_region", "gain", "hardware_id", "renderer", "renderthreads"}};
             if( find(tags.begin(),tags.end(),name) == tags.end() ) {
                 return PE_Pass;
             }
@@ -138,6 +139,16 @@ public:
             else if( name == "hardware_id" ) {
                 ss >> _psensor->_pgeom->hardware_id;
             }
+            else if( name == "renderer" ) {
+                string renderer;
+                ss >> renderer;
+                _psensor->_bSoftwareRenderer = renderer == "software";
+            }
+            else if( name == "renderthreads" ) {
+                int numthreads = 1;
+                ss >> numthreads;
+                _psensor->_rasterizer.SetNumThreads(numthreads);
+            }
             else {
                 RAVELOG_WARN(str(boost::format("bad tag: %s")%name));
             }
@@ -170,7 +181,8 @@ public:
     }
 
     BaseCameraSensor(EnvironmentBasePtr penv) : SensorBase(penv) {
-        __description = ":Interface Author: Rosen Diankov\n\nProvides a simulated camera using the standard pinhole projection.";
+        __description = ":Interface Author: Rosen Diankov\n\nProvides a simulated camera using the standard pinhole projection.\n\n\
+By default images are taken from the environment viewer. With <renderer>software</renderer>, the camera renders depth and flat shaded color from the collision meshes of all visible bodies on the CPU without a viewer. The number of rendering threads is set with <renderthreads>.";
         RegisterCommand("power",boost::bind(&BaseCameraSensor::_Power,this,_1,_2), "deprecated");
         RegisterCommand("render",boost::bind(&BaseCameraSensor::_Render,this,_1,_2),"deprecated");
         RegisterCommand("setintrinsic",boost::bind(&BaseCameraSensor::_SetIntrinsic,this,_1,_2),
@@ -179,6 +191,8 @@ public:
                         "Set the dimensions of the image (width,height)");
         RegisterCommand("SaveImage",boost::bind(&BaseCameraSensor::_SaveImage,this,_1,_2),
                         "Saves the next camera image to the given filename");
+        RegisterCommand("SetRenderer",boost::bind(&BaseCameraSensor::_SetRendererCommand,this,_1,_2),
+                        "Sets where images come from, 'viewer' for the environment viewer or 'software' for the CPU rasterizer, optionally followed by 'numthreads N' for the rasterizer.");
         _pgeom.reset(new CameraGeomData());
         _pdata.reset(new CameraSensorData());
         _bPower = false;
@@ -187,6 +201,7 @@ public:
         _numchannels = 3;
         _bRenderGeometry = true;
         _bRenderData = false;
+        _bSoftwareRenderer = false;
         _Reset();
     }
 
@@ -249,6 +264,8 @@ public:
         _pdata->vimagedata.resize(0);
         _pdata->__stamp = 0;
         _vimagedata.resize(3*_pgeom->width*_pgeom->height);
+        _vdepthdata.resize(0);
+        _mapRasterBodies.clear();
         _fTimeToImage = 0;
         _graphgeometry.reset();
         _dataviewer.reset();
@@ -270,6 +287,15 @@ public:
             _fTimeToImage -= fTimeElapsed;
             if( _fTimeToImage <= 0 ) {
                 _fTimeToImage = 1 / (float)framerate;
+                if( _bSoftwareRenderer ) {
+                    _RenderSoftware();
+                    boost::mutex::scoped_lock lock(_mutexdata);
+                    pdata->vimagedata = _vimagedata;
+                    pdata->vdepthdata = _vdepthdata;
+                    pdata->__stamp = GetEnv()->GetSimulationTime();
+                    pdata->__trans = _trans;
+                    return true;
+                }
                 GetEnv()->UpdatePublishedBodies();
                 if( !!GetEnv()->GetViewer() ) {
                     if( GetEnv()->GetViewer()->GetCameraImage(_vimagedata, _pgeom->width, _pgeom->height, _trans, _pgeom->KK) ) {
@@ -350,6 +376,41 @@ public:
         }
         return false;
     }
+    bool _SetRendererCommand(ostream& sout, istream& sinput)
+    {
+        string renderer, cmd;
+        sinput >> renderer;
+        if( !sinput || (renderer != "software" && renderer != "viewer") ) {
+            return false;
+        }
+        int numthreads = _rasterizer.GetNumThreads();
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+            if( cmd == "numthreads" ) {
+                sinput >> numthreads;
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+        _bSoftwareRenderer = renderer == "software";
+        if( numthreads != _rasterizer.GetNumThreads() ) {
+            _rasterizer.SetNumThreads(numthreads);
+        }
+        if( !_bSoftwareRenderer ) {
+            _mapRasterBodies.clear();
+        }
+        return true;
+    }
     bool _SaveImage(ostream& sout, istream& sinput)
     {
         RAVELOG_WARN("SaveImage not implemented yet\n");
@@ -377,6 +438,8 @@ public:
         _bRenderGeometry = r->_bRenderGeometry;
         _bRenderData = r->_bRenderData;
         _bPower = r->_bPower;
+        _bSoftwareRenderer = r->_bSoftwareRenderer;
+        _rasterizer.SetNumThreads(r->_rasterizer.GetNumThreads());
         _Reset();
     }
 
@@ -388,9 +451,117 @@ public:
         ss << _vColor.x << " " << _vColor.y << " " << _vColor.z;
         writer->AddChild("color",atts)->SetCharData(ss.str());
         writer->AddChild("format",atts)->SetCharData(_channelformat.size() > 0 ? _channelformat : std::string("uint8"));
+        if( _bSoftwareRenderer ) {
+            writer->AddChild("renderer",atts)->SetCharData("software");
+            writer->AddChild("renderthreads",atts)->SetCharData(boost::lexical_cast<std::string>(_rasterizer.GetNumThreads()));
+        }
     }
 
 protected:
+    /// \brief collision mesh of a geometry in the link coordinate system
+    struct RasterGeometry
+    {
+        std::vector<float> vvertices, vnormals; ///< 3 floats for every vertex and every triangle normal
+        std::vector<int> vindices;
+        RaveVector<float> color;
+    };
+
+    /// \brief rasterizer meshes of all links of a body, rebuilt when the geometry of the body changes
+    class RasterBody
+    {
+public:
+        RasterBody() : bGeometryChanged(false) {
+        }
+        KinBodyWeakPtr pbody;
+        UserDataPtr changehandle;
+        bool bGeometryChanged;
+        std::vector< std::vector<RasterGeometry> > vlinkgeometries;
+    };
+    typedef boost::shared_ptr<RasterBody> RasterBodyPtr;
+
+    static void _RasterBodyChangedCallback(boost::weak_ptr<RasterBody> pweakbody)
+    {
+        RasterBodyPtr prasterbody = pweakbody.lock();
+        if( !!prasterbody ) {
+            prasterbody->bGeometryChanged = true;
+        }
+    }
+
+    RasterBodyPtr _InitRasterBody(KinBodyPtr pbody)
+    {
+        RasterBodyPtr prasterbody(new RasterBody());
+        prasterbody->pbody = pbody;
+        prasterbody->changehandle = pbody->RegisterChangeCallback(KinBody::Prop_LinkGeometry|KinBody::Prop_LinkDraw, boost::bind(&BaseCameraSensor::_RasterBodyChangedCallback, boost::weak_ptr<RasterBody>(prasterbody)));
+        prasterbody->vlinkgeometries.resize(pbody->GetLinks().size());
+        FOREACHC(itlink, pbody->GetLinks()) {
+            std::vector<RasterGeometry>& vgeometries = prasterbody->vlinkgeometries.at((*itlink)->GetIndex());
+            FOREACHC(itgeom, (*itlink)->GetGeometries()) {
+                const TriMesh& mesh = (*itgeom)->GetCollisionMesh();
+                if( !(*itgeom)->IsVisible() || mesh.indices.size() == 0 ) {
+                    continue;
+                }
+                vgeometries.push_back(RasterGeometry());
+                RasterGeometry& rastergeom = vgeometries.back();
+                Transform tgeom = (*itgeom)->GetTransform();
+                rastergeom.color = (*itgeom)->GetDiffuseColor();
+                rastergeom.vvertices.resize(3*mesh.vertices.size());
+                for(size_t i = 0; i < mesh.vertices.size(); ++i) {
+                    Vector v = tgeom*mesh.vertices[i];
+                    rastergeom.vvertices[3*i+0] = v.x; rastergeom.vvertices[3*i+1] = v.y; rastergeom.vvertices[3*i+2] = v.z;
+                }
+                rastergeom.vindices = mesh.indices;
+                rastergeom.vnormals.resize(mesh.indices.size());
+                for(size_t i = 0; i < mesh.indices.size(); i += 3) {
+                    Vector v0 = tgeom*mesh.vertices.at(mesh.indices[i]), v1 = tgeom*mesh.vertices.at(mesh.indices[i+1]), v2 = tgeom*mesh.vertices.at(mesh.indices[i+2]);
+                    Vector n = (v1-v0).cross(v2-v0);
+                    dReal flen = RaveSqrt(n.lengthsqr3());
+                    if( flen > 0 ) {
+                        n /= flen;
+                    }
+                    rastergeom.vnormals[i+0] = n.x; rastergeom.vnormals[i+1] = n.y; rastergeom.vnormals[i+2] = n.z;
+                }
+            }
+        }
+        return prasterbody;
+    }
+
+    /// \brief renders _vimagedata and _vdepthdata from the collision meshes of the visible bodies
+    void _RenderSoftware()
+    {
+        _rasterizer.Begin(_pgeom->width, _pgeom->height, _pgeom->KK, _trans);
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        std::map<int, RasterBodyPtr> mapRasterBodies;
+        FOREACH(itbody, vbodies) {
+            KinBodyPtr pbody = *itbody;
+            if( !pbody->IsVisible() ) {
+                continue;
+            }
+            std::map<int, RasterBodyPtr>::iterator itraster = _mapRasterBodies.find(pbody->GetEnvironmentId());
+            RasterBodyPtr prasterbody;
+            if( itraster != _mapRasterBodies.end() && itraster->second->pbody.lock() == pbody && !itraster->second->bGeometryChanged ) {
+                prasterbody = itraster->second;
+            }
+            else {
+                prasterbody = _InitRasterBody(pbody);
+            }
+            mapRasterBodies[pbody->GetEnvironmentId()] = prasterbody;
+            FOREACHC(itlink, pbody->GetLinks()) {
+                const std::vector<RasterGeometry>& vgeometries = prasterbody->vlinkgeometries.at((*itlink)->GetIndex());
+                if( vgeometries.size() == 0 ) {
+                    continue;
+                }
+                Transform tlink = (*itlink)->GetTransform();
+                FOREACHC(itgeom, vgeometries) {
+                    _rasterizer.AddTriangles(tlink, &itgeom->vvertices[0], itgeom->vvertices.size()/3, &itgeom->vindices[0], &itgeom->vnormals[0], itgeom->vindices.size()/3, itgeom->color);
+                }
+            }
+        }
+        // bodies that were removed drop out of the cache
+        _mapRasterBodies.swap(mapRasterBodies);
+        _rasterizer.Render(_vimagedata, _vdepthdata);
+    }
+
     void _RenderGeometry()
     {
         if( !_bRenderGeometry ) {
@@ -439,6 +610,7 @@ protected:
 
     // more geom stuff
     vector<uint8_t> _vimagedata;
+    vector<float> _vdepthdata;
     RaveVector<float> _vColor;
 
     Transform _trans;
@@ -453,6 +625,10 @@ protected:
 
     bool _bRenderGeometry, _bRenderData;
     bool _bPower;     ///< if true, gather data, otherwise don't
+    bool _bSoftwareRenderer; ///< if true, render with _rasterizer instead of the viewer
+
+    SoftwareRasterizer _rasterizer;
+    std::map<int, RasterBodyPtr> _mapRasterBodies; ///< cached meshes indexed by the environment id of the bodies
 
     friend class BaseCameraXMLReader;
 };
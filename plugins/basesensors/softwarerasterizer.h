@@ -0,0 +1,354 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 The OpenRAVE Contributors
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_SOFTWARERASTERIZER_H
+#define OPENRAVE_SOFTWARERASTERIZER_H
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition.hpp>
+
+/// \brief renders depth and flat shaded color images of triangles with a pinhole camera on the CPU
+///
+/// Triangles are projected and binned into square tiles of the image, then the tiles are rasterized by a pool of
+/// threads that lives as long as the rasterizer. Tiles do not share pixels, so the threads never synchronize while
+/// rasterizing. Every row of a triangle is evaluated with incremental edge functions in a branch-free loop that the
+/// compiler can vectorize.
+class SoftwareRasterizer
+{
+    struct ScreenTriangle
+    {
+        float x[3], y[3];
+        float invz[3]; ///< inverse depth, which is linear in screen space
+        float invarea;
+        int minx, miny, maxx, maxy; ///< pixel bounding box inside the image
+        uint8_t color[3];
+    };
+
+public:
+    SoftwareRasterizer() : _width(0), _height(0), _numtilesx(0), _numtilesy(0), _fNear(0.01f), _pcolor(NULL), _pdepth(NULL), _nFrameId(0), _nNextTile(0), _nBusyThreads(0), _bShutdown(false) {
+    }
+    virtual ~SoftwareRasterizer() {
+        _StopThreads();
+    }
+
+    /// \brief sets the number of threads rendering every image including the calling thread, can only be called between two images
+    void SetNumThreads(int numthreads)
+    {
+        _StopThreads();
+        _bShutdown = false;
+        for(int i = 1; i < numthreads; ++i) {
+            _vthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&SoftwareRasterizer::_WorkerThread, this, _nFrameId))));
+        }
+    }
+
+    int GetNumThreads() const {
+        return (int)_vthreads.size()+1;
+    }
+
+    /// \brief starts a new image, tcamera is the camera coordinate system with z pointing along the optical axis
+    void Begin(int width, int height, const SensorBase::CameraIntrinsics& KK, const Transform& tcamera)
+    {
+        _width = width;
+        _height = height;
+        _fx = KK.fx; _fy = KK.fy; _cx = KK.cx; _cy = KK.cy;
+        _tcamerainv = tcamera.inverse();
+        _numtilesx = (width+s_nTileSize-1)/s_nTileSize;
+        _numtilesy = (height+s_nTileSize-1)/s_nTileSize;
+        _vtriangles.resize(0);
+        _vtilebins.resize(_numtilesx*_numtilesy);
+        FOREACH(itbin, _vtilebins) {
+            itbin->resize(0);
+        }
+    }
+
+    /// \brief adds numtriangles triangles whose coordinates are in the t coordinate system
+    ///
+    /// \param pvertices 3 floats for every vertex
+    /// \param pindices 3 vertex indices for every triangle
+    /// \param pnormals 3 floats for the unit normal of every triangle
+    /// \param color diffuse color of all triangles, shaded with the angle to the camera
+    void AddTriangles(const Transform& t, const float* pvertices, size_t numvertices, const int* pindices, const float* pnormals, size_t numtriangles, const RaveVector<float>& color)
+    {
+        TransformMatrix m(_tcamerainv*t);
+        float r[12] = { float(m.m[0]), float(m.m[1]), float(m.m[2]), float(m.trans.x), float(m.m[4]), float(m.m[5]), float(m.m[6]), float(m.trans.y), float(m.m[8]), float(m.m[9]), float(m.m[10]), float(m.trans.z) };
+        _vcameravertices.resize(3*numvertices);
+        for(size_t i = 0; i < numvertices; ++i) {
+            const float* p = pvertices + 3*i;
+            float* pout = &_vcameravertices[3*i];
+            pout[0] = r[0]*p[0] + r[1]*p[1] + r[2]*p[2] + r[3];
+            pout[1] = r[4]*p[0] + r[5]*p[1] + r[6]*p[2] + r[7];
+            pout[2] = r[8]*p[0] + r[9]*p[1] + r[10]*p[2] + r[11];
+        }
+
+        const float* pcamvertices = _vcameravertices.size() > 0 ? &_vcameravertices[0] : NULL;
+        for(size_t itri = 0; itri < numtriangles; ++itri) {
+            const float* p0 = pcamvertices + 3*pindices[3*itri+0];
+            const float* p1 = pcamvertices + 3*pindices[3*itri+1];
+            const float* p2 = pcamvertices + 3*pindices[3*itri+2];
+            if( p0[2] < _fNear && p1[2] < _fNear && p2[2] < _fNear ) {
+                continue;
+            }
+
+            // flat shading with a light at the camera
+            const float* n = pnormals + 3*itri;
+            float nx = r[0]*n[0] + r[1]*n[1] + r[2]*n[2], ny = r[4]*n[0] + r[5]*n[1] + r[6]*n[2], nz = r[8]*n[0] + r[9]*n[1] + r[10]*n[2];
+            float vx = p0[0]+p1[0]+p2[0], vy = p0[1]+p1[1]+p2[1], vz = p0[2]+p1[2]+p2[2];
+            float vlen = sqrtf(vx*vx+vy*vy+vz*vz);
+            float shade = 0.3f + 0.7f*(vlen > 0 ? fabsf(nx*vx+ny*vy+nz*vz)/vlen : 1.0f);
+            uint8_t rgb[3];
+            for(int j = 0; j < 3; ++j) {
+                float c = 255.0f*shade*color[j];
+                rgb[j] = c >= 255.0f ? 255 : (c <= 0 ? 0 : (uint8_t)c);
+            }
+
+            if( p0[2] >= _fNear && p1[2] >= _fNear && p2[2] >= _fNear ) {
+                _AddScreenTriangle(p0, p1, p2, rgb);
+            }
+            else {
+                // clip against the near plane, the result is a triangle or a quad
+                const float* ppoly[3] = { p0, p1, p2 };
+                float vclipped[4][3];
+                int numclipped = 0;
+                for(int j = 0; j < 3; ++j) {
+                    const float* pa = ppoly[j], *pb = ppoly[(j+1)%3];
+                    if( pa[2] >= _fNear ) {
+                        vclipped[numclipped][0] = pa[0]; vclipped[numclipped][1] = pa[1]; vclipped[numclipped][2] = pa[2];
+                        ++numclipped;
+                    }
+                    if( (pa[2] >= _fNear) != (pb[2] >= _fNear) ) {
+                        float s = (_fNear-pa[2])/(pb[2]-pa[2]);
+                        vclipped[numclipped][0] = pa[0] + s*(pb[0]-pa[0]);
+                        vclipped[numclipped][1] = pa[1] + s*(pb[1]-pa[1]);
+                        vclipped[numclipped][2] = _fNear;
+                        ++numclipped;
+                    }
+                }
+                for(int j = 2; j < numclipped; ++j) {
+                    _AddScreenTriangle(vclipped[0], vclipped[j-1], vclipped[j], rgb);
+                }
+            }
+        }
+    }
+
+    /// \brief renders all added triangles
+    ///
+    /// \param vcolor set to width*height*3 rgb values, black where nothing is visible
+    /// \param vdepth set to width*height depths along the optical axis, 0 where nothing is visible
+    void Render(std::vector<uint8_t>& vcolor, std::vector<float>& vdepth)
+    {
+        vcolor.resize(3*_width*_height);
+        vdepth.resize(_width*_height);
+        if( _width <= 0 || _height <= 0 ) {
+            return;
+        }
+        _pcolor = &vcolor[0];
+        _pdepth = &vdepth[0];
+        if( _vthreads.size() == 0 ) {
+            for(int itile = 0; itile < _numtilesx*_numtilesy; ++itile) {
+                _RenderTile(itile);
+            }
+        }
+        else {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                _nNextTile = 0;
+                _nBusyThreads = (int)_vthreads.size();
+                ++_nFrameId;
+            }
+            _condWork.notify_all();
+            _RenderTiles();
+            boost::mutex::scoped_lock lock(_mutex);
+            while(_nBusyThreads > 0) {
+                _condDone.wait(lock);
+            }
+        }
+        _pcolor = NULL;
+        _pdepth = NULL;
+    }
+
+protected:
+    void _AddScreenTriangle(const float* p0, const float* p1, const float* p2, const uint8_t* rgb)
+    {
+        ScreenTriangle tri;
+        const float* p[3] = { p0, p1, p2 };
+        for(int j = 0; j < 3; ++j) {
+            tri.invz[j] = 1.0f/p[j][2];
+            tri.x[j] = _fx*p[j][0]*tri.invz[j] + _cx;
+            tri.y[j] = _fy*p[j][1]*tri.invz[j] + _cy;
+        }
+        float area = (tri.x[1]-tri.x[0])*(tri.y[2]-tri.y[0]) - (tri.y[1]-tri.y[0])*(tri.x[2]-tri.x[0]);
+        if( fabsf(area) < 1e-8f ) {
+            return;
+        }
+        if( area < 0 ) {
+            // make the edge functions positive on the inside
+            std::swap(tri.x[1], tri.x[2]);
+            std::swap(tri.y[1], tri.y[2]);
+            std::swap(tri.invz[1], tri.invz[2]);
+            area = -area;
+        }
+        tri.invarea = 1.0f/area;
+        // pixel i covers [i,i+1) and is sampled at its center
+        tri.minx = max(0, (int)floorf(min(tri.x[0], min(tri.x[1], tri.x[2]))-0.5f));
+        tri.miny = max(0, (int)floorf(min(tri.y[0], min(tri.y[1], tri.y[2]))-0.5f));
+        tri.maxx = min(_width-1, (int)ceilf(max(tri.x[0], max(tri.x[1], tri.x[2]))-0.5f));
+        tri.maxy = min(_height-1, (int)ceilf(max(tri.y[0], max(tri.y[1], tri.y[2]))-0.5f));
+        if( tri.minx > tri.maxx || tri.miny > tri.maxy ) {
+            return;
+        }
+        tri.color[0] = rgb[0]; tri.color[1] = rgb[1]; tri.color[2] = rgb[2];
+        uint32_t index = _vtriangles.size();
+        _vtriangles.push_back(tri);
+        for(int ty = tri.miny/s_nTileSize; ty <= tri.maxy/s_nTileSize; ++ty) {
+            for(int tx = tri.minx/s_nTileSize; tx <= tri.maxx/s_nTileSize; ++tx) {
+                _vtilebins[ty*_numtilesx+tx].push_back(index);
+            }
+        }
+    }
+
+    void _RenderTiles()
+    {
+        while(1) {
+            int itile;
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                if( _nNextTile >= _numtilesx*_numtilesy ) {
+                    break;
+                }
+                itile = _nNextTile++;
+            }
+            _RenderTile(itile);
+        }
+    }
+
+    void _RenderTile(int itile)
+    {
+        int tilex0 = (itile%_numtilesx)*s_nTileSize, tiley0 = (itile/_numtilesx)*s_nTileSize;
+        int tilex1 = min(tilex0+s_nTileSize, _width), tiley1 = min(tiley0+s_nTileSize, _height);
+        int tilewidth = tilex1-tilex0;
+        float vinvdepth[s_nTileSize*s_nTileSize];
+        uint8_t vcolor[3*s_nTileSize*s_nTileSize];
+        float vrowinvz[s_nTileSize];
+        uint8_t vrowmask[s_nTileSize];
+        std::fill(vinvdepth, vinvdepth+s_nTileSize*s_nTileSize, 0.0f);
+        std::fill(vcolor, vcolor+3*s_nTileSize*s_nTileSize, 0);
+
+        FOREACHC(itindex, _vtilebins[itile]) {
+            const ScreenTriangle& tri = _vtriangles[*itindex];
+            int x0 = max(tilex0, tri.minx), x1 = min(tilex1-1, tri.maxx);
+            int y0 = max(tiley0, tri.miny), y1 = min(tiley1-1, tri.maxy);
+            if( x0 > x1 || y0 > y1 ) {
+                continue;
+            }
+            int numx = x1-x0+1;
+            // w_i = a_i*px + b_i*py + c_i is the edge function opposite of vertex i
+            float a0 = tri.y[1]-tri.y[2], b0 = tri.x[2]-tri.x[1], c0 = tri.x[1]*tri.y[2]-tri.y[1]*tri.x[2];
+            float a1 = tri.y[2]-tri.y[0], b1 = tri.x[0]-tri.x[2], c1 = tri.x[2]*tri.y[0]-tri.y[2]*tri.x[0];
+            float a2 = tri.y[0]-tri.y[1], b2 = tri.x[1]-tri.x[0], c2 = tri.x[0]*tri.y[1]-tri.y[0]*tri.x[1];
+            float iz0 = tri.invz[0]*tri.invarea, iz1 = tri.invz[1]*tri.invarea, iz2 = tri.invz[2]*tri.invarea;
+            for(int py = y0; py <= y1; ++py) {
+                float fy = py+0.5f, fx0 = x0+0.5f;
+                float w0 = a0*fx0 + b0*fy + c0, w1 = a1*fx0 + b1*fy + c1, w2 = a2*fx0 + b2*fy + c2;
+                float* prowdepth = vinvdepth + (py-tiley0)*s_nTileSize + (x0-tilex0);
+                for(int ix = 0; ix < numx; ++ix) {
+                    float fix = (float)ix;
+                    float e0 = w0 + a0*fix, e1 = w1 + a1*fix, e2 = w2 + a2*fix;
+                    float invz = e0*iz0 + e1*iz1 + e2*iz2;
+                    uint8_t inside = (e0 >= 0) & (e1 >= 0) & (e2 >= 0) & (invz > prowdepth[ix]);
+                    vrowmask[ix] = inside;
+                    vrowinvz[ix] = inside ? invz : prowdepth[ix];
+                }
+                uint8_t* prowcolor = vcolor + 3*((py-tiley0)*s_nTileSize + (x0-tilex0));
+                for(int ix = 0; ix < numx; ++ix) {
+                    prowdepth[ix] = vrowinvz[ix];
+                    if( vrowmask[ix] ) {
+                        prowcolor[3*ix+0] = tri.color[0];
+                        prowcolor[3*ix+1] = tri.color[1];
+                        prowcolor[3*ix+2] = tri.color[2];
+                    }
+                }
+            }
+        }
+
+        for(int py = tiley0; py < tiley1; ++py) {
+            const float* prowdepth = vinvdepth + (py-tiley0)*s_nTileSize;
+            float* pdepth = _pdepth + py*_width + tilex0;
+            for(int ix = 0; ix < tilewidth; ++ix) {
+                pdepth[ix] = prowdepth[ix] > 0 ? 1.0f/prowdepth[ix] : 0.0f;
+            }
+            std::copy(vcolor + 3*(py-tiley0)*s_nTileSize, vcolor + 3*((py-tiley0)*s_nTileSize + tilewidth), _pcolor + 3*(py*_width + tilex0));
+        }
+    }
+
+    void _WorkerThread(int nFrameId)
+    {
+        while(1) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while(!_bShutdown && _nFrameId == nFrameId) {
+                    _condWork.wait(lock);
+                }
+                if( _bShutdown ) {
+                    break;
+                }
+                nFrameId = _nFrameId;
+            }
+            _RenderTiles();
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                --_nBusyThreads;
+            }
+            _condDone.notify_all();
+        }
+    }
+
+    void _StopThreads()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bShutdown = true;
+        }
+        _condWork.notify_all();
+        FOREACH(itthread, _vthreads) {
+            (*itthread)->join();
+        }
+        _vthreads.resize(0);
+    }
+
+    static const int s_nTileSize = 64;
+
+    int _width, _height, _numtilesx, _numtilesy;
+    float _fx, _fy, _cx, _cy, _fNear;
+    Transform _tcamerainv;
+    std::vector<ScreenTriangle> _vtriangles;
+    std::vector< std::vector<uint32_t> > _vtilebins; ///< indices into _vtriangles overlapping every tile, in the order they were added
+    std::vector<float> _vcameravertices;
+
+    // output of the current image
+    uint8_t* _pcolor;
+    float* _pdepth;
+
+    // thread pool
+    std::vector<boost::shared_ptr<boost::thread> > _vthreads;
+    boost::mutex _mutex;
+    boost::condition _condWork, _condDone;
+    int _nFrameId; ///< incremented for every image rendered by the thread pool
+    int _nNextTile;
+    int _nBusyThreads;
+    bool _bShutdown;
+};
+
+#endif
@@ -157,7 +157,7 @@ public:
     class LinkAdjacentFilterCallback : public OpenRAVEFilterCallback
     {
 public:
-        LinkAdjacentFilterCallback(KinBodyConstPtr pparent, const std::set<int>& setadjacency) : OpenRAVEFilterCallback(), _pparent(pparent), _setadjacency(setadjacency) {
+        LinkAdjacentFilterCallback(KinBodyConstPtr pparent, const KinBody::NonAdjacentLinkPairs& nonadjacent) : OpenRAVEFilterCallback(), _pparent(pparent), _nonadjacent(nonadjacent) {
         }
 
         virtual bool CheckLinks(KinBody::LinkPtr plink0, KinBody::LinkPtr plink1) const
@@ -166,13 +166,11 @@ public:
                 return false;
             }
             // check if links are in adjacency list
-            int index0 = plink0->GetIndex();
-            int index1 = plink1->GetIndex();
-            return _setadjacency.find(index0|(index1<<16)) != _setadjacency.end() || _setadjacency.find(index1|(index0<<16)) != _setadjacency.end();
+            return _nonadjacent.IsNonAdjacent(plink0->GetIndex(), plink1->GetIndex());
         }
 
         KinBodyConstPtr _pparent;
-        const std::set<int>& _setadjacency;
+        const KinBody::NonAdjacentLinkPairs& _nonadjacent;
     };
 
     class KinBodyLinkFilterCallback : public OpenRAVEFilterCallback
@@ -386,6 +384,9 @@ public:
 
 public:
     BulletCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput) : CollisionCheckerBase(penv), bulletspace(new BulletSpace(penv, GetCollisionInfo, false)), _options(0) {
+        _gethull = boost::bind(&BulletSpace::GetLinkHull, bulletspace.get(), _1);
+        _getbodyaabb = boost::bind(&BulletSpace::GetBodyAABB, bulletspace.get(), _1, _2);
+        bulletspace->SetInitKinBodyFn(boost::bind(&BulletCollisionChecker::InitKinBody, this, _1));
         __description = ":Interface Author: Rosen Diankov\n\nCollision checker from the `Bullet Physics Package <http://bulletphysics.org>`";
         _userdatakey = std::string("bulletcollision");
     }
@@ -447,11 +448,6 @@ public:
     virtual bool SetCollisionOptions(int options)
     {
         _options = options;
-        if( options & CO_Distance ) {
-            //RAVELOG_WARN("bullet checker doesn't support CO_Distance\n");
-            return false;
-        }
-
         if( options & CO_Contacts ) {
             //setCollisionFlags btCollisionObject::CF_NO_CONTACT_RESPONSE - don't generate
         }
@@ -472,10 +468,13 @@ public:
         bulletspace->Synchronize();
 
         KinBodyFilterCallback kinbodycallback(shared_collisionchecker(),pbody);
-        if( CheckCollisionP(&kinbodycallback, report) ) {
-            return true;
+        bool bCollision = CheckCollisionP(&kinbodycallback, report);
+        if( (_options & CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1;
+            convexdistance::AddBodyLinks(pbody, _gethull, vlinks1);
+            convexdistance::UpdateEnvironmentReport(pbody, vlinks1, std::vector<KinBodyConstPtr>(), std::vector<KinBody::LinkConstPtr>(), _gethull, _getbodyaabb, bCollision, report);
         }
-        return false;
+        return bCollision;
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, KinBodyConstPtr pbody2, CollisionReportPtr report)
@@ -495,7 +494,14 @@ public:
         bulletspace->Synchronize();
 
         KinBodyFilterCallback kinbodycallback(shared_collisionchecker(),pbody1,pbody2);
-        return CheckCollisionP(&kinbodycallback, report);
+        bool bCollision = CheckCollisionP(&kinbodycallback, report);
+        if( (_options & CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1, vlinks2;
+            convexdistance::AddBodyLinks(pbody1, _gethull, vlinks1);
+            convexdistance::AddBodyLinks(pbody2, _gethull, vlinks2);
+            convexdistance::UpdateReport(vlinks1, vlinks2, bCollision, report);
+        }
+        return bCollision;
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report)
@@ -509,7 +515,13 @@ public:
 
         _linkcallback._pcollink0 = plink;
         _linkcallback._pcollink1.reset();
-        return CheckCollisionP(&_linkcallback, report);
+        bool bCollision = CheckCollisionP(&_linkcallback, report);
+        if( (_options & CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1;
+            convexdistance::AddLink(plink, _gethull, vlinks1);
+            convexdistance::UpdateEnvironmentReport(plink->GetParent(), vlinks1, std::vector<KinBodyConstPtr>(), std::vector<KinBody::LinkConstPtr>(), _gethull, _getbodyaabb, bCollision, report);
+        }
+        return bCollision;
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, CollisionReportPtr report)
@@ -526,7 +538,14 @@ public:
         bulletspace->Synchronize();
         _linkcallback._pcollink0 = plink1;
         _linkcallback._pcollink1 = plink2;
-        return CheckCollisionP(&_linkcallback, report);
+        bool bCollision = CheckCollisionP(&_linkcallback, report);
+        if( (_options & CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1, vlinks2;
+            convexdistance::AddLink(plink1, _gethull, vlinks1);
+            convexdistance::AddLink(plink2, _gethull, vlinks2);
+            convexdistance::UpdateReport(vlinks1, vlinks2, bCollision, report);
+        }
+        return bCollision;
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, KinBodyConstPtr pbody, CollisionReportPtr report)
@@ -546,7 +565,14 @@ public:
         KinBodyLinkFilterCallback kinbodylinkcallback;
         kinbodylinkcallback._pcollink = plink;
         kinbodylinkcallback._pbody = pbody;
-        return CheckCollisionP(&kinbodylinkcallback, report);
+        bool bCollision = CheckCollisionP(&kinbodylinkcallback, report);
+        if( (_options & CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1, vlinks2;
+            convexdistance::AddLink(plink, _gethull, vlinks1);
+            convexdistance::AddBodyLinks(pbody, _gethull, vlinks2);
+            convexdistance::UpdateReport(vlinks1, vlinks2, bCollision, report);
+        }
+        return bCollision;
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
@@ -570,7 +596,13 @@ public:
         bulletspace->Synchronize();
 
         KinBodyFilterExCallback kinbodyexcallback(shared_collisionchecker(),pbody,vbodyexcluded);
-        return CheckCollisionP(&kinbodyexcallback, report);
+        bool bCollision = CheckCollisionP(&kinbodyexcallback, report);
+        if( (_options & CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1;
+            convexdistance::AddBodyLinks(pbody, _gethull, vlinks1);
+            convexdistance::UpdateEnvironmentReport(pbody, vlinks1, vbodyexcluded, std::vector<KinBody::LinkConstPtr>(), _gethull, _getbodyaabb, bCollision, report);
+        }
+        return bCollision;
     }
 
     virtual bool CheckCollision(const RAY& ray, KinBody::LinkConstPtr plink, CollisionReportPtr report)
@@ -780,9 +812,13 @@ public:
         if( (_options&OpenRAVE::CO_ActiveDOFs) && pbody->IsRobot() ) {
             adjacentoptions |= KinBody::AO_ActiveDOFs;
         }
-        LinkAdjacentFilterCallback linkadjacent(pbody, pbody->GetNonAdjacentLinks(adjacentoptions));
+        const std::set<int>& nonadjacent = pbody->GetNonAdjacentLinks(adjacentoptions);
+        LinkAdjacentFilterCallback linkadjacent(pbody, pbody->GetNonAdjacentLinkPairs(adjacentoptions));
         bulletspace->Synchronize(); // call after GetNonAdjacentLinks since it can modify the body, even though it is const!
         bool bCollision = CheckCollisionP(&linkadjacent, report);
+        if( (_options & CO_Distance) && !!report ) {
+            convexdistance::UpdateSelfReport(pbody, nonadjacent, KinBody::LinkConstPtr(), _gethull, bCollision, report);
+        }
         return bCollision;
     }
 
@@ -798,6 +834,8 @@ public:
 
 private:
     boost::shared_ptr<BulletSpace> bulletspace;
+    convexdistance::GetLinkHullFn _gethull; ///< hulls of bulletspace used for CO_Distance queries
+    convexdistance::GetBodyAABBFn _getbodyaabb; ///< aabbs of the bodies in bulletspace used to cull CO_Distance queries
     int _options;
     std::string _userdatakey;
 
@@ -192,6 +192,7 @@ public:
 	stringstream ss;        
 	__description = ":Interface Authors: Max Argus, Nick Hillier, Katrina Monkley, Rosen Diankov\n\nInterface to `Bullet Physics Engine <http://bulletphysics.org/>`_\n";
         RegisterCommand("SetStaticBodyTransform",boost::bind(&BulletPhysicsEngine::SetStaticBodyTransform,this,_1,_2),"Sets the transformation of a static body manually, not allowed to use for dynamic bodies and it should be used with caution even for static bodies because it can cause instabilities in physics engine.");
+        _space->SetInitKinBodyFn(boost::bind(&BulletPhysicsEngine::InitKinBody, this, _1));
         _solver_iterations = 5;
         _margin_depth = 0.001;
         _linear_damping = 0.1;
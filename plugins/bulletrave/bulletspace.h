@@ -21,6 +21,7 @@
 #define OPENRAVE_BULLET_SPACE
 
 #include "plugindefs.h"
+#include "convexdistance.h"
 
 #include <btBulletCollisionCommon.h>
 #include <btBulletDynamicsCommon.h>
@@ -73,14 +74,21 @@ public:
 
             KinBody::LinkPtr plink;
             Transform tlocal;     /// local offset transform to account for inertias not aligned to axes
+            convexdistance::LinkHullPtr _distancehull; ///< convex hulls of the geometries for distance queries, see BulletSpace::GetLinkHull
         };
 
         KinBodyInfo(boost::shared_ptr<btCollisionWorld> world, bool bPhysics) : _world(world), _bPhysics(bPhysics) {
             nLastStamp = 0;
+            _bQueued = false;
             _worlddynamics = boost::dynamic_pointer_cast<btDiscreteDynamicsWorld>(_world);
         }
         virtual ~KinBodyInfo() {
             Reset();
+            // the user data of a live body was removed, so re-create it on the next Synchronize()
+            boost::shared_ptr<BulletSpace> bulletspace = _bulletspace.lock();
+            if( !!bulletspace && !!pbody ) {
+                bulletspace->QueueInitialize(pbody);
+            }
         }
 
         void Reset()
@@ -99,6 +107,7 @@ public:
             _mapjoints.clear(); // have to remove constraints first
             vlinks.resize(0);
             _geometrycallback.reset();
+            _updatestampcallback.reset();
         }
 
         KinBodyPtr pbody;     ///< body associated with this structure
@@ -108,8 +117,9 @@ public:
         ///< the pointer to this Link is the userdata
         typedef std::map< KinBody::JointConstPtr, boost::shared_ptr<btTypedConstraint> > MAPJOINTS;
         MAPJOINTS _mapjoints;
-        UserDataPtr _geometrycallback;
+        UserDataPtr _geometrycallback, _updatestampcallback;
         boost::weak_ptr<BulletSpace> _bulletspace;
+        bool _bQueued; ///< true if in BulletSpace::_vqueuedinfos
 
 private:
         boost::shared_ptr<btCollisionWorld> _world;
@@ -121,8 +131,10 @@ private:
     typedef boost::shared_ptr<KinBodyInfo const> KinBodyInfoConstPtr;
     typedef boost::function<KinBodyInfoPtr(KinBodyConstPtr)> GetInfoFn;
     typedef boost::function<void (KinBodyInfoPtr)> SynchronizeCallbackFn;
+    typedef boost::function<bool (KinBodyPtr)> InitKinBodyFn;
 
     BulletSpace(EnvironmentBasePtr penv, const GetInfoFn& infofn, bool bPhysics) : _penv(penv), GetInfo(infofn), _bPhysics(bPhysics) {
+        _bSynchronizeAllBodies = false;
     }
     virtual ~BulletSpace() {
     }
@@ -134,13 +146,22 @@ private:
         btGImpactCollisionAlgorithm::registerAlgorithm((btCollisionDispatcher*)_world->getDispatcher());
         //btConcaveConcaveCollisionAlgorithm::registerAlgorithm(_world->getDispatcher());
 
+        {
+            boost::mutex::scoped_lock lockqueue(_mutexqueue);
+            _bSynchronizeAllBodies = true;
+        }
+        // bodies added later are created on the next Synchronize() even if this space does not belong to the environment's checker
+        _bodycallback = _penv->RegisterBodyCallback(boost::bind(&BulletSpace::_BodyCallback, weak_space(), _1, _2));
         return true;
     }
 
     void DestroyEnvironment()
     {
+        _bodycallback.reset();
         _world.reset();
         _worlddynamics.reset();
+        boost::mutex::scoped_lock lockqueue(_mutexqueue);
+        _vqueuedbodies.resize(0);
     }
 
     KinBodyInfoPtr InitKinBody(KinBodyPtr pbody, KinBodyInfoPtr pinfo = KinBodyInfoPtr(), btScalar fmargin=0.0005) //  -> changed fmargin because penetration was too little. For collision the values needs to be changed. There will be an XML interface for fmargin.
@@ -366,27 +387,82 @@ private:
         }
 
         pinfo->_geometrycallback = pbody->RegisterChangeCallback(KinBody::Prop_LinkGeometry, boost::bind(&BulletSpace::GeometryChangedCallback,boost::bind(&utils::sptr_from<BulletSpace>, weak_space()),KinBodyWeakPtr(pbody)));
+        pinfo->_updatestampcallback = pbody->RegisterUpdateStampCallback(boost::bind(&BulletSpace::_QueueSynchronizeCallback, weak_space(), boost::weak_ptr<KinBodyInfo>(pinfo)));
         _Synchronize(pinfo);
         return pinfo;
     }
 
     void Synchronize()
     {
-        vector<KinBodyPtr> vbodies;
-        _penv->GetBodies(vbodies);
-        FOREACHC(itbody, vbodies) {
-            KinBodyInfoPtr pinfo = GetInfo(*itbody);
-            BOOST_ASSERT( pinfo->pbody == *itbody );
-            if( pinfo->nLastStamp != (*itbody)->GetUpdateStamp() ) {
-                _Synchronize(pinfo);
+        // only the bodies whose stamp changed since they were last synchronized are queued
+        std::vector< boost::weak_ptr<KinBodyInfo> > vqueuedinfos;
+        std::vector<KinBodyWeakPtr> vqueuedbodies;
+        bool bsynchronizeall = false;
+        {
+            boost::mutex::scoped_lock lockqueue(_mutexqueue);
+            vqueuedinfos.swap(_vqueuedinfos);
+            vqueuedbodies.swap(_vqueuedbodies);
+            std::swap(bsynchronizeall, _bSynchronizeAllBodies);
+        }
+        if( !!_initfn ) {
+            if( bsynchronizeall ) {
+                vector<KinBodyPtr> vbodies;
+                _penv->GetBodies(vbodies);
+                FOREACHC(itbody, vbodies) {
+                    if( !GetInfo(*itbody) ) {
+                        _initfn(*itbody);
+                    }
+                }
+            }
+            else {
+                // bodies that were added or whose user data was removed are created lazily
+                FOREACH(itbody, vqueuedbodies) {
+                    KinBodyPtr pbody = itbody->lock();
+                    if( !!pbody && !GetInfo(pbody) && _penv->GetBodyFromEnvironmentId(pbody->GetEnvironmentId()) == pbody ) {
+                        _initfn(pbody);
+                    }
+                }
+            }
+        }
+        FOREACH(itinfo, vqueuedinfos) {
+            KinBodyInfoPtr pinfo = itinfo->lock();
+            if( !!pinfo ) {
+                pinfo->_bQueued = false;
+                pinfo->pbody->ArmUpdateStampCallbacks();
+                if( pinfo->nLastStamp != pinfo->pbody->GetUpdateStamp() ) {
+                    _Synchronize(pinfo);
+                }
             }
         }
+        vqueuedinfos.resize(0);
+        boost::mutex::scoped_lock lockqueue(_mutexqueue);
+        if( _vqueuedinfos.size() == 0 ) {
+            _vqueuedinfos.swap(vqueuedinfos);
+        }
+    }
+
+    /// \brief creates the body through the init function on the next call to Synchronize() if it is still in the environment and has no user data
+    void QueueInitialize(KinBodyPtr pbody)
+    {
+        boost::mutex::scoped_lock lockqueue(_mutexqueue);
+        _vqueuedbodies.push_back(pbody);
+    }
+
+    /// \brief forces the body to be checked on the next call to Synchronize()
+    void QueueSynchronize(KinBodyInfoPtr pinfo)
+    {
+        boost::mutex::scoped_lock lockqueue(_mutexqueue);
+        if( !pinfo->_bQueued ) {
+            pinfo->_bQueued = true;
+            _vqueuedinfos.push_back(pinfo);
+        }
     }
 
     void Synchronize(KinBodyConstPtr pbody)
     {
         KinBodyInfoPtr pinfo = GetInfo(pbody);
         BOOST_ASSERT( pinfo->pbody == pbody );
+        pbody->ArmUpdateStampCallbacks();
         if( pinfo->nLastStamp != pbody->GetUpdateStamp() ) {
             _Synchronize(pinfo);
         }
@@ -399,6 +475,56 @@ private:
         return pinfo->vlinks.at(plink->GetIndex())->obj;
     }
 
+    /// \brief returns the convex hulls of the link geometries, computed on first use
+    ///
+    /// The hulls are discarded together with the body info whenever the geometry changes.
+    convexdistance::LinkHullConstPtr GetLinkHull(KinBody::LinkConstPtr plink)
+    {
+        KinBodyInfoPtr pinfo = GetInfo(plink->GetParent());
+        if( !pinfo ) {
+            return convexdistance::LinkHullConstPtr();
+        }
+        boost::shared_ptr<KinBodyInfo::LINK> link = pinfo->vlinks.at(plink->GetIndex());
+        if( !link->_distancehull ) {
+            link->_distancehull.reset(new convexdistance::LinkHull());
+            link->_distancehull->Init(plink);
+        }
+        return link->_distancehull;
+    }
+
+    /// \brief fills the world aabb of all link shapes of the body in this space, used to cull distance queries
+    bool GetBodyAABB(KinBodyConstPtr pbody, OpenRAVE::AABB& ab)
+    {
+        KinBodyInfoPtr pinfo = GetInfo(pbody);
+        if( !pinfo ) {
+            return false;
+        }
+        bool binit = false;
+        btVector3 vmin, vmax;
+        FOREACH(itlink, pinfo->vlinks) {
+            if( !(*itlink)->obj ) {
+                continue;
+            }
+            btVector3 vlinkmin, vlinkmax;
+            (*itlink)->obj->getCollisionShape()->getAabb((*itlink)->obj->getWorldTransform(), vlinkmin, vlinkmax);
+            if( !binit ) {
+                vmin = vlinkmin;
+                vmax = vlinkmax;
+                binit = true;
+            }
+            else {
+                vmin.setMin(vlinkmin);
+                vmax.setMax(vlinkmax);
+            }
+        }
+        if( !binit ) {
+            return false;
+        }
+        ab.pos = Vector(0.5*(vmin.getX()+vmax.getX()), 0.5*(vmin.getY()+vmax.getY()), 0.5*(vmin.getZ()+vmax.getZ()));
+        ab.extents = Vector(0.5*(vmax.getX()-vmin.getX()), 0.5*(vmax.getY()-vmin.getY()), 0.5*(vmax.getZ()-vmin.getZ()));
+        return true;
+    }
+
     boost::shared_ptr<btTypedConstraint> GetJoint(KinBody::JointConstPtr pjoint)
     {
         KinBodyInfoPtr pinfo = GetInfo(pjoint->GetParent());
@@ -413,6 +539,11 @@ private:
         _synccallback = synccallback;
     }
 
+    /// \brief sets the function that initializes the bodies without user data and sets their user data, called from Synchronize()
+    void SetInitKinBodyFn(const InitKinBodyFn& initfn) {
+        _initfn = initfn;
+    }
+
     static inline Transform GetTransform(const btTransform &t)
     {
         return Transform(Vector(t.getRotation().getW(), t.getRotation().getX(), t.getRotation().getY(), t.getRotation().getZ()), Vector(t.getOrigin().getX(), t.getOrigin().getY(), t.getOrigin().getZ()));
@@ -439,6 +570,7 @@ private:
 
     void _Synchronize(KinBodyInfoPtr pinfo)
     {
+        pinfo->pbody->ArmUpdateStampCallbacks();
         vector<Transform> vtrans;
         std::vector<int> dofbranches;
         pinfo->pbody->GetLinkTransformations(vtrans,dofbranches);
@@ -452,6 +584,25 @@ private:
         }
     }
 
+    /// \brief called from the body every time its stamp changes, the body is queued once until the next Synchronize()
+    static void _QueueSynchronizeCallback(boost::weak_ptr<BulletSpace> _pspace, boost::weak_ptr<KinBodyInfo> _pinfo)
+    {
+        boost::shared_ptr<BulletSpace> pspace = _pspace.lock();
+        KinBodyInfoPtr pinfo = _pinfo.lock();
+        if( !!pspace && !!pinfo ) {
+            pspace->QueueSynchronize(pinfo);
+        }
+    }
+
+    /// \brief called from the environment when a body is added
+    static void _BodyCallback(boost::weak_ptr<BulletSpace> _pspace, KinBodyPtr pbody, int action)
+    {
+        boost::shared_ptr<BulletSpace> pspace = _pspace.lock();
+        if( !!pspace && action == 1 ) {
+            pspace->QueueInitialize(pbody);
+        }
+    }
+
     virtual void GeometryChangedCallback(KinBodyWeakPtr _pbody)
     {
         EnvironmentMutex::scoped_lock lock(_penv->GetMutex());
@@ -470,6 +621,12 @@ private:
     boost::shared_ptr<btCollisionWorld> _world;
     boost::shared_ptr<btDiscreteDynamicsWorld> _worlddynamics;
     SynchronizeCallbackFn _synccallback;
+    InitKinBodyFn _initfn;
+    std::vector< boost::weak_ptr<KinBodyInfo> > _vqueuedinfos; ///< bodies whose update stamp changed since they were last synchronized
+    std::vector<KinBodyWeakPtr> _vqueuedbodies; ///< bodies that might not have user data yet, see \ref QueueInitialize
+    bool _bSynchronizeAllBodies; ///< if true, the next Synchronize() initializes all bodies in the environment without user data
+    boost::mutex _mutexqueue; ///< protects _vqueuedinfos, _vqueuedbodies and _bSynchronizeAllBodies
+    UserDataPtr _bodycallback; ///< \see _BodyCallback
     bool _bPhysics;
 };
 
@@ -82,6 +82,10 @@ By default will sample the robot's active DOFs. Parameters part of the interface
     bias_dir is the workspace direction to bias the sampling in.\n\
     nullsampleprob, nullbiassampleprob, and deltasampleprob are in [0,1]\n\
  //");
+        RegisterCommand("SetNumThreads",boost::bind(&ConfigurationJitterer::SetNumThreadsCommand,this,_1,_2),
+                        "Samples candidates in batches that are validated on several threads, each with its own clone of the environment::\n\n\
+  numthreads [batchsize]\n\n\
+The valid candidate of the first batch that is closest to the current configuration is returned, so the result does not depend on numthreads. If numthreads is 0, candidates are validated one at a time.");
 
         bool bUseCache = false;
         std::string robotname, samplername = "MT19937";
@@ -131,9 +135,7 @@ By default will sample the robot's active DOFs. Parameters part of the interface
 
         // use for sampling, perturbations
         _curdof.resize(dof,0);
-        _newdof2.resize(dof);
         _deltadof.resize(dof);
-        _deltadof2.resize(dof);
         _nRandomGeneratorSeed = 0;
 
         _report.reset(new CollisionReport());
@@ -143,6 +145,8 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         _linkdistthresh=0.02;
         _linkdistthresh2 = _linkdistthresh*_linkdistthresh;
         _neighdistthresh = 1;
+        _nNumThreads = 0;
+        _nBatchSize = 32;
 
         _UpdateLimits();
         _limitscallback = _probot->RegisterChangeCallback(RobotBase::Prop_JointLimits, boost::bind(&ConfigurationJitterer::_UpdateLimits,this));
@@ -155,6 +159,7 @@ By default will sample the robot's active DOFs. Parameters part of the interface
     }
 
     virtual ~ConfigurationJitterer(){
+        _DestroyContexts(0);
     }
 
     virtual void SetSeed(uint32_t seed) {
@@ -354,16 +359,33 @@ By default will sample the robot's active DOFs. Parameters part of the interface
 #endif
     }
 
+    bool SetNumThreadsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int numthreads = 0, batchsize = _nBatchSize;
+        sinput >> numthreads;
+        if( !sinput || numthreads < 0 ) {
+            return false;
+        }
+        if( !sinput.eof() ) {
+            sinput >> batchsize;
+            if( !sinput || batchsize <= 0 ) {
+                return false;
+            }
+        }
+        _nNumThreads = numthreads;
+        _nBatchSize = batchsize;
+        _DestroyContexts(numthreads);
+        return true;
+    }
+
     /// \brief jitters the current configuration and sets a new configuration on the environment
     ///
+    /// If _nNumThreads > 0, the candidates are generated in batches and the valid candidate of the first batch that is closest to the current configuration is returned.
     int Sample(std::vector<dReal>& vnewdof, IntervalType interval=IT_Closed)
     {
         RobotBase::RobotStateSaver robotsaver(_probot, KinBody::Save_LinkTransformation|KinBody::Save_ActiveDOF);
         _InitRobotState();
-        const dReal linkdistthresh = _linkdistthresh;
-        const dReal linkdistthresh2 = _linkdistthresh2;
 
-        vector<AABB> newLinkAABBs;
         bool bCollision = false;
         bool bConstraintFailed = false;
         bool bConstraint = !!_neighstatefn;
@@ -433,286 +455,489 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         }
 
         BOOST_ASSERT(!_busebiasing || _vbiasdofdirection.size() > 0);
-        const boost::array<dReal, 3> rayincs = {{0.5, 0.9, 0.2}};
 
-        bool busebiasing = _busebiasing;
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        int iter = -1;
+        if( _nNumThreads > 0 && !bConstraint ) {
+            // _neighstatefn can only be called on the original robot, so constraints are always validated one at a time
+            iter = _SampleBatches(vnewdof, perturbations, interval);
+        }
+        else {
+            JitterContext context;
+            _InitContext(context, _probot);
+            for(int curiter = 0; curiter < _maxiterations; ++curiter) {
+                if( (curiter%10) == 0 ) { // not sure what a good rate is...
+                    _CallStatusFunctions(curiter);
+                }
+                if( _SampleCandidate(curiter, vnewdof, interval) && _ValidateCandidate(context, vnewdof, perturbations) ) {
+                    // the last perturbation is 0, so state is already set to the correct jittered value
+                    iter = curiter;
+                    break;
+                }
+            }
+        }
+
+        if( iter >= 0 ) {
+            if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                _probot->GetActiveDOFValues(vnewdof);
+                stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+                ss << "jitter iter=" << iter << " ";
+                for(size_t i = 0; i < vnewdof.size(); ++i ) {
+                    if( i > 0 ) {
+                        ss << "," << vnewdof[i];
+                    }
+                    else {
+                        ss << "jitteredvalues=[" << vnewdof[i];
+                    }
+                }
+                ss << "]";
+                RAVELOG_VERBOSE(ss.str());
+            }
+
+            if( _bSetResultOnRobot ) {
+                // have to release the saver so it does not restore the old configuration
+                robotsaver.Release();
+            }
+
+            RAVELOG_DEBUG_FORMAT("succeed iterations=%d, computation=%fs\n",iter%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+            //RAVELOG_VERBOSE_FORMAT("succeed iterations=%d, cachehits=%d, cache size=%d, originaldist=%f, computation=%fs\n",iter%_cachehit%cache.GetNumNodes()%cache.ComputeDistance(_curdof, vnewdof)%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+            return 1;
+        }
+
+        RAVELOG_INFO_FORMAT("failed iterations=%d, computation=%fs\n",_maxiterations%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+        //RAVELOG_WARN_FORMAT("failed iterations=%d, cachehits=%d, cache size=%d, jitter time=%fs", _maxiterations%_cachehit%cache.GetNumNodes()%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+        return 0;
+    }
+
+protected:
+    /// \brief the robot and links a candidate is validated with, every validating thread has its own
+    class JitterContext
+    {
+public:
+        RobotBasePtr probot;
+        RobotBase::ManipulatorConstPtr pmanip;
+        std::vector<KinBody::LinkPtr> vlinks; ///< indexed according to _vLinks
+        CollisionReportPtr report;
+        std::vector<dReal> vnewdof2, vdeltadof2;
+        EnvironmentBasePtr penv; ///< the cloned environment of probot, empty if probot is the original robot
+    };
+    typedef boost::shared_ptr<JitterContext> JitterContextPtr;
+
+    class JitterBatch
+    {
+public:
+        JitterBatch() : nextcandidate(0) {
+        }
+        std::vector< std::vector<dReal> > vcandidates;
+        std::vector<int> vcandidateiters; ///< the iteration each candidate was sampled in
+        std::vector<uint8_t> vvalid;
+        size_t nextcandidate; ///< first candidate that was not handed to a thread yet
+        boost::mutex mutex;
+    };
+    typedef boost::shared_ptr<JitterBatch> JitterBatchPtr;
+
+    /// \brief sets up context to validate candidates on probot, which is either _probot or its counterpart in a cloned environment
+    ///
+    /// \return false if the tracked links or the manipulator cannot be found in the environment of probot
+    bool _InitContext(JitterContext& context, RobotBasePtr probot)
+    {
+        context.probot = probot;
+        context.report.reset(new CollisionReport());
+        context.vnewdof2.resize(_curdof.size());
+        context.vdeltadof2.resize(_curdof.size());
+        if( probot == _probot ) {
+            context.pmanip = _pmanip;
+            context.vlinks = _vLinks;
+            return true;
+        }
+
+        probot->SetActiveDOFs(_vActiveIndices, _nActiveAffineDOFs, _vActiveAffineAxis);
+        if( !!_pmanip ) {
+            context.pmanip = probot->GetManipulator(_pmanip->GetName());
+            if( !context.pmanip ) {
+                return false;
+            }
+        }
+        context.vlinks.resize(_vLinks.size());
+        for(size_t i = 0; i < _vLinks.size(); ++i) {
+            // grabbed bodies are cloned along with the robot
+            KinBodyPtr pbody = probot->GetEnv()->GetKinBody(_vLinks[i]->GetParent()->GetName());
+            if( !pbody || _vLinks[i]->GetIndex() >= (int)pbody->GetLinks().size() ) {
+                return false;
+            }
+            context.vlinks[i] = pbody->GetLinks().at(_vLinks[i]->GetIndex());
+        }
+        return true;
+    }
+
+    /// \brief samples the candidate of iteration iter around _curdof and clamps it to the limits
+    ///
+    /// \return false if no candidate was sampled in this iteration or it is close to an already visited configuration
+    bool _SampleCandidate(int iter, std::vector<dReal>& vnewdof, IntervalType interval)
+    {
+        const boost::array<dReal, 3> rayincs = {{0.5, 0.9, 0.2}};
         const int nMaxIterRadiusThresh=_maxiterations/2;
         const dReal imaxiterations = 2.0/dReal(_maxiterations);
         const dReal fJitterLowerThresh=0.2, fJitterHigherThresh=0.8;
-        dReal fBias = _vbiasdirection.lengthsqr3();
-        if( fBias > g_fEpsilon ) {
-            fBias = RaveSqrt(fBias);
+        bool busebiasing = _busebiasing;
+        if( busebiasing && iter < (int)rayincs.size() ) {
+            // start by checking samples directly above the current configuration
+            for (size_t j = 0; j < vnewdof.size(); ++j) {
+                vnewdof[j] = _curdof[j] + (rayincs[iter] * _vbiasdofdirection.at(j));
+            }
         }
-
-        uint64_t starttime = utils::GetNanoPerformanceTime();
-        for(int iter = 0; iter < _maxiterations; ++iter) {
-            if( (iter%10) == 0 ) { // not sure what a good rate is...
-                _CallStatusFunctions(iter);
-            }
-            if( busebiasing && iter < (int)rayincs.size() ) {
-                // start by checking samples directly above the current configuration
-                for (size_t j = 0; j < vnewdof.size(); ++j) {
-                    vnewdof[j] = _curdof[j] + (rayincs[iter] * _vbiasdofdirection.at(j));
-                }
+        else {
+            // ramp of the jitter as iterations increase
+            dReal jitter = _maxjitter;
+            if( iter < nMaxIterRadiusThresh ) {
+                jitter = _maxjitter*dReal(iter)*imaxiterations;
             }
-            else {
-                // ramp of the jitter as iterations increase
-                dReal jitter = _maxjitter;
-                if( iter < nMaxIterRadiusThresh ) {
-                    jitter = _maxjitter*dReal(iter)*imaxiterations;
-                }
 
-                bool samplebiasdir = false;
-                bool samplenull = false;
-                bool sampledelta = false;
-                if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullsampleprob)
-                {
-                    samplenull = true;
-                }
-                if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullbiassampleprob) {
-                    samplebiasdir = true;
-                }
-                if( (!samplenull && !samplebiasdir) || _ssampler->SampleSequenceOneReal() < _deltasampleprob ) {
-                    sampledelta = true;
-                }
+            bool samplebiasdir = false;
+            bool samplenull = false;
+            bool sampledelta = false;
+            if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullsampleprob)
+            {
+                samplenull = true;
+            }
+            if (busebiasing && _ssampler->SampleSequenceOneReal() < _nullbiassampleprob) {
+                samplebiasdir = true;
+            }
+            if( (!samplenull && !samplebiasdir) || _ssampler->SampleSequenceOneReal() < _deltasampleprob ) {
+                sampledelta = true;
+            }
 
-                bool deltasuccess = false;
-                if( sampledelta ) {
-                    // check which third the sampled dof is in
-                    for(size_t j = 0; j < vnewdof.size(); ++j) {
-                        dReal f = 2*_ssampler->SampleSequenceOneReal(interval)-1; // f in [-1,1]
-                        if( RaveFabs(f) < fJitterLowerThresh ) {
-                            _deltadof[j] = 0;
-                        }
-                        else if( f < -fJitterHigherThresh ) {
-                            _deltadof[j] = -jitter;
-                        }
-                        else if( f > fJitterHigherThresh ) {
-                            _deltadof[j] = jitter;
-                        }
-                        else {
-                            _deltadof[j] = jitter*f;
-                        }
+            bool deltasuccess = false;
+            if( sampledelta ) {
+                // check which third the sampled dof is in
+                for(size_t j = 0; j < vnewdof.size(); ++j) {
+                    dReal f = 2*_ssampler->SampleSequenceOneReal(interval)-1; // f in [-1,1]
+                    if( RaveFabs(f) < fJitterLowerThresh ) {
+                        _deltadof[j] = 0;
+                    }
+                    else if( f < -fJitterHigherThresh ) {
+                        _deltadof[j] = -jitter;
+                    }
+                    else if( f > fJitterHigherThresh ) {
+                        _deltadof[j] = jitter;
+                    }
+                    else {
+                        _deltadof[j] = jitter*f;
+                    }
+                    if( _deltadof[j] != 0 ) {
+                        deltasuccess = true;
                     }
                 }
+            }
 
-                if (!samplebiasdir && !samplenull && !deltasuccess) {
-                    continue;
+            if (!samplebiasdir && !samplenull && !deltasuccess) {
+                return false;
+            }
+            // (lambda * biasdir) + (Nx) + delta + _curdofs
+            dReal fNullspaceMultiplier = _linkdistthresh*2;
+            if( fNullspaceMultiplier <= 0 ) {
+                fNullspaceMultiplier = _vbiasdirection.lengthsqr3();
+                if( fNullspaceMultiplier > g_fEpsilon ) {
+                    fNullspaceMultiplier = RaveSqrt(fNullspaceMultiplier);
+                }
+            }
+            for (size_t k = 0; k < vnewdof.size(); ++k) {
+                vnewdof[k] = _curdof[k];
+                if (samplebiasdir) {
+                    vnewdof[k] += _ssampler->SampleSequenceOneReal() * _vbiasdofdirection[k];
                 }
-                // (lambda * biasdir) + (Nx) + delta + _curdofs
-                dReal fNullspaceMultiplier = linkdistthresh*2;
-                if( fNullspaceMultiplier <= 0 ) {
-                    fNullspaceMultiplier = fBias;
+                if (sampledelta) {
+                    vnewdof[k] += _deltadof[k];
                 }
+            }
+            if (samplenull) {
+                // every nullspace vector gets its own coefficient
                 for (size_t j = 0; j < _vbiasnullspace.size(); ++j) {
-                    for (size_t k = 0; k < vnewdof.size(); ++k)
-                    {
-                        vnewdof[k] = _curdof[k];
-                        if (samplebiasdir) {
-                            vnewdof[k] += _ssampler->SampleSequenceOneReal() * _vbiasdofdirection[k];
-                        }
-                        if (samplenull) {
-                            dReal nullx = (_ssampler->SampleSequenceOneReal()*2-1)*fNullspaceMultiplier;
-                            vnewdof[k] += nullx * _vbiasnullspace[j][k];
-                        }
-                        if (sampledelta) {
-                            vnewdof[k] += _deltadof[k];
-                        }
+                    dReal nullx = (_ssampler->SampleSequenceOneReal()*2-1)*fNullspaceMultiplier;
+                    for (size_t k = 0; k < vnewdof.size(); ++k) {
+                        vnewdof[k] += nullx * _vbiasnullspace[j][k];
                     }
                 }
             }
+        }
 
-            // get new state
-            for(size_t j = 0; j < _deltadof.size(); ++j) {
-                if( vnewdof[j] > _upper.at(j) ) {
-                    vnewdof[j] = _upper.at(j);
-                }
-                else if( vnewdof[j] < _lower.at(j) ) {
-                    vnewdof[j] = _lower.at(j);
-                }
+        // get new state
+        for(size_t j = 0; j < _deltadof.size(); ++j) {
+            if( vnewdof[j] > _upper.at(j) ) {
+                vnewdof[j] = _upper.at(j);
             }
+            else if( vnewdof[j] < _lower.at(j) ) {
+                vnewdof[j] = _lower.at(j);
+            }
+        }
 
-            if( !!_cache ) {
-                if( !!_cache->FindNearestNode(vnewdof, _neighdistthresh).first ) {
-                    _cachehit++;
-                    continue;
-                }
+        if( !!_cache ) {
+            if( !!_cache->FindNearestNode(vnewdof, _neighdistthresh).first ) {
+                _cachehit++;
+                return false;
             }
+        }
 
-            //int ret = cache.InsertNode(vnewdof, CollisionReportPtr(), _neighdistthresh);
-            //BOOST_ASSERT(ret==1);
+        //int ret = cache.InsertNode(vnewdof, CollisionReportPtr(), _neighdistthresh);
+        //BOOST_ASSERT(ret==1);
+        return true;
+    }
 
-            _probot->SetActiveDOFValues(vnewdof);
-#ifdef _DEBUG
-            dReal fmaxtransdist = 0;
-#endif
-            bool bSuccess = true;
-            if( linkdistthresh > 0 ) {
-                for (size_t ilink = 0; ilink < _vLinkAABBs.size(); ++ilink) {
-                    // check for an elipse
-                    // L^2 (b*v)^2 + |v|^2|b|^4 - (b*v)^2 |b|^2 <= |b|^4 * L^2
-                    Transform tnewlink = _vLinks[ilink]->GetTransform();
-                    TransformMatrix projdelta = _vOriginalInvTransforms[ilink] * tnewlink;
-                    projdelta.m[0] -= 1;
-                    projdelta.m[5] -= 1;
-                    projdelta.m[10] -= 1;
-                    Vector projextents = _vLinkAABBs[ilink].extents;
-                    Vector projboxright(projdelta.m[0]*projextents.x, projdelta.m[4]*projextents.x, projdelta.m[8]*projextents.x);
-                    Vector projboxup(projdelta.m[1]*projextents.y, projdelta.m[5]*projextents.y, projdelta.m[9]*projextents.y);
-                    Vector projboxdir(projdelta.m[2]*projextents.z, projdelta.m[6]*projextents.z, projdelta.m[10]*projextents.z);
-                    Vector projboxpos = projdelta * _vLinkAABBs[ilink].pos;
-
-                    Vector b;
-                    if( busebiasing ) {
-                        b = _vOriginalInvTransforms[ilink].rotate(_vbiasdirection); // inside link coordinate system
-                    }
-                    else {
-                        // doesn't matter which vector we pick since it is just a sphere.
-                        b = Vector(0,0,linkdistthresh);
-                    }
+    /// \brief checks the link distance threshold, tool direction and collisions of vnewdof and all its perturbations on context.probot
+    ///
+    /// The environment of context.probot has to be locked. If successful, context.probot is left at vnewdof.
+    bool _ValidateCandidate(JitterContext& context, const std::vector<dReal>& vnewdof, const std::vector<dReal>& perturbations)
+    {
+        const dReal linkdistthresh = _linkdistthresh;
+        const dReal linkdistthresh2 = _linkdistthresh2;
+        bool busebiasing = _busebiasing;
+        // _neighstatefn works on the original robot
+        bool bConstraint = !!_neighstatefn && !context.penv;
+        context.probot->SetActiveDOFValues(vnewdof);
+        if( linkdistthresh > 0 ) {
+            for (size_t ilink = 0; ilink < _vLinkAABBs.size(); ++ilink) {
+                // check for an elipse
+                // L^2 (b*v)^2 + |v|^2|b|^4 - (b*v)^2 |b|^2 <= |b|^4 * L^2
+                Transform tnewlink = context.vlinks[ilink]->GetTransform();
+                TransformMatrix projdelta = _vOriginalInvTransforms[ilink] * tnewlink;
+                projdelta.m[0] -= 1;
+                projdelta.m[5] -= 1;
+                projdelta.m[10] -= 1;
+                Vector projextents = _vLinkAABBs[ilink].extents;
+                Vector projboxright(projdelta.m[0]*projextents.x, projdelta.m[4]*projextents.x, projdelta.m[8]*projextents.x);
+                Vector projboxup(projdelta.m[1]*projextents.y, projdelta.m[5]*projextents.y, projdelta.m[9]*projextents.y);
+                Vector projboxdir(projdelta.m[2]*projextents.z, projdelta.m[6]*projextents.z, projdelta.m[10]*projextents.z);
+                Vector projboxpos = projdelta * _vLinkAABBs[ilink].pos;
+
+                Vector b;
+                if( busebiasing ) {
+                    b = _vOriginalInvTransforms[ilink].rotate(_vbiasdirection); // inside link coordinate system
+                }
+                else {
+                    // doesn't matter which vector we pick since it is just a sphere.
+                    b = Vector(0,0,linkdistthresh);
+                }
 
-                    dReal blength2 = b.lengthsqr3();
-                    dReal blength4 = blength2*blength2;
-                    dReal rhs = blength4 * linkdistthresh2;
-                    //dReal rhs = (b.lengthsqr3()) * linkdistthresh;
-                    dReal ellipdist = 0;
-                    // now figure out what is the max distance
-                    for(int ix = 0; ix < 2; ++ix) {
-                        Vector projvx = ix > 0 ? projboxpos + projboxright : projboxpos - projboxright;
-                        for(int iy = 0; iy < 2; ++iy) {
-                            Vector projvy = iy > 0 ? projvx + projboxup : projvx - projboxup;
-                            for(int iz = 0; iz < 2; ++iz) {
-                                Vector projvz = iz > 0 ? projvy + projboxdir : projvy - projboxdir;
-                                Vector v = projvz; // inside link coordinate system
-                                dReal bv = (v.dot3(b));
-                                dReal bv2 = bv*bv;
-                                dReal flen2 = (linkdistthresh2 - blength2) * bv2 + v.lengthsqr3()*blength4;
-
-                                if( ellipdist < flen2 ) {
-                                    ellipdist = flen2;
-#ifdef _DEBUG
-                                    fmaxtransdist = flen2;
-#endif
-                                    if (ellipdist > rhs) {
-                                        bSuccess = false;
-                                        break;
-                                    }
+                dReal blength2 = b.lengthsqr3();
+                dReal blength4 = blength2*blength2;
+                dReal rhs = blength4 * linkdistthresh2;
+                //dReal rhs = (b.lengthsqr3()) * linkdistthresh;
+                dReal ellipdist = 0;
+                // now figure out what is the max distance
+                for(int ix = 0; ix < 2; ++ix) {
+                    Vector projvx = ix > 0 ? projboxpos + projboxright : projboxpos - projboxright;
+                    for(int iy = 0; iy < 2; ++iy) {
+                        Vector projvy = iy > 0 ? projvx + projboxup : projvx - projboxup;
+                        for(int iz = 0; iz < 2; ++iz) {
+                            Vector projvz = iz > 0 ? projvy + projboxdir : projvy - projboxdir;
+                            Vector v = projvz; // inside link coordinate system
+                            dReal bv = (v.dot3(b));
+                            dReal bv2 = bv*bv;
+                            dReal flen2 = (linkdistthresh2 - blength2) * bv2 + v.lengthsqr3()*blength4;
+                            if( ellipdist < flen2 ) {
+                                ellipdist = flen2;
+                                if (ellipdist > rhs) {
+                                    return false;
                                 }
                             }
-
-                            if (ellipdist > rhs) {
-                                bSuccess = false;
-                                break;
-                            }
-                        }
-                        if (ellipdist > rhs) {
-                            bSuccess = false;
-                            break;
                         }
                     }
                 }
-
-                if (!bSuccess) {
-                    continue;
-                }
             }
+        }
 
-            // check perturbation
-            bCollision = false;
-            bConstraintFailed = false;
-            FOREACH(itperturbation,perturbations) {
-                for(size_t j = 0; j < _deltadof.size(); ++j) {
-                    _deltadof2[j] = *itperturbation;
-                }
-                if( bConstraint ) {
-                    _newdof2 = vnewdof;
-                    _probot->SetActiveDOFValues(_newdof2);
-                    if( !_neighstatefn(_newdof2,_deltadof2,0) ) {
-                        if( *itperturbation != 0 ) {
-                            RAVELOG_DEBUG(str(boost::format("constraint function failed, pert=%e\n")%*itperturbation));
-                        }
-                        bConstraintFailed = true;
-                        break;
+        // check perturbation
+        FOREACHC(itperturbation,perturbations) {
+            for(size_t j = 0; j < context.vdeltadof2.size(); ++j) {
+                context.vdeltadof2[j] = *itperturbation;
+            }
+            if( bConstraint ) {
+                context.vnewdof2 = vnewdof;
+                context.probot->SetActiveDOFValues(context.vnewdof2);
+                if( !_neighstatefn(context.vnewdof2,context.vdeltadof2,0) ) {
+                    if( *itperturbation != 0 ) {
+                        RAVELOG_DEBUG(str(boost::format("constraint function failed, pert=%e\n")%*itperturbation));
                     }
+                    return false;
                 }
-                else {
-                    for(size_t j = 0; j < _deltadof.size(); ++j) {
-                        _newdof2[j] = vnewdof[j] + _deltadof2[j];
-                        if( _newdof2[j] > _upper.at(j) ) {
-                            _newdof2[j] = _upper.at(j);
-                        }
-                        else if( _newdof2[j] < _lower.at(j) ) {
-                            _newdof2[j] = _lower.at(j);
-                        }
+            }
+            else {
+                for(size_t j = 0; j < context.vdeltadof2.size(); ++j) {
+                    context.vnewdof2[j] = vnewdof[j] + context.vdeltadof2[j];
+                    if( context.vnewdof2[j] > _upper.at(j) ) {
+                        context.vnewdof2[j] = _upper.at(j);
                     }
-                }
-
-                _probot->SetActiveDOFValues(_newdof2);
-                if( !!_pConstraintToolDirection ) {
-                    if( !_pConstraintToolDirection->IsInConstraints(_pmanip->GetTransform()) ) {
-                        bConstraintFailed = true;
-                        break;
+                    else if( context.vnewdof2[j] < _lower.at(j) ) {
+                        context.vnewdof2[j] = _lower.at(j);
                     }
                 }
+            }
 
-                if( GetEnv()->CheckCollision(_probot, _report) || _probot->CheckSelfCollision(_report)) {
-                    bCollision = true;
-                    if( IS_DEBUGLEVEL(Level_Verbose) ) {
-                        stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
-                        ss << "constraints failed, ";
-                        for(size_t i = 0; i < _newdof2.size(); ++i ) {
-                            if( i > 0 ) {
-                                ss << "," << _newdof2[i];
-                            }
-                            else {
-                                ss << "colvalues=[" << _newdof2[i];
-                            }
-                        }
-                        ss << "], report=" << _report->__str__();
-                        RAVELOG_VERBOSE(ss.str());
-                    }
-                    break;
+            context.probot->SetActiveDOFValues(context.vnewdof2);
+            if( !!_pConstraintToolDirection ) {
+                if( !_pConstraintToolDirection->IsInConstraints(context.pmanip->GetTransform()) ) {
+                    return false;
                 }
             }
 
-            if( !bCollision && !bConstraintFailed ) {
-                // the last perturbation is 0, so state is already set to the correct jittered value
+            if( context.probot->GetEnv()->CheckCollision(context.probot, context.report) || context.probot->CheckSelfCollision(context.report)) {
                 if( IS_DEBUGLEVEL(Level_Verbose) ) {
-                    _probot->GetActiveDOFValues(vnewdof);
                     stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
-                    ss << "jitter iter=" << iter << " ";
-#ifdef _DEBUG
-                    ss << "maxtrans=" << fmaxtransdist << " ";
-#endif
-                    for(size_t i = 0; i < vnewdof.size(); ++i ) {
+                    ss << "constraints failed, ";
+                    for(size_t i = 0; i < context.vnewdof2.size(); ++i ) {
                         if( i > 0 ) {
-                            ss << "," << vnewdof[i];
+                            ss << "," << context.vnewdof2[i];
                         }
                         else {
-                            ss << "jitteredvalues=[" << vnewdof[i];
+                            ss << "colvalues=[" << context.vnewdof2[i];
                         }
                     }
-                    ss << "]";
+                    ss << "], report=" << context.report->__str__();
                     RAVELOG_VERBOSE(ss.str());
                 }
+                return false;
+            }
+        }
+        return true;
+    }
 
-                if( _bSetResultOnRobot ) {
-                    // have to release the saver so it does not restore the old configuration
-                    robotsaver.Release();
+    /// \brief samples all iterations in batches of _nBatchSize candidates that are validated on _nNumThreads threads
+    ///
+    /// Every batch is sampled in order on the calling thread, so the result only depends on the seed and not on the number of threads.
+    /// \return the iteration of the valid candidate of the first batch that is closest to _curdof, or -1 if none is valid. The candidate is set on _probot and vnewdof.
+    int _SampleBatches(std::vector<dReal>& vnewdof, const std::vector<dReal>& perturbations, IntervalType interval)
+    {
+        _InitContexts();
+        const std::vector<JitterContextPtr>& vcontexts = _vcontexts;
+
+        int ibestiter = -1;
+        JitterBatchPtr batch(new JitterBatch());
+        int iter = 0;
+        while( iter < _maxiterations && ibestiter < 0 ) {
+            batch->vcandidates.resize(0);
+            batch->vcandidateiters.resize(0);
+            while( iter < _maxiterations && (int)batch->vcandidates.size() < _nBatchSize ) {
+                if( (iter%10) == 0 ) { // not sure what a good rate is...
+                    _CallStatusFunctions(iter);
+                }
+                if( _SampleCandidate(iter, vnewdof, interval) ) {
+                    batch->vcandidates.push_back(vnewdof);
+                    batch->vcandidateiters.push_back(iter);
                 }
+                ++iter;
+            }
+            if( batch->vcandidates.size() == 0 ) {
+                continue;
+            }
 
-                RAVELOG_DEBUG_FORMAT("succeed iterations=%d, computation=%fs\n",iter%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
-                //RAVELOG_VERBOSE_FORMAT("succeed iterations=%d, cachehits=%d, cache size=%d, originaldist=%f, computation=%fs\n",iter%_cachehit%cache.GetNumNodes()%cache.ComputeDistance(_curdof, vnewdof)%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
-                return 1;
+            batch->vvalid.resize(0);
+            batch->vvalid.resize(batch->vcandidates.size(), 0);
+            batch->nextcandidate = 0;
+            std::vector<boost::shared_ptr<boost::thread> > listthreads(min(vcontexts.size(), batch->vcandidates.size())-1);
+            for(size_t ithread = 0; ithread < listthreads.size(); ++ithread) {
+                listthreads[ithread].reset(new boost::thread(boost::bind(&ConfigurationJitterer::_ValidateBatchThread,this,batch,vcontexts[ithread+1],boost::cref(perturbations))));
+            }
+            _ValidateBatchWorker(batch, *vcontexts[0], perturbations);
+            FOREACH(itthread,listthreads) {
+                (*itthread)->join();
+            }
+
+            // pick the closest valid candidate, ties go to the earlier one
+            dReal fbestdist = 0;
+            int ibest = -1;
+            for(size_t i = 0; i < batch->vcandidates.size(); ++i) {
+                if( batch->vvalid[i] ) {
+                    dReal fdist = 0;
+                    for(size_t j = 0; j < _curdof.size(); ++j) {
+                        dReal f = batch->vcandidates[i][j] - _curdof[j];
+                        fdist += f*f;
+                    }
+                    if( ibest < 0 || fdist < fbestdist ) {
+                        ibest = i;
+                        fbestdist = fdist;
+                    }
+                }
+            }
+            if( ibest >= 0 ) {
+                vnewdof = batch->vcandidates[ibest];
+                _probot->SetActiveDOFValues(vnewdof);
+                ibestiter = batch->vcandidateiters[ibest];
             }
         }
+        return ibestiter;
+    }
 
-        RAVELOG_INFO_FORMAT("failed iterations=%d, computation=%fs\n",_maxiterations%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
-        //RAVELOG_WARN_FORMAT("failed iterations=%d, cachehits=%d, cache size=%d, jitter time=%fs", _maxiterations%_cachehit%cache.GetNumNodes()%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
-        return 0;
+    /// \brief makes _vcontexts hold one context for each of the _nNumThreads threads
+    ///
+    /// The calling thread validates with the original robot, every other thread with a robot in its own clone of the environment.
+    /// The clones are kept between calls and only resynchronized with the current state of the environment.
+    void _InitContexts()
+    {
+        if( _vcontexts.size() == 0 ) {
+            _vcontexts.push_back(JitterContextPtr(new JitterContext()));
+        }
+        _InitContext(*_vcontexts[0], _probot);
+        _DestroyContexts(_nNumThreads);
+        for(int ithread = 1; ithread < _nNumThreads; ++ithread) {
+            JitterContextPtr context;
+            if( ithread < (int)_vcontexts.size() ) {
+                context = _vcontexts[ithread];
+                context->penv->Clone(GetEnv(), Clone_Bodies);
+            }
+            else {
+                context.reset(new JitterContext());
+                context->penv = GetEnv()->CloneSelf(Clone_Bodies);
+                _vcontexts.push_back(context);
+            }
+            RobotBasePtr probot = context->penv->GetRobot(_probot->GetName());
+            if( !probot || !_InitContext(*context, probot) ) {
+                RAVELOG_WARN(str(boost::format("failed to find robot %s in the cloned environment\n")%_probot->GetName()));
+                _DestroyContexts(ithread);
+                break;
+            }
+        }
     }
 
-protected:
+    /// \brief destroys the cloned environments of all contexts starting at index numcontexts and removes the contexts
+    void _DestroyContexts(size_t numcontexts)
+    {
+        for(size_t i = max(numcontexts, size_t(1)); i < _vcontexts.size(); ++i) {
+            _vcontexts[i]->penv->Destroy();
+        }
+        if( _vcontexts.size() > numcontexts ) {
+            _vcontexts.resize(numcontexts);
+        }
+    }
+
+    void _ValidateBatchThread(JitterBatchPtr batch, JitterContextPtr context, const std::vector<dReal>& perturbations)
+    {
+        EnvironmentMutex::scoped_lock lock(context->penv->GetMutex());
+        _ValidateBatchWorker(batch, *context, perturbations);
+    }
+
+    /// \brief validates candidates of the batch until all are handed out, the environment of context.probot should be locked
+    ///
+    /// Exceptions cannot leave the threads, so a candidate whose validation throws is logged and treated as invalid.
+    void _ValidateBatchWorker(JitterBatchPtr batch, JitterContext& context, const std::vector<dReal>& perturbations)
+    {
+        while(1) {
+            size_t icandidate;
+            {
+                boost::mutex::scoped_lock lock(batch->mutex);
+                if( batch->nextcandidate >= batch->vcandidates.size() ) {
+                    break;
+                }
+                icandidate = batch->nextcandidate++;
+            }
+            try {
+                batch->vvalid[icandidate] = _ValidateCandidate(context, batch->vcandidates[icandidate], perturbations);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_ERROR_FORMAT("env=%d, failed to validate jitter candidate %d: %s", context.probot->GetEnv()->GetId()%icandidate%ex.what());
+                batch->vvalid[icandidate] = 0;
+            }
+        }
+    }
 
     /// \brief extracts all used bodies from the configurationspecification and computes AABBs, transforms, and limits for links
     void _InitRobotState()
@@ -878,8 +1103,11 @@ protected:
     dReal _maxjitter; ///< The max deviation of a dof value to jitter. value +- maxjitter
     dReal _perturbation; ///< Test with perturbations since very small changes in angles can produce collision inconsistencies
     dReal _linkdistthresh, _linkdistthresh2; ///< the maximum distance to allow a link to move. If 0, then will disable checking
+    int _nNumThreads; ///< number of threads that validate the candidates of a batch. If 0, then candidates are sampled and validated one at a time
+    int _nBatchSize; ///< number of candidates sampled in one batch
+    std::vector<JitterContextPtr> _vcontexts; ///< the validation context of every thread, kept between calls to Sample. All except the first have a cloned environment
 
-    std::vector<dReal> _curdof, _newdof2, _deltadof, _deltadof2, _vonesample;
+    std::vector<dReal> _curdof, _deltadof, _vonesample;
 
     CacheTreePtr _cache; ///< caches the visisted configurations
     int _cachehit;
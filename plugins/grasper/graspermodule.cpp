@@ -258,6 +258,9 @@ public:
             else if( cmd == "finestep" ) {
                 sinput >> params->ffinestep;
             }
+            else if( cmd == "conservativeadvancement" ) {
+                sinput >> params->bconservativeadvancement;
+            }
             else if( cmd == "chuckingdirection" ) {
                 vchuckingdir.resize(_robot->GetActiveManipulator()->GetGripperDOF());
                 for(size_t i = 0; i < vchuckingdir.size(); ++i) {
@@ -626,6 +629,7 @@ public:
             nGraspingNoiseRetries = 0;
             forceclosurethreshold = 0;
             ffinestep = 0.001f;
+            bconservativeadvancement = false;
             bCheckGraspIK = false;
         }
 
@@ -641,6 +645,7 @@ public:
         string collisionchecker;
         dReal ftranslationstepmult;
         dReal ffinestep;
+        bool bconservativeadvancement;
 
         string manipname;
         vector<int> vactiveindices;
@@ -730,6 +735,9 @@ public:
             else if( cmd == "finestep" ) {
                 sinput >> worker_params->ffinestep;
             }
+            else if( cmd == "conservativeadvancement" ) {
+                sinput >> worker_params->bconservativeadvancement;
+            }
             else if( cmd == "numthreads" ) {
                 sinput >> numthreads;
             }
@@ -893,6 +901,7 @@ public:
             params->btightgrasp = worker_params->btightgrasp;
             params->fgraspingnoise = 0;
             params->ftranslationstepmult = worker_params->ftranslationstepmult;
+            params->bconservativeadvancement = worker_params->bconservativeadvancement;
 
             CollisionReportPtr report(new CollisionReport());
             TrajectoryBasePtr ptraj = RaveCreateTrajectory(pcloneenv,"");
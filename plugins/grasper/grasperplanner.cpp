@@ -33,7 +33,7 @@ class GrasperPlanner :  public PlannerBase
     };
 
 public:
-    GrasperPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _report(new CollisionReport()) {
+    GrasperPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _report(new CollisionReport()), _distancereport(new CollisionReport()), _bUseDistance(false) {
         __description = ":Interface Authors: Rosen Diankov, Dmitry Berenson\n\nSimple planner that performs a follow and squeeze operation of a robotic hand.";
     }
     bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
@@ -106,6 +106,13 @@ public:
         }
 
         CollisionCheckerMngr checkermngr(GetEnv(),"");
+        _bUseDistance = false;
+        if( _parameters->bconservativeadvancement ) {
+            _bUseDistance = GetEnv()->GetCollisionChecker()->SetCollisionOptions(CO_Distance);
+            if( !_bUseDistance ) {
+                RAVELOG_WARN(str(boost::format("collision checker %s does not support distance queries, using fixed steps\n")%GetEnv()->GetCollisionChecker()->GetXMLId()));
+            }
+        }
         GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
 
         // do not disable any links of the robot here!
@@ -447,6 +454,18 @@ public:
                     break;
                 }
 
+                if( _bUseDistance && coarse_pass ) {
+                    // never step less than the coarse step so the coarse/fine search behaves exactly as before close to contact
+                    step_size = _parameters->fcoarsestep*fmult;
+                    dReal fremaining = (vchuckingdir[ifing] > 0 ? vupperlim[ifing]-dofvals[ifing] : dofvals[ifing]-vlowerlim[ifing])/RaveFabs(vchuckingdir[ifing]);
+                    if( fremaining > step_size ) {
+                        dReal fsafestep = _ComputeConservativeStep(ifing, dofvals, vupperlim[ifing], _parameters->ffinestep*fmult)/RaveFabs(vchuckingdir[ifing]);
+                        if( fsafestep > step_size ) {
+                            step_size = min(fsafestep, fremaining);
+                        }
+                    }
+                }
+
                 dofvals[ifing] += vchuckingdir[ifing] * step_size;
                 _robot->SetActiveDOFValues(dofvals,KinBody::CLA_CheckLimitsSilent);
                 _robot->GetActiveDOFValues(dofvals);
@@ -600,7 +619,8 @@ protected:
         }
 
         bool bMoved = false;
-        Vector v = vapproachdir * (_parameters->fcoarsestep*_parameters->ftranslationstepmult);
+        dReal fcoarsestep = _parameters->fcoarsestep*_parameters->ftranslationstepmult;
+        Vector v = vapproachdir * fcoarsestep;
         int ct = 0;
         while(1) {
             ct = 0;
@@ -618,6 +638,13 @@ protected:
                 ptraj->Insert(ptraj->GetNumWaypoints(),dofvals, _robot->GetActiveConfigurationSpecification());
             }
 
+            if( _bUseDistance ) {
+                // the hand translates, so no point moves farther than the step
+                std::vector<KinBody::LinkConstPtr> vmovinglinks(_vlinks.begin(), _vlinks.end());
+                dReal fsafestep = 0.9*_ComputeClearance(vmovinglinks, targetbody, false);
+                v = vapproachdir * max(fcoarsestep, fsafestep);
+            }
+
             if( pX != NULL ) {
                 *pX += v.x;
             }
@@ -683,7 +710,80 @@ protected:
 
         return ct;
     }
+    /// \brief conservative advancement step of active dof ifing
+    ///
+    /// The speed of every link moved by the dof is bounded by moving the dof by fdelta and measuring how far the link's
+    /// bounding box can travel. The returned change of the dof value cannot bring any moving link closer than 10% of its
+    /// clearance. Returns 0 if nothing moves or the links are in contact.
+    dReal _ComputeConservativeStep(size_t ifing, const std::vector<dReal>& dofvals, dReal fupper, dReal fdelta)
+    {
+        _vlinktransforms.resize(_vlinks.size());
+        _vlinkaabbs.resize(_vlinks.size());
+        for(size_t i = 0; i < _vlinks.size(); ++i) {
+            _vlinktransforms[i] = _vlinks[i]->GetTransform();
+            _vlinkaabbs[i] = _vlinks[i]->ComputeAABB();
+        }
+
+        std::vector<dReal> vtempvalues = dofvals;
+        if( vtempvalues[ifing]+fdelta > fupper ) {
+            fdelta = -fdelta;
+        }
+        vtempvalues[ifing] += fdelta;
+        _robot->SetActiveDOFValues(vtempvalues,KinBody::CLA_CheckLimitsSilent);
+
+        std::vector<KinBody::LinkConstPtr> vmovinglinks;
+        dReal fmaxspeed = 0;
+        for(size_t i = 0; i < _vlinks.size(); ++i) {
+            Transform tdelta = _vlinks[i]->GetTransform() * _vlinktransforms[i].inverse();
+            dReal fangle = 2*RaveAcos(min(dReal(1),RaveFabs(tdelta.rot.x)));
+            dReal fdisplacement = RaveSqrt((tdelta*_vlinkaabbs[i].pos - _vlinkaabbs[i].pos).lengthsqr3()) + fangle*RaveSqrt(_vlinkaabbs[i].extents.lengthsqr3());
+            if( fdisplacement > g_fEpsilon*RaveFabs(fdelta) ) {
+                vmovinglinks.push_back(_vlinks[i]);
+                fmaxspeed = max(fmaxspeed, fdisplacement/RaveFabs(fdelta));
+            }
+        }
+        _robot->SetActiveDOFValues(dofvals,KinBody::CLA_CheckLimitsSilent);
+        if( vmovinglinks.size() == 0 || fmaxspeed <= 0 ) {
+            return 0;
+        }
+        return 0.9*_ComputeClearance(vmovinglinks, KinBodyPtr(), true)/fmaxspeed;
+    }
+
+    /// \brief lower bound of the distance of the links to the environment (or only targetbody if set), 0 if any link is in collision
+    ///
+    /// \param bselfcollision if true, also includes the distance to the rest of the robot
+    dReal _ComputeClearance(const std::vector<KinBody::LinkConstPtr>& vlinks, KinBodyPtr targetbody, bool bselfcollision)
+    {
+        CollisionCheckerBasePtr pchecker = GetEnv()->GetCollisionChecker();
+        CollisionOptionsStateSaver optionsaver(pchecker, CO_Distance, false);
+        dReal fclearance = 1e20;
+        FOREACHC(itlink, vlinks) {
+            bool bcollision;
+            if( !!targetbody ) {
+                bcollision = GetEnv()->CheckCollision(*itlink, KinBodyConstPtr(targetbody), _distancereport);
+            }
+            else {
+                bcollision = GetEnv()->CheckCollision(*itlink, _distancereport);
+            }
+            if( bcollision ) {
+                return 0;
+            }
+            fclearance = min(fclearance, _distancereport->minDistance);
+            if( bselfcollision ) {
+                if( pchecker->CheckStandaloneSelfCollision(*itlink, _distancereport) ) {
+                    return 0;
+                }
+                fclearance = min(fclearance, _distancereport->minDistance);
+            }
+        }
+        return fclearance;
+    }
+
     CollisionReportPtr _report;
+    CollisionReportPtr _distancereport; ///< used for the clearance queries of conservative advancement
+    bool _bUseDistance; ///< true if bconservativeadvancement is set and the collision checker supports CO_Distance
+    std::vector<Transform> _vlinktransforms;
+    std::vector<AABB> _vlinkaabbs;
     boost::shared_ptr<GraspParameters> _parameters;
     RobotBasePtr _robot;
     vector<KinBody::LinkPtr> _vAvoidLinkGeometry;
@@ -16,6 +16,7 @@
 #include "plugindefs.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
 
 #ifdef Boost_IOSTREAMS_FOUND
 #include <boost/iostreams/device/file_descriptor.hpp>
@@ -337,6 +338,17 @@ public:
 * float sampledegeneratecases - probability in [0,1] specifies the probability of sampling joint values on [-pi/2,0,pi/2] (default is 0.2).\n\n\
 * int selfcollision - if true, will check IK only for non-self colliding positions of the robot (default is 0).\n\n\
 * string robot - name of the robot to test. the active manipulator of the roobt is used.\n\n");
+        RegisterCommand("ComputeReachability",boost::bind(&IkFastModule::ComputeReachability,this,_1,_2),
+                        "Samples end effector poses on a voxel grid inside a sphere and counts the ik solutions of every (voxel, rotation) pair on several threads. "
+                        "Every thread works on its own clone of the environment with the current robot state, so the collisions are checked with the links that are currently enabled.\n"
+                        "Usage::\n\n  ComputeReachability robot name [manipname name] maxradius r xyzdelta d [center x y z] rotations N qw qx qy qz ... [usefreespace 0|1] [filteroptions N] [numthreads N] filename path\n\n"
+                        "The voxels are (ix,iy,iz)*xyzdelta+center for ix,iy,iz in [-floor(r/d),floor(r/d)) that are inside the sphere. "
+                        "If usefreespace is 1, all ik solutions are counted, otherwise only the existence of one solution is recorded. "
+                        "The result is written to filename with the native byte order as:\n\n"
+                        "  uint32 magic 0x4d52524f, uint32 version 2, uint32 numrotations, uint32 numvoxels, int32 nsteps, float64 xyzdelta, float64 center[3], "
+                        "float64 quaternions[numrotations][4], int32 voxelindices[numvoxels], uint32 counts[numvoxels][numrotations]\n\n"
+                        "where voxelindices are flat indices into the (2*nsteps)^3 grid. Version 1 stored the counts as uint8 clamped to 255.\n"
+                        "return the number of sampled voxels");
     }
 
     virtual ~IkFastModule() {
@@ -1307,6 +1319,213 @@ public:
         return true;
     }
 
+    /// \brief poses shared by the ComputeReachability threads
+    struct ReachabilityWork
+    {
+        ReachabilityWork() : filteroptions(0), busefreespace(false), nextvoxel(0) {
+        }
+        std::string robotname, manipname;
+        std::vector<Vector> vrotations; ///< quaternions of the sampled rotations
+        std::vector<Vector> vtranslations; ///< center of every sampled voxel
+        std::vector<uint32_t> vcounts; ///< vcounts[ivoxel*vrotations.size()+irotation] is the number of ik solutions
+        int filteroptions;
+        bool busefreespace;
+        boost::mutex mutex; ///< protects nextvoxel
+        size_t nextvoxel; ///< next voxel to be processed by any thread
+    };
+    typedef boost::shared_ptr<ReachabilityWork> ReachabilityWorkPtr;
+
+    bool ComputeReachability(ostream& sout, istream& sinput)
+    {
+        ReachabilityWorkPtr work(new ReachabilityWork());
+        dReal maxradius = 0, xyzdelta = 0.04;
+        Vector vcenter;
+        int numthreads = boost::thread::hardware_concurrency();
+        string filename, cmd;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+
+            if( cmd == "robot" ) {
+                sinput >> work->robotname;
+            }
+            else if( cmd == "manipname" ) {
+                sinput >> work->manipname;
+            }
+            else if( cmd == "maxradius" ) {
+                sinput >> maxradius;
+            }
+            else if( cmd == "xyzdelta" ) {
+                sinput >> xyzdelta;
+            }
+            else if( cmd == "center" ) {
+                sinput >> vcenter.x >> vcenter.y >> vcenter.z;
+            }
+            else if( cmd == "rotations" ) {
+                size_t numrotations = 0;
+                sinput >> numrotations;
+                work->vrotations.resize(numrotations);
+                FOREACH(it, work->vrotations) {
+                    sinput >> it->x >> it->y >> it->z >> it->w;
+                }
+            }
+            else if( cmd == "usefreespace" ) {
+                sinput >> work->busefreespace;
+            }
+            else if( cmd == "filteroptions" ) {
+                sinput >> work->filteroptions;
+            }
+            else if( cmd == "numthreads" ) {
+                sinput >> numthreads;
+            }
+            else if( cmd == "filename" ) {
+                sinput >> filename;
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+
+        if( filename.size() == 0 || work->vrotations.size() == 0 || maxradius <= 0 || xyzdelta <= 0 ) {
+            RAVELOG_ERROR("ComputeReachability needs filename, rotations, maxradius, and xyzdelta\n");
+            return false;
+        }
+
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        RobotBasePtr probot = GetEnv()->GetRobot(work->robotname);
+        if( !probot ) {
+            RAVELOG_ERROR(str(boost::format("could not find robot %s\n")%work->robotname));
+            return false;
+        }
+        RobotBase::ManipulatorPtr pmanip = work->manipname.size() > 0 ? probot->GetManipulator(work->manipname) : probot->GetActiveManipulator();
+        if( !pmanip || !pmanip->GetIkSolver() ) {
+            RAVELOG_ERROR(str(boost::format("robot %s manipulator %s does not have an ik solver\n")%probot->GetName()%work->manipname));
+            return false;
+        }
+        work->manipname = pmanip->GetName();
+
+        int nsteps = (int)floor(maxradius/xyzdelta);
+        std::vector<int> vvoxelindices;
+        for(int ix = -nsteps; ix < nsteps; ++ix) {
+            for(int iy = -nsteps; iy < nsteps; ++iy) {
+                for(int iz = -nsteps; iz < nsteps; ++iz) {
+                    Vector v(ix*xyzdelta, iy*xyzdelta, iz*xyzdelta);
+                    if( v.lengthsqr3() < maxradius*maxradius ) {
+                        vvoxelindices.push_back(((ix+nsteps)*2*nsteps + iy+nsteps)*2*nsteps + iz+nsteps);
+                        work->vtranslations.push_back(v+vcenter);
+                    }
+                }
+            }
+        }
+        work->vcounts.resize(work->vtranslations.size()*work->vrotations.size(), 0);
+        RAVELOG_INFO(str(boost::format("computing reachability of %s:%s for %d voxels, %d rotations, %d threads\n")%probot->GetName()%work->manipname%work->vtranslations.size()%work->vrotations.size()%numthreads));
+
+        uint32_t starttime = utils::GetMilliTime();
+        if( numthreads <= 1 ) {
+            RobotBase::RobotStateSaver saver(probot);
+            _ReachabilityWorker(work, pmanip);
+        }
+        else {
+            EnvironmentBasePtr pcloneenv = GetEnv()->CloneSelf(Clone_Bodies);
+            vector<boost::shared_ptr<boost::thread> > listthreads(numthreads);
+            FOREACH(itthread,listthreads) {
+                itthread->reset(new boost::thread(boost::bind(&IkFastModule::_ReachabilityThread,this,work,pcloneenv)));
+            }
+            FOREACH(itthread,listthreads) {
+                (*itthread)->join();
+            }
+            pcloneenv->Destroy();
+        }
+        RAVELOG_INFO(str(boost::format("reachability finished in %fs\n")%(0.001*(utils::GetMilliTime()-starttime))));
+
+        ofstream f(filename.c_str(), ios::binary);
+        if( !f ) {
+            RAVELOG_ERROR(str(boost::format("failed to open %s for writing\n")%filename));
+            return false;
+        }
+        uint32_t header[4] = { 0x4d52524f, 2, (uint32_t)work->vrotations.size(), (uint32_t)work->vtranslations.size() };
+        f.write((const char*)header, sizeof(header));
+        int32_t nsteps32 = nsteps;
+        f.write((const char*)&nsteps32, sizeof(nsteps32));
+        double values[4] = { xyzdelta, vcenter.x, vcenter.y, vcenter.z };
+        f.write((const char*)values, sizeof(values));
+        FOREACHC(itrot, work->vrotations) {
+            double quat[4] = { itrot->x, itrot->y, itrot->z, itrot->w };
+            f.write((const char*)quat, sizeof(quat));
+        }
+        if( vvoxelindices.size() > 0 ) {
+            f.write((const char*)&vvoxelindices[0], vvoxelindices.size()*sizeof(vvoxelindices[0]));
+            f.write((const char*)&work->vcounts[0], work->vcounts.size()*sizeof(work->vcounts[0]));
+        }
+        if( !f ) {
+            RAVELOG_ERROR(str(boost::format("failed to write %s\n")%filename));
+            return false;
+        }
+        sout << work->vtranslations.size();
+        return true;
+    }
+
+    void _ReachabilityThread(ReachabilityWorkPtr work, EnvironmentBasePtr penv)
+    {
+        EnvironmentBasePtr pcloneenv = penv->CloneSelf(Clone_Bodies);
+        {
+            EnvironmentMutex::scoped_lock lock(pcloneenv->GetMutex());
+            RobotBasePtr probot = pcloneenv->GetRobot(work->robotname);
+            RobotBase::ManipulatorPtr pmanip = probot->GetManipulator(work->manipname);
+            if( !pmanip->GetIkSolver() ) {
+                RAVELOG_ERROR(str(boost::format("cloned manipulator %s does not have an ik solver\n")%pmanip->GetName()));
+            }
+            else {
+                _ReachabilityWorker(work, pmanip);
+            }
+        }
+        pcloneenv->Destroy();
+    }
+
+    /// \brief processes voxels until all are done, the environment of pmanip should be locked
+    void _ReachabilityWorker(ReachabilityWorkPtr work, RobotBase::ManipulatorPtr pmanip)
+    {
+        IkParameterization ikparam;
+        vector<dReal> vsolution;
+        vector< vector<dReal> > vsolutions;
+        size_t numrotations = work->vrotations.size();
+        while(1) {
+            size_t ivoxel;
+            {
+                boost::mutex::scoped_lock lock(work->mutex);
+                if( work->nextvoxel >= work->vtranslations.size() ) {
+                    break;
+                }
+                ivoxel = work->nextvoxel++;
+            }
+            if( (ivoxel % 1000) == 0 ) {
+                RAVELOG_INFO(str(boost::format("%d/%d\n")%ivoxel%work->vtranslations.size()));
+            }
+            for(size_t irotation = 0; irotation < numrotations; ++irotation) {
+                ikparam.SetTransform6D(Transform(work->vrotations[irotation], work->vtranslations[ivoxel]));
+                size_t numsolutions = 0;
+                if( work->busefreespace ) {
+                    if( pmanip->FindIKSolutions(ikparam, vsolutions, work->filteroptions) ) {
+                        numsolutions = vsolutions.size();
+                    }
+                }
+                else if( pmanip->FindIKSolution(ikparam, vsolution, work->filteroptions) ) {
+                    numsolutions = 1;
+                }
+                work->vcounts[ivoxel*numrotations+irotation] = (uint32_t)numsolutions;
+            }
+        }
+    }
+
     static void GetIKFastCommand(std::ostream& o, const IkParameterization& globalparam, RobotBase::ManipulatorPtr pmanip)
     {
         IkParameterization param = pmanip->GetBase()->GetTransform().inverse()*globalparam;
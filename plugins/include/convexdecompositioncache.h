@@ -0,0 +1,298 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 The OpenRAVE Contributors
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/** \file convexdecompositioncache.h
+    \brief Convex decompositions of triangle meshes computed with the convexdecomposition library and cached by mesh hash.
+
+    Decompositions are kept in memory for the lifetime of the process, so bodies that are cloned or loaded again reuse
+    them. They are also written to $OPENRAVE_HOME/convexdecomposition so that later processes skip the decomposition.
+    Plugins including this file have to link with the convexdecomposition library.
+ */
+#ifndef OPENRAVE_PLUGIN_CONVEXDECOMPOSITIONCACHE_H
+#define OPENRAVE_PLUGIN_CONVEXDECOMPOSITIONCACHE_H
+
+#include "convexdistance.h"
+#include <openrave/utils.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/format.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#else
+#include <windows.h>
+#endif
+
+#include "NvConvexDecomposition.h"
+
+namespace convexdistance {
+
+/// \brief parameters of the decomposition, the defaults are the same as the convexdecomposition python database
+class ConvexDecompositionParameters
+{
+public:
+    ConvexDecompositionParameters() : skinwidth(0), decompositiondepth(8), maxhullvertices(64), concavitythresholdpercent(0.1f), mergethresholdpercent(30.0f), volumesplitthresholdpercent(0.1f), useinitialislandgeneration(true), useislandgeneration(false), busediskcache(true) {
+    }
+
+    /// \brief reads "name value" pairs until the end of the stream, returns false on an unknown name or bad value
+    bool Deserialize(std::istream& sinput)
+    {
+        std::string name;
+        while(!sinput.eof()) {
+            sinput >> name;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            if( name == "skinwidth" ) {
+                sinput >> skinwidth;
+            }
+            else if( name == "decompositiondepth" ) {
+                sinput >> decompositiondepth;
+            }
+            else if( name == "maxhullvertices" ) {
+                sinput >> maxhullvertices;
+            }
+            else if( name == "concavitythresholdpercent" ) {
+                sinput >> concavitythresholdpercent;
+            }
+            else if( name == "mergethresholdpercent" ) {
+                sinput >> mergethresholdpercent;
+            }
+            else if( name == "volumesplitthresholdpercent" ) {
+                sinput >> volumesplitthresholdpercent;
+            }
+            else if( name == "useinitialislandgeneration" ) {
+                sinput >> useinitialislandgeneration;
+            }
+            else if( name == "useislandgeneration" ) {
+                sinput >> useislandgeneration;
+            }
+            else if( name == "usediskcache" ) {
+                sinput >> busediskcache;
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized convex decomposition parameter: %s\n")%name));
+                return false;
+            }
+            if( !sinput ) {
+                RAVELOG_WARN(str(boost::format("bad value for convex decomposition parameter %s\n")%name));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief the parameters that change the result, used for the cache key
+    void Serialize(std::ostream& o) const
+    {
+        o << skinwidth << " " << decompositiondepth << " " << maxhullvertices << " " << concavitythresholdpercent << " " << mergethresholdpercent << " " << volumesplitthresholdpercent << " " << useinitialislandgeneration << " " << useislandgeneration;
+    }
+
+    float skinwidth;
+    uint32_t decompositiondepth;
+    uint32_t maxhullvertices;
+    float concavitythresholdpercent;
+    float mergethresholdpercent;
+    float volumesplitthresholdpercent;
+    bool useinitialislandgeneration;
+    bool useislandgeneration;
+    bool busediskcache; ///< if true, read and write decompositions in $OPENRAVE_HOME/convexdecomposition
+};
+
+typedef std::vector< std::vector<Vector> > ConvexHullList;
+typedef boost::shared_ptr<ConvexHullList const> ConvexHullListConstPtr;
+
+namespace detail {
+
+/// \brief version of the cache file format, stored in the file header
+static const uint32_t s_convexdecompositionversion = 0x00010000;
+
+inline std::map<std::string, ConvexHullListConstPtr>& GetConvexDecompositionCache()
+{
+    static std::map<std::string, ConvexHullListConstPtr> s_mapcache;
+    return s_mapcache;
+}
+
+inline boost::mutex& GetConvexDecompositionMutex()
+{
+    static boost::mutex s_mutex;
+    return s_mutex;
+}
+
+inline std::string GetConvexDecompositionFilename(const std::string& hash)
+{
+    return OpenRAVE::RaveGetHomeDirectory() + "/convexdecomposition/" + hash + ".hulls";
+}
+
+inline bool ReadConvexDecomposition(const std::string& filename, ConvexHullList& vhulls)
+{
+    std::ifstream f(filename.c_str(), std::ios::in|std::ios::binary);
+    if( !f ) {
+        return false;
+    }
+    uint32_t version = 0, numhulls = 0;
+    f.read((char*)&version, sizeof(version));
+    f.read((char*)&numhulls, sizeof(numhulls));
+    if( !f || version != s_convexdecompositionversion ) {
+        return false;
+    }
+    vhulls.resize(numhulls);
+    std::vector<float> vvalues;
+    for(uint32_t ihull = 0; ihull < numhulls; ++ihull) {
+        uint32_t numvertices = 0;
+        f.read((char*)&numvertices, sizeof(numvertices));
+        vvalues.resize(3*numvertices);
+        if( numvertices > 0 ) {
+            f.read((char*)&vvalues[0], vvalues.size()*sizeof(float));
+        }
+        if( !f ) {
+            return false;
+        }
+        vhulls[ihull].resize(numvertices);
+        for(uint32_t i = 0; i < numvertices; ++i) {
+            vhulls[ihull][i] = Vector(vvalues[3*i], vvalues[3*i+1], vvalues[3*i+2]);
+        }
+    }
+    return true;
+}
+
+inline void WriteConvexDecomposition(const std::string& filename, const ConvexHullList& vhulls)
+{
+    std::string dirname = OpenRAVE::RaveGetHomeDirectory() + "/convexdecomposition";
+#ifndef _WIN32
+    mkdir(dirname.c_str(),S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH | S_IRWXU);
+#else
+    CreateDirectory(dirname.c_str(),NULL);
+#endif
+    // write to a temporary file first so that other processes never read a partial file
+    std::string tempfilename = str(boost::format("%s.%d")%filename%OpenRAVE::utils::GetMicroTime());
+    {
+        std::ofstream f(tempfilename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        if( !f ) {
+            RAVELOG_VERBOSE(str(boost::format("failed to write convex decomposition cache %s\n")%filename));
+            return;
+        }
+        uint32_t version = s_convexdecompositionversion, numhulls = vhulls.size();
+        f.write((const char*)&version, sizeof(version));
+        f.write((const char*)&numhulls, sizeof(numhulls));
+        std::vector<float> vvalues;
+        for(size_t ihull = 0; ihull < vhulls.size(); ++ihull) {
+            uint32_t numvertices = vhulls[ihull].size();
+            f.write((const char*)&numvertices, sizeof(numvertices));
+            vvalues.resize(3*numvertices);
+            for(uint32_t i = 0; i < numvertices; ++i) {
+                vvalues[3*i+0] = vhulls[ihull][i].x;
+                vvalues[3*i+1] = vhulls[ihull][i].y;
+                vvalues[3*i+2] = vhulls[ihull][i].z;
+            }
+            if( numvertices > 0 ) {
+                f.write((const char*)&vvalues[0], vvalues.size()*sizeof(float));
+            }
+        }
+    }
+    if( rename(tempfilename.c_str(), filename.c_str()) != 0 ) {
+        remove(tempfilename.c_str());
+    }
+}
+
+inline void ComputeConvexDecomposition(const OpenRAVE::TriMesh& mesh, const ConvexDecompositionParameters& params, ConvexHullList& vhulls)
+{
+    boost::shared_ptr<CONVEX_DECOMPOSITION::iConvexDecomposition> ic(CONVEX_DECOMPOSITION::createConvexDecomposition(),CONVEX_DECOMPOSITION::releaseConvexDecomposition);
+    NxF32 vertices[9];
+    for(size_t i = 0; i+2 < mesh.indices.size(); i += 3) {
+        for(int j = 0; j < 3; ++j) {
+            const Vector& v = mesh.vertices.at(mesh.indices[i+j]);
+            vertices[3*j+0] = v.x; vertices[3*j+1] = v.y; vertices[3*j+2] = v.z;
+        }
+        ic->addTriangle(&vertices[0], &vertices[3], &vertices[6]);
+    }
+    ic->computeConvexDecomposition(params.skinwidth, params.decompositiondepth, params.maxhullvertices, params.concavitythresholdpercent, params.mergethresholdpercent, params.volumesplitthresholdpercent, params.useinitialislandgeneration, params.useislandgeneration, false);
+    NxU32 hullcount = ic->getHullCount();
+    vhulls.resize(0);
+    vhulls.reserve(hullcount);
+    CONVEX_DECOMPOSITION::ConvexHullResult result;
+    for(NxU32 ihull = 0; ihull < hullcount; ++ihull) {
+        if( !ic->getConvexHullResult(ihull, result) || result.mVcount == 0 ) {
+            continue;
+        }
+        vhulls.push_back(std::vector<Vector>(result.mVcount));
+        for(NxU32 i = 0; i < result.mVcount; ++i) {
+            vhulls.back()[i] = Vector(result.mVertices[3*i], result.mVertices[3*i+1], result.mVertices[3*i+2]);
+        }
+    }
+}
+
+} // end namespace detail
+
+/// \brief hash of the mesh and the parameters that change the decomposition
+inline std::string GetConvexDecompositionHash(const OpenRAVE::TriMesh& mesh, const ConvexDecompositionParameters& params)
+{
+    std::stringstream ss;
+    ss << std::setprecision(std::numeric_limits<float>::digits10+1);
+    params.Serialize(ss);
+    ss << " " << mesh.vertices.size() << " " << mesh.indices.size();
+    for(size_t i = 0; i < mesh.vertices.size(); ++i) {
+        ss << " " << (float)mesh.vertices[i].x << " " << (float)mesh.vertices[i].y << " " << (float)mesh.vertices[i].z;
+    }
+    for(size_t i = 0; i < mesh.indices.size(); ++i) {
+        ss << " " << mesh.indices[i];
+    }
+    return OpenRAVE::utils::GetMD5HashString(ss.str());
+}
+
+/// \brief returns the convex pieces of the mesh, computing them only if neither the memory nor the disk cache has them
+///
+/// Safe to call from several threads, meshes are decomposed one at a time.
+inline ConvexHullListConstPtr GetConvexDecomposition(const OpenRAVE::TriMesh& mesh, const ConvexDecompositionParameters& params)
+{
+    std::string hash = GetConvexDecompositionHash(mesh, params);
+    boost::mutex::scoped_lock lock(detail::GetConvexDecompositionMutex());
+    std::map<std::string, ConvexHullListConstPtr>& mapcache = detail::GetConvexDecompositionCache();
+    std::map<std::string, ConvexHullListConstPtr>::iterator it = mapcache.find(hash);
+    if( it != mapcache.end() ) {
+        return it->second;
+    }
+
+    boost::shared_ptr<ConvexHullList> phulls(new ConvexHullList());
+    std::string filename = detail::GetConvexDecompositionFilename(hash);
+    if( !params.busediskcache || !detail::ReadConvexDecomposition(filename, *phulls) ) {
+        uint64_t starttime = OpenRAVE::utils::GetMicroTime();
+        detail::ComputeConvexDecomposition(mesh, params, *phulls);
+        RAVELOG_DEBUG(str(boost::format("decomposed mesh with %d triangles into %d convex hulls in %fs\n")%(mesh.indices.size()/3)%phulls->size()%((OpenRAVE::utils::GetMicroTime()-starttime)*1e-6)));
+        if( params.busediskcache ) {
+            detail::WriteConvexDecomposition(filename, *phulls);
+        }
+    }
+    mapcache[hash] = phulls;
+    return phulls;
+}
+
+/// \brief DecomposeMeshFn for LinkHull::Init using the cache
+inline void DecomposeMesh(const OpenRAVE::TriMesh& mesh, std::vector< std::vector<Vector> >& vhulls, const ConvexDecompositionParameters& params)
+{
+    ConvexHullListConstPtr phulls = GetConvexDecomposition(mesh, params);
+    vhulls = *phulls;
+}
+
+} // end namespace convexdistance
+
+#endif
@@ -0,0 +1,1039 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 The OpenRAVE Contributors
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/** \file convexdistance.h
+    \brief Distance and penetration depth between the convex hulls of link geometries using GJK and EPA.
+
+    Used by the collision checkers that do not have their own distance query. Triangle meshes are replaced by their
+    convex hull, so for non-convex meshes the returned distance is a lower bound of the true distance. Checkers that
+    pass a DecomposeMeshFn get one hull per convex piece of the mesh instead, see convexdecompositioncache.h.
+ */
+#ifndef OPENRAVE_PLUGIN_CONVEXDISTANCE_H
+#define OPENRAVE_PLUGIN_CONVEXDISTANCE_H
+
+#include <openrave/openrave.h>
+#include <boost/function.hpp>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace convexdistance {
+
+using OpenRAVE::dReal;
+using OpenRAVE::Vector;
+using OpenRAVE::Transform;
+using OpenRAVE::KinBody;
+using OpenRAVE::KinBodyConstPtr;
+using OpenRAVE::KinBodyPtr;
+using OpenRAVE::CollisionReport;
+using OpenRAVE::CollisionReportPtr;
+
+/// \brief convex shape attached to a link, all values are in the link coordinate system
+class ConvexShape
+{
+public:
+    ConvexShape() : bCylinder(false), cylinderradius(0), cylinderhalfheight(0), margin(0), radius(0) {
+    }
+
+    /// \brief point of the core (the shape without the margin) furthest in direction d
+    inline Vector Support(const Vector& d) const
+    {
+        if( bCylinder ) {
+            Vector dlocal = tcylinderinv.rotate(d);
+            Vector p(0,0,dlocal.z >= 0 ? cylinderhalfheight : -cylinderhalfheight);
+            dReal fxy = OpenRAVE::RaveSqrt(dlocal.x*dlocal.x+dlocal.y*dlocal.y);
+            if( fxy > 1e-10 ) {
+                p.x = dlocal.x*(cylinderradius/fxy);
+                p.y = dlocal.y*(cylinderradius/fxy);
+            }
+            return tcylinder*p;
+        }
+        size_t ibest = 0;
+        dReal fbest = vpoints[0].dot3(d);
+        for(size_t i = 1; i < vpoints.size(); ++i) {
+            dReal f = vpoints[i].dot3(d);
+            if( f > fbest ) {
+                fbest = f;
+                ibest = i;
+            }
+        }
+        return vpoints[ibest];
+    }
+
+    std::vector<Vector> vpoints; ///< vertices of the core when not a cylinder
+    bool bCylinder; ///< if true, the core is a cylinder along the z-axis of tcylinder
+    Transform tcylinder, tcylinderinv;
+    dReal cylinderradius, cylinderhalfheight;
+    dReal margin; ///< the shape contains all points within margin of the core, used for spheres
+    Vector center; ///< center of the bounding sphere
+    dReal radius; ///< radius of the bounding sphere, includes the margin
+};
+
+/// \brief lexicographic order of the coordinates, used to remove duplicate vertices
+inline bool ComparePoints(const Vector& p1, const Vector& p2)
+{
+    if( p1.x != p2.x ) {
+        return p1.x < p2.x;
+    }
+    if( p1.y != p2.y ) {
+        return p1.y < p2.y;
+    }
+    return p1.z < p2.z;
+}
+
+inline bool EqualPoints(const Vector& p1, const Vector& p2)
+{
+    return p1.x == p2.x && p1.y == p2.y && p1.z == p2.z;
+}
+
+/// \brief splits a triangle mesh into convex pieces, fills the vertices of each piece in the mesh coordinate system
+typedef boost::function<void(const OpenRAVE::TriMesh&, std::vector< std::vector<Vector> >&)> DecomposeMeshFn;
+
+/// \brief the convex shapes of all the geometries of a link
+class LinkHull
+{
+public:
+    LinkHull() : radius(0) {
+    }
+
+    /// \brief initializes from the geometries of the link, or from the geometry group if the link has it
+    ///
+    /// \param decomposefn if set, every triangle mesh becomes one shape per convex piece instead of a single hull
+    void Init(KinBody::LinkConstPtr plink, const std::string& geometrygroup=std::string(), const DecomposeMeshFn& decomposefn=DecomposeMeshFn())
+    {
+        vshapes.resize(0);
+        if( geometrygroup.size() > 0 && plink->GetGroupNumGeometries(geometrygroup) >= 0 ) {
+            const std::vector<KinBody::GeometryInfoPtr>& vgeometryinfos = plink->GetGeometriesFromGroup(geometrygroup);
+            for(size_t i = 0; i < vgeometryinfos.size(); ++i) {
+                _AddGeometry(*vgeometryinfos[i], decomposefn);
+            }
+        }
+        else {
+            const std::vector<KinBody::Link::GeometryPtr>& vgeometries = plink->GetGeometries();
+            for(size_t i = 0; i < vgeometries.size(); ++i) {
+                _AddGeometry(vgeometries[i]->GetInfo(), decomposefn);
+            }
+        }
+
+        if( vshapes.size() == 0 ) {
+            radius = 0;
+            return;
+        }
+        Vector vmin = vshapes[0].center, vmax = vshapes[0].center;
+        for(size_t i = 1; i < vshapes.size(); ++i) {
+            for(int j = 0; j < 3; ++j) {
+                vmin[j] = std::min(vmin[j], vshapes[i].center[j]);
+                vmax[j] = std::max(vmax[j], vshapes[i].center[j]);
+            }
+        }
+        center = 0.5*(vmin+vmax);
+        radius = 0;
+        for(size_t i = 0; i < vshapes.size(); ++i) {
+            radius = std::max(radius, OpenRAVE::RaveSqrt((vshapes[i].center-center).lengthsqr3()) + vshapes[i].radius);
+        }
+    }
+
+    std::vector<ConvexShape> vshapes;
+    Vector center; ///< center of the bounding sphere of all shapes
+    dReal radius; ///< radius of the bounding sphere of all shapes
+
+private:
+    void _AddGeometry(const KinBody::GeometryInfo& info, const DecomposeMeshFn& decomposefn)
+    {
+        ConvexShape shape;
+        switch(info._type) {
+        case OpenRAVE::GT_Box: {
+            const Vector& extents = info._vGeomData;
+            for(int i = 0; i < 8; ++i) {
+                shape.vpoints.push_back(info._t*Vector(i&1 ? extents.x : -extents.x, i&2 ? extents.y : -extents.y, i&4 ? extents.z : -extents.z));
+            }
+            break;
+        }
+        case OpenRAVE::GT_Sphere:
+            shape.vpoints.push_back(info._t.trans);
+            shape.margin = info._vGeomData.x;
+            break;
+        case OpenRAVE::GT_Cylinder:
+            shape.bCylinder = true;
+            shape.tcylinder = info._t;
+            shape.tcylinderinv = info._t.inverse();
+            shape.cylinderradius = info._vGeomData.x;
+            shape.cylinderhalfheight = 0.5*info._vGeomData.y;
+            shape.center = info._t.trans;
+            shape.radius = OpenRAVE::RaveSqrt(shape.cylinderradius*shape.cylinderradius + shape.cylinderhalfheight*shape.cylinderhalfheight);
+            vshapes.push_back(shape);
+            return;
+        default:
+            if( !!decomposefn && info._meshcollision.indices.size() > 0 ) {
+                std::vector< std::vector<Vector> > vhulls;
+                decomposefn(info._meshcollision, vhulls);
+                if( vhulls.size() > 0 ) {
+                    for(size_t ihull = 0; ihull < vhulls.size(); ++ihull) {
+                        ConvexShape hullshape;
+                        hullshape.vpoints.resize(vhulls[ihull].size());
+                        for(size_t i = 0; i < hullshape.vpoints.size(); ++i) {
+                            hullshape.vpoints[i] = info._t*vhulls[ihull][i];
+                        }
+                        _AddShape(hullshape);
+                    }
+                    return;
+                }
+            }
+            shape.vpoints.resize(info._meshcollision.vertices.size());
+            for(size_t i = 0; i < shape.vpoints.size(); ++i) {
+                shape.vpoints[i] = info._t*info._meshcollision.vertices[i];
+            }
+            break;
+        }
+        _AddShape(shape);
+    }
+
+    /// \brief computes the bounding sphere of a shape made of points and adds it
+    ///
+    /// Meshes usually repeat every vertex for each of its triangles, so the duplicates are removed to make the support
+    /// function cheaper. The points are not reduced to the vertices of their convex hull.
+    void _AddShape(ConvexShape& shape)
+    {
+        if( shape.vpoints.size() == 0 ) {
+            return;
+        }
+        std::sort(shape.vpoints.begin(), shape.vpoints.end(), ComparePoints);
+        shape.vpoints.erase(std::unique(shape.vpoints.begin(), shape.vpoints.end(), EqualPoints), shape.vpoints.end());
+        Vector vmin = shape.vpoints[0], vmax = shape.vpoints[0];
+        for(size_t i = 1; i < shape.vpoints.size(); ++i) {
+            for(int j = 0; j < 3; ++j) {
+                vmin[j] = std::min(vmin[j], shape.vpoints[i][j]);
+                vmax[j] = std::max(vmax[j], shape.vpoints[i][j]);
+            }
+        }
+        shape.center = 0.5*(vmin+vmax);
+        shape.radius = 0;
+        for(size_t i = 0; i < shape.vpoints.size(); ++i) {
+            shape.radius = std::max(shape.radius, (shape.vpoints[i]-shape.center).lengthsqr3());
+        }
+        shape.radius = OpenRAVE::RaveSqrt(shape.radius) + shape.margin;
+        vshapes.push_back(shape);
+    }
+};
+
+typedef boost::shared_ptr<LinkHull> LinkHullPtr;
+typedef boost::shared_ptr<LinkHull const> LinkHullConstPtr;
+
+/// \brief result of a distance query between two shapes
+class DistanceResult
+{
+public:
+    DistanceResult() : distance(1e20) {
+    }
+    dReal distance; ///< signed distance, negative is the penetration depth
+    Vector p1, p2; ///< closest points on each shape in world coordinates, or the deepest points when penetrating
+    Vector normal; ///< unit direction from the first shape towards the second
+};
+
+/// \brief a link hull placed in the world
+class LinkHullInstance
+{
+public:
+    LinkHullInstance() {
+    }
+    LinkHullInstance(KinBody::LinkConstPtr plink, LinkHullConstPtr phull) : plink(plink), phull(phull), t(plink->GetTransform()) {
+        center = t*phull->center;
+    }
+    KinBody::LinkConstPtr plink;
+    LinkHullConstPtr phull;
+    Transform t;
+    Vector center; ///< center of the bounding sphere in the world
+};
+
+/// \brief returns the hull of a link from the space of the checker, or an empty pointer if the link is not in the space
+typedef boost::function<LinkHullConstPtr(KinBody::LinkConstPtr)> GetLinkHullFn;
+
+/// \brief appends the link if its hull is available
+inline void AddLink(KinBody::LinkConstPtr plink, const GetLinkHullFn& gethull, std::vector<LinkHullInstance>& vlinks)
+{
+    LinkHullConstPtr phull = gethull(plink);
+    if( !!phull ) {
+        vlinks.push_back(LinkHullInstance(plink, phull));
+    }
+}
+
+/// \brief appends the enabled links of pbody and all bodies attached to it
+inline void AddBodyLinks(KinBodyConstPtr pbody, const GetLinkHullFn& gethull, std::vector<LinkHullInstance>& vlinks, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded=std::vector<KinBody::LinkConstPtr>())
+{
+    std::set<KinBodyPtr> setattached;
+    pbody->GetAttached(setattached);
+    for(std::set<KinBodyPtr>::iterator itbody = setattached.begin(); itbody != setattached.end(); ++itbody) {
+        const std::vector<KinBody::LinkPtr>& vbodylinks = (*itbody)->GetLinks();
+        for(size_t i = 0; i < vbodylinks.size(); ++i) {
+            if( vbodylinks[i]->IsEnabled() && std::find(vlinkexcluded.begin(), vlinkexcluded.end(), vbodylinks[i]) == vlinkexcluded.end() ) {
+                AddLink(vbodylinks[i], gethull, vlinks);
+            }
+        }
+    }
+}
+
+/// \brief fills the world aabb of all geometries of a body in the space of the checker, returns false if the body is not in the space
+typedef boost::function<bool(KinBodyConstPtr, OpenRAVE::AABB&)> GetBodyAABBFn;
+
+namespace detail {
+
+/// \brief vertex of the Minkowski difference A-B with the points of A and B it came from
+struct SupportPoint
+{
+    Vector w, a, b;
+};
+
+/// \brief support mapping of the Minkowski difference of two shapes placed in the world
+class ShapePair
+{
+public:
+    ShapePair(const ConvexShape& s1, const Transform& t1, const ConvexShape& s2, const Transform& t2) : _s1(s1), _s2(s2), _t1(t1), _t2(t2), _t1inv(t1.inverse()), _t2inv(t2.inverse()) {
+    }
+
+    /// \brief support of A-B in direction d
+    inline void Support(const Vector& d, SupportPoint& p) const
+    {
+        p.a = _t1*_s1.Support(_t1inv.rotate(d));
+        p.b = _t2*_s2.Support(_t2inv.rotate(-d));
+        p.w = p.a - p.b;
+    }
+
+    const ConvexShape& _s1, &_s2;
+    Transform _t1, _t2, _t1inv, _t2inv;
+};
+
+/// \brief closest point to the origin on triangle a,b,c, see Ericson's Real-Time Collision Detection 5.1.5
+///
+/// \param lambdas barycentric coordinates of the closest point, zero for the vertices not in the supporting sub-simplex
+inline Vector ClosestOnTriangle(const Vector& a, const Vector& b, const Vector& c, dReal lambdas[3])
+{
+    Vector ab = b-a, ac = c-a;
+    dReal d1 = -ab.dot3(a), d2 = -ac.dot3(a);
+    lambdas[0] = 1; lambdas[1] = 0; lambdas[2] = 0;
+    if( d1 <= 0 && d2 <= 0 ) {
+        return a;
+    }
+    dReal d3 = -ab.dot3(b), d4 = -ac.dot3(b);
+    if( d3 >= 0 && d4 <= d3 ) {
+        lambdas[0] = 0; lambdas[1] = 1;
+        return b;
+    }
+    dReal vc = d1*d4 - d3*d2;
+    if( vc <= 0 && d1 >= 0 && d3 <= 0 ) {
+        dReal v = d1/(d1-d3);
+        lambdas[0] = 1-v; lambdas[1] = v;
+        return a + ab*v;
+    }
+    dReal d5 = -ab.dot3(c), d6 = -ac.dot3(c);
+    if( d6 >= 0 && d5 <= d6 ) {
+        lambdas[0] = 0; lambdas[2] = 1;
+        return c;
+    }
+    dReal vb = d5*d2 - d1*d6;
+    if( vb <= 0 && d2 >= 0 && d6 <= 0 ) {
+        dReal w = d2/(d2-d6);
+        lambdas[0] = 1-w; lambdas[2] = w;
+        return a + ac*w;
+    }
+    dReal va = d3*d6 - d5*d4;
+    if( va <= 0 && (d4-d3) >= 0 && (d5-d6) >= 0 ) {
+        dReal w = (d4-d3)/((d4-d3)+(d5-d6));
+        lambdas[0] = 0; lambdas[1] = 1-w; lambdas[2] = w;
+        return b + (c-b)*w;
+    }
+    dReal denom = 1/(va+vb+vc);
+    dReal v = vb*denom, w = vc*denom;
+    lambdas[0] = 1-v-w; lambdas[1] = v; lambdas[2] = w;
+    return a + ab*v + ac*w;
+}
+
+/// \brief reduces the simplex to the sub-simplex supporting the point closest to the origin
+///
+/// \return false if the origin is inside the tetrahedron
+inline bool ReduceSimplex(SupportPoint simplex[4], int& num, dReal lambdas[4], Vector& v)
+{
+    switch(num) {
+    case 1:
+        lambdas[0] = 1;
+        v = simplex[0].w;
+        return true;
+    case 2: {
+        Vector ab = simplex[1].w - simplex[0].w;
+        dReal fdenom = ab.lengthsqr3();
+        dReal t = fdenom > 0 ? -simplex[0].w.dot3(ab)/fdenom : 0;
+        if( t <= 0 ) {
+            num = 1; lambdas[0] = 1;
+        }
+        else if( t >= 1 ) {
+            simplex[0] = simplex[1];
+            num = 1; lambdas[0] = 1;
+        }
+        else {
+            lambdas[0] = 1-t; lambdas[1] = t;
+        }
+        break;
+    }
+    case 3: {
+        dReal l[3];
+        ClosestOnTriangle(simplex[0].w, simplex[1].w, simplex[2].w, l);
+        int newnum = 0;
+        for(int i = 0; i < 3; ++i) {
+            if( l[i] > 0 ) {
+                simplex[newnum] = simplex[i];
+                lambdas[newnum++] = l[i];
+            }
+        }
+        num = newnum;
+        break;
+    }
+    case 4: {
+        // check the faces whose outside contains the origin and keep the closest
+        static const int s_faces[4][4] = { {0,1,2,3}, {0,2,3,1}, {0,3,1,2}, {1,3,2,0} };
+        dReal fbest = -1, lbest[3] = {0,0,0};
+        int ibest = -1;
+        for(int iface = 0; iface < 4; ++iface) {
+            const Vector& a = simplex[s_faces[iface][0]].w, &b = simplex[s_faces[iface][1]].w, &c = simplex[s_faces[iface][2]].w, &d = simplex[s_faces[iface][3]].w;
+            Vector n = (b-a).cross(c-a);
+            dReal signorigin = -a.dot3(n), signd = (d-a).dot3(n);
+            if( OpenRAVE::RaveFabs(signd) > 1e-12 && signorigin*signd >= 0 ) {
+                continue;
+            }
+            dReal l[3];
+            Vector p = ClosestOnTriangle(a, b, c, l);
+            dReal f = p.lengthsqr3();
+            if( ibest < 0 || f < fbest ) {
+                fbest = f;
+                ibest = iface;
+                lbest[0] = l[0]; lbest[1] = l[1]; lbest[2] = l[2];
+            }
+        }
+        if( ibest < 0 ) {
+            return false;
+        }
+        SupportPoint face[3] = { simplex[s_faces[ibest][0]], simplex[s_faces[ibest][1]], simplex[s_faces[ibest][2]] };
+        int newnum = 0;
+        for(int i = 0; i < 3; ++i) {
+            if( lbest[i] > 0 ) {
+                simplex[newnum] = face[i];
+                lambdas[newnum++] = lbest[i];
+            }
+        }
+        num = newnum;
+        break;
+    }
+    }
+    v = Vector(0,0,0);
+    for(int i = 0; i < num; ++i) {
+        v += simplex[i].w*lambdas[i];
+    }
+    return true;
+}
+
+enum GJKStatus
+{
+    GJK_Separated = 0,
+    GJK_Overlapping = 1,
+    GJK_FartherThanBound = 2, ///< stopped early since the distance is at least the given bound
+};
+
+/// \brief distance between the cores of the two shapes
+///
+/// \param upperbound stop as soon as the distance is proven to be at least this much
+/// \param simplex on return, the final simplex. When overlapping, its points are used to start EPA.
+inline GJKStatus GJK(const ShapePair& pair, dReal upperbound, SupportPoint simplex[4], int& num, dReal lambdas[4], Vector& v)
+{
+    pair.Support(Vector(1,0,0), simplex[0]);
+    num = 1;
+    lambdas[0] = 1;
+    v = simplex[0].w;
+    for(int iter = 0; iter < 64; ++iter) {
+        dReal vv = v.lengthsqr3();
+        if( vv < 1e-20 ) {
+            return GJK_Overlapping;
+        }
+        SupportPoint p;
+        pair.Support(-v, p);
+        dReal vw = v.dot3(p.w);
+        if( vw > 0 && vw*vw > vv*upperbound*upperbound ) {
+            return GJK_FartherThanBound;
+        }
+        if( vv - vw <= 1e-10*vv ) {
+            break;
+        }
+        bool bduplicate = false;
+        for(int i = 0; i < num; ++i) {
+            if( (simplex[i].w - p.w).lengthsqr3() < 1e-20 ) {
+                bduplicate = true;
+            }
+        }
+        if( bduplicate ) {
+            break;
+        }
+        simplex[num++] = p;
+        Vector vnew;
+        if( !ReduceSimplex(simplex, num, lambdas, vnew) ) {
+            return GJK_Overlapping;
+        }
+        if( vnew.lengthsqr3() >= vv ) {
+            // no progress because of numerical precision
+            break;
+        }
+        v = vnew;
+    }
+    return GJK_Separated;
+}
+
+/// \brief adds support points until the simplex is a tetrahedron, returns false if the Minkowski difference is flat
+inline bool CompleteTetrahedron(const ShapePair& pair, SupportPoint simplex[4], int& num)
+{
+    static const Vector s_axes[6] = { Vector(1,0,0), Vector(-1,0,0), Vector(0,1,0), Vector(0,-1,0), Vector(0,0,1), Vector(0,0,-1) };
+    if( num == 0 ) {
+        pair.Support(s_axes[0], simplex[0]);
+        num = 1;
+    }
+    if( num == 1 ) {
+        for(int i = 0; i < 6 && num == 1; ++i) {
+            pair.Support(s_axes[i], simplex[1]);
+            if( (simplex[1].w - simplex[0].w).lengthsqr3() > 1e-16 ) {
+                num = 2;
+            }
+        }
+    }
+    if( num == 2 ) {
+        Vector d = simplex[1].w - simplex[0].w;
+        for(int i = 0; i < 6 && num == 2; ++i) {
+            Vector dir = d.cross(s_axes[i]);
+            if( dir.lengthsqr3() < 1e-16 ) {
+                continue;
+            }
+            pair.Support(dir, simplex[2]);
+            if( d.cross(simplex[2].w - simplex[0].w).lengthsqr3() > 1e-16 ) {
+                num = 3;
+            }
+        }
+    }
+    if( num == 3 ) {
+        Vector n = (simplex[1].w - simplex[0].w).cross(simplex[2].w - simplex[0].w);
+        for(int i = 0; i < 2 && num == 3; ++i) {
+            pair.Support(i == 0 ? n : -n, simplex[3]);
+            if( OpenRAVE::RaveFabs(n.dot3(simplex[3].w - simplex[0].w)) > 1e-16 ) {
+                num = 4;
+            }
+        }
+    }
+    return num == 4;
+}
+
+struct EPAFace
+{
+    int indices[3];
+    Vector normal;
+    dReal distance;
+    bool bValid;
+};
+
+inline bool SetEPAFace(const std::vector<SupportPoint>& vertices, int i0, int i1, int i2, EPAFace& face)
+{
+    face.indices[0] = i0; face.indices[1] = i1; face.indices[2] = i2;
+    face.normal = (vertices[i1].w - vertices[i0].w).cross(vertices[i2].w - vertices[i0].w);
+    dReal flen = face.normal.lengthsqr3();
+    if( flen < 1e-24 ) {
+        return false;
+    }
+    face.normal *= 1/OpenRAVE::RaveSqrt(flen);
+    face.distance = face.normal.dot3(vertices[i0].w);
+    face.bValid = true;
+    return true;
+}
+
+/// \brief penetration depth of overlapping cores with the expanding polytope algorithm
+///
+/// \param simplex tetrahedron of the Minkowski difference containing the origin
+inline bool EPA(const ShapePair& pair, const SupportPoint simplex[4], DistanceResult& result)
+{
+    std::vector<SupportPoint> vertices(simplex, simplex+4);
+    std::vector<EPAFace> faces;
+    faces.reserve(64);
+    static const int s_faces[4][3] = { {0,1,2}, {0,3,1}, {0,2,3}, {1,3,2} };
+    for(int i = 0; i < 4; ++i) {
+        // orient all faces away from the opposite vertex
+        const int* f = s_faces[i];
+        int iopposite = 6 - f[0] - f[1] - f[2];
+        Vector n = (vertices[f[1]].w - vertices[f[0]].w).cross(vertices[f[2]].w - vertices[f[0]].w);
+        EPAFace face;
+        bool bset = n.dot3(vertices[iopposite].w - vertices[f[0]].w) > 0 ? SetEPAFace(vertices, f[0], f[2], f[1], face) : SetEPAFace(vertices, f[0], f[1], f[2], face);
+        if( !bset ) {
+            return false;
+        }
+        faces.push_back(face);
+    }
+
+    std::vector< std::pair<int,int> > vhorizon;
+    int ibest = 0;
+    for(int iter = 0; iter < 64; ++iter) {
+        ibest = -1;
+        for(size_t i = 0; i < faces.size(); ++i) {
+            if( faces[i].bValid && (ibest < 0 || faces[i].distance < faces[ibest].distance) ) {
+                ibest = i;
+            }
+        }
+        if( ibest < 0 ) {
+            return false;
+        }
+        SupportPoint p;
+        pair.Support(faces[ibest].normal, p);
+        if( faces[ibest].normal.dot3(p.w) - faces[ibest].distance <= 1e-8 + 1e-6*OpenRAVE::RaveFabs(faces[ibest].distance) ) {
+            break;
+        }
+        vertices.push_back(p);
+        int inew = (int)vertices.size()-1;
+        vhorizon.resize(0);
+        for(size_t i = 0; i < faces.size(); ++i) {
+            if( !faces[i].bValid || faces[i].normal.dot3(p.w - vertices[faces[i].indices[0]].w) <= 0 ) {
+                continue;
+            }
+            faces[i].bValid = false;
+            for(int j = 0; j < 3; ++j) {
+                std::pair<int,int> edge(faces[i].indices[j], faces[i].indices[(j+1)%3]);
+                std::vector< std::pair<int,int> >::iterator itreverse = std::find(vhorizon.begin(), vhorizon.end(), std::make_pair(edge.second, edge.first));
+                if( itreverse != vhorizon.end() ) {
+                    vhorizon.erase(itreverse);
+                }
+                else {
+                    vhorizon.push_back(edge);
+                }
+            }
+        }
+        for(size_t i = 0; i < vhorizon.size(); ++i) {
+            EPAFace face;
+            if( SetEPAFace(vertices, vhorizon[i].first, vhorizon[i].second, inew, face) ) {
+                faces.push_back(face);
+            }
+        }
+    }
+
+    // barycentric coordinates of the projection of the origin on the closest face
+    const EPAFace& face = faces[ibest];
+    const SupportPoint& s0 = vertices[face.indices[0]], &s1 = vertices[face.indices[1]], &s2 = vertices[face.indices[2]];
+    Vector q = face.normal*face.distance;
+    Vector e0 = s1.w - s0.w, e1 = s2.w - s0.w, e2 = q - s0.w;
+    dReal d00 = e0.dot3(e0), d01 = e0.dot3(e1), d11 = e1.dot3(e1), d20 = e2.dot3(e0), d21 = e2.dot3(e1);
+    dReal denom = d00*d11 - d01*d01;
+    dReal l1 = 0, l2 = 0;
+    if( OpenRAVE::RaveFabs(denom) > 1e-24 ) {
+        l1 = (d11*d20 - d01*d21)/denom;
+        l2 = (d00*d21 - d01*d20)/denom;
+    }
+    dReal l0 = 1-l1-l2;
+    result.p1 = s0.a*l0 + s1.a*l1 + s2.a*l2;
+    result.p2 = s0.b*l0 + s1.b*l1 + s2.b*l2;
+    result.normal = face.normal;
+    result.distance = -face.distance;
+    return true;
+}
+
+} // end namespace detail
+
+/// \brief signed distance between two shapes placed at t1 and t2
+///
+/// \param upperbound only distances smaller than this are computed
+/// \return true if the distance is smaller than upperbound and result was filled
+inline bool ComputeShapeDistance(const ConvexShape& s1, const Transform& t1, const ConvexShape& s2, const Transform& t2, dReal upperbound, DistanceResult& result)
+{
+    detail::ShapePair pair(s1, t1, s2, t2);
+    detail::SupportPoint simplex[4];
+    dReal lambdas[4];
+    int num = 0;
+    Vector v;
+    dReal fmargin = s1.margin + s2.margin;
+    detail::GJKStatus status = detail::GJK(pair, upperbound+fmargin, simplex, num, lambdas, v);
+    if( status == detail::GJK_FartherThanBound ) {
+        return false;
+    }
+
+    DistanceResult coreresult;
+    dReal fcoredist = status == detail::GJK_Separated ? OpenRAVE::RaveSqrt(v.lengthsqr3()) : 0;
+    if( status == detail::GJK_Separated && fcoredist > 1e-10 ) {
+        coreresult.p1 = Vector(0,0,0);
+        coreresult.p2 = Vector(0,0,0);
+        for(int i = 0; i < num; ++i) {
+            coreresult.p1 += simplex[i].a*lambdas[i];
+            coreresult.p2 += simplex[i].b*lambdas[i];
+        }
+        coreresult.normal = v*(-1/fcoredist);
+        coreresult.distance = fcoredist;
+    }
+    else if( !detail::CompleteTetrahedron(pair, simplex, num) || !detail::EPA(pair, simplex, coreresult) ) {
+        // touching or flat, so penetration depth is 0 and there is no well defined normal
+        coreresult.p1 = coreresult.p2 = num > 0 ? simplex[0].a : t1.trans;
+        coreresult.normal = Vector(0,0,1);
+        coreresult.distance = 0;
+    }
+
+    dReal fdistance = coreresult.distance - fmargin;
+    if( fdistance >= upperbound ) {
+        return false;
+    }
+    result.distance = fdistance;
+    result.normal = coreresult.normal;
+    result.p1 = coreresult.p1 + coreresult.normal*s1.margin;
+    result.p2 = coreresult.p2 - coreresult.normal*s2.margin;
+    return true;
+}
+
+/// \brief signed distance between two link hulls, shape pairs are visited in the order of their bounding sphere distance
+inline bool ComputeLinkDistance(const LinkHull& h1, const Transform& t1, const LinkHull& h2, const Transform& t2, dReal upperbound, DistanceResult& result)
+{
+    std::vector< std::pair<dReal, std::pair<int,int> > > vpairs;
+    vpairs.reserve(h1.vshapes.size()*h2.vshapes.size());
+    for(size_t i = 0; i < h1.vshapes.size(); ++i) {
+        Vector c1 = t1*h1.vshapes[i].center;
+        for(size_t j = 0; j < h2.vshapes.size(); ++j) {
+            dReal flowerbound = OpenRAVE::RaveSqrt((t2*h2.vshapes[j].center - c1).lengthsqr3()) - h1.vshapes[i].radius - h2.vshapes[j].radius;
+            if( flowerbound < upperbound ) {
+                vpairs.push_back(std::make_pair(flowerbound, std::make_pair((int)i,(int)j)));
+            }
+        }
+    }
+    std::sort(vpairs.begin(), vpairs.end());
+    bool bfound = false;
+    for(size_t i = 0; i < vpairs.size(); ++i) {
+        if( vpairs[i].first >= upperbound ) {
+            break;
+        }
+        DistanceResult shaperesult;
+        if( ComputeShapeDistance(h1.vshapes[vpairs[i].second.first], t1, h2.vshapes[vpairs[i].second.second], t2, upperbound, shaperesult) ) {
+            result = shaperesult;
+            upperbound = shaperesult.distance;
+            bfound = true;
+        }
+    }
+    return bfound;
+}
+
+namespace detail {
+
+/// \brief minimum signed distance between the given link pairs that is smaller than upperbound
+///
+/// \param upperbound set to the distance found
+inline bool ComputeMinimumDistance(const std::vector<LinkHullInstance>& v1, const std::vector<LinkHullInstance>& v2, const std::vector< std::pair<size_t,size_t> >& vindices, dReal& upperbound, DistanceResult& result, size_t& index1, size_t& index2)
+{
+    std::vector< std::pair<dReal, std::pair<size_t,size_t> > > vpairs;
+    vpairs.reserve(vindices.size());
+    for(size_t i = 0; i < vindices.size(); ++i) {
+        const LinkHullInstance& l1 = v1[vindices[i].first], &l2 = v2[vindices[i].second];
+        if( l1.phull->vshapes.size() == 0 || l2.phull->vshapes.size() == 0 ) {
+            continue;
+        }
+        dReal flowerbound = OpenRAVE::RaveSqrt((l2.center - l1.center).lengthsqr3()) - l1.phull->radius - l2.phull->radius;
+        if( flowerbound < upperbound ) {
+            vpairs.push_back(std::make_pair(flowerbound, vindices[i]));
+        }
+    }
+    std::sort(vpairs.begin(), vpairs.end());
+    bool bfound = false;
+    for(size_t i = 0; i < vpairs.size(); ++i) {
+        if( vpairs[i].first >= upperbound ) {
+            break;
+        }
+        const LinkHullInstance& l1 = v1[vpairs[i].second.first], &l2 = v2[vpairs[i].second.second];
+        DistanceResult linkresult;
+        if( ComputeLinkDistance(*l1.phull, l1.t, *l2.phull, l2.t, upperbound, linkresult) ) {
+            result = linkresult;
+            upperbound = linkresult.distance;
+            index1 = vpairs[i].second.first;
+            index2 = vpairs[i].second.second;
+            bfound = true;
+        }
+    }
+    return bfound;
+}
+
+/// \brief links of one body with the bounding sphere of all their hulls
+struct BodyLinks
+{
+    KinBodyConstPtr pbody;
+    std::vector<size_t> vindices; ///< indices of the link instances of the body
+    Vector center;
+    dReal radius;
+};
+
+/// \brief groups the link instances by their body and computes the bounding sphere of each group
+inline void GroupByBody(const std::vector<LinkHullInstance>& vlinks, std::vector<BodyLinks>& vbodies)
+{
+    vbodies.resize(0);
+    for(size_t i = 0; i < vlinks.size(); ++i) {
+        if( vlinks[i].phull->vshapes.size() == 0 ) {
+            continue;
+        }
+        KinBodyConstPtr pbody = vlinks[i].plink->GetParent();
+        // the links of a body are added one after the other, if not a body only ends up in several groups
+        if( vbodies.size() == 0 || vbodies.back().pbody != pbody ) {
+            vbodies.push_back(BodyLinks());
+            vbodies.back().pbody = pbody;
+        }
+        vbodies.back().vindices.push_back(i);
+    }
+    for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+        BodyLinks& body = vbodies[ibody];
+        Vector vmin = vlinks[body.vindices[0]].center, vmax = vmin;
+        for(size_t i = 1; i < body.vindices.size(); ++i) {
+            const Vector& c = vlinks[body.vindices[i]].center;
+            for(int j = 0; j < 3; ++j) {
+                vmin[j] = std::min(vmin[j], c[j]);
+                vmax[j] = std::max(vmax[j], c[j]);
+            }
+        }
+        body.center = 0.5*(vmin+vmax);
+        body.radius = 0;
+        for(size_t i = 0; i < body.vindices.size(); ++i) {
+            const LinkHullInstance& l = vlinks[body.vindices[i]];
+            body.radius = std::max(body.radius, OpenRAVE::RaveSqrt((l.center-body.center).lengthsqr3()) + l.phull->radius);
+        }
+    }
+}
+
+} // end namespace detail
+
+/// \brief minimum signed distance between the given link pairs
+///
+/// Link pairs are visited in the order of their bounding sphere distance and the search stops once the bound exceeds
+/// the best distance found so far, so far away links never reach GJK.
+/// \param vindices pairs of indices into v1 and v2 to check
+/// \param index1 filled with the index into v1 of the closest link
+/// \param index2 filled with the index into v2 of the closest link
+inline bool ComputeMinimumDistance(const std::vector<LinkHullInstance>& v1, const std::vector<LinkHullInstance>& v2, const std::vector< std::pair<size_t,size_t> >& vindices, DistanceResult& result, size_t& index1, size_t& index2)
+{
+    dReal upperbound = 1e20;
+    return detail::ComputeMinimumDistance(v1, v2, vindices, upperbound, result, index1, index2);
+}
+
+/// \brief minimum signed distance between any link of v1 and any different link of v2
+///
+/// The links are first grouped by body. Body pairs are visited in the order of their bounding sphere distance, and only
+/// the link pairs of bodies that can be closer than the best distance so far are sorted and checked. For queries against
+/// the whole environment, use \ref UpdateEnvironmentReport so that far away bodies are not placed at all.
+inline bool ComputeMinimumDistance(const std::vector<LinkHullInstance>& v1, const std::vector<LinkHullInstance>& v2, DistanceResult& result, size_t& index1, size_t& index2)
+{
+    std::vector<detail::BodyLinks> vbodies1, vbodies2;
+    detail::GroupByBody(v1, vbodies1);
+    detail::GroupByBody(v2, vbodies2);
+    std::vector< std::pair<dReal, std::pair<size_t,size_t> > > vbodypairs;
+    vbodypairs.reserve(vbodies1.size()*vbodies2.size());
+    for(size_t i = 0; i < vbodies1.size(); ++i) {
+        for(size_t j = 0; j < vbodies2.size(); ++j) {
+            dReal flowerbound = OpenRAVE::RaveSqrt((vbodies2[j].center - vbodies1[i].center).lengthsqr3()) - vbodies1[i].radius - vbodies2[j].radius;
+            vbodypairs.push_back(std::make_pair(flowerbound, std::make_pair(i,j)));
+        }
+    }
+    std::sort(vbodypairs.begin(), vbodypairs.end());
+    dReal upperbound = 1e20;
+    bool bfound = false;
+    std::vector< std::pair<size_t,size_t> > vindices;
+    for(size_t ipair = 0; ipair < vbodypairs.size(); ++ipair) {
+        if( vbodypairs[ipair].first >= upperbound ) {
+            break;
+        }
+        const detail::BodyLinks& body1 = vbodies1[vbodypairs[ipair].second.first], &body2 = vbodies2[vbodypairs[ipair].second.second];
+        vindices.resize(0);
+        for(size_t i = 0; i < body1.vindices.size(); ++i) {
+            for(size_t j = 0; j < body2.vindices.size(); ++j) {
+                if( v1[body1.vindices[i]].plink != v2[body2.vindices[j]].plink ) {
+                    vindices.push_back(std::make_pair(body1.vindices[i], body2.vindices[j]));
+                }
+            }
+        }
+        if( detail::ComputeMinimumDistance(v1, v2, vindices, upperbound, result, index1, index2) ) {
+            bfound = true;
+        }
+    }
+    return bfound;
+}
+
+/// \brief fills the distance fields of the report from the closest pair found after the collision query finished
+///
+/// minDistance is 0 when colliding. If the links do not collide, the closest points are returned as the only contact
+/// with a negative depth. If they collide and no contacts were requested, the deepest points are returned as a contact
+/// with the penetration depth. Since the distance is between hulls, it is clamped to 0 when the hulls of non-convex
+/// meshes overlap even though the meshes do not collide, see \ref OpenRAVE::CollisionReport::minDistance.
+inline void UpdateReport(const DistanceResult& result, KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, bool bCollision, CollisionReportPtr report)
+{
+    if( bCollision ) {
+        report->minDistance = 0;
+        if( report->contacts.size() == 0 && result.distance < 0 ) {
+            report->contacts.push_back(CollisionReport::CONTACT(result.p1, result.normal, -result.distance));
+        }
+    }
+    else if( result.distance < report->minDistance ) {
+        report->minDistance = std::max(dReal(0), result.distance);
+        report->plink1 = plink1;
+        report->plink2 = plink2;
+        report->contacts.resize(1);
+        report->contacts[0] = CollisionReport::CONTACT(result.p1, result.normal, -result.distance);
+    }
+}
+
+/// \brief computes the minimum distance between the links of v1 and v2 and fills the report, see \ref UpdateReport
+inline void UpdateReport(const std::vector<LinkHullInstance>& v1, const std::vector<LinkHullInstance>& v2, bool bCollision, CollisionReportPtr report)
+{
+    DistanceResult result;
+    size_t index1 = 0, index2 = 0;
+    if( !!report && ComputeMinimumDistance(v1, v2, result, index1, index2) ) {
+        UpdateReport(result, v1[index1].plink, v2[index2].plink, bCollision, report);
+    }
+}
+
+/// \brief computes the minimum distance between the links of v1 and the enabled links of the environment and fills the report, see \ref UpdateReport
+///
+/// Only bodies that are not attached to pbody and not in vbodyexcluded are considered. They are visited in the order of the
+/// distance between their aabb in the space of the checker and the aabb of the bounding spheres of v1, and the links of a body
+/// are only placed and checked if its aabb can be closer than the best distance found so far.
+inline void UpdateEnvironmentReport(KinBodyConstPtr pbody, const std::vector<LinkHullInstance>& v1, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, const GetLinkHullFn& gethull, const GetBodyAABBFn& getbodyaabb, bool bCollision, CollisionReportPtr report)
+{
+    if( !report ) {
+        return;
+    }
+    Vector vmin1, vmax1;
+    bool bhasshapes = false;
+    for(size_t i = 0; i < v1.size(); ++i) {
+        if( v1[i].phull->vshapes.size() == 0 ) {
+            continue;
+        }
+        Vector vradius(v1[i].phull->radius, v1[i].phull->radius, v1[i].phull->radius);
+        if( !bhasshapes ) {
+            vmin1 = v1[i].center - vradius;
+            vmax1 = v1[i].center + vradius;
+            bhasshapes = true;
+        }
+        else {
+            for(int j = 0; j < 3; ++j) {
+                vmin1[j] = std::min(vmin1[j], v1[i].center[j] - vradius[j]);
+                vmax1[j] = std::max(vmax1[j], v1[i].center[j] + vradius[j]);
+            }
+        }
+    }
+    if( !bhasshapes ) {
+        return;
+    }
+
+    std::vector<KinBodyPtr> vbodies;
+    pbody->GetEnv()->GetBodies(vbodies);
+    std::vector< std::pair<dReal, size_t> > vbodybounds;
+    vbodybounds.reserve(vbodies.size());
+    for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+        const KinBodyPtr& pother = vbodies[ibody];
+        if( !pother->IsEnabled() || pbody->IsAttached(pother) || std::find(vbodyexcluded.begin(), vbodyexcluded.end(), pother) != vbodyexcluded.end() ) {
+            continue;
+        }
+        OpenRAVE::AABB ab;
+        if( !getbodyaabb(pother, ab) ) {
+            continue;
+        }
+        // the distance between the boxes is a lower bound of the distance between any of their links
+        dReal fdist2 = 0;
+        for(int j = 0; j < 3; ++j) {
+            dReal fgap = std::max(ab.pos[j] - ab.extents[j] - vmax1[j], vmin1[j] - ab.pos[j] - ab.extents[j]);
+            if( fgap > 0 ) {
+                fdist2 += fgap*fgap;
+            }
+        }
+        vbodybounds.push_back(std::make_pair(OpenRAVE::RaveSqrt(fdist2), ibody));
+    }
+    std::sort(vbodybounds.begin(), vbodybounds.end());
+
+    std::vector<LinkHullInstance> v2;
+    std::vector< std::pair<size_t,size_t> > vindices;
+    dReal upperbound = 1e20;
+    DistanceResult result;
+    size_t index1 = 0, index2 = 0;
+    bool bfound = false;
+    for(size_t ibound = 0; ibound < vbodybounds.size(); ++ibound) {
+        // overlapping boxes have a bound of 0, so they are all checked when penetrating to find the deepest pair
+        if( upperbound >= 0 ? vbodybounds[ibound].first >= upperbound : vbodybounds[ibound].first > 0 ) {
+            break;
+        }
+        size_t istart = v2.size();
+        const std::vector<KinBody::LinkPtr>& vbodylinks = vbodies[vbodybounds[ibound].second]->GetLinks();
+        for(size_t i = 0; i < vbodylinks.size(); ++i) {
+            if( vbodylinks[i]->IsEnabled() && std::find(vlinkexcluded.begin(), vlinkexcluded.end(), vbodylinks[i]) == vlinkexcluded.end() ) {
+                AddLink(vbodylinks[i], gethull, v2);
+            }
+        }
+        vindices.resize(0);
+        for(size_t i = 0; i < v1.size(); ++i) {
+            for(size_t j = istart; j < v2.size(); ++j) {
+                if( v1[i].plink != v2[j].plink ) {
+                    vindices.push_back(std::make_pair(i, j));
+                }
+            }
+        }
+        if( detail::ComputeMinimumDistance(v1, v2, vindices, upperbound, result, index1, index2) ) {
+            bfound = true;
+        }
+    }
+    if( bfound ) {
+        UpdateReport(result, v1[index1].plink, v2[index2].plink, bCollision, report);
+    }
+}
+
+/// \brief computes the minimum distance between the given link pairs of v1 and v2 and fills the report, see \ref UpdateReport
+inline void UpdateReport(const std::vector<LinkHullInstance>& v1, const std::vector<LinkHullInstance>& v2, const std::vector< std::pair<size_t,size_t> >& vindices, bool bCollision, CollisionReportPtr report)
+{
+    DistanceResult result;
+    size_t index1 = 0, index2 = 0;
+    if( !!report && ComputeMinimumDistance(v1, v2, vindices, result, index1, index2) ) {
+        UpdateReport(result, v1[index1].plink, v2[index2].plink, bCollision, report);
+    }
+}
+
+/// \brief computes the minimum distance between the non-adjacent links of pbody and fills the report, see \ref UpdateReport
+///
+/// \param nonadjacent the non-adjacent link pairs as returned by KinBody::GetNonAdjacentLinks
+/// \param plink if set, only the pairs containing this link are checked
+inline void UpdateSelfReport(KinBodyConstPtr pbody, const std::set<int>& nonadjacent, KinBody::LinkConstPtr plink, const GetLinkHullFn& gethull, bool bCollision, CollisionReportPtr report)
+{
+    if( !report ) {
+        return;
+    }
+    std::vector<LinkHullInstance> vlinks;
+    std::vector<int> vlinkindices(pbody->GetLinks().size(), -1);
+    for(size_t i = 0; i < pbody->GetLinks().size(); ++i) {
+        const KinBody::LinkPtr& pbodylink = pbody->GetLinks()[i];
+        if( pbodylink->IsEnabled() ) {
+            size_t oldsize = vlinks.size();
+            AddLink(pbodylink, gethull, vlinks);
+            if( vlinks.size() > oldsize ) {
+                vlinkindices[i] = (int)oldsize;
+            }
+        }
+    }
+    std::vector< std::pair<size_t,size_t> > vindices;
+    for(std::set<int>::const_iterator itset = nonadjacent.begin(); itset != nonadjacent.end(); ++itset) {
+        int index1 = *itset&0xffff, index2 = *itset>>16;
+        if( vlinkindices.at(index1) < 0 || vlinkindices.at(index2) < 0 ) {
+            continue;
+        }
+        if( !!plink && plink->GetIndex() != index1 && plink->GetIndex() != index2 ) {
+            continue;
+        }
+        vindices.push_back(std::make_pair((size_t)vlinkindices[index1], (size_t)vlinkindices[index2]));
+    }
+    UpdateReport(vlinks, vlinks, vindices, bCollision, report);
+}
+
+} // end namespace convexdistance
+
+#endif
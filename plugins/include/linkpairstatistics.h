@@ -0,0 +1,98 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 The OpenRAVE Contributors
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/** \file linkpairstatistics.h
+    \brief Orders the self-collision link pairs of a body by how often they were found colliding.
+
+    Most self-collisions of a robot come from a handful of link pairs (gripper fingers, elbow and torso, etc), so
+    checking those first makes colliding queries return after very few narrow phase tests.
+ */
+#ifndef OPENRAVE_PLUGIN_LINKPAIRSTATISTICS_H
+#define OPENRAVE_PLUGIN_LINKPAIRSTATISTICS_H
+
+#include <openrave/openrave.h>
+#include <algorithm>
+#include <vector>
+
+/// \brief per-body collision counts of the non-adjacent link pairs
+class LinkPairStatistics
+{
+public:
+    LinkPairStatistics() : _nStamp(-1), _nLinks(0), _adjacentoptions(-1) {
+    }
+
+    /// \brief returns the pairs of \ref KinBody::NonAdjacentLinkPairs ordered by descending number of collisions
+    ///
+    /// The order is only rebuilt when the pairs change, the collision counts are kept as long as the number of links stays the same.
+    const std::vector<int>& GetOrderedPairs(const OpenRAVE::KinBody::NonAdjacentLinkPairs& pairs, int adjacentoptions)
+    {
+        if( pairs._nStamp != _nStamp || pairs._nLinks != _nLinks || adjacentoptions != _adjacentoptions ) {
+            if( pairs._nLinks != _nLinks ) {
+                _vhits.resize(0);
+                _vhits.resize(pairs._nLinks*pairs._nLinks, 0);
+                _nLinks = pairs._nLinks;
+            }
+            _vorder = pairs._vpairs;
+            std::stable_sort(_vorder.begin(), _vorder.end(), PairComparator(*this));
+            _nStamp = pairs._nStamp;
+            _adjacentoptions = adjacentoptions;
+        }
+        return _vorder;
+    }
+
+    /// \brief records a collision of the pair at position index of the ordered pairs.
+    ///
+    /// The pair is moved ahead of all pairs with fewer collisions. Only positions up to index are touched, so iterating
+    /// over the ordered pairs can continue at index+1.
+    void AddCollision(size_t index)
+    {
+        uint32_t& hits = _vhits.at(_GetHitIndex(_vorder.at(index)));
+        if( ++hits >= 0x10000 ) {
+            // age the counts so that the order can adapt to new configurations
+            for(size_t i = 0; i < _vhits.size(); ++i) {
+                _vhits[i] >>= 1;
+            }
+        }
+        while(index > 0 && _vhits[_GetHitIndex(_vorder[index-1])] < hits ) {
+            std::swap(_vorder[index-1], _vorder[index]);
+            --index;
+        }
+    }
+
+private:
+    inline size_t _GetHitIndex(int pair) const {
+        return (pair&0xffff)*_nLinks + (pair>>16);
+    }
+
+    class PairComparator
+    {
+public:
+        PairComparator(const LinkPairStatistics& stats) : _stats(stats) {
+        }
+        bool operator()(int pair0, int pair1) const {
+            return _stats._vhits[_stats._GetHitIndex(pair0)] > _stats._vhits[_stats._GetHitIndex(pair1)];
+        }
+        const LinkPairStatistics& _stats;
+    };
+
+    std::vector<int> _vorder; ///< non-adjacent pairs i|(j<<16) ordered by descending _vhits
+    std::vector<uint32_t> _vhits; ///< _vhits[i*_nLinks+j] is the number of collisions of links i and j
+    int _nStamp; ///< KinBody::NonAdjacentLinkPairs::_nStamp of _vorder
+    int _nLinks;
+    int _adjacentoptions;
+};
+
+#endif
@@ -17,17 +17,19 @@
 #define RAVE_COLLISION_ODE
 
 #include "odespace.h"
+#include "convexdecompositioncache.h"
 
 #include <boost/lexical_cast.hpp>
 #include <openrave/utils.h>
 
-#ifndef ODE_USE_MULTITHREAD
+// unless ode is built with its multi-threading extensions, the collision caches are shared between all spaces, so every checker has to be serialized
 static boost::mutex _mutexode;
 static bool _bnotifiedmessage=false;
-#endif
 
 class ODECollisionChecker : public OpenRAVE::CollisionCheckerBase
 {
+    typedef std::set< std::pair<KinBody::Link const*, KinBody::Link const*> > LinkPairSet;
+
     class CollisionCallbackData
     {
     public:
@@ -96,6 +98,7 @@ class ODECollisionChecker : public OpenRAVE::CollisionCheckerBase
 
         bool _bCollision;
         bool _bStopChecking; ///< if true, should stop checking for new collisions
+        LinkPairSet _setcheckedlinkpairs; ///< link pairs whose convex hulls were already checked, see ODECollisionChecker::_LinkHullCollide
 private:
         vector<uint8_t> _vactivelinks;     ///< active links for _pbody, only valid if _pbody is a robot
         bool bActiveDOFs;
@@ -114,6 +117,8 @@ public:
     ODECollisionChecker(EnvironmentBasePtr penv) : OpenRAVE::CollisionCheckerBase(penv) {
         _userdatakey = std::string("odecollision") + boost::lexical_cast<std::string>(this);
         _odespace.reset(new ODESpace(penv,_userdatakey,false));
+        _gethull = boost::bind(&ODESpace::GetLinkHull, _odespace.get(), _1);
+        _getbodyaabb = boost::bind(&ODESpace::GetBodyAABB, _odespace.get(), _1, _2);
         _options = 0;
         geomray = NULL;
         _nMaxStartContacts = 32;
@@ -121,12 +126,18 @@ public:
         __description = ":Interface Author: Rosen Diankov\n\nOpen Dynamics Engine collision checker (fast, but inaccurate for triangle meshes)";
         RegisterCommand("SetMaxContacts",boost::bind(&ODECollisionChecker::_SetMaxContactsCommand, this,_1,_2),
                         str(boost::format("sets the maximum contacts that can be returned by the checker (limit is %d)")%_nMaxContacts));
-#ifndef ODE_USE_MULTITHREAD
-        if( !_bnotifiedmessage ) {
-            RAVELOG_DEBUG("ode will be slow in multi-threaded environments\n");
-            _bnotifiedmessage = false;
-        }
+        RegisterCommand("SetConvexDecomposition",boost::bind(&ODECollisionChecker::_SetConvexDecompositionCommand, this,_1,_2),
+                        "Format: SetConvexDecomposition enable [name value]...\n\n\
+If enable is 1, triangle meshes are split into convex pieces and links are collided by their convex hulls with GJK instead of the ODE triangle collider. Decompositions are cached by mesh hash in memory and in $OPENRAVE_HOME/convexdecomposition. The optional parameters are skinwidth, decompositiondepth, maxhullvertices, concavitythresholdpercent, mergethresholdpercent, volumesplitthresholdpercent, useinitialislandgeneration, useislandgeneration and usediskcache.");
+        _bMultiThreadedCollisions = false;
+#ifdef ODE_HAVE_ALLOCATE_DATA_THREAD
+        // ode built with --enable-ou keeps its collision data per thread, and every query thread allocates its own in ODESpace::Synchronize
+        _bMultiThreadedCollisions = !!dCheckConfiguration("ODE_EXT_mt_collisions");
 #endif
+        if( !_bMultiThreadedCollisions && !_bnotifiedmessage ) {
+            RAVELOG_DEBUG("ode is not built with its multi-threading extensions, so it will be slow in multi-threaded environments\n");
+            _bnotifiedmessage = true;
+        }
 
         _odespace->Init();
         geomray = dCreateRay(0, 1000.0f);     // 1000m (is this used?)
@@ -147,6 +158,26 @@ public:
         return !!sinput;
     }
 
+    bool _SetConvexDecompositionCommand(ostream& sout, istream& sinput)
+    {
+        int enable = 0;
+        sinput >> enable;
+        if( !sinput ) {
+            return false;
+        }
+        convexdistance::DecomposeMeshFn decomposemeshfn;
+        if( enable ) {
+            convexdistance::ConvexDecompositionParameters params;
+            if( !params.Deserialize(sinput) ) {
+                return false;
+            }
+            decomposemeshfn = boost::bind(convexdistance::DecomposeMesh, _1, _2, params);
+        }
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
+        _odespace->SetDecomposeMeshFn(decomposemeshfn);
+        return true;
+    }
+
     virtual void SetTolerance(OpenRAVE::dReal tolerance) {
     }
 
@@ -188,9 +219,6 @@ public:
     virtual bool SetCollisionOptions(int collisionoptions)
     {
         _options = collisionoptions;
-        if( _options & OpenRAVE::CO_Distance ) {
-            return false;
-        }
         return true;
     }
 
@@ -204,16 +232,15 @@ public:
         if(( pbody->GetLinks().size() == 0) || !pbody->IsEnabled() ) {
             return false;
         }
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
         _odespace->Synchronize();
         dSpaceCollide(_odespace->GetSpace(), &cb, KinBodyCollisionCallback);
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1;
+            convexdistance::AddBodyLinks(pbody, _gethull, vlinks1);
+            convexdistance::UpdateEnvironmentReport(pbody, vlinks1, std::vector<KinBodyConstPtr>(), std::vector<KinBody::LinkConstPtr>(), _gethull, _getbodyaabb, cb._bCollision, report);
+        }
         return cb._bCollision;
     }
 
@@ -229,14 +256,8 @@ public:
         if( pbody1->IsAttached(pbody2) ) {
             return false;
         }
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
         _odespace->Synchronize();
 
         // have to go through all attached bodies manually (not sure if there's a fast way to set temporary groups in ode)
@@ -248,11 +269,20 @@ public:
                 cb._bStopChecking = false;
                 dSpaceCollide2((dGeomID)_odespace->GetBodySpace(*it1),(dGeomID)_odespace->GetBodySpace(*it2),&cb,KinBodyKinBodyCollisionCallback);
                 if( !(_options & OpenRAVE::CO_AllLinkCollisions) && cb._bCollision ) {
-                    return true;
+                    break;
                 }
             }
+            if( !(_options & OpenRAVE::CO_AllLinkCollisions) && cb._bCollision ) {
+                break;
+            }
         }
 
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1, vlinks2;
+            convexdistance::AddBodyLinks(pbody1, _gethull, vlinks1);
+            convexdistance::AddBodyLinks(pbody2, _gethull, vlinks2);
+            convexdistance::UpdateReport(vlinks1, vlinks2, cb._bCollision, report);
+        }
         return cb._bCollision;
     }
 
@@ -263,21 +293,27 @@ public:
             RAVELOG_VERBOSE("calling collision on disabled link %s\n", plink->GetName().c_str());
             return false;
         }
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
         _odespace->Synchronize();
         dSpaceCollide(_odespace->GetSpace(), &cb, LinkCollisionCallback);
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1;
+            convexdistance::AddLink(plink, _gethull, vlinks1);
+            convexdistance::UpdateEnvironmentReport(plink->GetParent(), vlinks1, std::vector<KinBodyConstPtr>(), std::vector<KinBody::LinkConstPtr>(), _gethull, _getbodyaabb, cb._bCollision, report);
+        }
         return cb._bCollision;
     }
 
-    int _GeomCollide(dGeomID geom1, dGeomID geom2, vector<dContact>& vcontacts, bool bComputeAllContacts)
+    /// \param psetcheckedlinkpairs when meshes are decomposed, link pairs in the set are skipped and the checked pair is added
+    int _GeomCollide(dGeomID geom1, dGeomID geom2, vector<dContact>& vcontacts, bool bComputeAllContacts, LinkPairSet* psetcheckedlinkpairs=NULL)
     {
+        if( _odespace->IsDecomposingMeshes() ) {
+            int N = _LinkHullCollide(geom1, geom2, vcontacts, psetcheckedlinkpairs);
+            if( N >= 0 ) {
+                return N;
+            }
+        }
         vcontacts.resize(bComputeAllContacts ? _nMaxStartContacts : 1);
         int log2limit = (int)ceil(OpenRAVE::RaveLog(vcontacts.size())/OpenRAVE::RaveLog(2));
         while( 1 ) {
@@ -304,6 +340,48 @@ public:
         return vcontacts.size();
     }
 
+    /// \brief collides the convex hulls of the links owning the geoms instead of the geoms themselves
+    ///
+    /// Every geom pair of two links gives the same answer, so each link pair is only checked once per query. At most
+    /// one contact at the deepest point is returned.
+    /// \return the number of contacts, or -1 if one of the geoms does not belong to a link
+    int _LinkHullCollide(dGeomID geom1, dGeomID geom2, vector<dContact>& vcontacts, LinkPairSet* psetcheckedlinkpairs)
+    {
+        dBodyID b1 = dGeomGetBody(geom1), b2 = dGeomGetBody(geom2);
+        if( !b1 || !b2 || !dBodyGetData(b1) || !dBodyGetData(b2) ) {
+            return -1;
+        }
+        KinBody::LinkPtr plink1 = ((ODESpace::KinBodyInfo::LINK*)dBodyGetData(b1))->GetLink();
+        KinBody::LinkPtr plink2 = ((ODESpace::KinBodyInfo::LINK*)dBodyGetData(b2))->GetLink();
+        if( !plink1 || !plink2 ) {
+            return -1;
+        }
+        convexdistance::LinkHullConstPtr phull1 = _odespace->GetLinkHull(plink1), phull2 = _odespace->GetLinkHull(plink2);
+        if( !phull1 || !phull2 ) {
+            return -1;
+        }
+        vcontacts.resize(0);
+        if( !!psetcheckedlinkpairs && !psetcheckedlinkpairs->insert(std::make_pair(plink1.get(), plink2.get())).second ) {
+            return 0;
+        }
+        convexdistance::DistanceResult result;
+        if( !convexdistance::ComputeLinkDistance(*phull1, plink1->GetTransform(), *phull2, plink2->GetTransform(), 0, result) ) {
+            return 0;
+        }
+        vcontacts.resize(1);
+        dContactGeom& contact = vcontacts[0].geom;
+        Vector vpos = 0.5*(result.p1+result.p2);
+        // ode normals point into the first geom
+        for(int i = 0; i < 3; ++i) {
+            contact.pos[i] = vpos[i];
+            contact.normal[i] = -result.normal[i];
+        }
+        contact.depth = -result.distance;
+        contact.g1 = dGeomGetClass(geom1) == dGeomTransformClass ? dGeomTransformGetGeom(geom1) : geom1;
+        contact.g2 = dGeomGetClass(geom2) == dGeomTransformClass ? dGeomTransformGetGeom(geom2) : geom2;
+        return 1;
+    }
+
     virtual bool CheckCollision(KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, CollisionReportPtr report)
     {
         if( !!report ) {
@@ -317,17 +395,18 @@ public:
             //RAVELOG_VERBOSE(str(boost::format("calling collision on disabled link2 %s\n")%plink2->GetName()));
             return false;
         }
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
 
         _odespace->Synchronize();
-        return _CheckCollision(plink1,plink2,report);
+        bool bCollision = _CheckCollision(plink1,plink2,report);
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1, vlinks2;
+            convexdistance::AddLink(plink1, _gethull, vlinks1);
+            convexdistance::AddLink(plink2, _gethull, vlinks2);
+            convexdistance::UpdateReport(vlinks1, vlinks2, bCollision, report);
+        }
+        return bCollision;
     }
 
     /// shouldn't call Reset on the report since it could be compounded!
@@ -337,6 +416,7 @@ public:
         std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
 
         vector<dContact> vcontacts;
+        LinkPairSet setcheckedlinkpairs;
         dGeomID geom1 = _odespace->GetLinkGeom(plink1);
         int igeom1 = 0;
         bool bCollision = false;
@@ -347,7 +427,7 @@ public:
             while(geom2 != NULL) {
                 BOOST_ASSERT(dGeomIsEnabled(geom2));
 
-                int N = _GeomCollide(geom1, geom2, vcontacts, !!preport && !!(preport->options & OpenRAVE::CO_Contacts));
+                int N = _GeomCollide(geom1, geom2, vcontacts, !!preport && !!(preport->options & OpenRAVE::CO_Contacts), &setcheckedlinkpairs);
                 if (N) {
                     if( !preport && bHasCallbacks ) {
                         preport.reset(new CollisionReport());
@@ -430,14 +510,8 @@ public:
         if( pbody->IsAttached(plink->GetParent()) ) {
             return false;
         }
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
 
         _odespace->Synchronize();
         CollisionCallbackData cb(shared_checker(),report,KinBodyPtr(),KinBody::LinkConstPtr());
@@ -451,13 +525,22 @@ public:
                     if( _CheckCollision(plink, KinBody::LinkConstPtr(*itlink), report) ) {
                         bCollision = true;
                         if( !(_options & OpenRAVE::CO_AllLinkCollisions) ) {
-                            return true;
+                            break;
                         }
                     }
                 }
             }
+            if( bCollision && !(_options & OpenRAVE::CO_AllLinkCollisions) ) {
+                break;
+            }
         }
 
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1, vlinks2;
+            convexdistance::AddLink(plink, _gethull, vlinks1);
+            convexdistance::AddBodyLinks(pbody, _gethull, vlinks2);
+            convexdistance::UpdateReport(vlinks1, vlinks2, bCollision, report);
+        }
         return bCollision;
 
         // doesn't work, but why?
@@ -469,10 +552,6 @@ public:
         if(( vlinkexcluded.size() == 0) &&( vbodyexcluded.size() == 0) ) {
             return CheckCollision(plink,report);
         }
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
         throw openrave_exception("This type of collision checking is not yet implemented in the ODE collision checker.\n",OpenRAVE::ORE_NotImplemented);
     }
 
@@ -482,22 +561,21 @@ public:
         if(( pbody->GetLinks().size() == 0) || !pbody->IsEnabled() ) {
             return false;
         }
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
         if( vbodyexcluded.size() > 0 ) {
             cb.pvbodyexcluded = &vbodyexcluded;
         }
         if( vlinkexcluded.size() > 0 ) {
             cb.pvlinkexcluded = &vlinkexcluded;
         }
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
 
         _odespace->Synchronize();
         dSpaceCollide(_odespace->GetSpace(), &cb, KinBodyCollisionCallback);
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            std::vector<convexdistance::LinkHullInstance> vlinks1;
+            convexdistance::AddBodyLinks(pbody, _gethull, vlinks1, vlinkexcluded);
+            convexdistance::UpdateEnvironmentReport(pbody, vlinks1, vbodyexcluded, vlinkexcluded, _gethull, _getbodyaabb, cb._bCollision, report);
+        }
         return cb._bCollision;
     }
 
@@ -511,9 +589,7 @@ public:
             return false;
         }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
 
         _odespace->Synchronize();
         OpenRAVE::dReal fmaxdist = OpenRAVE::RaveSqrt(ray.dir.lengthsqr3());
@@ -624,9 +700,7 @@ public:
             return false;
         }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
 
         _odespace->Synchronize();
         cb.fraymaxdist = OpenRAVE::RaveSqrt(ray.dir.lengthsqr3());
@@ -660,9 +734,7 @@ public:
             RAVELOG_DEBUG("CheckCollision: ray direction length is 1.0, note that only collisions within a distance of 1.0 will be checked\n");
         }
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
         dGeomRaySet(geomray, ray.pos.x, ray.pos.y, ray.pos.z, vnormdir.x, vnormdir.y, vnormdir.z);
 
         dGeomRaySetClosestHit(geomray, !(_options&OpenRAVE::CO_RayAnyHit));     // only care about the closest points
@@ -678,10 +750,6 @@ public:
 
     virtual bool CheckStandaloneSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report)
     {
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
         if( !!report ) {
             report->Reset(_options);
         }
@@ -695,18 +763,22 @@ public:
         }
 
         const std::set<int>& nonadjacent = pbody->GetNonAdjacentLinks(adjacentoptions);
+        const KinBody::NonAdjacentLinkPairs& nonadjacentpairs = pbody->GetNonAdjacentLinkPairs(adjacentoptions);
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
         _odespace->Synchronize(); // call after GetNonAdjacentLinks since it can modify the body, even though it is const!
+        ODESpace::KinBodyInfoPtr pinfo = _odespace->GetInfo(pbody);
+        const std::vector<int>& vpairs = !!pinfo ? pinfo->_selfcollisionstats.GetOrderedPairs(nonadjacentpairs, adjacentoptions) : nonadjacentpairs._vpairs;
         bool bCollision = false;
-        FOREACHC(itset, nonadjacent) {
-            KinBody::LinkConstPtr plink1(pbody->GetLinks().at(*itset&0xffff)), plink2(pbody->GetLinks().at(*itset>>16));
+        for(size_t ipair = 0; ipair < vpairs.size(); ++ipair) {
+            KinBody::LinkConstPtr plink1(pbody->GetLinks().at(vpairs[ipair]&0xffff)), plink2(pbody->GetLinks().at(vpairs[ipair]>>16));
             if( !plink1->IsEnabled() || !plink2->IsEnabled() ) {
                 continue;
             }
             if( _CheckCollision(plink1,plink2, report) ) {
+                if( !!pinfo ) {
+                    pinfo->_selfcollisionstats.AddCollision(ipair);
+                }
                 if( IS_DEBUGLEVEL(OpenRAVE::Level_Verbose) ) {
                     RAVELOG_VERBOSE(str(boost::format("selfcol %s, Links %s %s are colliding\n")%pbody->GetName()%plink1->GetName()%plink2->GetName()));
                     std::vector<OpenRAVE::dReal> v;
@@ -725,19 +797,18 @@ public:
                 }
                 bCollision = true;
                 if( !(_options & OpenRAVE::CO_AllLinkCollisions) ) {
-                    return true;
+                    break;
                 }
             }
         }
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            convexdistance::UpdateSelfReport(pbody, nonadjacent, KinBody::LinkConstPtr(), _gethull, bCollision, report);
+        }
         return bCollision;
     }
 
     virtual bool CheckStandaloneSelfCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report)
     {
-        if( _options & OpenRAVE::CO_Distance ) {
-            RAVELOG_WARN("ode doesn't support CO_Distance\n");
-            return false;
-        }
         if( !!report ) {
             report->Reset(_options);
         }
@@ -752,16 +823,21 @@ public:
         }
 
         const std::set<int>& nonadjacent = pbody->GetNonAdjacentLinks(adjacentoptions);
+        const KinBody::NonAdjacentLinkPairs& nonadjacentpairs = pbody->GetNonAdjacentLinkPairs(adjacentoptions);
 
-#ifndef ODE_USE_MULTITHREAD
-        boost::mutex::scoped_lock lock(_mutexode);
-#endif
+        boost::mutex::scoped_lock lock(_GetQueryMutex());
         _odespace->Synchronize(); // call after GetNonAdjacentLinks since it can modify the body, even though it is const!
+        ODESpace::KinBodyInfoPtr pinfo = _odespace->GetInfo(pbody);
+        const std::vector<int>& vpairs = !!pinfo ? pinfo->_selfcollisionstats.GetOrderedPairs(nonadjacentpairs, adjacentoptions) : nonadjacentpairs._vpairs;
+        int linkindex = plink->GetIndex();
         bool bCollision = false;
-        FOREACHC(itset, nonadjacent) {
-            KinBody::LinkConstPtr plink1(pbody->GetLinks().at(*itset&0xffff)), plink2(pbody->GetLinks().at(*itset>>16));
-            if( plink == plink1 || plink == plink2 ) {
+        for(size_t ipair = 0; ipair < vpairs.size(); ++ipair) {
+            if( (vpairs[ipair]&0xffff) == linkindex || (vpairs[ipair]>>16) == linkindex ) {
+                KinBody::LinkConstPtr plink1(pbody->GetLinks().at(vpairs[ipair]&0xffff)), plink2(pbody->GetLinks().at(vpairs[ipair]>>16));
                 if( _CheckCollision(plink1,plink2, report) ) {
+                    if( !!pinfo ) {
+                        pinfo->_selfcollisionstats.AddCollision(ipair);
+                    }
                     if( IS_DEBUGLEVEL(OpenRAVE::Level_Verbose) ) {
                         RAVELOG_VERBOSE(str(boost::format("selfcol %s, Links %s %s are colliding\n")%pbody->GetName()%plink1->GetName()%plink2->GetName()));
                         std::vector<OpenRAVE::dReal> v;
@@ -780,11 +856,14 @@ public:
                     }
                     bCollision = true;
                     if( !(_options & OpenRAVE::CO_AllLinkCollisions) ) {
-                        return true;
+                        break;
                     }
                 }
             }
         }
+        if( (_options & OpenRAVE::CO_Distance) && !!report ) {
+            convexdistance::UpdateSelfReport(pbody, nonadjacent, plink, _gethull, bCollision, report);
+        }
         return bCollision;
     }
 
@@ -799,6 +878,15 @@ public:
     }
 
 private:
+    /// \brief mutex protecting the ode space of a query.
+    ///
+    /// When ode has its multi-threading extensions, its collision data is allocated per thread, so checkers of different
+    /// environments do not share anything and only need to protect their own space and report.
+    /// Otherwise all checkers share the global lock.
+    inline boost::mutex& _GetQueryMutex() {
+        return _bMultiThreadedCollisions ? _mutexquery : _mutexode;
+    }
+
     static void KinBodyCollisionCallback (void *data, dGeomID o1, dGeomID o2)
     {
         CollisionCallbackData* pcb = (CollisionCallbackData*)data;
@@ -895,7 +983,7 @@ private:
         }
 
         vector<dContact> vcontacts;
-        int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
+        int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts), &pcb->_setcheckedlinkpairs);
         if ( N > 0 ) {
             if( !!pcb->_report || pcb->GetCallbacks().size() > 0 ) {
                 _report.Reset(_options);
@@ -996,7 +1084,7 @@ private:
 
         // only care if one of the bodies is the link
         vector<dContact> vcontacts;
-        int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
+        int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts), &pcb->_setcheckedlinkpairs);
         if ( N > 0 ) {
 
             if( !!pcb->_report || pcb->GetCallbacks().size() > 0 ) {
@@ -1115,7 +1203,7 @@ private:
         // only care if one of the bodies is the link
         if(( pkb1 == pcb->_plink) ||( pkb2 == pcb->_plink) ) {
             vector<dContact> vcontacts;
-            int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
+            int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts), &pcb->_setcheckedlinkpairs);
             if (N) {
                 if(!!pcb->_report || pcb->GetCallbacks().size() > 0 ) {
                     _report.plink1 = pcb->_plink;
@@ -1287,9 +1375,13 @@ private:
     int _options;
     dGeomID geomray;     // used for all ray tests
     boost::shared_ptr<ODESpace> _odespace;
+    convexdistance::GetLinkHullFn _gethull; ///< hulls of _odespace used for CO_Distance queries
+    convexdistance::GetBodyAABBFn _getbodyaabb; ///< aabbs of the bodies in _odespace used to cull CO_Distance queries
     size_t _nMaxStartContacts, _nMaxContacts;
     std::string _userdatakey;
     CollisionReport _report;
+    boost::mutex _mutexquery; ///< serializes the queries of this checker, see _GetQueryMutex
+    bool _bMultiThreadedCollisions; ///< true if ode reports ODE_EXT_mt_collisions, see _GetQueryMutex
 
 
 };
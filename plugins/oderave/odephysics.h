@@ -17,6 +17,8 @@
 #define RAVE_PHYSICSENGINE_ODE
 
 #include "odespace.h"
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition.hpp>
 
 class ODEPhysicsEngine : public OpenRAVE::PhysicsEngineBase
 {
@@ -148,6 +150,13 @@ public:
                 }
                 RAVELOG_DEBUG("Setting surface layer depth to: %f\n",_physics->_surfacelayer);
             }
+            else if( name == "contactthreads" ) {
+                int temp=0;
+                _ss >> temp;
+                if( !!_ss ) {
+                    _physics->_SetNumContactThreads(temp);
+                }
+            }
             else {
                 RAVELOG_ERROR("unknown field %s\n", name.c_str());
             }
@@ -170,8 +179,8 @@ public:
             }
         }
 
-        static const boost::array<string, 11>& GetTags() {
-            static const boost::array<string, 11> tags = {{"friction","selfcollision", "gravity", "contact", "erp", "cfm", "elastic_reduction_parameter", "constraint_force_mixing", "dcontactapprox", "numiterations", "surfacelayer" }};
+        static const boost::array<string, 12>& GetTags() {
+            static const boost::array<string, 12> tags = {{"friction","selfcollision", "gravity", "contact", "erp", "cfm", "elastic_reduction_parameter", "constraint_force_mixing", "dcontactapprox", "numiterations", "surfacelayer", "contactthreads" }};
             return tags;
         }
 
@@ -187,7 +196,7 @@ public:
         return BaseXMLReaderPtr(new PhysicsPropertiesXMLReader(boost::dynamic_pointer_cast<ODEPhysicsEngine>(ptr),atts));
     }
 
-    ODEPhysicsEngine(OpenRAVE::EnvironmentBasePtr penv) : OpenRAVE::PhysicsEngineBase(penv), _odespace(new ODESpace(penv, "odephysics", true)) {
+    ODEPhysicsEngine(OpenRAVE::EnvironmentBasePtr penv) : OpenRAVE::PhysicsEngineBase(penv), _odespace(new ODESpace(penv, "odephysics", true)), _nStepId(0), _nPairsPerThread(0), _nBusyThreads(0), _bShutdown(false) {
         stringstream ss;
         ss << ":Interface Author: Rosen Diankov\n\nODE physics engine\n\n\
 It is possible to set ODE physics engine and its properties inside the <environment> XML tags by typing:\n\n\
@@ -199,14 +208,21 @@ It is possible to set ODE physics engine and its properties inside the <environm
       <selfcollision>1</selfcollision>\n\
       <dcontactapprox>1</dcontactapprox>\n\
       <numiterations>1</numiterations>\n\
+      <contactthreads>4</contactthreads>\n\
     </odeproperties>\n\
   </physicsengine>\n\n\
 The possible properties that can be set are: ";
         FOREACHC(it, PhysicsPropertiesXMLReader::GetTags()) {
             ss << "**" << *it << "**, ";
         }
-        ss << "\n\n";
+        ss << "\n\n**contactthreads** sets the number of threads used for narrow-phase contact generation and requires ODE to be built with multi-threading support. Contacts are always merged in broad-phase order, so the simulation does not depend on the number of threads.\n\n";
         __description = ss.str();
+        RegisterCommand("SetContactThreads",boost::bind(&ODEPhysicsEngine::_SetContactThreadsCommand,this,_1,_2),
+                        "Sets the number of threads used for narrow-phase contact generation.");
+        RegisterCommand("GetTimings",boost::bind(&ODEPhysicsEngine::_GetTimingsCommand,this,_1,_2),
+                        "Returns the accumulated time in seconds spent in each phase of SimulateStep since the last reset: numsteps synchronize broadphase narrowphase contacts step writeback");
+        RegisterCommand("ResetTimings",boost::bind(&ODEPhysicsEngine::_ResetTimingsCommand,this,_1,_2),
+                        "Resets the timings returned by GetTimings.");
         _globalfriction = 0.4;
         _globalerp = 0.01;
         _globalcfm = 1e-5;
@@ -216,6 +232,7 @@ The possible properties that can be set are: ";
         _surface_mode = 0;
         _surfacelayer = 0.001;
         _options = OpenRAVE::PEO_SelfCollisions;
+        _numcontactthreads = 1;
 
         memset(_jointadd, 0, sizeof(_jointadd));
         _jointadd[dJointTypeBall] = DummyAddForce;
@@ -235,6 +252,7 @@ The possible properties that can be set are: ";
         _jointgetvel[dJointTypeHinge2].push_back(dJointGetHinge2Angle2Rate);
     }
     virtual ~ODEPhysicsEngine() {
+        _StopContactThreads();
         _odespace->Destroy();
     }
 
@@ -321,6 +339,7 @@ The possible properties that can be set are: ";
         _globalerp = r->_globalerp;
         _surface_mode = r->_surface_mode;
         _num_iterations = r->_num_iterations;
+        _SetNumContactThreads(r->_numcontactthreads);
         if( !!_odespace && _odespace->IsInitialized() ) {
             dWorldSetERP(_odespace->GetWorld(),_globalerp);
             dWorldSetCFM(_odespace->GetWorld(),_globalcfm);
@@ -491,7 +510,9 @@ The possible properties that can be set are: ";
 
     virtual void SimulateStep(OpenRAVE::dReal fTimeElapsed)
     {
+        uint64_t starttime = OpenRAVE::utils::GetMicroTime();
         _odespace->Synchronize();
+        uint64_t synchronizetime = OpenRAVE::utils::GetMicroTime();
 
         bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
         if( bHasCallbacks ) {
@@ -501,6 +522,8 @@ The possible properties that can be set are: ";
             _listcallbacks.clear();
         }
 
+        // broad phase only gathers the candidate pairs, contacts are generated afterwards
+        _vgeompairs.resize(0);
         dSpaceCollide (_odespace->GetSpace(),this,nearCallback);
 
         vector<KinBodyPtr> vbodies;
@@ -514,9 +537,22 @@ The possible properties that can be set are: ";
                 }
             }
         }
+        uint64_t broadphasetime = OpenRAVE::utils::GetMicroTime();
+
+        _CollideGeomPairs();
+        uint64_t narrowphasetime = OpenRAVE::utils::GetMicroTime();
+
+        // merge in the order of the broad phase so that the result is independent of the number of threads
+        for(size_t ipair = 0; ipair < _vgeompairs.size(); ++ipair) {
+            if( _vnumcontacts[ipair] > 0 ) {
+                _ProcessContacts(_vgeompairs[ipair], &_vcontacts.at(ipair*s_nMaxContacts), _vnumcontacts[ipair]);
+            }
+        }
+        uint64_t contactstime = OpenRAVE::utils::GetMicroTime();
 
         dWorldQuickStep(_odespace->GetWorld(), fTimeElapsed);
         dJointGroupEmpty (_odespace->GetContactGroup());
+        uint64_t steptime = OpenRAVE::utils::GetMicroTime();
 
         // synchronize all the objects from the ODE world to the OpenRAVE world
         Transform t;
@@ -541,14 +577,172 @@ The possible properties that can be set are: ";
             else {
                 // the body isn't enabled, so set a different timestamp in order for physics to synchornize it on the next run.
                 pinfo->nLastStamp = (*itbody)->GetUpdateStamp()-1;
+                _odespace->QueueSynchronize(pinfo);
             }
         }
 
         _listcallbacks.clear();
+
+        _timings.numsteps += 1;
+        _timings.synchronize += synchronizetime - starttime;
+        _timings.broadphase += broadphasetime - synchronizetime;
+        _timings.narrowphase += narrowphasetime - broadphasetime;
+        _timings.contacts += contactstime - narrowphasetime;
+        _timings.step += steptime - contactstime;
+        _timings.writeback += OpenRAVE::utils::GetMicroTime() - steptime;
     }
 
 
 private:
+    /// \brief candidate pair of geometries from the broad phase
+    struct GeomPair
+    {
+        dGeomID o1, o2;
+        dBodyID b1, b2;
+        KinBody::LinkPtr plink1, plink2;
+    };
+
+    /// \brief accumulated time in microseconds of each phase of SimulateStep
+    struct StepTimings
+    {
+        StepTimings() {
+            Reset();
+        }
+        void Reset() {
+            numsteps = synchronize = broadphase = narrowphase = contacts = step = writeback = 0;
+        }
+        uint64_t numsteps, synchronize, broadphase, narrowphase, contacts, step, writeback;
+    };
+
+    static const int s_nMaxContacts = 16; ///< max contacts generated per geometry pair
+    static const size_t s_nMinPairsPerThread = 32; ///< below this, waking up the threads costs more than it saves
+
+    /// \brief starts numthreads-1 worker threads that live until the number changes, the calling thread is the remaining one
+    void _SetNumContactThreads(int numthreads)
+    {
+#ifdef ODE_USE_MULTITHREAD
+        numthreads = max(1,numthreads);
+#else
+        if( numthreads > 1 ) {
+            RAVELOG_WARN("ode is not compiled with ODE_USE_MULTITHREAD, so contacts are generated with one thread\n");
+        }
+        numthreads = 1;
+#endif
+        if( numthreads == _numcontactthreads && (int)_vcontactthreads.size() == numthreads-1 ) {
+            return;
+        }
+        _StopContactThreads();
+        _numcontactthreads = numthreads;
+        _bShutdown = false;
+        for(int ithread = 1; ithread < numthreads; ++ithread) {
+            _vcontactthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&ODEPhysicsEngine::_ContactWorkerThread, this, ithread, _nStepId))));
+        }
+    }
+
+    void _StopContactThreads()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutexcontacts);
+            _bShutdown = true;
+        }
+        _condWork.notify_all();
+        FOREACH(itthread, _vcontactthreads) {
+            (*itthread)->join();
+        }
+        _vcontactthreads.resize(0);
+    }
+
+    bool _SetContactThreadsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int numthreads = 1;
+        sinput >> numthreads;
+        if( !sinput ) {
+            return false;
+        }
+        _SetNumContactThreads(numthreads);
+        return true;
+    }
+
+    bool _GetTimingsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sout << _timings.numsteps << " " << _timings.synchronize*1e-6 << " " << _timings.broadphase*1e-6 << " " << _timings.narrowphase*1e-6 << " " << _timings.contacts*1e-6 << " " << _timings.step*1e-6 << " " << _timings.writeback*1e-6;
+        return !!sout;
+    }
+
+    bool _ResetTimingsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        _timings.Reset();
+        return true;
+    }
+
+    /// \brief generates the contacts of all the pairs in _vgeompairs, splitting them into contiguous ranges across the contact threads
+    void _CollideGeomPairs()
+    {
+        size_t numpairs = _vgeompairs.size();
+        _vnumcontacts.resize(numpairs);
+        if( _vcontacts.size() < numpairs*s_nMaxContacts ) {
+            _vcontacts.resize(numpairs*s_nMaxContacts);
+        }
+        size_t numthreads = min((size_t)_vcontactthreads.size()+1, numpairs/s_nMinPairsPerThread);
+        if( numthreads <= 1 ) {
+            _CollideGeomPairsRange(0, numpairs);
+            return;
+        }
+
+        {
+            boost::mutex::scoped_lock lock(_mutexcontacts);
+            _nPairsPerThread = (numpairs+numthreads-1)/numthreads;
+            _nBusyThreads = (int)_vcontactthreads.size();
+            ++_nStepId;
+        }
+        _condWork.notify_all();
+        _CollideGeomPairsRange(0, _nPairsPerThread);
+        boost::mutex::scoped_lock lock(_mutexcontacts);
+        while(_nBusyThreads > 0) {
+            _condDone.wait(lock);
+        }
+    }
+
+    void _CollideGeomPairsRange(size_t istart, size_t iend)
+    {
+        for(size_t ipair = istart; ipair < iend; ++ipair) {
+            _vnumcontacts[ipair] = dCollide(_vgeompairs[ipair].o1, _vgeompairs[ipair].o2, s_nMaxContacts, &_vcontacts[ipair*s_nMaxContacts].geom, sizeof(dContact));
+        }
+    }
+
+    /// \brief generates the contacts of range ithread of every step, the ode data of the thread is allocated once
+    void _ContactWorkerThread(int ithread, int nStepId)
+    {
+#ifdef ODE_HAVE_ALLOCATE_DATA_THREAD
+        dAllocateODEDataForThread(dAllocateMaskAll);
+#endif
+        while(1) {
+            size_t istart, iend;
+            {
+                boost::mutex::scoped_lock lock(_mutexcontacts);
+                while(!_bShutdown && _nStepId == nStepId) {
+                    _condWork.wait(lock);
+                }
+                if( _bShutdown ) {
+                    break;
+                }
+                nStepId = _nStepId;
+                // steps with few pairs use fewer threads, so the range can be empty
+                istart = min(_vgeompairs.size(), ithread*_nPairsPerThread);
+                iend = min(_vgeompairs.size(), (ithread+1)*_nPairsPerThread);
+            }
+            _CollideGeomPairsRange(istart, iend);
+            {
+                boost::mutex::scoped_lock lock(_mutexcontacts);
+                --_nBusyThreads;
+            }
+            _condDone.notify_all();
+        }
+#ifdef ODE_HAVE_ALLOCATE_DATA_THREAD
+        dCleanupODEAllDataForThread();
+#endif
+    }
+
     static void nearCallback(void *data, dGeomID o1, dGeomID o2)
     {
         ((ODEPhysicsEngine*)data)->_nearCallback(o1,o2);
@@ -601,13 +795,23 @@ private:
                 return;
         }
 
-        const int N = 16;
-        dContact contact[N];
-        int n = dCollide (o1,o2,N,&contact[0].geom,sizeof(dContact));
-        if( n <= 0 ) {
-            return;
-        }
+        GeomPair geompair;
+        geompair.o1 = o1;
+        geompair.o2 = o2;
+        geompair.b1 = b1;
+        geompair.b2 = b2;
+        geompair.plink1 = pkb1;
+        geompair.plink2 = pkb2;
+        _vgeompairs.push_back(geompair);
+    }
 
+    /// \brief calls the collision callbacks and creates the contact joints for n contacts of a pair
+    void _ProcessContacts(const GeomPair& geompair, dContact* contact, int n)
+    {
+        dGeomID o1 = geompair.o1;
+        dBodyID b1 = geompair.b1, b2 = geompair.b2;
+        const KinBody::LinkPtr& pkb1 = geompair.plink1;
+        const KinBody::LinkPtr& pkb2 = geompair.plink2;
         if( _listcallbacks.size() > 0 ) {
             // fill the collision report
             _report->Reset(OpenRAVE::CO_Contacts);
@@ -706,6 +910,21 @@ private:
     vector<JointGetFn> _jointgetvel[12];
     std::list<EnvironmentBase::CollisionCallbackFn> _listcallbacks;
     CollisionReportPtr _report;
+
+    int _numcontactthreads; ///< number of threads for narrow-phase contact generation
+
+    // contact thread pool, started by _SetNumContactThreads
+    std::vector<boost::shared_ptr<boost::thread> > _vcontactthreads;
+    boost::mutex _mutexcontacts;
+    boost::condition _condWork, _condDone;
+    int _nStepId; ///< incremented for every step handed to the contact threads
+    size_t _nPairsPerThread;
+    int _nBusyThreads;
+    bool _bShutdown;
+    std::vector<GeomPair> _vgeompairs; ///< candidate pairs gathered by the broad phase in the current step
+    std::vector<dContact> _vcontacts; ///< s_nMaxContacts contacts for every pair of _vgeompairs
+    std::vector<int> _vnumcontacts; ///< number of valid contacts for every pair of _vgeompairs
+    StepTimings _timings;
 };
 
 #endif
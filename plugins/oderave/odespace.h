@@ -16,6 +16,9 @@
 #ifndef OPENRAVE_ODE_SPACE
 #define OPENRAVE_ODE_SPACE
 
+#include "convexdistance.h"
+#include "linkpairstatistics.h"
+
 //#include <boost/thread/tss.hpp>
 
 // manages a space of ODE objects
@@ -87,6 +90,7 @@ public:
 
             dBodyID body;
             dGeomID geom;
+            convexdistance::LinkHullPtr _distancehull; ///< convex hulls of the geometries for distance queries, see ODESpace::GetLinkHull
 
             void Enable(bool bEnable)
             {
@@ -140,6 +144,7 @@ public:
             jointgroup = dJointGroupCreate(0);
             space = dHashSpaceCreate(_ode->space);
             nLastStamp = 0;
+            _bQueued = false;
         }
 
         virtual ~KinBodyInfo() {
@@ -150,6 +155,13 @@ public:
 
             dSpaceDestroy(space);
             dJointGroupDestroy(jointgroup);
+
+            // the user data of a live body was removed, so re-create it on the next Synchronize()
+            boost::shared_ptr<ODESpace> odespace = _odespace.lock();
+            KinBodyPtr pbody = _pbody.lock();
+            if( !!odespace && !!pbody ) {
+                odespace->QueueInitialize(pbody);
+            }
         }
 
         void Reset()
@@ -200,6 +212,7 @@ public:
 
             _geometrycallback.reset();
             _staticcallback.reset();
+            _updatestampcallback.reset();
         }
 
         KinBodyPtr GetBody() {
@@ -215,8 +228,10 @@ public:
         ///< the pointer to this Link is the userdata
         vector<dJointID> vjoints;
         vector<dJointFeedback> vjointfeedback;
-        OpenRAVE::UserDataPtr _geometrycallback, _staticcallback;
+        OpenRAVE::UserDataPtr _geometrycallback, _staticcallback, _updatestampcallback;
         boost::weak_ptr<ODESpace> _odespace;
+        bool _bQueued; ///< true if in ODESpace::_vqueuedinfos
+        LinkPairStatistics _selfcollisionstats; ///< orders the self-collision link pairs by how often they collided
 
         dSpaceID space;                             ///< space that contanis all the collision objects of this chain
         dJointGroupID jointgroup;
@@ -231,6 +246,7 @@ private:
 
     ODESpace(EnvironmentBasePtr penv, const std::string& userdatakey, bool bUsingPhysics) : _penv(penv), _userdatakey(userdatakey), _bUsingPhysics(bUsingPhysics)
     {
+        _bSynchronizeAllBodies = true;
         static bool s_bIsODEInitialized = false;
         if( !s_bIsODEInitialized ) {
             s_bIsODEInitialized = true;
@@ -258,11 +274,18 @@ private:
 
         RAVELOG_VERBOSE("init ode collision environment\n");
         _ode.reset(new ODEResources());
+        {
+            boost::mutex::scoped_lock lockqueue(_mutexqueue);
+            _bSynchronizeAllBodies = true;
+        }
+        // bodies added later are created on the next Synchronize() even if this space does not belong to the environment's checker
+        _bodycallback = _penv->RegisterBodyCallback(boost::bind(&ODESpace::_BodyCallback, weak_space(), _1, _2));
         return true;
     }
 
     void Destroy()
     {
+        _bodycallback.reset();
         DestroyEnvironment();
         _ode.reset();
     }
@@ -485,9 +508,17 @@ private:
             pinfo->_staticcallback = pbody->RegisterChangeCallback(KinBody::Prop_LinkStatic|KinBody::Prop_LinkDynamics, boost::bind(&ODESpace::_ResetKinBodyCallback,boost::bind(&OpenRAVE::utils::sptr_from<ODESpace>, weak_space()),boost::weak_ptr<KinBody const>(pbody)));
         }
 
+        pinfo->_updatestampcallback = pbody->RegisterUpdateStampCallback(boost::bind(&ODESpace::_QueueSynchronizeCallback, weak_space(), boost::weak_ptr<KinBodyInfo>(pinfo)));
+
         pbody->SetUserData(_userdatakey, pinfo);
         _setInitializedBodies.insert(pbody);
         _Synchronize(pinfo, false);
+        if( !!_decomposemeshfn ) {
+            // decompose the meshes now rather than on the first query
+            FOREACHC(itlink, pbody->GetLinks()) {
+                GetLinkHull(*itlink);
+            }
+        }
         return pinfo;
     }
 
@@ -513,6 +544,32 @@ private:
         return _geometrygroup;
     }
 
+    /// \brief sets the function splitting triangle meshes into convex pieces for the link hulls, empty to use one hull per mesh
+    void SetDecomposeMeshFn(const convexdistance::DecomposeMeshFn& decomposemeshfn)
+    {
+        _decomposemeshfn = decomposemeshfn;
+        std::vector<KinBodyPtr> vbodies;
+        _penv->GetBodies(vbodies);
+        FOREACH(itbody, vbodies) {
+            KinBodyInfoPtr pinfo = boost::dynamic_pointer_cast<KinBodyInfo>((*itbody)->GetUserData(_userdatakey));
+            if( !!pinfo ) {
+                FOREACH(itlink, pinfo->vlinks) {
+                    (*itlink)->_distancehull.reset();
+                }
+                if( !!_decomposemeshfn ) {
+                    FOREACHC(itlink, (*itbody)->GetLinks()) {
+                        GetLinkHull(*itlink);
+                    }
+                }
+            }
+        }
+    }
+
+    bool IsDecomposingMeshes() const
+    {
+        return !!_decomposemeshfn;
+    }
+
     void RemoveUserData(KinBodyPtr pbody)
     {
         if( !!pbody ) {
@@ -530,12 +587,63 @@ private:
         dAllocateODEDataForThread(dAllocateMaskAll);
 #endif
         boost::mutex::scoped_lock lockode(_ode->_mutex);
-        vector<KinBodyPtr> vbodies;
-        _penv->GetBodies(vbodies);
-        FOREACHC(itbody, vbodies) {
-            KinBodyInfoPtr pinfo = GetCreateInfo(*itbody, false).first;
-            BOOST_ASSERT( pinfo->GetBody() == *itbody );
-            _Synchronize(pinfo,false);
+        // only the bodies whose stamp changed since they were last synchronized are queued, so static bodies cost nothing
+        std::vector< boost::weak_ptr<KinBodyInfo> > vqueuedinfos;
+        std::vector<KinBodyWeakPtr> vqueuedbodies;
+        bool bsynchronizeall = false;
+        {
+            boost::mutex::scoped_lock lockqueue(_mutexqueue);
+            vqueuedinfos.swap(_vqueuedinfos);
+            vqueuedbodies.swap(_vqueuedbodies);
+            std::swap(bsynchronizeall, _bSynchronizeAllBodies);
+        }
+        if( bsynchronizeall ) {
+            vector<KinBodyPtr> vbodies;
+            _penv->GetBodies(vbodies);
+            FOREACHC(itbody, vbodies) {
+                GetCreateInfo(*itbody, false);
+            }
+        }
+        else {
+            // bodies that were added or whose user data was removed are created lazily
+            FOREACH(itbody, vqueuedbodies) {
+                KinBodyPtr pbody = itbody->lock();
+                if( !!pbody && _penv->GetBodyFromEnvironmentId(pbody->GetEnvironmentId()) == pbody ) {
+                    GetCreateInfo(pbody, false);
+                }
+            }
+        }
+        FOREACH(itinfo, vqueuedinfos) {
+            KinBodyInfoPtr pinfo = itinfo->lock();
+            if( !!pinfo ) {
+                pinfo->_bQueued = false;
+                if( !!pinfo->GetBody() ) {
+                    _Synchronize(pinfo,false);
+                }
+            }
+        }
+        // reuse the memory for the next queue
+        vqueuedinfos.resize(0);
+        boost::mutex::scoped_lock lockqueue(_mutexqueue);
+        if( _vqueuedinfos.size() == 0 ) {
+            _vqueuedinfos.swap(vqueuedinfos);
+        }
+    }
+
+    /// \brief creates the body on the next call to Synchronize() if it is still in the environment and has no user data
+    void QueueInitialize(KinBodyPtr pbody)
+    {
+        boost::mutex::scoped_lock lockqueue(_mutexqueue);
+        _vqueuedbodies.push_back(pbody);
+    }
+
+    /// \brief forces the body to be synchronized on the next call to Synchronize() even if its stamp did not change
+    void QueueSynchronize(KinBodyInfoPtr pinfo)
+    {
+        boost::mutex::scoped_lock lockqueue(_mutexqueue);
+        if( !pinfo->_bQueued ) {
+            pinfo->_bQueued = true;
+            _vqueuedinfos.push_back(pinfo);
         }
     }
 
@@ -569,6 +677,40 @@ private:
         return pinfo->vlinks[plink->GetIndex()]->geom;
     }
 
+    /// \brief returns the convex hulls of the link geometries, computed on first use
+    ///
+    /// The hulls are discarded together with the body info whenever the geometry changes or SetDecomposeMeshFn is called.
+    convexdistance::LinkHullConstPtr GetLinkHull(KinBody::LinkConstPtr plink)
+    {
+        KinBodyInfoPtr pinfo = GetInfo(plink->GetParent());
+        if( !pinfo ) {
+            return convexdistance::LinkHullConstPtr();
+        }
+        BOOST_ASSERT( plink->GetIndex() >= 0 && plink->GetIndex() < (int)pinfo->vlinks.size());
+        boost::shared_ptr<KinBodyInfo::LINK> link = pinfo->vlinks[plink->GetIndex()];
+        if( !link->_distancehull ) {
+            link->_distancehull.reset(new convexdistance::LinkHull());
+            link->_distancehull->Init(plink, _geometrygroup, _decomposemeshfn);
+        }
+        return link->_distancehull;
+    }
+
+    /// \brief fills the world aabb of all geometries of the body in this space, used to cull distance queries
+    bool GetBodyAABB(KinBodyConstPtr pbody, OpenRAVE::AABB& ab)
+    {
+        KinBodyInfoPtr pinfo = GetInfo(pbody);
+        if( !pinfo || pinfo->GetBody() != pbody || dSpaceGetNumGeoms(pinfo->space) == 0 ) {
+            return false;
+        }
+        // the aabbs of moved geometries are only recomputed when their space is cleaned
+        dSpaceClean(pinfo->space);
+        dReal aabb[6];
+        dGeomGetAABB((dGeomID)pinfo->space, aabb);
+        ab.pos = Vector(0.5*(aabb[0]+aabb[1]), 0.5*(aabb[2]+aabb[3]), 0.5*(aabb[4]+aabb[5]));
+        ab.extents = Vector(0.5*(aabb[1]-aabb[0]), 0.5*(aabb[3]-aabb[2]), 0.5*(aabb[5]-aabb[4]));
+        return true;
+    }
+
     dJointID GetJoint(KinBody::JointConstPtr pjoint)
     {
         KinBodyInfoPtr pinfo = GetInfo(pjoint->GetParent());
@@ -685,6 +827,8 @@ private:
     /// \param block if true, then will lock _ode->_mutex. Set to false when mutex is known to be already locked.
     void _Synchronize(KinBodyInfoPtr pinfo, bool block=true)
     {
+        // arm before reading the body so that any later change queues it again
+        pinfo->GetBody()->ArmUpdateStampCallbacks();
         if( pinfo->nLastStamp != pinfo->GetBody()->GetUpdateStamp() ) {
             boost::shared_ptr<boost::mutex::scoped_lock> lockode;
             if( block ) {
@@ -712,6 +856,25 @@ private:
         }
     }
 
+    /// \brief called from the body every time its stamp changes, the body is queued once until the next Synchronize()
+    static void _QueueSynchronizeCallback(boost::weak_ptr<ODESpace> _pspace, boost::weak_ptr<KinBodyInfo> _pinfo)
+    {
+        boost::shared_ptr<ODESpace> pspace = _pspace.lock();
+        KinBodyInfoPtr pinfo = _pinfo.lock();
+        if( !!pspace && !!pinfo ) {
+            pspace->QueueSynchronize(pinfo);
+        }
+    }
+
+    /// \brief called from the environment when a body is added
+    static void _BodyCallback(boost::weak_ptr<ODESpace> _pspace, KinBodyPtr pbody, int action)
+    {
+        boost::shared_ptr<ODESpace> pspace = _pspace.lock();
+        if( !!pspace && action == 1 ) {
+            pspace->QueueInitialize(pbody);
+        }
+    }
+
     void _ResetKinBodyCallback(boost::weak_ptr<KinBody const> _pbody)
     {
         KinBodyConstPtr pbody(_pbody);
@@ -728,8 +891,14 @@ private:
     boost::shared_ptr<ODEResources> _ode;
     std::string _userdatakey;
     std::string _geometrygroup;
+    convexdistance::DecomposeMeshFn _decomposemeshfn; ///< if set, triangle meshes of the link hulls are split into convex pieces
     SynchronizeCallbackFn _synccallback;
     std::set<KinBodyConstPtr> _setInitializedBodies; ///< set of bodies that have been initialized and user data is set
+    std::vector< boost::weak_ptr<KinBodyInfo> > _vqueuedinfos; ///< bodies whose update stamp changed since they were last synchronized
+    std::vector<KinBodyWeakPtr> _vqueuedbodies; ///< bodies that might not have user data yet, see \ref QueueInitialize
+    bool _bSynchronizeAllBodies; ///< if true, the next Synchronize() creates the user data of all bodies in the environment
+    boost::mutex _mutexqueue; ///< protects _vqueuedinfos, _vqueuedbodies and _bSynchronizeAllBodies since bodies can be modified outside of _ode->_mutex
+    OpenRAVE::UserDataPtr _bodycallback; ///< \see _BodyCallback
     bool _bUsingPhysics;
 };
 
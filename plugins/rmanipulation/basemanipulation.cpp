@@ -58,6 +58,10 @@ Method wraps the WorkspaceTrajectoryTracker planner. For more details on paramet
                         "Sets post processing parameters.");
         RegisterCommand("SetRobot",boost::bind(&BaseManipulation::SetRobotCommand,this,_1,_2),
                         "Sets the robot.");
+        RegisterCommand("SetEdgeValidityCache",boost::bind(&BaseManipulation::SetEdgeValidityCacheCommand,this,_1,_2),
+                        "Sets an edge cache of maximum N edges on the robot so that repeated planning queries in the same scene reuse the edges already checked, N=0 removes the cache. See planningutils::EdgeValidityCache.");
+        RegisterCommand("GetEdgeValidityCacheStatistics",boost::bind(&BaseManipulation::GetEdgeValidityCacheStatisticsCommand,this,_1,_2),
+                        "Returns the number of hits, misses, and stored edges of the robot's edge cache.");
         _minimumgoalpaths=1;
     }
 
@@ -1114,6 +1118,32 @@ protected:
         return !!sinput;
     }
 
+    bool SetEdgeValidityCacheCommand(ostream& sout, istream& sinput)
+    {
+        size_t maxedges = 0;
+        sinput >> maxedges;
+        if( !sinput ) {
+            return false;
+        }
+        if( maxedges == 0 ) {
+            robot->RemoveUserData("edgevaliditycache");
+        }
+        else {
+            robot->SetUserData("edgevaliditycache", planningutils::EdgeValidityCachePtr(new planningutils::EdgeValidityCache(maxedges)));
+        }
+        return true;
+    }
+
+    bool GetEdgeValidityCacheStatisticsCommand(ostream& sout, istream& sinput)
+    {
+        planningutils::EdgeValidityCachePtr pedgecache = planningutils::EdgeValidityCache::GetBodyCache(robot);
+        if( !pedgecache ) {
+            return false;
+        }
+        sout << pedgecache->GetNumHits() << " " << pedgecache->GetNumMisses() << " " << pedgecache->GetNumEdges();
+        return true;
+    }
+
     RobotBasePtr robot;
     string _strRRTPlannerName;
     dReal _fMaxVelMult;
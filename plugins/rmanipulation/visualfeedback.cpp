@@ -14,11 +14,12 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "commonmanipulation.h"
+#include <boost/thread/thread.hpp>
 
-/// samples rays from the projected OBB and returns true if the test function returns true
-/// for all the rays. Otherwise, returns false
-/// allowableoutliers - specifies the % of allowable outliying rays
-bool SampleProjectedOBBWithTest(const OBB& obb, dReal delta, const boost::function<bool(const Vector&)>& testfn,dReal allowableocclusion=0)
+/// samples rays from the projected OBB and appends their directions (on the z=1 plane) to vsamples.
+/// allowableocclusion - specifies the % of allowable outliying rays
+/// \return the number of rays that are allowed to fail
+int SampleProjectedOBB(const OBB& obb, dReal delta, std::vector<Vector>& vsamples, dReal allowableocclusion=0)
 {
     dReal fscalefactor = 0.95f; // have to make box smaller or else rays might miss
     Vector vpoints[8] = { obb.pos + fscalefactor*(obb.right*obb.extents.x + obb.up*obb.extents.y + obb.dir*obb.extents.z),
@@ -94,10 +95,7 @@ bool SampleProjectedOBBWithTest(const OBB& obb, dReal delta, const boost::functi
             int numsteps = (int)(ftotalen/delta);
             Vector vdelta = (vcur2-vcur1)*(1.0f/numsteps), vcur = vcur1;
             for(int k = 0; k <= numsteps; ++k, vcur += vdelta) {
-                if( !testfn(vcur) ) {
-                    if( nallowableoutliers-- <= 0 )
-                        return false;
-                }
+                vsamples.push_back(vcur);
             }
         }
 
@@ -120,15 +118,12 @@ bool SampleProjectedOBBWithTest(const OBB& obb, dReal delta, const boost::functi
             int numsteps = (int)(ftotalen/delta);
             Vector vdelta = (vcur2-vcur1)*(1.0f/numsteps), vcur = vcur1;
             for(int k = 0; k <= numsteps; ++k, vcur += vdelta) {
-                if( !testfn(vcur) ) {
-                    if( nallowableoutliers-- <= 0 )
-                        return false;
-                }
+                vsamples.push_back(vcur);
             }
         }
     }
 
-    return true;
+    return nallowableoutliers;
 }
 
 class VisualFeedback : public ModuleBase
@@ -278,6 +273,47 @@ public:
             return true;
         }
 
+        /// \brief InConvexHull for many camera transforms at once
+        ///
+        /// Instead of moving the planes into the target coordinate system for every camera, the target OBBs are moved
+        /// into the camera coordinate system where the planes are fixed. The plane loop is branch-free over contiguous
+        /// arrays so that the compiler can vectorize it.
+        /// \param vCamerasInTarget camera transforms in the target coordinate system
+        /// \param vinside set to 1 for every camera that sees all the target OBBs, 0 otherwise
+        /// \param mindist Minimum distance to keep from the plane (should be non-negative)
+        void InConvexHull(const vector<Transform>& vCamerasInTarget, vector<uint8_t>& vinside, dReal mindist=0)
+        {
+            size_t numplanes = _vf->_vconvexplanes.size();
+            _vplanecoeffs.resize(3*numplanes);
+            for(size_t i = 0; i < numplanes; ++i) {
+                _vplanecoeffs[i] = _vf->_vconvexplanes[i].x;
+                _vplanecoeffs[numplanes+i] = _vf->_vconvexplanes[i].y;
+                _vplanecoeffs[2*numplanes+i] = _vf->_vconvexplanes[i].z;
+            }
+            const dReal* px = numplanes > 0 ? &_vplanecoeffs[0] : NULL;
+            const dReal* py = px+numplanes;
+            const dReal* pz = py+numplanes;
+
+            vinside.resize(vCamerasInTarget.size());
+            for(size_t icamera = 0; icamera < vCamerasInTarget.size(); ++icamera) {
+                TransformMatrix tTargetInCamera = vCamerasInTarget[icamera].inverse();
+                uint8_t inside = 1;
+                for(size_t iobb = 0; iobb < _vTargetOBBs.size() && inside; ++iobb) {
+                    const OBB& obb = _vTargetOBBs[iobb];
+                    Vector pos = tTargetInCamera*obb.pos;
+                    Vector right = tTargetInCamera.rotate(obb.right)*obb.extents.x;
+                    Vector up = tTargetInCamera.rotate(obb.up)*obb.extents.y;
+                    Vector dir = tTargetInCamera.rotate(obb.dir)*obb.extents.z;
+                    for(size_t i = 0; i < numplanes; ++i) {
+                        dReal fdist = pos.x*px[i] + pos.y*py[i] + pos.z*pz[i] - mindist;
+                        dReal fradius = RaveFabs(right.x*px[i] + right.y*py[i] + right.z*pz[i]) + RaveFabs(up.x*px[i] + up.y*py[i] + up.z*pz[i]) + RaveFabs(dir.x*px[i] + dir.y*py[i] + dir.z*pz[i]);
+                        inside &= (uint8_t)(fdist >= fradius);
+                    }
+                }
+                vinside[icamera] = inside;
+            }
+        }
+
         /// check if any part of the environment or robot is in front of the camera blocking the object
         /// sample object's surface and shoot rays
         /// \param tCameraInTarget in target coordinate system
@@ -287,15 +323,21 @@ public:
             TransformMatrix tCameraInTargetinv = tCameraInTarget.inverse();
             Transform ttarget = _vf->_target->GetTransform();
             _ptargetbox->SetTransform(ttarget);
-            Transform tworldcamera = ttarget*tCameraInTarget;
+            TransformMatrix tworldcamera = ttarget*tCameraInTarget;
             _ptargetbox->Enable(true);
             //_vf->_target->Enable(false);
             SampleRaysScope srs(*this);
             FOREACH(itobb,_vTargetOBBs) {
                 OBB cameraobb = geometry::TransformOBB(tCameraInTargetinv,*itobb);
-                if( !SampleProjectedOBBWithTest(cameraobb, _vf->_fSampleRayDensity, boost::bind(&VisibilityConstraintFunction::_TestRay, this, _1, boost::ref(tworldcamera)),_vf->_fAllowableOcclusion) ) {
-                    RAVELOG_VERBOSE("box is occluded\n");
-                    return true;
+                _vraysamples.resize(0);
+                int nallowableoutliers = SampleProjectedOBB(cameraobb, _vf->_fSampleRayDensity, _vraysamples, _vf->_fAllowableOcclusion);
+                FOREACHC(itray, _vraysamples) {
+                    if( !_TestRay(*itray, tworldcamera) ) {
+                        if( nallowableoutliers-- <= 0 ) {
+                            RAVELOG_VERBOSE("box is occluded\n");
+                            return true;
+                        }
+                    }
                 }
             }
             return false;
@@ -320,13 +362,15 @@ public:
             TransformMatrix tcamerainv = tcamera.inverse();
             Transform ttarget = _vf->_target->GetTransform();
             _ptargetbox->SetTransform(ttarget);
-            Transform tworldcamera = ttarget*tcamera;
             _ptargetbox->Enable(true);
             //_vf->_target->Enable(false);
             SampleRaysScope srs(*this);
+            _vraysamples.resize(0);
             FOREACH(itobb,_vTargetOBBs) {
-                OBB cameraobb = geometry::TransformOBB(tcamerainv,*itobb);
-                if( !SampleProjectedOBBWithTest(cameraobb, _vf->_fSampleRayDensity, boost::bind(&VisibilityConstraintFunction::_TestRayRigid, this, _1, boost::ref(tworldcamera),boost::ref(vattachedlinks)), 0.0f) ) {
+                SampleProjectedOBB(geometry::TransformOBB(tcamerainv,*itobb), _vf->_fSampleRayDensity, _vraysamples, 0);
+            }
+            FOREACHC(itray, _vraysamples) {
+                if( !_TestRayRigid(*itray) ) {
                     return true;
                 }
             }
@@ -360,7 +404,7 @@ private:
             return !!_report->plink1 && _report->plink1->GetParent() == _ptargetbox;
         }
 
-        bool _TestRayRigid(const Vector& v, const TransformMatrix& tcamera, const vector<KinBody::LinkPtr>& vattachedlinks)
+        bool _TestRayRigid(const Vector& v)
         {
             dReal filen = 1/RaveSqrt(v.lengthsqr3());
             RAY r((_vf->_fRayMinDist*filen)*v,(2.0f*filen)*v);
@@ -406,6 +450,8 @@ private:
         CollisionReportPtr _report;
         AABB _abTarget;         // target aabb
         vector<Vector> _vconvexplanes3d;
+        vector<dReal> _vplanecoeffs;         ///< x, y, and z coefficients of all convex planes, used by the batched InConvexHull
+        vector<Vector> _vraysamples;         ///< ray directions of the current camera on the z=1 plane
     };
 
     class GoalSampleFunction
@@ -415,6 +461,18 @@ public:
         {
             RAVELOG_DEBUG(str(boost::format("have %d detection extents hypotheses\n")%_visibilitytransforms.size()));
             _ttarget = _vf->_target->GetTransform();
+            // the camera does not move relative to the target while sampling, so prune the hypotheses outside the convex hull all at once
+            vector<Transform> vCamerasInTarget(_visibilitytransforms.size());
+            Transform tsensorintarget = _ttarget.inverse()*_vf->_psensor->GetTransform();
+            for(size_t i = 0; i < _visibilitytransforms.size(); ++i) {
+                if( _vf->_robot != _vf->_sensorrobot ) {
+                    vCamerasInTarget[i] = _visibilitytransforms[i].inverse()*tsensorintarget;
+                }
+                else {
+                    vCamerasInTarget[i] = _visibilitytransforms[i];
+                }
+            }
+            _vconstraint.InConvexHull(vCamerasInTarget, _vinside);
             _sphereperms.PermuteStart(_visibilitytransforms.size());
         }
         virtual ~GoalSampleFunction() {
@@ -440,6 +498,9 @@ public:
 
         bool SampleWithParameters(int isample, vector<dReal>& pNewSample)
         {
+            if( !_vinside.at(isample) ) {
+                return false;
+            }
             TransformMatrix tcamera = _ttarget*_visibilitytransforms.at(isample);
             return _vconstraint.SampleWithCamera(tcamera,pNewSample);
         }
@@ -452,6 +513,7 @@ private:
 
 
         Transform _ttarget;         ///< transform of target
+        vector<uint8_t> _vinside;         ///< 1 if the target is inside the camera convex hull for the visibility transform
         Vector _vTargetLocalCenter;
         RandomPermutationExecutor _sphereperms;
         vector<Transform> _vcameras;         ///< camera transformations in local coord systems
@@ -482,7 +544,8 @@ Visibility computation checks occlusion with other objects using ray sampling in
                         "Processes the visibility extents of the target and initializes the camera transforms.\n\
 \n\
 :param sphere: Sets the transforms along a sphere density and the distances\n\
-:param conedirangle: Prunes the currently set transforms along a cone centered at the local target center and directed towards conedirangle with a half-angle of ``|conedirangle|``. Can specify multiple cones for an OR effect.");
+:param conedirangle: Prunes the currently set transforms along a cone centered at the local target center and directed towards conedirangle with a half-angle of ``|conedirangle|``. Can specify multiple cones for an OR effect.\n\
+:param numthreads: Number of threads that cast the occlusion rays, each thread works on a clone of the environment. Results are cached for the target geometry.");
         RegisterCommand("SetCameraTransforms",boost::bind(&VisualFeedback::SetCameraTransforms,this,_1,_2),
                         "Sets new camera transformations. Can optionally choose a minimum distance from all planes of the camera convex hull (includes gripper mask)");
         RegisterCommand("ComputeVisibility",boost::bind(&VisualFeedback::ComputeVisibility,this,_1,_2),
@@ -760,7 +823,7 @@ Visibility computation checks occlusion with other objects using ray sampling in
         string cmd;
         Vector vTargetLocalCenter;
         bool bSetTargetCenter = false;
-        int numrolls=8;
+        int numrolls=8, numthreads=1;
         vector<Vector> vconedirangles;
         vector<Transform> vtransforms;
         while(!sinput.eof()) {
@@ -783,6 +846,8 @@ Visibility computation checks occlusion with other objects using ray sampling in
             }
             else if( cmd == "numrolls" )
                 sinput >> numrolls;
+            else if( cmd == "numthreads" )
+                sinput >> numthreads;
             else if( cmd == "extents" ) {
                 if( !bSetTargetCenter && !!_target ) {
                     KinBody::KinBodyStateSaver saver(_target);
@@ -879,35 +944,187 @@ Visibility computation checks occlusion with other objects using ray sampling in
 
         KinBody::KinBodyStateSaver saver(_target,KinBody::Save_LinkTransformation);
         _target->SetTransform(Transform());
-        boost::shared_ptr<VisibilityConstraintFunction> pconstraintfn(new VisibilityConstraintFunction(shared_problem()));
+
+        vector<uint8_t> vvisible;
+        string cachekey = _GetRigidVisibilityCacheKey(vtransforms);
+        std::map<std::string, std::vector<uint8_t> >::iterator itcache = _mapRigidVisibilityCache.find(cachekey);
+        if( itcache != _mapRigidVisibilityCache.end() ) {
+            RAVELOG_DEBUG_FORMAT("using cached visibility of %d transforms", vtransforms.size());
+            vvisible = itcache->second;
+        }
+        else {
+            _ComputeRigidVisibility(vtransforms, vvisible, numthreads);
+            if( _mapRigidVisibilityCache.size() >= 16 ) {
+                _mapRigidVisibilityCache.clear();
+            }
+            _mapRigidVisibilityCache[cachekey] = vvisible;
+        }
 
         // get all the camera positions and test them
-        FOREACHC(itcamera, vtransforms) {
-            Transform tCameraInTarget = *itcamera;
-            Transform tTargetInWorld;
-            if( _sensorrobot == _robot ) {
-                //BOOST_ASSERT(0);
-                tTargetInWorld = _sensorrobot->GetTransform() * tCameraInTarget.inverse();
+        for(size_t i = 0; i < vtransforms.size(); ++i) {
+            if( !vvisible[i] ) {
+                continue;
+            }
+            Transform tCameraInTarget = vtransforms[i];
+            Transform tTargetInWorld = _sensorrobot->GetTransform() * tCameraInTarget.inverse();
+            if( !_pmanip->CheckEndEffectorCollision(tTargetInWorld*_ttogripper, _preport) ) {
+                sout << tCameraInTarget << " ";
             }
             else {
-                tTargetInWorld = _sensorrobot->GetTransform() * tCameraInTarget.inverse();
+                RAVELOG_VERBOSE_FORMAT("in convex hull, but end effector collision: %s", _preport->__str__());
             }
+        }
 
-            if( pconstraintfn->InConvexHull(*itcamera) ) {
-                if( !_pmanip->CheckEndEffectorCollision(tTargetInWorld*_ttogripper, _preport) ) {
-                    if( !pconstraintfn->IsOccludedByRigid(*itcamera) ) {
-                        sout << *itcamera << " ";
-                    }
-                    else {
-                        RAVELOG_VERBOSE("in convex hull and effector is free, but not occluded by rigid\n");
-                    }
+        return true;
+    }
+
+    /// \brief rigid visibility of a batch of camera transforms, shared between the worker threads
+    struct RigidVisibilityWork
+    {
+        RigidVisibilityWork() : nextcamera(0) {
+        }
+        vector<Transform> vcameras; ///< camera transforms in the target coordinate system that are inside the convex hull
+        vector<uint8_t> vvisible; ///< 1 if vcameras[i] is not occluded by the links rigidly attached to the sensor
+        boost::mutex mutex; ///< protects nextcamera
+        size_t nextcamera; ///< next camera to be processed by any thread
+    };
+    typedef boost::shared_ptr<RigidVisibilityWork> RigidVisibilityWorkPtr;
+
+    /// \brief returns a key identifying the rigid visibility of the camera transforms
+    ///
+    /// Rigid visibility only depends on the target geometry, the robot links rigidly attached to the sensor, the camera
+    /// convex hull, and the ray parameters, so the rest of the environment is not part of the key.
+    std::string _GetRigidVisibilityCacheKey(const vector<Transform>& vtransforms) const
+    {
+        stringstream ss; ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        ss << _target->GetKinematicsGeometryHash() << " " << _robot->GetRobotStructureHash() << " " << _sensorrobot->GetRobotStructureHash() << " " << _psensor->GetName() << " " << _fSampleRayDensity << " " << _fRayMinDist << " ";
+        // the joint values decide which links are rigidly attached to the camera and where they are
+        vector<dReal> vsensorrobotvalues;
+        _sensorrobot->GetDOFValues(vsensorrobotvalues);
+        FOREACHC(itvalue, vsensorrobotvalues) {
+            ss << *itvalue << " ";
+        }
+        ss << _psensor->GetRelativeTransform() << " ";
+        FOREACHC(itplane, _vconvexplanes) {
+            ss << *itplane << " ";
+        }
+        FOREACHC(ittrans, vtransforms) {
+            ss << *ittrans << " ";
+        }
+        return utils::GetMD5HashString(ss.str());
+    }
+
+    /// \brief sets vvisible[i] to 1 if the target is inside the camera convex hull of vtransforms[i] and is not occluded by the rigidly attached links.
+    ///
+    /// The convex hull is tested for all transforms at once, the occlusion rays of the remaining transforms are
+    /// distributed over numthreads threads that each work on their own clone of the environment.
+    /// The target should be at the identity.
+    void _ComputeRigidVisibility(const vector<Transform>& vtransforms, vector<uint8_t>& vvisible, int numthreads)
+    {
+        uint64_t starttime = utils::GetMicroTime();
+        RigidVisibilityWorkPtr work(new RigidVisibilityWork());
+        vector<size_t> vindices;
+        bool bthreaded = false;
+        {
+            boost::shared_ptr<VisibilityConstraintFunction> pconstraintfn(new VisibilityConstraintFunction(shared_problem()));
+            vector<uint8_t> vinside;
+            pconstraintfn->InConvexHull(vtransforms, vinside);
+            for(size_t i = 0; i < vtransforms.size(); ++i) {
+                if( vinside[i] ) {
+                    work->vcameras.push_back(vtransforms[i]);
+                    vindices.push_back(i);
                 }
-                else {
-                    RAVELOG_VERBOSE_FORMAT("in convex hull, but end effector collision: %s", _preport->__str__());
+            }
+            work->vvisible.resize(work->vcameras.size(), 0);
+            bthreaded = numthreads > 1 && work->vcameras.size() > 1;
+            if( !bthreaded ) {
+                _RigidVisibilityWorker(work, pconstraintfn);
+            }
+        }
+        if( bthreaded ) {
+            // clone after the constraint function is gone so that its dummy box is not copied
+            EnvironmentBasePtr pcloneenv = GetEnv()->CloneSelf(Clone_Bodies);
+            vector<boost::shared_ptr<boost::thread> > listthreads(min(numthreads, (int)work->vcameras.size()));
+            FOREACH(itthread,listthreads) {
+                itthread->reset(new boost::thread(boost::bind(&VisualFeedback::_RigidVisibilityThread,this,work,pcloneenv)));
+            }
+            FOREACH(itthread,listthreads) {
+                (*itthread)->join();
+            }
+            pcloneenv->Destroy();
+        }
+
+        vvisible.resize(0);
+        vvisible.resize(vtransforms.size(), 0);
+        for(size_t i = 0; i < vindices.size(); ++i) {
+            vvisible[vindices[i]] = work->vvisible[i];
+        }
+        RAVELOG_DEBUG_FORMAT("%d/%d transforms in convex hull, rigid visibility took %fs", vindices.size()%vtransforms.size()%(1e-6*(utils::GetMicroTime()-starttime)));
+    }
+
+    void _RigidVisibilityThread(RigidVisibilityWorkPtr work, EnvironmentBasePtr penv)
+    {
+        EnvironmentBasePtr pcloneenv = penv->CloneSelf(Clone_Bodies);
+        {
+            EnvironmentMutex::scoped_lock lock(pcloneenv->GetMutex());
+            boost::shared_ptr<VisualFeedback> pvf(new VisualFeedback(pcloneenv));
+            if( pvf->_CopyCameraAndTarget(*this) ) {
+                boost::shared_ptr<VisibilityConstraintFunction> pconstraintfn(new VisibilityConstraintFunction(pvf));
+                _RigidVisibilityWorker(work, pconstraintfn);
+            }
+            else {
+                RAVELOG_ERROR("failed to find the camera and target in the cloned environment\n");
+            }
+        }
+        pcloneenv->Destroy();
+    }
+
+    /// \brief processes cameras until all are done, the environment of pconstraintfn should be locked
+    void _RigidVisibilityWorker(RigidVisibilityWorkPtr work, boost::shared_ptr<VisibilityConstraintFunction> pconstraintfn)
+    {
+        while(1) {
+            size_t icamera;
+            {
+                boost::mutex::scoped_lock lock(work->mutex);
+                if( work->nextcamera >= work->vcameras.size() ) {
+                    break;
                 }
+                icamera = work->nextcamera++;
             }
+            work->vvisible[icamera] = !pconstraintfn->IsOccludedByRigid(work->vcameras[icamera]);
         }
+    }
 
+    /// \brief copies the camera and target settings of vf, the bodies are looked up by name in the environment of this module
+    bool _CopyCameraAndTarget(const VisualFeedback& vf)
+    {
+        _robot = GetEnv()->GetRobot(vf._robot->GetName());
+        _sensorrobot = GetEnv()->GetRobot(vf._sensorrobot->GetName());
+        _target = GetEnv()->GetKinBody(vf._target->GetName());
+        if( !_robot || !_sensorrobot || !_target ) {
+            return false;
+        }
+        _psensor.reset();
+        FOREACHC(itsensor,_sensorrobot->GetAttachedSensors()) {
+            if( (*itsensor)->GetName() == vf._psensor->GetName() ) {
+                _psensor = *itsensor;
+                break;
+            }
+        }
+        _pmanip = _robot->GetManipulator(vf._pmanip->GetName());
+        if( !_psensor || !_pmanip ) {
+            return false;
+        }
+        _bIgnoreSensorCollision = vf._bIgnoreSensorCollision;
+        _bCameraOnManip = vf._bCameraOnManip;
+        _fMaxVelMult = vf._fMaxVelMult;
+        _pcamerageom = vf._pcamerageom;
+        _ttogripper = vf._ttogripper;
+        _fRayMinDist = vf._fRayMinDist;
+        _fAllowableOcclusion = vf._fAllowableOcclusion;
+        _fSampleRayDensity = vf._fSampleRayDensity;
+        _vconvexplanes = vf._vconvexplanes;
+        _vcenterconvex = vf._vcenterconvex;
         return true;
     }
 
@@ -951,10 +1168,12 @@ Visibility computation checks occlusion with other objects using ray sampling in
             _target->SetTransform(Transform());
             boost::shared_ptr<VisibilityConstraintFunction> pconstraintfn(new VisibilityConstraintFunction(shared_problem()));
             vector<Transform> visibilitytransforms; visibilitytransforms.swap(_visibilitytransforms);
+            vector<uint8_t> vinside;
+            pconstraintfn->InConvexHull(visibilitytransforms, vinside, mindist);
             _visibilitytransforms.reserve(visibilitytransforms.size());
-            FOREACH(it,visibilitytransforms) {
-                if( pconstraintfn->InConvexHull(*it,mindist) ) {
-                    _visibilitytransforms.push_back(*it);
+            for(size_t i = 0; i < visibilitytransforms.size(); ++i) {
+                if( vinside[i] ) {
+                    _visibilitytransforms.push_back(visibilitytransforms[i]);
                 }
             }
         }
@@ -1357,6 +1576,7 @@ protected:
     dReal _fRayMinDist, _fAllowableOcclusion, _fSampleRayDensity;
 
     CollisionReportPtr _preport;
+    std::map<std::string, std::vector<uint8_t> > _mapRigidVisibilityCache; ///< results of _ComputeRigidVisibility indexed by _GetRigidVisibilityCacheKey
 
     vector<Vector> _vconvexplanes;     ///< the planes defining the bounding visibility region (posive is inside)
     Vector _vcenterconvex;     ///< center point on the z=1 plane of the convex region
@@ -13,7 +13,8 @@
 //
 // You should have received a copy of the GNU Lesser General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
-#include "openraveplugindefs.h"
+#include "rplanners.h"
+#include <deque>
 
 class RandomizedAStarPlanner : public PlannerBase
 {
@@ -50,78 +51,6 @@ private:
     };
 
 
-    // sorted by increasing getvalue
-    template <class T, class S> class BinarySearchTree
-    {
-public:
-        BinarySearchTree() {
-            Reset();
-        }
-
-        // other global definitions
-        void Add(T& pex)
-        {
-            BOOST_ASSERT( pex != NULL );
-
-            switch(blocks.size()) {
-            case 0:
-                blocks.push_back(pex);
-                return;
-            case 1:
-                if( blocks.front()->getvalue() < pex->getvalue() ) {
-                    blocks.push_back(pex);
-                }
-                else blocks.insert(blocks.begin(), pex);
-
-                return;
-
-            default: {
-                int imin = 0, imax = (int)blocks.size(), imid;
-
-                while(imin < imax) {
-                    imid = (imin+imax)>>1;
-
-                    if( blocks[imid]->getvalue() > pex->getvalue() ) imax = imid;
-                    else imin = imid+1;
-                }
-
-                blocks.insert(blocks.begin()+imin, pex);
-                return;
-            }
-            }
-        }
-
-        ///< returns the index into blocks
-        int Get(S& s)
-        {
-            switch(blocks.size()) {
-            case 1: return 0;
-            case 2: return blocks.front()->getvalue() < s;
-            default: {
-                int imin = 0, imax = blocks.size()-1, imid;
-
-                while(imin < imax) {
-                    imid = (imin+imax)>>1;
-
-                    if( blocks[imid]->getvalue() > s ) imax = imid;
-                    else if( blocks[imid]->getvalue() == s ) return imid;
-                    else imin = imid+1;
-                }
-
-                return imin;
-            }
-            }
-        }
-
-        void Reset()
-        {
-            blocks.clear();
-            blocks.reserve(1<<16);
-        }
-
-        vector<T> blocks;
-    };
-
 public:
     class RAStarParameters : public PlannerBase::PlannerParameters {
 public:
@@ -195,15 +124,6 @@ protected:
             parent = NULL; level = 0; numchildren = 0;
         }
 
-        // negative because those are most likely to be popped first
-        dReal getvalue() {
-            return -ftotal;
-        }
-
-        bool compare(const Node* r) {
-            BOOST_ASSERT(r != NULL); return ftotal < r->ftotal;
-        }
-
         dReal fcost, ftotal;
         int level;
         Node* parent;
@@ -216,60 +136,11 @@ protected:
         return p1->ftotal < p2->ftotal;    //p1->ftotal-p1->fcost < p2->ftotal-p2->fcost;
     }
 
-    // implement kd-tree or approx-nn in the future, deallocates memory from Node
-    class SpatialTree
+    /// \brief heap order of the open set, the node with the lowest ftotal is popped first
+    static bool SortOpenNodes(const RandomizedAStarPlanner::Node* p1, const RandomizedAStarPlanner::Node* p2)
     {
-public:
-        SpatialTree() {
-            _fBestDist = 0;
-        }
-        ~SpatialTree() {
-            Destroy();
-        }
-
-        void Destroy()
-        {
-            list<Node*>::iterator it;
-            FORIT(it, _nodes)
-            delete *it;
-            FORIT(it, _dead)
-            delete *it;
-            _nodes.clear();
-        }
-
-        inline void AddNode(Node* pnode) {
-            _nodes.push_back(pnode);
-        }
-        Node* GetNN(const vector<dReal>& q)
-        {
-            if( _nodes.size() == 0 )
-                return NULL;
-
-            list<Node*>::iterator itnode = _nodes.begin(), itbest = _nodes.begin();
-            dReal fbest = _pDistMetric(q, _nodes.front()->q);
-            ++itnode;
-
-            while(itnode != _nodes.end()) {
-                dReal f = _pDistMetric(q, (*itnode)->q);
-                if( f < fbest ) {
-                    itbest = itnode;
-                    fbest = f;
-                }
-                ++itnode;
-            }
-
-            _fBestDist = fbest;
-            return *itbest;
-        }
-        inline void RemoveNode(Node* pnode) {
-            _nodes.remove(pnode);
-        }
-
-        list<Node*> _nodes;
-        list<Node*> _dead;
-        boost::function<dReal(const std::vector<dReal>&, const std::vector<dReal>&)> _pDistMetric;
-        dReal _fBestDist;         ///< valid after a call to GetNN
-    };
+        return p1->ftotal > p2->ftotal;
+    }
 
     enum IntervalType {
         OPEN = 0,
@@ -278,12 +149,13 @@ public:
         CLOSED
     };
 
-    RandomizedAStarPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv)
+    RandomizedAStarPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _nntree(0)
     {
         __description = ":Interface Author: Rosen Diankov\n\nRandomized A*. A continuous version of A*. See:\n\
 Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf. on Intelligent Robots and Systems, October 2007.\"\n";
         bUseGauss = false;
         nIndex = 0;
+        _nNumNodes = 0;
     }
 
     virtual ~RandomizedAStarPlanner() {
@@ -295,14 +167,12 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
 
     void Destroy()
     {
-        _spatialtree.Destroy();
-        _sortedtree.Reset();
-
-        //    for(size_t i = 0; i < _vdeadnodes.size(); ++i) {
-        //        _vdeadnodes[i]->~Node();
-        //        free(_vdeadnodes[i]);
-        //    }
-        _vdeadnodes.clear();
+        _nntree.Reset();
+        // keep the nodes in the pool so that their configurations do not have to be reallocated
+        _nNumNodes = 0;
+        _vopennodes.resize(0);
+        _vopennodes.reserve(1<<16);
+        _vdeadnodes.resize(0);
         _vdeadnodes.reserve(1<<16);
     }
 
@@ -327,7 +197,7 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
         _vSampleConfig.resize(GetDOF());
         _jointIncrement.resize(GetDOF());
         _vzero.resize(GetDOF(),0);
-        _spatialtree._pDistMetric = parameters->_distmetricfn;
+        _nntree.Init(shared_planner(), parameters->GetDOF(), parameters->_distmetricfn, parameters->_fStepLength, parameters->_distmetricfn(parameters->_vConfigLowerLimit, parameters->_vConfigUpperLimit));
 
         _jointResolutionInv.resize(0);
         FOREACH(itj, parameters->_vConfigResolution) {
@@ -368,15 +238,14 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
         int nMaxIter = _parameters->_nMaxIterations > 0 ? _parameters->_nMaxIterations : 8000;
 
         while(1) {
-            if( _sortedtree.blocks.size() == 0 ) {
+            if( _vopennodes.size() == 0 ) {
                 break;
             }
-            else {
-                pcurrent = _sortedtree.blocks.back();
-            }
 
             // delete from current lists
-            _sortedtree.blocks.pop_back();
+            std::pop_heap(_vopennodes.begin(), _vopennodes.end(), SortOpenNodes);
+            pcurrent = _vopennodes.back();
+            _vopennodes.pop_back();
             _vdeadnodes.push_back(pcurrent);
             BOOST_ASSERT( pcurrent->numchildren < _parameters->nMaxChildren );
 
@@ -412,20 +281,21 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
 
                 //while (getchar() != '\n') usleep(1000);
 
-                Node* nearestnode = _spatialtree.GetNN(_vSampleConfig);
-                if( _spatialtree._fBestDist > _parameters->fDistThresh ) {
+                std::pair<NodeBasePtr, dReal> nn = _nntree.FindNearestNode(_vSampleConfig);
+                if( nn.second > _parameters->fDistThresh ) {
+                    Node* nearestnode = &_nodepool.at(((SimpleNode*)nn.first)->_userdata);
                     dReal fdist = _parameters->_distmetricfn(pcurrent->q, _vSampleConfig);
                     CreateNode(nearestnode->fcost + fdist * _parameters->_costfn(_vSampleConfig), nearestnode, _vSampleConfig, true);
                     pcurrent->numchildren++;
 
-                    if( (_spatialtree._nodes.size() % 50) == 0 ) {
+                    if( (_nNumNodes % 50) == 0 ) {
                         //DumpNodes();
-                        RAVELOG_VERBOSE(str(boost::format("trees at %d(%d) : to goal at %f,%f\n")%_sortedtree.blocks.size()%_spatialtree._nodes.size()%((pcurrent->ftotal-pcurrent->fcost)/_parameters->fGoalCoeff)%pcurrent->fcost));
+                        RAVELOG_VERBOSE(str(boost::format("trees at %d(%d) : to goal at %f,%f\n")%_vopennodes.size()%_nNumNodes%((pcurrent->ftotal-pcurrent->fcost)/_parameters->fGoalCoeff)%pcurrent->fcost));
                     }
                 }
             }
 
-            if( (int)_spatialtree._nodes.size() > nMaxIter ) {
+            if( (int)_nNumNodes > nMaxIter ) {
                 break;
             }
         }
@@ -475,7 +345,7 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
     }
 
     int GetTotalNodes() {
-        return (int)_sortedtree.blocks.size();
+        return (int)_vopennodes.size();
     }
 
     bool bUseGauss;
@@ -484,19 +354,23 @@ private:
 
     Node* CreateNode(dReal fcost, Node* parent, const vector<dReal>& pfConfig, bool add = true)
     {
-        Node* p = new Node();
+        if( _nNumNodes >= _nodepool.size() ) {
+            _nodepool.push_back(Node());
+        }
+        Node* p = &_nodepool[_nNumNodes];
         p->parent = parent;
-        if( parent != NULL )
-            p->level = parent->level + 1;
-
-        p->q = pfConfig;
+        p->level = parent != NULL ? parent->level + 1 : 0;
+        p->numchildren = 0;
+        p->q = pfConfig; // reuses the memory of the previous plan
         p->fcost = fcost;
         p->ftotal = _parameters->fGoalCoeff*_parameters->_goalfn(pfConfig) + fcost;
 
         if( add ) {
-            _spatialtree.AddNode(p);
-            _sortedtree.Add(p);
+            _nntree.InsertNode(NULL, pfConfig, _nNumNodes);
+            _vopennodes.push_back(p);
+            std::push_heap(_vopennodes.begin(), _vopennodes.end(), SortOpenNodes);
         }
+        ++_nNumNodes;
         return p;
     }
 
@@ -567,7 +441,7 @@ private:
 
         vector<Node*>::iterator it;
 
-        vector<Node*>* allnodes[2] = { &_vdeadnodes, &_sortedtree.blocks };
+        vector<Node*>* allnodes[2] = { &_vdeadnodes, &_vopennodes };
 
         fprintf(f, "allnodes = [");
 
@@ -607,8 +481,10 @@ private:
     }
 
     boost::shared_ptr<RAStarParameters> _parameters;
-    SpatialTree _spatialtree;
-    BinarySearchTree<Node*, dReal> _sortedtree;       // sorted by decreasing value
+    SpatialTree<SimpleNode> _nntree; ///< cover tree of the configurations of all nodes, SimpleNode::_userdata is the index into _nodepool
+    std::deque<Node> _nodepool; ///< the nodes of the current plan are the first _nNumNodes, the rest are kept for later plans
+    size_t _nNumNodes;
+    vector<Node*> _vopennodes; ///< open set, heap ordered by SortOpenNodes
 
     RobotBasePtr _robot;
 
@@ -360,6 +360,7 @@ Some python code to display data::\n\
             RAVELOG_ERROR("BirrtPlanner::PlanPath - Error, planner not initialized\n");
             return PS_Failed;
         }
+        RAVE_TRACE_SCOPE("BirrtPlanner::PlanPath");
 
         EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
         uint32_t basetime = utils::GetMilliTime();
@@ -426,13 +427,18 @@ Some python code to display data::\n\
             }
 
             if( _sampleConfig.size() == 0 ) {
+                RAVE_TRACE_SCOPE("BirrtPlanner::Sample");
                 if( !_parameters->_samplefn(_sampleConfig) ) {
                     continue;
                 }
             }
 
             // extend A
-            ExtendType et = TreeA->Extend(_sampleConfig, iConnectedA);
+            ExtendType et;
+            {
+                RAVE_TRACE_SCOPE("BirrtPlanner::ExtendToSample");
+                et = TreeA->Extend(_sampleConfig, iConnectedA);
+            }
 
             // although check isn't necessary, having it improves running times
             if( et == ET_Failed ) {
@@ -444,12 +450,18 @@ Some python code to display data::\n\
                 continue;
             }
 
-            et = TreeB->Extend(TreeA->GetVectorConfig(iConnectedA), iConnectedB);     // extend B toward A
+            {
+                RAVE_TRACE_SCOPE("BirrtPlanner::ExtendToOtherTree");
+                et = TreeB->Extend(TreeA->GetVectorConfig(iConnectedA), iConnectedB);     // extend B toward A
+            }
 
             if( et == ET_Connected ) {
                 // connected, process goal
                 _vgoalpaths.push_back(GOALPATH());
-                _ExtractPath(_vgoalpaths.back(), TreeA == &_treeForward ? iConnectedA : iConnectedB, TreeA == &_treeBackward ? iConnectedA : iConnectedB);
+                {
+                    RAVE_TRACE_SCOPE("BirrtPlanner::ExtractPath");
+                    _ExtractPath(_vgoalpaths.back(), TreeA == &_treeForward ? iConnectedA : iConnectedB, TreeA == &_treeBackward ? iConnectedA : iConnectedB);
+                }
                 int goalindex = _vgoalpaths.back().goalindex;
                 int startindex = _vgoalpaths.back().startindex;
                 if( IS_DEBUGLEVEL(Level_Debug) ) {
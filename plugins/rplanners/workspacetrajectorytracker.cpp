@@ -14,6 +14,7 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "openraveplugindefs.h"
+#include <boost/thread/thread.hpp>
 
 class WorkspaceTrajectoryTracker : public PlannerBase
 {
@@ -37,13 +38,22 @@ Planner Parameters\n\
 \n\
 - **dReal minimumcompletetime** - specifies the minimum trajectory that must be followed for planner to declare success. If 0, then the entire trajectory has to be followed.\n\
 \n\
+- **int numthreads** - if > 0, all end effector poses are checked for collisions in batches by numthreads threads before tracking, the calling thread is one of them.\n\
+\n\
+- **bool predictiksolution** - if true, the ik of every pose is started from the jacobian prediction of the previous solution.\n\
+\n\
 - **TrajectoryBasePtr workspacetraj** - workspace trajectory of the end effector, needs to hold 'ikparam_values' groups\n\
 \n\
+The duration of each planning stage is passed to the plan callbacks in PlannerProgress::_stage and PlannerProgress::_stageduration.\n\
+\n\
 ";
         _report.reset(new CollisionReport());
         _filteroptions = 0;
     }
     virtual ~WorkspaceTrajectoryTracker() {
+        FOREACH(itenv, _vcloneenvs) {
+            (*itenv)->Destroy();
+        }
     }
 
     virtual bool InitPlan(RobotBasePtr probot, PlannerParametersConstPtr params)
@@ -139,6 +149,7 @@ Planner Parameters\n\
 
         EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
         uint32_t basetime = utils::GetMilliTime();
+        uint64_t stagestarttime = utils::GetMicroTime();
         RobotBase::RobotStateSaver savestate(_robot);
         _robot->SetActiveDOFs(_manip->GetArmIndices());     // should be set by user anyway, but this is an extra precaution
         CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
@@ -167,15 +178,25 @@ Planner Parameters\n\
 
         dReal fstarttime = 0, fendtime = workspacetraj->GetDuration();
         bool bPrevInCollision = true;
-        list<Transform> listtransforms;
+        vector<Transform> vtransforms;
         dReal ftime = 0;
         for(; ftime < workspacetraj->GetDuration()-_parameters->_fStepLength*0.5; ftime += _parameters->_fStepLength) {
             workspacetraj->Sample(vtrajpoint,ftime);
             workspacetraj->GetConfigurationSpecification().ExtractIkParameterization(ikparam,vtrajpoint.begin());
-            Transform t = ikparam.GetTransform6D();
+            vtransforms.push_back(ikparam.GetTransform6D());
+        }
+        vector<uint8_t> vcolliding;
+        if( _parameters->numthreads > 0 ) {
+            _CheckEndEffectorCollisions(vtransforms, vcolliding, _parameters->numthreads);
+        }
+
+        list<Transform> listtransforms;
+        ftime = 0;
+        for(size_t itrans = 0; itrans < vtransforms.size(); ftime += _parameters->_fStepLength, ++itrans) {
+            const Transform& t = vtransforms[itrans];
             listtransforms.push_back(t);
             // end effector is only fully known given the entire 6D transform!
-            if( _manip->CheckEndEffectorCollision(t,_report) ) {
+            if( vcolliding.size() > 0 ? vcolliding[itrans] != 0 : _manip->CheckEndEffectorCollision(t,_report) ) {
                 if(( ftime < _parameters->ignorefirstcollision) && bPrevInCollision ) {
                     continue;
                 }
@@ -206,6 +227,9 @@ Planner Parameters\n\
         }
 
         listtransforms.push_back(tlasttrans);
+        if( _ReportStage("endeffectorcollisions", stagestarttime) == PA_Interrupt ) {
+            return PS_Interrupted;
+        }
 
         _vchildlinks.resize(0);
         // disable all child links since we've already checked their collision
@@ -242,6 +266,11 @@ Planner Parameters\n\
         for(; ittrans != listtransforms.end(); ftime += _parameters->_fStepLength, ++ittrans) {
             _filteroptions = (ftime >= fstarttime) ? IKFO_CheckEnvCollisions : 0;
             IkParameterization ikparam(*ittrans,IKP_Transform6D);
+            if( _parameters->predictiksolution && _vprevsolution.size() > 0 ) {
+                // the ik solver prefers solutions close to the current configuration
+                _PredictSolution(*ittrans, _vpredictedsolution);
+                _robot->SetActiveDOFValues(_vpredictedsolution, KinBody::CLA_CheckLimitsSilent);
+            }
             if( !_manip->FindIKSolution(ikparam,vsolution,_filteroptions) ) {
                 if( _filteroptions == 0 ) {
                     // haven't even checked with environment collisions, so a solution really doesn't exist
@@ -278,10 +307,16 @@ Planner Parameters\n\
         if( bPrevInCollision ) {
             return PS_Failed;
         }
+        if( _ReportStage("ik", stagestarttime) == PA_Interrupt ) {
+            return PS_Interrupted;
+        }
 
         if( !_retimerplanner->InitPlan(RobotBasePtr(),_parameters) || !_retimerplanner->PlanPath(poutputtraj) ) {
             return PS_Failed;
         }
+        if( _ReportStage("retiming", stagestarttime) == PA_Interrupt ) {
+            return PS_Interrupted;
+        }
 
         RAVELOG_DEBUG(str(boost::format("workspace trajectory tracker plan success, path=%d points, traj time=%e computed in %fs\n")%poutputtraj->GetNumWaypoints()%poutputtraj->GetDuration()%((0.001f*(float)(utils::GetMilliTime()-basetime)))));
         return PS_HasSolution;
@@ -292,6 +327,160 @@ Planner Parameters\n\
     }
 
 protected:
+    class EndEffectorCollisionWork
+    {
+public:
+        EndEffectorCollisionWork() : nexttransform(0) {
+        }
+        std::vector<Transform> vtransforms;
+        std::vector<uint8_t> vcolliding;
+        size_t nexttransform; ///< first transform that was not handed to a thread yet
+        boost::mutex mutex;
+    };
+    typedef boost::shared_ptr<EndEffectorCollisionWork> EndEffectorCollisionWorkPtr;
+
+    /// \brief sets vcolliding[i] to 1 if the end effector collides at vtransforms[i]
+    ///
+    /// The transforms are handed out in batches to numthreads threads, the calling thread and numthreads-1 threads that
+    /// each work on their own clone of the environment. The clones are kept for the next calls.
+    void _CheckEndEffectorCollisions(const std::vector<Transform>& vtransforms, std::vector<uint8_t>& vcolliding, int numthreads)
+    {
+        EndEffectorCollisionWorkPtr work(new EndEffectorCollisionWork());
+        work->vtransforms = vtransforms;
+        work->vcolliding.resize(vtransforms.size(), 0);
+        int numbatches = (int)((vtransforms.size()+s_nEndEffectorBatchSize-1)/s_nEndEffectorBatchSize);
+        int numworkers = min(numthreads, numbatches)-1;
+        vector<boost::shared_ptr<boost::thread> > listthreads;
+        if( numworkers > 0 ) {
+            // only the differences to the environment are cloned into the environments of the previous calls
+            for(size_t i = numworkers; i < _vcloneenvs.size(); ++i) {
+                _vcloneenvs[i]->Destroy();
+            }
+            _vcloneenvs.resize(numworkers);
+            listthreads.resize(numworkers);
+            for(int i = 0; i < numworkers; ++i) {
+                if( !_vcloneenvs[i] ) {
+                    _vcloneenvs[i] = GetEnv()->CloneSelf(Clone_Bodies);
+                }
+                else {
+                    _vcloneenvs[i]->Clone(GetEnv(), Clone_Bodies);
+                }
+                listthreads[i].reset(new boost::thread(boost::bind(&WorkspaceTrajectoryTracker::_EndEffectorCollisionThread,this,work,_vcloneenvs[i])));
+            }
+        }
+        // also checks whatever a failed thread left over
+        _EndEffectorCollisionWorker(work, _manip);
+        FOREACH(itthread,listthreads) {
+            (*itthread)->join();
+        }
+        vcolliding.swap(work->vcolliding);
+    }
+
+    void _EndEffectorCollisionThread(EndEffectorCollisionWorkPtr work, EnvironmentBasePtr pcloneenv)
+    {
+        EnvironmentMutex::scoped_lock lock(pcloneenv->GetMutex());
+        RobotBasePtr probot = pcloneenv->GetRobot(_robot->GetName());
+        RobotBase::ManipulatorPtr pmanip;
+        if( !!probot ) {
+            pmanip = probot->GetManipulator(_manip->GetName());
+        }
+        if( !!pmanip ) {
+            _EndEffectorCollisionWorker(work, pmanip);
+        }
+        else {
+            RAVELOG_ERROR(str(boost::format("failed to find manipulator %s in the cloned environment\n")%_manip->GetName()));
+        }
+    }
+
+    /// \brief checks batches of transforms until all are done, the environment of pmanip should be locked
+    void _EndEffectorCollisionWorker(EndEffectorCollisionWorkPtr work, RobotBase::ManipulatorPtr pmanip)
+    {
+        while(1) {
+            size_t istart, iend;
+            {
+                boost::mutex::scoped_lock lock(work->mutex);
+                if( work->nexttransform >= work->vtransforms.size() ) {
+                    break;
+                }
+                istart = work->nexttransform;
+                iend = min(istart+s_nEndEffectorBatchSize, work->vtransforms.size());
+                work->nexttransform = iend;
+            }
+            for(size_t i = istart; i < iend; ++i) {
+                work->vcolliding[i] = pmanip->CheckEndEffectorCollision(work->vtransforms[i]);
+            }
+        }
+    }
+
+    /// \brief passes the duration of a finished stage to the plan callbacks and restarts the stage timer
+    PlannerAction _ReportStage(const std::string& stage, uint64_t& stagestarttime)
+    {
+        uint64_t curtime = utils::GetMicroTime();
+        PlannerProgress progress;
+        progress._stage = stage;
+        progress._stageduration = 1e-6*(curtime-stagestarttime);
+        stagestarttime = curtime;
+        RAVELOG_VERBOSE(str(boost::format("stage %s took %fs\n")%stage%progress._stageduration));
+        return _CallCallbacks(progress);
+    }
+
+    /// \brief moves the previous solution by a damped least-squares jacobian step towards the end effector transform t
+    ///
+    /// The robot has to be at the previous solution.
+    void _PredictSolution(const Transform& t, std::vector<dReal>& vpredicted)
+    {
+        int dof = (int)_vprevsolution.size();
+        Transform tcur = _manip->GetTransform();
+        Vector qdelta = quatMultiply(t.rot, quatInverse(tcur.rot));
+        if( qdelta.x < 0 ) {
+            qdelta = -qdelta;
+        }
+        Vector vangle = axisAngleFromQuat(qdelta), vtrans = t.trans - tcur.trans;
+        dReal error[6] = { vangle.x, vangle.y, vangle.z, vtrans.x, vtrans.y, vtrans.z };
+
+        // J is the angular velocity jacobian followed by the translation jacobian
+        _vjacobian.resize(6*dof);
+        _manip->CalculateAngularVelocityJacobian(_vtempjacobian);
+        std::copy(_vtempjacobian.begin(), _vtempjacobian.end(), _vjacobian.begin());
+        _manip->CalculateJacobian(_vtempjacobian);
+        std::copy(_vtempjacobian.begin(), _vtempjacobian.end(), _vjacobian.begin()+3*dof);
+
+        // solve (J*J^T + lambda^2*I) y = error with cholesky, the step is J^T y
+        const dReal flambda2 = 1e-4;
+        dReal L[6][6];
+        for(int i = 0; i < 6; ++i) {
+            for(int j = 0; j <= i; ++j) {
+                dReal sum = i == j ? flambda2 : 0;
+                for(int k = 0; k < dof; ++k) {
+                    sum += _vjacobian[i*dof+k]*_vjacobian[j*dof+k];
+                }
+                for(int k = 0; k < j; ++k) {
+                    sum -= L[i][k]*L[j][k];
+                }
+                L[i][j] = i == j ? RaveSqrt(sum) : sum/L[j][j];
+            }
+        }
+        for(int i = 0; i < 6; ++i) {
+            for(int k = 0; k < i; ++k) {
+                error[i] -= L[i][k]*error[k];
+            }
+            error[i] /= L[i][i];
+        }
+        for(int i = 5; i >= 0; --i) {
+            for(int k = i+1; k < 6; ++k) {
+                error[i] -= L[k][i]*error[k];
+            }
+            error[i] /= L[i][i];
+        }
+
+        vpredicted = _vprevsolution;
+        for(int k = 0; k < dof; ++k) {
+            for(int i = 0; i < 6; ++i) {
+                vpredicted[k] += _vjacobian[i*dof+k]*error[i];
+            }
+        }
+    }
+
     void _SetPreviousSolution(const std::vector<dReal>& vsolution, bool bsetjacobian=true)
     {
         if( bsetjacobian ) {
@@ -429,6 +618,12 @@ protected:
     IkParameterization _ikprev;
     vector<dReal> _vprevsolution;
     PlannerBasePtr _retimerplanner;
+
+    // cache
+    vector<dReal> _vpredictedsolution, _vjacobian, _vtempjacobian;
+    vector<EnvironmentBasePtr> _vcloneenvs; ///< environments of the end effector collision threads
+
+    static const size_t s_nEndEffectorBatchSize = 16; ///< number of transforms a thread checks before getting the next ones
 };
 
 PlannerBasePtr CreateWorkspaceTrajectoryTracker(EnvironmentBasePtr penv, std::istream& sinput) {
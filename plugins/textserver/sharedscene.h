@@ -0,0 +1,122 @@
+/* -*- coding: utf-8 -*-
+   Copyright (C) 2026 The OpenRAVE Contributors
+
+   This file is part of OpenRAVE.
+   OpenRAVE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/** \file sharedscene.h
+    \brief Layout of the POSIX shared-memory segment written by the SharedSceneServer module and the C functions to read it.
+
+    The segment holds a header and two buffers. The server always writes the buffer that is not the latest one, and
+    every buffer has a sequence counter that is odd while it is written. Readers access the latest buffer in place and
+    only have to retry if the server wrapped around to the same buffer while they were reading:
+
+    \code
+    orss_reader reader;
+    if( orss_open(&reader, "/openrave_scene") == 0 ) {
+        uint64_t token;
+        const orss_frame* frame = orss_read_begin(&reader, &token);
+        // ... read frame, orss_get_body, orss_get_links, orss_get_dofvalues
+        if( !orss_read_end(&reader, token) ) {
+            // data changed while reading, read again
+        }
+        orss_close(&reader);
+    }
+    \endcode
+ */
+#ifndef OPENRAVE_SHAREDSCENE_H
+#define OPENRAVE_SHAREDSCENE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORSS_MAGIC 0x5353524f /* "ORSS" */
+#define ORSS_VERSION 1
+#define ORSS_NAMELENGTH 64
+
+/** \brief start of the segment */
+typedef struct
+{
+    uint32_t magic; /* ORSS_MAGIC */
+    uint32_t version; /* ORSS_VERSION */
+    uint64_t segmentsize; /* total bytes of the segment */
+    uint64_t bufferoffset[2]; /* byte offsets of the two buffers from the start of the segment */
+    uint64_t buffersize; /* bytes of each buffer */
+    volatile uint64_t latest; /* index of the buffer that was written last */
+    volatile uint64_t sequence[2]; /* sequence counter of each buffer, odd while the buffer is written */
+} orss_header;
+
+/** \brief start of every buffer, followed by numbodies orss_body */
+typedef struct
+{
+    uint64_t publishindex; /* incremented every time a new scene state is written */
+    uint64_t simulationtime; /* simulation time of the environment in microseconds */
+    uint32_t numbodies;
+    uint32_t reserved;
+} orss_frame;
+
+typedef struct
+{
+    int32_t environmentid;
+    int32_t updatestamp; /* changes every time the body is modified */
+    uint32_t numlinks;
+    uint32_t numdof;
+    uint64_t linkoffset; /* byte offset from the frame to 7*numlinks doubles: quaternion (cos component first) and translation of every link */
+    uint64_t dofoffset; /* byte offset from the frame to numdof doubles */
+    char name[ORSS_NAMELENGTH]; /* null terminated, truncated if longer */
+} orss_body;
+
+typedef struct
+{
+    int fd;
+    void* pdata;
+    size_t size;
+    const orss_header* header;
+} orss_reader;
+
+/** \brief maps the segment for reading, returns 0 on success */
+int orss_open(orss_reader* reader, const char* name);
+
+void orss_close(orss_reader* reader);
+
+/** \brief returns the latest frame without copying it, token has to be passed to orss_read_end once done reading. */
+const orss_frame* orss_read_begin(const orss_reader* reader, uint64_t* token);
+
+/** \brief returns 1 if the frame returned by orss_read_begin was not modified while it was read, otherwise 0. */
+int orss_read_end(const orss_reader* reader, uint64_t token);
+
+static inline const orss_body* orss_get_body(const orss_frame* frame, uint32_t index)
+{
+    return (const orss_body*)(frame+1) + index;
+}
+
+static inline const double* orss_get_links(const orss_frame* frame, const orss_body* body)
+{
+    return (const double*)((const char*)frame + body->linkoffset);
+}
+
+static inline const double* orss_get_dofvalues(const orss_frame* frame, const orss_body* body)
+{
+    return (const double*)((const char*)frame + body->dofoffset);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+/* -*- coding: utf-8 -*-
+   Copyright (C) 2026 The OpenRAVE Contributors
+
+   This file is part of OpenRAVE.
+   OpenRAVE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "sharedscene.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int orss_open(orss_reader* reader, const char* name)
+{
+    struct stat st;
+    reader->fd = -1;
+    reader->pdata = NULL;
+    reader->size = 0;
+    reader->header = NULL;
+
+    reader->fd = shm_open(name, O_RDONLY, 0);
+    if( reader->fd < 0 ) {
+        return -1;
+    }
+    if( fstat(reader->fd, &st) != 0 || (size_t)st.st_size < sizeof(orss_header) ) {
+        orss_close(reader);
+        return -2;
+    }
+    reader->pdata = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if( reader->pdata == MAP_FAILED ) {
+        reader->pdata = NULL;
+        orss_close(reader);
+        return -3;
+    }
+    reader->size = st.st_size;
+    reader->header = (const orss_header*)reader->pdata;
+    if( reader->header->magic != ORSS_MAGIC || reader->header->version != ORSS_VERSION || reader->header->segmentsize > reader->size ) {
+        orss_close(reader);
+        return -4;
+    }
+    return 0;
+}
+
+void orss_close(orss_reader* reader)
+{
+    if( reader->pdata != NULL ) {
+        munmap(reader->pdata, reader->size);
+        reader->pdata = NULL;
+    }
+    if( reader->fd >= 0 ) {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+    reader->size = 0;
+    reader->header = NULL;
+}
+
+const orss_frame* orss_read_begin(const orss_reader* reader, uint64_t* token)
+{
+    const orss_header* header = reader->header;
+    uint64_t index, sequence;
+    for(;; ) {
+        index = header->latest & 1;
+        sequence = header->sequence[index];
+        __sync_synchronize();
+        if( (sequence & 1) == 0 ) {
+            break;
+        }
+        /* the server wrapped around and is writing this buffer again, the other one is complete by now */
+    }
+    /* sequence is even, so the buffer index fits in the lowest bit */
+    *token = sequence | index;
+    return (const orss_frame*)((const char*)reader->pdata + header->bufferoffset[index]);
+}
+
+int orss_read_end(const orss_reader* reader, uint64_t token)
+{
+    __sync_synchronize();
+    return reader->header->sequence[token & 1] == (token & ~(uint64_t)1);
+}
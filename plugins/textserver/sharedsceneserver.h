@@ -0,0 +1,265 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 The OpenRAVE Contributors
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_SHAREDSCENESERVER
+#define OPENRAVE_SHAREDSCENESERVER
+
+#include "sharedscene.h"
+#include <openrave/utils.h>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// \brief publishes the published bodies of the environment into a POSIX shared-memory segment, see sharedscene.h for the layout
+class SharedSceneServer : public ModuleBase
+{
+public:
+    SharedSceneServer(EnvironmentBasePtr penv) : ModuleBase(penv), _fd(-1), _pdata(NULL), _size(0), _fPeriod(0.002), _bStop(false), _publishindex(0)
+    {
+        __description = ":Interface Author: The OpenRAVE Contributors\n\n\
+Publishes the link transforms, DOF values and update stamps of all published bodies into a POSIX shared-memory segment so that processes on the same host can read the scene without copies or locks. The segment layout and a C reader are in sharedscene.h.\n\n\
+Started with \"name /openrave_scene size 4194304 period 0.002\", where size is the bytes of the segment and period the seconds between checks for new states.";
+        RegisterCommand("GetPublishIndex",boost::bind(&SharedSceneServer::_GetPublishIndexCommand,this,_1,_2),
+                        "Returns the number of scene states written so far.");
+        _name = "/openrave_scene";
+    }
+
+    virtual ~SharedSceneServer() {
+        Destroy();
+    }
+
+    virtual int main(const std::string& cmd)
+    {
+        Destroy();
+        size_t size = 4*1024*1024;
+        string command;
+        stringstream ss(cmd);
+        while(!ss.eof()) {
+            ss >> command;
+            if( !ss ) {
+                break;
+            }
+            std::transform(command.begin(), command.end(), command.begin(), ::tolower);
+            if( command == "name" ) {
+                ss >> _name;
+            }
+            else if( command == "size" ) {
+                ss >> size;
+            }
+            else if( command == "period" ) {
+                ss >> _fPeriod;
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%command));
+                break;
+            }
+            if( !ss ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%command));
+                return -1;
+            }
+        }
+
+        if( !_Open(size) ) {
+            return -1;
+        }
+        _bStop = false;
+        _thread.reset(new boost::thread(boost::bind(&SharedSceneServer::_PublishThread,this)));
+        return 0;
+    }
+
+    virtual void Destroy()
+    {
+        _bStop = true;
+        if( !!_thread ) {
+            _thread->join();
+            _thread.reset();
+        }
+        _Close();
+        ModuleBase::Destroy();
+    }
+
+protected:
+    bool _GetPublishIndexCommand(ostream& sout, istream& sinput)
+    {
+        sout << (uint64_t)_publishindex;
+        return true;
+    }
+
+    bool _Open(size_t size)
+    {
+        // the header and both buffers start on cache lines
+        size_t headersize = (sizeof(orss_header)+63)&~(size_t)63;
+        size_t buffersize = size > headersize ? ((size-headersize)/2)&~(size_t)63 : 0;
+        if( buffersize < sizeof(orss_frame) ) {
+            RAVELOG_ERROR(str(boost::format("shared memory size %d is too small\n")%size));
+            return false;
+        }
+        _fd = shm_open(_name.c_str(), O_CREAT|O_RDWR, 0644);
+        if( _fd < 0 ) {
+            RAVELOG_ERROR(str(boost::format("failed to open shared memory %s\n")%_name));
+            return false;
+        }
+        _size = headersize + 2*buffersize;
+        if( ftruncate(_fd, _size) != 0 ) {
+            RAVELOG_ERROR(str(boost::format("failed to resize shared memory %s to %d bytes\n")%_name%_size));
+            _Close();
+            return false;
+        }
+        _pdata = mmap(NULL, _size, PROT_READ|PROT_WRITE, MAP_SHARED, _fd, 0);
+        if( _pdata == MAP_FAILED ) {
+            _pdata = NULL;
+            RAVELOG_ERROR(str(boost::format("failed to map shared memory %s\n")%_name));
+            _Close();
+            return false;
+        }
+
+        orss_header* header = (orss_header*)_pdata;
+        memset(_pdata, 0, headersize + 2*sizeof(orss_frame));
+        header->segmentsize = _size;
+        header->bufferoffset[0] = headersize;
+        header->bufferoffset[1] = headersize + buffersize;
+        header->buffersize = buffersize;
+        memset((char*)_pdata + header->bufferoffset[1], 0, sizeof(orss_frame));
+        __sync_synchronize();
+        // readers check the magic number last, so set it once everything else is valid
+        header->version = ORSS_VERSION;
+        header->magic = ORSS_MAGIC;
+        _vstamps.resize(0);
+        _publishindex = 0;
+        RAVELOG_DEBUG(str(boost::format("publishing scene to shared memory %s, %d bytes\n")%_name%_size));
+        return true;
+    }
+
+    void _Close()
+    {
+        if( !!_pdata ) {
+            munmap(_pdata, _size);
+            _pdata = NULL;
+        }
+        if( _fd >= 0 ) {
+            close(_fd);
+            shm_unlink(_name.c_str());
+            _fd = -1;
+        }
+        _size = 0;
+    }
+
+    void _PublishThread()
+    {
+        std::vector<KinBody::BodyState> vbodies;
+        while(!_bStop) {
+            uint64_t starttime = utils::GetMicroTime();
+            try {
+                GetEnv()->GetPublishedBodies(vbodies, 100000);
+                _Publish(vbodies);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_VERBOSE(str(boost::format("failed to publish scene: %s\n")%ex.what()));
+            }
+            uint64_t elapsed = utils::GetMicroTime() - starttime;
+            uint64_t period = (uint64_t)(_fPeriod*1000000);
+            if( elapsed < period ) {
+                usleep(period - elapsed);
+            }
+        }
+    }
+
+    /// \brief writes vbodies into the buffer that is not the latest if any body changed since the last call
+    void _Publish(const std::vector<KinBody::BodyState>& vbodies)
+    {
+        // every body state change increments its update stamp
+        bool bChanged = _vstamps.size() != 2*vbodies.size();
+        size_t numvalues = 0;
+        _vstamps.resize(2*vbodies.size());
+        for(size_t i = 0; i < vbodies.size(); ++i) {
+            if( _vstamps[2*i] != vbodies[i].environmentid || _vstamps[2*i+1] != vbodies[i].updatestamp ) {
+                _vstamps[2*i] = vbodies[i].environmentid;
+                _vstamps[2*i+1] = vbodies[i].updatestamp;
+                bChanged = true;
+            }
+            numvalues += 7*vbodies[i].vectrans.size() + vbodies[i].jointvalues.size();
+        }
+        if( !bChanged ) {
+            return;
+        }
+
+        orss_header* header = (orss_header*)_pdata;
+        size_t requiredsize = sizeof(orss_frame) + vbodies.size()*sizeof(orss_body) + numvalues*sizeof(double);
+        if( requiredsize > header->buffersize ) {
+            RAVELOG_WARN(str(boost::format("scene needs %d bytes, but shared memory buffers only have %d\n")%requiredsize%header->buffersize));
+            _vstamps.resize(0);
+            return;
+        }
+
+        uint64_t index = 1-(header->latest&1);
+        header->sequence[index]++;
+        __sync_synchronize();
+
+        char* pframe = (char*)_pdata + header->bufferoffset[index];
+        orss_frame* frame = (orss_frame*)pframe;
+        frame->publishindex = ++_publishindex;
+        frame->simulationtime = GetEnv()->GetSimulationTime();
+        frame->numbodies = vbodies.size();
+        frame->reserved = 0;
+        size_t offset = sizeof(orss_frame) + vbodies.size()*sizeof(orss_body);
+        for(size_t i = 0; i < vbodies.size(); ++i) {
+            const KinBody::BodyState& state = vbodies[i];
+            orss_body* body = (orss_body*)(frame+1) + i;
+            body->environmentid = state.environmentid;
+            body->updatestamp = state.updatestamp;
+            body->numlinks = state.vectrans.size();
+            body->numdof = state.jointvalues.size();
+            strncpy(body->name, state.strname.c_str(), ORSS_NAMELENGTH-1);
+            body->name[ORSS_NAMELENGTH-1] = 0;
+            body->linkoffset = offset;
+            double* pvalues = (double*)(pframe + offset);
+            FOREACHC(ittrans, state.vectrans) {
+                *pvalues++ = ittrans->rot.x; *pvalues++ = ittrans->rot.y; *pvalues++ = ittrans->rot.z; *pvalues++ = ittrans->rot.w;
+                *pvalues++ = ittrans->trans.x; *pvalues++ = ittrans->trans.y; *pvalues++ = ittrans->trans.z;
+            }
+            offset += 7*state.vectrans.size()*sizeof(double);
+            body->dofoffset = offset;
+            std::copy(state.jointvalues.begin(), state.jointvalues.end(), pvalues);
+            offset += state.jointvalues.size()*sizeof(double);
+        }
+
+        __sync_synchronize();
+        header->sequence[index]++;
+        __sync_synchronize();
+        header->latest = index;
+    }
+
+    string _name;
+    int _fd;
+    void* _pdata;
+    size_t _size;
+    dReal _fPeriod;
+    // set by Destroy and read by _PublishThread, _publishindex is also read by GetPublishIndex
+#if BOOST_VERSION >= 105300
+    boost::atomic<bool> _bStop;
+    boost::atomic<uint64_t> _publishindex;
+#else
+    volatile bool _bStop;
+    volatile uint64_t _publishindex;
+#endif
+    std::vector<int> _vstamps; ///< environment id and update stamp of every body last written
+    boost::shared_ptr<boost::thread> _thread;
+};
+
+#endif
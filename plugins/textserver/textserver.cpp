@@ -15,6 +15,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "plugindefs.h"
 #include "textserver.h"
+#ifndef _WIN32
+#include "sharedsceneserver.h"
+#endif
 #include <openrave/plugin.h>
 
 InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string& interfacename, std::istream& sinput, EnvironmentBasePtr penv)
@@ -23,6 +26,10 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
     case OpenRAVE::PT_Module:
         if( interfacename == "textserver")
             return InterfaceBasePtr(new SimpleTextServer(penv));
+#ifndef _WIN32
+        else if( interfacename == "sharedsceneserver" )
+            return InterfaceBasePtr(new SharedSceneServer(penv));
+#endif
         break;
     default:
         break;
@@ -33,6 +40,9 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
 void GetPluginAttributesValidated(PLUGININFO& info)
 {
     info.interfacenames[OpenRAVE::PT_Module].push_back("textserver");
+#ifndef _WIN32
+    info.interfacenames[OpenRAVE::PT_Module].push_back("SharedSceneServer");
+#endif
 }
 
 OPENRAVE_PLUGIN_API void DestroyPlugin()
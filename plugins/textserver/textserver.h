@@ -55,6 +55,7 @@ public:
 
         Socket() {
             bInit = false;
+            bBinary = false;
             client_sockfd = 0;
         }
         ~Socket() {
@@ -101,6 +102,27 @@ public:
             return bInit;
         }
 
+        /// returns true if requests are read with ReadFrame instead of ReadLine
+        bool IsBinary() {
+            return bBinary;
+        }
+        void SetBinary(bool binary) {
+            bBinary = binary;
+        }
+
+        /// \brief sends an error reply
+        ///
+        /// In text mode this is the string "error\n" truncated to textsize, in binary mode it is a reply with size -1 and no data.
+        void SendError(int textsize)
+        {
+            if( bBinary ) {
+                SendData(NULL, -1);
+            }
+            else {
+                SendData("error\n", textsize);
+            }
+        }
+
         void SendData(const void* pdata, int size_to_write)
         {
             if( client_sockfd == 0 )
@@ -234,12 +256,88 @@ public:
             return true;
         }
 
+        /// \brief reads one binary request
+        ///
+        /// protocol: int32 size followed by size bytes, the bytes are returned in data
+        bool ReadFrame(std::vector<char>& data)
+        {
+            data.resize(0);
+            if( !_IsReadable() ) {
+                return false;
+            }
+            int32_t size = 0;
+            if( !_ReadAll((char*)&size, sizeof(size)) ) {
+                return false;
+            }
+            if( size < 0 || size > s_nMaxFrameSize ) {
+                RAVELOG_ERROR("invalid frame size %d, closing connection\n", size);
+                Close();
+                return false;
+            }
+            data.resize(size);
+            return size == 0 || _ReadAll(&data[0], size);
+        }
+
+        /// 16MB, enough for setting the joints of thousands of bodies in one bodies_setjoints request
+        static const int32_t s_nMaxFrameSize = 0x1000000;
+
 private:
+        /// \brief returns true if there is data to be read without blocking
+        bool _IsReadable()
+        {
+            struct timeval tv;
+            fd_set readfds, exfds;
+            tv.tv_sec = 0;
+            tv.tv_usec = 0;
+
+            FD_ZERO(&exfds);
+            FD_SET(client_sockfd, &exfds);
+            int num = select(client_sockfd+1, NULL, NULL, &exfds, &tv);
+            if (( num > 0) && FD_ISSET(client_sockfd, &exfds) ) {
+                RAVELOG_ERROR("socket exception detected\n");
+                Close();
+                return false;
+            }
+
+            FD_ZERO(&readfds);
+            FD_SET(client_sockfd, &readfds);
+            num = select(client_sockfd+1, &readfds, NULL, NULL, &tv);
+            return num > 0 && FD_ISSET(client_sockfd, &readfds);
+        }
+
+        /// \brief blocks until size bytes are read
+        bool _ReadAll(char* pbuf, int size)
+        {
+            int failed = 0;
+            while(size > 0) {
+                long nBytesReceived = recv(client_sockfd, pbuf, size, 0);
+                if( nBytesReceived > 0 ) {
+                    size -= nBytesReceived;
+                    pbuf += nBytesReceived;
+                }
+                else if( nBytesReceived == 0 ) {
+                    return false;
+                }
+                else {
+                    if( failed < 10 ) {
+                        failed++;
+                        usleep(1000);
+                        continue;
+                    }
+                    perror("failed to read frame");
+                    Close();
+                    return false;
+                }
+            }
+            return true;
+        }
+
         int client_sockfd;
         int client_len;
 
         struct sockaddr_in client_address;
         bool bInit;
+        bool bBinary; ///< if true, requests are binary frames
     };
     typedef boost::shared_ptr<Socket> SocketPtr;
     typedef boost::shared_ptr<Socket const> SocketConstPtr;
@@ -270,7 +368,8 @@ public:
         _nNextFigureId = 1;
         _bWorking = false;
         bDestroying = false;
-        __description=":Interface Author: Rosen Diankov\n\nSimple text-based server using sockets.";
+        __description=":Interface Author: Rosen Diankov\n\nSimple text-based server using sockets.\n\n\
+Every reply is an int32 size followed by the data. Sending \"setprotocol binary\" switches the connection to binary requests: an int32 size followed by the command name, a 0 byte and the raw arguments. Binary errors are replies of size -1 and every binary command sends a reply. In binary mode the batched commands bodies_getjoints, bodies_setjoints, bodies_settransforms and bodies_getlinks take native-endian int32 and float64 arrays, all text commands stay available.";
         mapNetworkFns["body_checkcollision"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvCheckCollision, this, _1, _2, _3), OpenRaveWorkerFn(), true);
         mapNetworkFns["body_getjoints"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBodyGetJointValues, this,_1, _2, _3), OpenRaveWorkerFn(), true);
         mapNetworkFns["body_destroy"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBodyDestroy,this,_1,_2,_3), OpenRaveWorkerFn(), false);
@@ -317,6 +416,11 @@ public:
         mapNetworkFns["test"] = RAVENETWORKFN(OpenRaveNetworkFn(), OpenRaveWorkerFn(), false);
         mapNetworkFns["wait"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvWait,this,_1,_2,_3), OpenRaveWorkerFn(), true);
 
+        mapBinaryNetworkFns["bodies_getjoints"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBinaryBodiesGetJointValues,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+        mapBinaryNetworkFns["bodies_getlinks"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBinaryBodiesGetLinks,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+        mapBinaryNetworkFns["bodies_setjoints"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBinaryBodiesSetJointValues,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+        mapBinaryNetworkFns["bodies_settransforms"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBinaryBodiesSetTransforms,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+
         string logfilename = RaveGetHomeDirectory() + string("/textserver.log");
         flog.open(logfilename.c_str());
         if( !!flog )
@@ -553,40 +657,95 @@ private:
         RAVELOG_DEBUG("**Server thread exiting\n");
     }
 
+    /// \brief reads the next command from the socket
+    ///
+    /// In text mode a command is one line. In binary mode it is one frame holding the command name terminated by 0
+    /// followed by the raw arguments.
+    bool _ReadCommand(SocketPtr psocket, vector<char>& vframe, string& cmd, boost::shared_ptr<istream>& is)
+    {
+        if( psocket->IsBinary() ) {
+            if( !psocket->ReadFrame(vframe) || vframe.size() == 0 ) {
+                return false;
+            }
+            vector<char>::iterator itname = std::find(vframe.begin(), vframe.end(), 0);
+            cmd.assign(vframe.begin(), itname);
+            if( itname != vframe.end() ) {
+                ++itname;
+            }
+            is.reset(new stringstream(string(itname, vframe.end())));
+            if( !!flog &&( GetEnv()->GetDebugLevel()>0) ) {
+                static int index=0;
+                flog << index++ << ": " << cmd << " (" << vframe.size() << " bytes)" << endl;
+            }
+        }
+        else {
+            string line;
+            if( !psocket->ReadLine(line) || line.length() == 0 ) {
+                return false;
+            }
+            if( !!flog &&( GetEnv()->GetDebugLevel()>0) ) {
+                static int index=0;
+                flog << index++ << ": " << line << endl;
+            }
+            is.reset(new stringstream(line));
+            *is >> cmd;
+            if( !*is ) {
+                cmd.resize(0);
+            }
+        }
+        std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+        return true;
+    }
+
     void _read_threadcb(SocketPtr psocket)
     {
         RAVELOG_VERBOSE("started new server connection\n");
-        string cmd, line;
+        string cmd;
+        vector<char> vframe;
         stringstream sout;
         while(!bCloseThread) {
-            if( psocket->ReadLine(line) && line.length() ) {
-
-                if( !!flog &&( GetEnv()->GetDebugLevel()>0) ) {
-                    static int index=0;
-                    flog << index++ << ": " << line << endl;
-                }
-
-                boost::shared_ptr<istream> is(new stringstream(line));
-                *is >> cmd;
-                if( !*is ) {
+            boost::shared_ptr<istream> is;
+            if( _ReadCommand(psocket, vframe, cmd, is) ) {
+                if( cmd.size() == 0 ) {
                     RAVELOG_ERROR("Failed to get command\n");
-                    psocket->SendData("error\n",1);
+                    psocket->SendError(1);
+                    continue;
+                }
+                if( cmd == "setprotocol" ) {
+                    // switching is acknowledged with the protocol name, all requests after it use the new protocol
+                    string protocol;
+                    *is >> protocol;
+                    std::transform(protocol.begin(), protocol.end(), protocol.begin(), ::tolower);
+                    if( protocol == "binary" || protocol == "text" ) {
+                        psocket->SendData(protocol.c_str(), protocol.size());
+                        psocket->SetBinary(protocol == "binary");
+                    }
+                    else {
+                        RAVELOG_ERROR("unknown protocol: %s\n", protocol.c_str());
+                        psocket->SendError(6);
+                    }
                     continue;
                 }
-                std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
                 stringstream::streampos inputpos = is->tellg();
 
-                map<string, RAVENETWORKFN>::iterator itfn = mapNetworkFns.find(cmd);
-                if( itfn != mapNetworkFns.end() ) {
+                RAVENETWORKFN* pfn = NULL;
+                map<string, RAVENETWORKFN>::iterator itfn;
+                if( psocket->IsBinary() && (itfn = mapBinaryNetworkFns.find(cmd)) != mapBinaryNetworkFns.end() ) {
+                    pfn = &itfn->second;
+                }
+                else if( (itfn = mapNetworkFns.find(cmd)) != mapNetworkFns.end() ) {
+                    pfn = &itfn->second;
+                }
+                if( !!pfn ) {
                     bool bCallWorker = true;
                     boost::shared_ptr<void> pdata;
 
                     // need to set w.args before pcmdend is modified
                     sout.str(""); sout.clear();
-                    if( !!itfn->second.fnSocketThread ) {
+                    if( !!pfn->fnSocketThread ) {
                         bool bSuccess = false;
                         try {
-                            bSuccess = itfn->second.fnSocketThread(*is, sout, pdata);
+                            bSuccess = pfn->fnSocketThread(*is, sout, pdata);
                         }
                         catch(const std::exception& ex) {
                             RAVELOG_FATAL("server caught exception: %s\n",ex.what());
@@ -596,10 +755,10 @@ private:
                         }
 
                         if( bSuccess ) {
-                            if( itfn->second.bReturnResult ) {
+                            if( pfn->bReturnResult ) {
                                 psocket->SendData(sout.str().c_str(), sout.str().size());
                             }
-                            if( !itfn->second.fnWorker ) {
+                            if( !pfn->fnWorker ) {
                                 bCallWorker = false;
                             }
                         }
@@ -608,29 +767,31 @@ private:
                             if( !!flog  ) {
                                 flog << " error" << endl;
                             }
-                            if( itfn->second.bReturnResult ) {
-                                psocket->SendData("error\n", 6);
+                            if( pfn->bReturnResult ) {
+                                psocket->SendError(6);
                             }
                         }
                     }
                     else {
-                        if( itfn->second.bReturnResult ) {
+                        if( pfn->bReturnResult ) {
                             psocket->SendData(sout.str().c_str(), sout.str().size());     // return dummy
                         }
-                        bCallWorker = !!itfn->second.fnWorker;
+                        bCallWorker = !!pfn->fnWorker;
                     }
 
                     if( bCallWorker ) {
-                        BOOST_ASSERT(!!itfn->second.fnWorker);
+                        BOOST_ASSERT(!!pfn->fnWorker);
                         is->clear();
                         is->seekg(inputpos);
-                        ScheduleWorker(boost::bind(itfn->second.fnWorker,is,pdata));
+                        ScheduleWorker(boost::bind(pfn->fnWorker,is,pdata));
                     }
                 }
                 else {
                     RAVELOG_ERROR("Failed to recognize command: %s\n", cmd.c_str());
-                    psocket->SendData("error\n",1);
+                    psocket->SendError(1);
                 }
+                // check for the next request right away so that streamed requests are not throttled
+                continue;
             }
             else if( !psocket->IsInit() ) {
                 break;
@@ -661,6 +822,7 @@ private:
 
     list<boost::function<void()> > listWorkers;
     map<string, RAVENETWORKFN> mapNetworkFns;
+    map<string, RAVENETWORKFN> mapBinaryNetworkFns; ///< commands only available in binary mode, looked up before mapNetworkFns
 
     int _nIdIndex;
     map<int, ModuleBasePtr > _mapModules;
@@ -1837,6 +1999,232 @@ protected:
         return true;
     }
 
+    /// \name Binary commands
+    ///
+    /// Only available after "setprotocol binary". Integers are int32 and all real values are float64, both in native
+    /// byte order. Transforms are 7 values: the quaternion (cos component first) followed by the translation.
+    //@{
+
+    template <typename T>
+    static bool _ReadBinary(istream& is, T& value)
+    {
+        is.read((char*)&value, sizeof(T));
+        return !!is;
+    }
+
+    static bool _ReadBinaryArray(istream& is, vector<dReal>& values, int num)
+    {
+        values.resize(num);
+        if( num == 0 ) {
+            return true;
+        }
+        if( sizeof(dReal) == sizeof(double) ) {
+            is.read((char*)&values[0], num*sizeof(double));
+        }
+        else {
+            vector<double> vdoubles(num);
+            is.read((char*)&vdoubles[0], num*sizeof(double));
+            std::copy(vdoubles.begin(), vdoubles.end(), values.begin());
+        }
+        return !!is;
+    }
+
+    template <typename T>
+    static void _WriteBinary(ostream& os, const T& value)
+    {
+        os.write((const char*)&value, sizeof(T));
+    }
+
+    static void _WriteBinaryArray(ostream& os, const vector<dReal>& values)
+    {
+        if( values.size() == 0 ) {
+            return;
+        }
+        if( sizeof(dReal) == sizeof(double) ) {
+            os.write((const char*)&values[0], values.size()*sizeof(double));
+        }
+        else {
+            vector<double> vdoubles(values.begin(), values.end());
+            os.write((const char*)&vdoubles[0], vdoubles.size()*sizeof(double));
+        }
+    }
+
+    static void _WriteBinaryTransform(ostream& os, const Transform& t)
+    {
+        double values[7] = { t.rot.x, t.rot.y, t.rot.z, t.rot.w, t.trans.x, t.trans.y, t.trans.z };
+        os.write((const char*)values, sizeof(values));
+    }
+
+    /// \brief returns the number of bytes left to read in the frame
+    static size_t _GetBinaryRemainingSize(istream& is)
+    {
+        std::streampos pos = is.tellg();
+        if( pos < 0 ) {
+            return 0;
+        }
+        is.seekg(0, ios::end);
+        std::streampos end = is.tellg();
+        is.seekg(pos);
+        return end > pos ? (size_t)(end - pos) : 0;
+    }
+
+    /// \brief reads int32 num followed by num int32 body ids, num=0 returns all bodies
+    ///
+    /// num comes from the client, so it is checked against the ids left in the frame before allocating anything
+    bool _ReadBinaryBodies(istream& is, vector<KinBodyPtr>& vbodies)
+    {
+        int32_t numbodies = 0;
+        if( !_ReadBinary(is, numbodies) || numbodies < 0 ) {
+            return false;
+        }
+        if( numbodies == 0 ) {
+            GetEnv()->GetBodies(vbodies);
+            return true;
+        }
+        if( (size_t)numbodies > _GetBinaryRemainingSize(is)/sizeof(int32_t) ) {
+            RAVELOG_WARN(str(boost::format("frame too short for %d body ids")%numbodies));
+            return false;
+        }
+        vbodies.resize(numbodies);
+        for(int32_t i = 0; i < numbodies; ++i) {
+            int32_t id = 0;
+            if( !_ReadBinary(is, id) ) {
+                return false;
+            }
+            vbodies[i] = GetEnv()->GetBodyFromEnvironmentId(id);
+            if( !vbodies[i] ) {
+                RAVELOG_WARN(str(boost::format("unknown body id %d")%id));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// bodies_getjoints: int32 num, int32 ids[num]
+    ///
+    /// returns int32 num, then for every body int32 id, int32 dof, float64 values[dof]
+    bool orBinaryBodiesGetJointValues(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        vector<KinBodyPtr> vbodies;
+        if( !_ReadBinaryBodies(is, vbodies) ) {
+            return false;
+        }
+        vector<dReal> values;
+        _WriteBinary(os, (int32_t)vbodies.size());
+        FOREACHC(itbody, vbodies) {
+            (*itbody)->GetDOFValues(values);
+            _WriteBinary(os, (int32_t)(*itbody)->GetEnvironmentId());
+            _WriteBinary(os, (int32_t)values.size());
+            _WriteBinaryArray(os, values);
+        }
+        return true;
+    }
+
+    /// bodies_setjoints: int32 num, then for every body int32 id, int32 dof, float64 values[dof]
+    ///
+    /// dof has to be the body's dof. All bodies are set while holding the environment lock once.
+    /// returns int32 num, the number of bodies set
+    bool orBinaryBodiesSetJointValues(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        int32_t numbodies = 0;
+        if( !_ReadBinary(is, numbodies) || numbodies < 0 ) {
+            return false;
+        }
+        vector<dReal> vvalues;
+        for(int32_t i = 0; i < numbodies; ++i) {
+            int32_t id = 0, dof = 0;
+            if( !_ReadBinary(is, id) || !_ReadBinary(is, dof) ) {
+                return false;
+            }
+            KinBodyPtr pbody = GetEnv()->GetBodyFromEnvironmentId(id);
+            if( !pbody || dof != pbody->GetDOF() ) {
+                RAVELOG_WARN(str(boost::format("body id %d does not exist or does not have %d dof")%id%dof));
+                return false;
+            }
+            if( !_ReadBinaryArray(is, vvalues, dof) ) {
+                return false;
+            }
+            pbody->SetDOFValues(vvalues, true);
+            if( pbody->IsRobot() ) {
+                // if robot, have to turn off any trajectory following
+                RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+                if( !!probot->GetController() ) {
+                    probot->GetDOFValues(vvalues);
+                    probot->GetController()->SetDesired(vvalues);
+                }
+            }
+        }
+        _WriteBinary(os, numbodies);
+        return true;
+    }
+
+    /// bodies_settransforms: int32 num, then for every body int32 id, float64 transform[7]
+    ///
+    /// returns int32 num, the number of bodies set
+    bool orBinaryBodiesSetTransforms(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        int32_t numbodies = 0;
+        if( !_ReadBinary(is, numbodies) || numbodies < 0 ) {
+            return false;
+        }
+        for(int32_t i = 0; i < numbodies; ++i) {
+            int32_t id = 0;
+            double values[7];
+            if( !_ReadBinary(is, id) || !_ReadBinary(is, values) ) {
+                return false;
+            }
+            KinBodyPtr pbody = GetEnv()->GetBodyFromEnvironmentId(id);
+            if( !pbody ) {
+                RAVELOG_WARN(str(boost::format("unknown body id %d")%id));
+                return false;
+            }
+            Transform t;
+            t.rot = Vector(values[0], values[1], values[2], values[3]);
+            t.trans = Vector(values[4], values[5], values[6]);
+            t.rot.normalize4();
+            pbody->SetTransform(t);
+            if( pbody->IsRobot() ) {
+                ControllerBasePtr pcontroller = RaveInterfaceCast<RobotBase>(pbody)->GetController();
+                if( !!pcontroller ) {
+                    pcontroller->Reset(0);
+                }
+            }
+        }
+        _WriteBinary(os, numbodies);
+        return true;
+    }
+
+    /// bodies_getlinks: int32 num, int32 ids[num]
+    ///
+    /// returns int32 num, then for every body int32 id, int32 numlinks, float64 transforms[7*numlinks]
+    bool orBinaryBodiesGetLinks(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        vector<KinBodyPtr> vbodies;
+        if( !_ReadBinaryBodies(is, vbodies) ) {
+            return false;
+        }
+        _WriteBinary(os, (int32_t)vbodies.size());
+        FOREACHC(itbody, vbodies) {
+            const std::vector<KinBody::LinkPtr>& links = (*itbody)->GetLinks();
+            _WriteBinary(os, (int32_t)(*itbody)->GetEnvironmentId());
+            _WriteBinary(os, (int32_t)links.size());
+            FOREACHC(itlink, links) {
+                _WriteBinaryTransform(os, (*itlink)->GetTransform());
+            }
+        }
+        return true;
+    }
+
+    //@}
+
     /// orBodySetJointTorques(body, values, indices)
     bool orBodySetJointTorques(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
     {
@@ -1561,6 +1561,27 @@ public:
         return openravepy::GetUserData(_penv->GetUserData());
     }
 
+    object SendCommand(const string& in, bool releasegil=false, bool lockenv=false) {
+        stringstream sin(in), sout;
+        {
+            openravepy::PythonThreadSaverPtr statesaver;
+            openravepy::PyEnvironmentLockSaverPtr envsaver;
+            if( releasegil ) {
+                statesaver.reset(new openravepy::PythonThreadSaver());
+                if( lockenv ) {
+                    envsaver.reset(new openravepy::PyEnvironmentLockSaver(shared_from_this(), true));
+                }
+            }
+            else if( lockenv ) {
+                envsaver.reset(new openravepy::PyEnvironmentLockSaver(shared_from_this(), false));
+            }
+            if( !_penv->SendCommand(sout,sin) ) {
+                return object();
+            }
+        }
+        return object(sout.str());
+    }
+
     bool __eq__(PyEnvironmentBasePtr p) {
         return !!p && _penv==p->_penv;
     }
@@ -1986,6 +2007,7 @@ Because race conditions can pop up when trying to lock the openrave environment
                     .def("SetUserData",setuserdata1,args("data"), DOXY_FN(InterfaceBase,SetUserData))
                     .def("SetUserData",setuserdata2,args("data"), DOXY_FN(InterfaceBase,SetUserData))
                     .def("GetUserData",&PyEnvironmentBase::GetUserData, DOXY_FN(InterfaceBase,GetUserData))
+                    .def("SendCommand",&PyEnvironmentBase::SendCommand,SendCommand_overloads(args("cmd","releasegil","lockenv"), DOXY_FN(EnvironmentBase,SendCommand)))
                     .def("__enter__",&PyEnvironmentBase::__enter__)
                     .def("__exit__",&PyEnvironmentBase::__exit__)
                     .def("__eq__",&PyEnvironmentBase::__eq__)
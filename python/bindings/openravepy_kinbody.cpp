@@ -2374,6 +2374,36 @@ int PyKinBody::GetUpdateStamp() const
     return _pbody->GetUpdateStamp();
 }
 
+static void _UpdateStampCallback(object fncallback)
+{
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    try {
+        fncallback();
+    }
+    catch(...) {
+        RAVELOG_ERROR("exception occured in python update stamp callback:\n");
+        PyErr_Print();
+    }
+    PyGILState_Release(gstate);
+}
+
+object PyKinBody::RegisterUpdateStampCallback(object fncallback)
+{
+    if( !fncallback ) {
+        throw openrave_exception("callback not specified");
+    }
+    UserDataPtr p = _pbody->RegisterUpdateStampCallback(boost::bind(_UpdateStampCallback,fncallback));
+    if( !p ) {
+        throw openrave_exception("registration handle is NULL");
+    }
+    return openravepy::GetUserData(p);
+}
+
+void PyKinBody::ArmUpdateStampCallbacks() const
+{
+    _pbody->ArmUpdateStampCallbacks();
+}
+
 string PyKinBody::serialize(int options) const
 {
     stringstream ss;
@@ -2893,6 +2923,8 @@ void init_openravepy_kinbody()
                         .def("GetCollisionData",&PyKinBody::GetCollisionData, DOXY_FN(KinBody,GetCollisionData))
                         .def("GetManageData",&PyKinBody::GetManageData, DOXY_FN(KinBody,GetManageData))
                         .def("GetUpdateStamp",&PyKinBody::GetUpdateStamp, DOXY_FN(KinBody,GetUpdateStamp))
+                        .def("RegisterUpdateStampCallback",&PyKinBody::RegisterUpdateStampCallback, args("callback"), DOXY_FN(KinBody,RegisterUpdateStampCallback))
+                        .def("ArmUpdateStampCallbacks",&PyKinBody::ArmUpdateStampCallbacks, DOXY_FN(KinBody,ArmUpdateStampCallbacks))
                         .def("serialize",&PyKinBody::serialize,args("options"), DOXY_FN(KinBody,serialize))
                         .def("GetKinematicsGeometryHash",&PyKinBody::GetKinematicsGeometryHash, DOXY_FN(KinBody,GetKinematicsGeometryHash))
                         .def("CreateKinBodyStateSaver",&PyKinBody::CreateKinBodyStateSaver, CreateKinBodyStateSaver_overloads(args("options"), "Creates an object that can be entered using 'with' and returns a KinBodyStateSaver")[return_value_policy<manage_new_object>()])
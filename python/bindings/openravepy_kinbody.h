@@ -204,6 +204,8 @@ public:
     object GetCollisionData() const;
     object GetManageData() const;
     int GetUpdateStamp() const;
+    object RegisterUpdateStampCallback(object fncallback);
+    void ArmUpdateStampCallbacks() const;
     string serialize(int options) const;
     string GetKinematicsGeometryHash() const;
     PyStateRestoreContextBase* CreateKinBodyStateSaver(object options=object());
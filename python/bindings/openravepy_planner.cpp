@@ -22,16 +22,23 @@ namespace openravepy {
 class PyPlannerProgress
 {
 public:
-    PyPlannerProgress() : _iteration(0) {
+    PyPlannerProgress() : _iteration(0), _stageduration(0) {
     }
     PyPlannerProgress(const PlannerBase::PlannerProgress& progress) {
         _iteration = progress._iteration;
+        _stage = progress._stage;
+        _stageduration = progress._stageduration;
     }
     string __str__() {
+        if( _stage.size() > 0 ) {
+            return boost::str(boost::format("<PlannerProgress: iter=%d, stage=%s %fs>")%_iteration%_stage%_stageduration);
+        }
         return boost::str(boost::format("<PlannerProgress: iter=%d>")%_iteration);
     }
 
     int _iteration;
+    string _stage;
+    dReal _stageduration;
 };
 
 class PyPlannerBase : public PyInterfaceBase
@@ -304,6 +311,8 @@ void init_openravepy_planner()
     ;
     class_<PyPlannerProgress, boost::shared_ptr<PyPlannerProgress> >("PlannerProgress", DOXY_CLASS(PlannerBase::PlannerProgress))
     .def_readwrite("_iteration",&PyPlannerProgress::_iteration)
+    .def_readwrite("_stage",&PyPlannerProgress::_stage)
+    .def_readwrite("_stageduration",&PyPlannerProgress::_stageduration)
     ;
 
     {
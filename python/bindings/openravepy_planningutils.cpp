@@ -130,6 +130,45 @@ public:
 
 typedef boost::shared_ptr<PyActiveDOFTrajectoryRetimer> PyActiveDOFTrajectoryRetimerPtr;
 
+class PyActiveDOFTrajectoryBatchPlanner
+{
+public:
+    PyActiveDOFTrajectoryBatchPlanner(PyRobotBasePtr pyrobot, int numthreads, bool bsmooth, const std::string& plannername, const std::string& plannerparameters) : _planner(openravepy::GetRobot(pyrobot), numthreads, bsmooth, plannername, plannerparameters) {
+    }
+    virtual ~PyActiveDOFTrajectoryBatchPlanner() {
+    }
+
+    object PlanPaths(object pytrajectories, bool hastimestamps=false, bool releasegil=true)
+    {
+        std::vector<TrajectoryBasePtr> vtrajectories(len(pytrajectories));
+        for(size_t i = 0; i < vtrajectories.size(); ++i) {
+            extract<PyTrajectoryBasePtr> epytrajectory(pytrajectories[i]);
+            vtrajectories[i] = openravepy::GetTrajectory((PyTrajectoryBasePtr)epytrajectory);
+        }
+        std::vector<PlannerStatus> vstatuses;
+        {
+            openravepy::PythonThreadSaverPtr statesaver;
+            if( releasegil ) {
+                statesaver.reset(new openravepy::PythonThreadSaver());
+            }
+            _planner.PlanPaths(vtrajectories, vstatuses, hastimestamps);
+        }
+        boost::python::list ostatuses;
+        FOREACHC(itstatus, vstatuses) {
+            ostatuses.append(*itstatus);
+        }
+        return ostatuses;
+    }
+
+    int GetNumThreads() const {
+        return _planner.GetNumThreads();
+    }
+
+    OpenRAVE::planningutils::ActiveDOFTrajectoryBatchPlanner _planner;
+};
+
+typedef boost::shared_ptr<PyActiveDOFTrajectoryBatchPlanner> PyActiveDOFTrajectoryBatchPlannerPtr;
+
 class PyAffineTrajectoryRetimer
 {
 public:
@@ -347,6 +386,7 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(InsertWaypointWithSmoothing_overloads, planningu
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads, PlanPath, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads2, PlanPath, 3, 5)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads3, PlanPath, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPaths_overloads, PlanPaths, 1, 3)
 
 void InitPlanningUtils()
 {
@@ -426,6 +466,12 @@ void InitPlanningUtils()
         .def("PlanPath",&planningutils::PyActiveDOFTrajectoryRetimer::PlanPath,PlanPath_overloads3(args("traj","hastimestamps", "releasegil"), DOXY_FN(planningutils::ActiveDOFTrajectoryRetimer,PlanPath)))
         ;
 
+        class_<planningutils::PyActiveDOFTrajectoryBatchPlanner, planningutils::PyActiveDOFTrajectoryBatchPlannerPtr >("ActiveDOFTrajectoryBatchPlanner", DOXY_CLASS(planningutils::ActiveDOFTrajectoryBatchPlanner), no_init)
+        .def(init<PyRobotBasePtr, int, bool, const std::string&, const std::string&>(args("robot", "numthreads", "smooth", "plannername", "plannerparameters")))
+        .def("PlanPaths",&planningutils::PyActiveDOFTrajectoryBatchPlanner::PlanPaths,PlanPaths_overloads(args("trajectories","hastimestamps", "releasegil"), DOXY_FN(planningutils::ActiveDOFTrajectoryBatchPlanner,PlanPaths)))
+        .def("GetNumThreads",&planningutils::PyActiveDOFTrajectoryBatchPlanner::GetNumThreads, DOXY_FN(planningutils::ActiveDOFTrajectoryBatchPlanner,GetNumThreads))
+        ;
+
         class_<planningutils::PyAffineTrajectoryRetimer, planningutils::PyAffineTrajectoryRetimerPtr >("AffineTrajectoryRetimer", DOXY_CLASS(planningutils::AffineTrajectoryRetimer), no_init)
         .def(init<const std::string&, const std::string&>(args("plannername", "plannerparameters")))
         .def("PlanPath",&planningutils::PyAffineTrajectoryRetimer::PlanPath,PlanPath_overloads2(args("traj","maxvelocities", "maxaccelerations", "hastimestamps", "releasegil"), DOXY_FN(planningutils::AffineTrajectoryRetimer,PlanPath)))
@@ -367,6 +367,12 @@ public:
                 }
                 imagedata = static_cast<numeric::array>(handle<>(pyvalues));
             }
+            if( (int)pdata->vdepthdata.size() == pgeom->height*pgeom->width && pdata->vdepthdata.size() > 0 ) {
+                npy_intp dims[] = { pgeom->height,pgeom->width};
+                PyObject *pyvalues = PyArray_SimpleNew(2,dims, PyArray_FLOAT);
+                memcpy(PyArray_DATA(pyvalues),&pdata->vdepthdata[0],pdata->vdepthdata.size()*sizeof(float));
+                depthdata = static_cast<numeric::array>(handle<>(pyvalues));
+            }
         }
         PyCameraSensorData(boost::shared_ptr<SensorBase::CameraGeomData const> pgeom) : PySensorData(SensorBase::ST_Camera), intrinsics(pgeom->intrinsics)
         {
@@ -384,7 +390,7 @@ public:
         }
         virtual ~PyCameraSensorData() {
         }
-        object imagedata, KK;
+        object imagedata, depthdata, KK;
         PyCameraIntrinsics intrinsics;
     };
 
@@ -748,6 +754,7 @@ void init_openravepy_sensor()
         class_<PySensorBase::PyCameraSensorData, boost::shared_ptr<PySensorBase::PyCameraSensorData>, bases<PySensorBase::PySensorData> >("CameraSensorData", DOXY_CLASS(SensorBase::CameraSensorData),no_init)
         .def_readonly("transform",&PySensorBase::PyCameraSensorData::transform)
         .def_readonly("imagedata",&PySensorBase::PyCameraSensorData::imagedata)
+        .def_readonly("depthdata",&PySensorBase::PyCameraSensorData::depthdata)
         .def_readonly("KK",&PySensorBase::PyCameraSensorData::KK)
         .def_readonly("intrinsics",&PySensorBase::PyCameraSensorData::intrinsics)
         ;
@@ -57,7 +57,7 @@ if not __openravepy_build_doc__:
 else:
     from numpy import array
 
-from ..openravepy_int import RaveFindDatabaseFile, IkParameterization, rotationMatrixFromQArray, poseFromMatrix
+from ..openravepy_int import RaveFindDatabaseFile, IkParameterization, rotationMatrixFromQArray, poseFromMatrix, quatFromRotationMatrix
 from ..openravepy_ext import transformPoints, quatArrayTDist
 from .. import metaclass, pyANN
 from ..misc import SpaceSamplerExtra
@@ -66,7 +66,9 @@ from . import convexdecomposition, inversekinematics
 
 import numpy
 import time
+import os
 import os.path
+import tempfile
 from os import makedirs
 from heapq import nsmallest # for nth smallest element
 from optparse import OptionParser
@@ -126,6 +128,7 @@ class ReachabilityModel(DatabaseGenerator):
         self.quatdelta = None
         self.kdtree6d = None
         self.kdtree3d = None
+        self.numthreads = None
     def clone(self,envother):
         clone = DatabaseGenerator.clone(self,envother)
         return clone
@@ -234,6 +237,8 @@ class ReachabilityModel(DatabaseGenerator):
             if options.quatdelta is not None:
                 quatdelta=options.quatdelta
             usefreespace=options.usefreespace
+            if hasattr(options,'numthreads') and options.numthreads is not None:
+                self.numthreads = options.numthreads
         if self.robot.GetKinematicsGeometryHash() == 'e829feb384e6417bbf5bd015f1c6b49a' or self.robot.GetKinematicsGeometryHash() == '22548f4f2ecf83e88ae7e2f3b2a0bd08': # wam 7dof
             if maxradius is None:
                 maxradius = 1.1
@@ -268,6 +273,103 @@ class ReachabilityModel(DatabaseGenerator):
                     links.append(newlink)
         return links
 
+    def _InitSampling(self,maxradius,translationonly,xyzdelta,quatdelta,usefreespace):
+        """Moves the robot so that the manipulator base is at the origin and only enables the manipulator links, so has to be called while the robot state is saved. Sets the sampling parameters of the model.
+
+        :return: Trobot,baseanchor,maxradius,allpoints,insideinds,shape,rotations
+        """
+        Tbase = self.manip.GetBase().GetTransform()
+        Tbaseinv = linalg.inv(Tbase)
+        Trobot=dot(Tbaseinv,self.robot.GetTransform())
+        self.robot.SetTransform(Trobot) # set base link to global origin
+        maniplinks = self.getManipulatorLinks(self.manip)
+        for link in self.robot.GetLinks():
+            link.Enable(link in maniplinks)
+        # the axes' anchors are the best way to find the max radius
+        # the best estimate of arm length is to sum up the distances of the anchors of all the points in between the chain
+        armjoints = self.getOrderedArmJoints()
+        baseanchor = armjoints[0].GetAnchor()
+        eetrans = self.manip.GetEndEffectorTransform()[0:3,3]
+        armlength = 0
+        for j in armjoints[::-1]:
+            armlength += sqrt(sum((eetrans-j.GetAnchor())**2))
+            eetrans = j.GetAnchor()    
+        if maxradius is None:
+            maxradius = armlength+xyzdelta*sqrt(3.0)*1.05
+
+        allpoints,insideinds,shape,self.pointscale = self.UniformlySampleSpace(maxradius,delta=xyzdelta)
+        qarray = SpaceSamplerExtra().sampleSO3(quatdelta=quatdelta)
+        rotations = [eye(3)] if translationonly else rotationMatrixFromQArray(qarray)
+        self.xyzdelta = xyzdelta
+        self.quatdelta = 0
+        if not translationonly:
+            # for rotations, get the average distance to the nearest rotation
+            neighdists = []
+            for q in qarray:
+                neighdists.append(nsmallest(2,quatArrayTDist(q,qarray))[1])
+            self.quatdelta = mean(neighdists)
+        log.info('radius: %f, xyzsamples: %d, quatdelta: %f, rot samples: %d, freespace: %d',maxradius,len(insideinds),self.quatdelta,len(rotations),usefreespace)
+        return Trobot,baseanchor,maxradius,allpoints,insideinds,shape,rotations
+
+    def generate(self,maxradius=None,translationonly=False,xyzdelta=None,quatdelta=None,usefreespace=False):
+        """Computes the reachability with the ikfast module's ComputeReachability command, which solves the ik of all poses in C++ using self.numthreads threads. If the module is not available, falls back to the python loop of :meth:`.generatepcg`.
+        """
+        if not self.ikmodel.load():
+            self.ikmodel.autogenerate()
+        if self.ikmodel.ikfastproblem is None:
+            return DatabaseGenerator.generate(self,maxradius,translationonly,xyzdelta,quatdelta,usefreespace)
+        
+        if xyzdelta is None:
+            xyzdelta=0.04
+        if quatdelta is None:
+            quatdelta=0.5
+        self.kdtree3d = self.kdtree6d = None
+        starttime = time.time()
+        fd,filename = tempfile.mkstemp(suffix='.reachability')
+        os.close(fd)
+        try:
+            with self.robot:
+                Trobot,baseanchor,maxradius,allpoints,insideinds,shape,rotations = self._InitSampling(maxradius,translationonly,xyzdelta,quatdelta,usefreespace)
+            with self.robot:
+                # like the python loop, the ik is solved with all links enabled, only the robot is moved to the manipulator base
+                self.robot.SetTransform(Trobot)
+                quats = [quatFromRotationMatrix(rotation) for rotation in rotations]
+                cmd = 'ComputeReachability robot %s manipname %s maxradius %.15e xyzdelta %.15e center %.15e %.15e %.15e usefreespace %d filteroptions 0 filename %s '%(self.robot.GetName(),self.manip.GetName(),maxradius,xyzdelta,baseanchor[0],baseanchor[1],baseanchor[2],usefreespace,filename)
+                if self.numthreads is not None:
+                    cmd += 'numthreads %d '%self.numthreads
+                cmd += 'rotations %d '%len(quats) + ' '.join('%.15e'%f for f in array(quats).flat)
+                if self.ikmodel.ikfastproblem.SendCommand(cmd) is None:
+                    raise ValueError('ComputeReachability failed')
+            self.LoadReachabilityGrid(filename)
+        finally:
+            os.remove(filename)
+        log.info('database %s finished in %fs',self.__class__.__name__,time.time()-starttime)
+
+    def LoadReachabilityGrid(self,filename):
+        """Loads the binary grid written by the ikfast module's ComputeReachability command and sets reachabilitystats, reachability3d, and reachabilitydensity3d from it.
+        """
+        with open(filename,'rb') as f:
+            magic,version,numrotations,numvoxels = numpy.fromfile(f,dtype=uint32,count=4)
+            if magic != 0x4d52524f or version not in (1,2):
+                raise ValueError('%s is not a reachability grid'%filename)
+            nsteps = numpy.fromfile(f,dtype=int32,count=1)[0]
+            values = numpy.fromfile(f,dtype=float64,count=4)
+            xyzdelta,center = values[0],values[1:4]
+            quats = reshape(numpy.fromfile(f,dtype=float64,count=4*numrotations),(numrotations,4))
+            voxelindices = numpy.fromfile(f,dtype=int32,count=numvoxels)
+            # version 1 clamped the counts to 255
+            counts = reshape(numpy.fromfile(f,dtype=uint32 if version >= 2 else uint8,count=numvoxels*numrotations),(numvoxels,numrotations))
+        shape = (2*nsteps,2*nsteps,2*nsteps)
+        self.reachabilitydensity3d = zeros(prod(shape))
+        self.reachability3d = zeros(prod(shape))
+        self.reachabilitydensity3d[voxelindices] = numpy.sum(counts,1)/float(numrotations)
+        self.reachability3d[voxelindices] = numpy.sum(counts>0,1)/float(numrotations)
+        self.reachability3d = reshape(self.reachability3d,shape)
+        self.reachabilitydensity3d = reshape(self.reachabilitydensity3d,shape)
+        voxelinds,rotationinds = nonzero(counts)
+        translations = (c_[unravel_index(voxelindices[voxelinds],shape)]-nsteps)*xyzdelta+center
+        self.reachabilitystats = c_[quats[rotationinds],translations,counts[voxelinds,rotationinds]]
+
     def generatepcg(self,maxradius=None,translationonly=False,xyzdelta=None,quatdelta=None,usefreespace=False):
         """Generate producer, consumer, and gatherer functions allowing parallelization
         """
@@ -280,37 +382,7 @@ class ReachabilityModel(DatabaseGenerator):
             quatdelta=0.5
         self.kdtree3d = self.kdtree6d = None
         with self.robot:
-            Tbase = self.manip.GetBase().GetTransform()
-            Tbaseinv = linalg.inv(Tbase)
-            Trobot=dot(Tbaseinv,self.robot.GetTransform())
-            self.robot.SetTransform(Trobot) # set base link to global origin
-            maniplinks = self.getManipulatorLinks(self.manip)
-            for link in self.robot.GetLinks():
-                link.Enable(link in maniplinks)
-            # the axes' anchors are the best way to find the max radius
-            # the best estimate of arm length is to sum up the distances of the anchors of all the points in between the chain
-            armjoints = self.getOrderedArmJoints()
-            baseanchor = armjoints[0].GetAnchor()
-            eetrans = self.manip.GetEndEffectorTransform()[0:3,3]
-            armlength = 0
-            for j in armjoints[::-1]:
-                armlength += sqrt(sum((eetrans-j.GetAnchor())**2))
-                eetrans = j.GetAnchor()    
-            if maxradius is None:
-                maxradius = armlength+xyzdelta*sqrt(3.0)*1.05
-
-            allpoints,insideinds,shape,self.pointscale = self.UniformlySampleSpace(maxradius,delta=xyzdelta)
-            qarray = SpaceSamplerExtra().sampleSO3(quatdelta=quatdelta)
-            rotations = [eye(3)] if translationonly else rotationMatrixFromQArray(qarray)
-            self.xyzdelta = xyzdelta
-            self.quatdelta = 0
-            if not translationonly:
-                # for rotations, get the average distance to the nearest rotation
-                neighdists = []
-                for q in qarray:
-                    neighdists.append(nsmallest(2,quatArrayTDist(q,qarray))[1])
-                self.quatdelta = mean(neighdists)
-            log.info('radius: %f, xyzsamples: %d, quatdelta: %f, rot samples: %d, freespace: %d',maxradius,len(insideinds),self.quatdelta,len(rotations),usefreespace)
+            Trobot,baseanchor,maxradius,allpoints,insideinds,shape,rotations = self._InitSampling(maxradius,translationonly,xyzdelta,quatdelta,usefreespace)
             
         self.reachabilitydensity3d = zeros(prod(shape))
         self.reachability3d = zeros(prod(shape))
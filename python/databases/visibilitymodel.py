@@ -135,6 +135,7 @@ class VisibilityModel(DatabaseGenerator):
         self.visibilitytransforms = None
         self.rmodel = self.ikmodel = None
         self.preshapes = None
+        self.numthreads = None
         self.preprocess()
     def clone(self,envother):
         clone = DatabaseGenerator.clone(self,envother)
@@ -191,6 +192,8 @@ class VisibilityModel(DatabaseGenerator):
                 conedirangles = []
                 for conediranglestring in options.conedirangles:
                     conedirangles.append([float(s) for s in conediranglestring.split()])
+            if hasattr(options,'numthreads') and options.numthreads is not None:
+                self.numthreads = options.numthreads
         if not gmodel is None:
             preshapes = array([gmodel.grasps[0][gmodel.graspindices['igrasppreshape']]])
         if len(self.manip.GetGripperIndices()) > 0:
@@ -227,13 +230,13 @@ class VisibilityModel(DatabaseGenerator):
                             self.robot.SetDOFValues(self.preshapes[0],self.manip.GetGripperIndices())
                     extentsfile = os.path.join(RaveGetHomeDirectory(),'kinbody.'+self.target.GetKinematicsGeometryHash(),'visibility.txt')
                     if sphere is None and os.path.isfile(extentsfile):
-                        self.visibilitytransforms = self.visualprob.ProcessVisibilityExtents(extents=loadtxt(extentsfile,float),conedirangles=conedirangles)
+                        self.visibilitytransforms = self.visualprob.ProcessVisibilityExtents(extents=loadtxt(extentsfile,float),conedirangles=conedirangles,numthreads=self.numthreads)
                     elif localtransforms is not None:
-                        self.visibilitytransforms = self.visualprob.ProcessVisibilityExtents(transforms=localtransforms)
+                        self.visibilitytransforms = self.visualprob.ProcessVisibilityExtents(transforms=localtransforms,numthreads=self.numthreads)
                     else:
                         if sphere is None:
                             sphere = [3,0.1,0.15,0.2,0.25,0.3]
-                        self.visibilitytransforms = self.visualprob.ProcessVisibilityExtents(sphere=sphere,conedirangles=conedirangles)
+                        self.visibilitytransforms = self.visualprob.ProcessVisibilityExtents(sphere=sphere,conedirangles=conedirangles,numthreads=self.numthreads)
                 print 'total transforms: ',len(self.visibilitytransforms)
                 self.visualprob.SetCameraTransforms(transforms=self.visibilitytransforms)
         finally:
@@ -68,6 +68,21 @@ class BaseManipulation:
         
         return False
     
+    def SetEdgeValidityCache(self,maxedges):
+        """See :ref:`module-basemanipulation-setedgevaliditycache`
+        """
+        return self.prob.SendCommand('SetEdgeValidityCache %d'%maxedges) is not None
+
+    def GetEdgeValidityCacheStatistics(self):
+        """See :ref:`module-basemanipulation-getedgevaliditycachestatistics`
+
+        :return: (hits, misses, numedges)
+        """
+        res = self.prob.SendCommand('GetEdgeValidityCacheStatistics')
+        if res is None:
+            return None
+        return tuple(int(s) for s in res.split())
+
     def TrajFromData(self,data,resettrans=False,resettiming=False):
         """See :ref:`module-basemanipulation-traj`
         """
@@ -58,7 +58,7 @@ class Grasper:
         clone.avoidlinks = [clone.robot.GetLink(link.GetName()) for link in self.avoidlinks]
         envother.Add(clone.prob,True,clone.args)
         return clone
-    def Grasp(self,direction=None,roll=None,position=None,standoff=None,target=None,stablecontacts=False,forceclosure=False,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,execute=None,translationstepmult=None,outputfinal=False,manipulatordirection=None,finestep=None,vintersectplane=None,chuckingdirection=None):
+    def Grasp(self,direction=None,roll=None,position=None,standoff=None,target=None,stablecontacts=False,forceclosure=False,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,execute=None,translationstepmult=None,outputfinal=False,manipulatordirection=None,finestep=None,vintersectplane=None,chuckingdirection=None,conservativeadvancement=False):
         """See :ref:`module-grasper-grasp`
         """
         cmd = 'Grasp '
@@ -81,6 +81,8 @@ class Grasper:
             cmd += 'translationstepmult %.15e '%translationstepmult
         if finestep is not None:
             cmd += 'finestep %.15e '%finestep
+        if conservativeadvancement:
+            cmd += 'conservativeadvancement 1 '
         if vintersectplane is not None:
             cmd += 'vintersectplane %.15e %.15e %.15e %.15e '%(vintersectplane[0], vintersectplane[1], vintersectplane[2], vintersectplane[3])
         if chuckingdirection is not None:
@@ -111,7 +113,7 @@ class Grasper:
         contacts = reshape(array([float64(s) for s in resvalues],float64),(len(resvalues)/6,6))
         return contacts,finalconfig,mindist,volume
 
-    def GraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,finestep=None):
+    def GraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,finestep=None,conservativeadvancement=False):
         """See :ref:`module-grasper-graspthreaded`
         """
         cmd = 'GraspThreaded '
@@ -132,6 +134,8 @@ class Grasper:
             cmd += 'translationstepmult %.15e '%translationstepmult
         if finestep is not None:
             cmd += 'finestep %.15e '%finestep
+        if conservativeadvancement:
+            cmd += 'conservativeadvancement 1 '
         if numthreads is not None:
             cmd += 'numthreads %d '%numthreads
         cmd += 'approachrays %d '%len(approachrays)
@@ -79,7 +79,7 @@ class VisualFeedback:
         if res is None:
             raise planning_error()
         return res
-    def ProcessVisibilityExtents(self,localtargetcenter=None,numrolls=None,transforms=None,extents=None,sphere=None,conedirangles=None):
+    def ProcessVisibilityExtents(self,localtargetcenter=None,numrolls=None,transforms=None,extents=None,sphere=None,conedirangles=None,numthreads=None):
         """See :ref:`module-visualfeedback-processvisibilityextents`
         """
         cmd = 'ProcessVisibilityExtents '
@@ -102,6 +102,8 @@ class VisualFeedback:
         if conedirangles is not None:
             for conedirangle in conedirangles:
                 cmd += 'conedirangle %.15e %.15e %.15e '%(conedirangle[0],conedirangle[1],conedirangle[2])
+        if numthreads is not None:
+            cmd += 'numthreads %d '%numthreads
         res = self.prob.SendCommand(cmd)
         if res is None:
             raise planning_error()
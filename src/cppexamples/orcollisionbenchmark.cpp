@@ -0,0 +1,118 @@
+/** \example orcollisionbenchmark.cpp
+
+    Measures how collision checking scales with the number of threads. Every thread clones the environment and checks
+    random robot configurations for environment and self collisions on its own clone. The total number of checks per
+    second is printed for each thread count.
+
+    Usage:
+    \verbatim
+    orcollisionbenchmark [--checker checker_name] [--scene scene] [--maxthreads N] [--time seconds]
+    \endverbatim
+
+    Example:
+    \verbatim
+    orcollisionbenchmark --checker ode --scene data/lab1.env.xml --maxthreads 16
+    \endverbatim
+
+    <b>Full Example Code:</b>
+ */
+#include <openrave-core.h>
+#include <openrave/utils.h>
+#include <vector>
+#include <cstring>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+using namespace OpenRAVE;
+using namespace std;
+
+void CheckingThread(EnvironmentBasePtr pclonedenv, const std::string& robotname, dReal ftime, uint64_t* pnumchecks)
+{
+    RobotBasePtr probot = pclonedenv->GetRobot(robotname);
+    EnvironmentMutex::scoped_lock lock(pclonedenv->GetMutex());
+    vector<dReal> vlower, vupper, vvalues(probot->GetDOF());
+    probot->GetDOFLimits(vlower,vupper);
+    uint64_t numchecks = 0;
+    uint64_t starttime = utils::GetMicroTime();
+    uint64_t endtime = starttime + (uint64_t)(ftime*1000000);
+    while(utils::GetMicroTime() < endtime) {
+        for(size_t i = 0; i < vvalues.size(); ++i) {
+            vvalues[i] = vlower[i] + (vupper[i]-vlower[i])*RaveRandomFloat();
+        }
+        probot->SetDOFValues(vvalues);
+        pclonedenv->CheckCollision(KinBodyConstPtr(probot));
+        probot->CheckSelfCollision();
+        numchecks += 2;
+    }
+    *pnumchecks = numchecks;
+}
+
+int main(int argc, char ** argv)
+{
+    string collisionchecker = "ode", scenefilename = "data/lab1.env.xml";
+    int maxthreads = 16;
+    dReal ftime = 2;
+    for(int i = 1; i < argc; ++i) {
+        if( strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-?") == 0 || strcmp(argv[i], "/?") == 0 || strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-help") == 0 ) {
+            RAVELOG_INFO("orcollisionbenchmark [--checker checker_name] [--scene scene] [--maxthreads N] [--time seconds]\n");
+            return 0;
+        }
+        else if( strcmp(argv[i], "--checker") == 0 && i+1 < argc ) {
+            collisionchecker = argv[++i];
+        }
+        else if( strcmp(argv[i], "--scene") == 0 && i+1 < argc ) {
+            scenefilename = argv[++i];
+        }
+        else if( strcmp(argv[i], "--maxthreads") == 0 && i+1 < argc ) {
+            maxthreads = atoi(argv[++i]);
+        }
+        else if( strcmp(argv[i], "--time") == 0 && i+1 < argc ) {
+            ftime = atof(argv[++i]);
+        }
+    }
+
+    RaveInitialize(true);
+    EnvironmentBasePtr penv = RaveCreateEnvironment();
+    CollisionCheckerBasePtr pchecker = RaveCreateCollisionChecker(penv, collisionchecker);
+    if( !pchecker ) {
+        RAVELOG_ERROR("failed to create checker %s\n", collisionchecker.c_str());
+        return 1;
+    }
+    penv->SetCollisionChecker(pchecker);
+    if( !penv->Load(scenefilename) ) {
+        RAVELOG_ERROR("failed to load %s\n", scenefilename.c_str());
+        return 2;
+    }
+    vector<RobotBasePtr> vrobots;
+    penv->GetRobots(vrobots);
+    if( vrobots.size() == 0 ) {
+        RAVELOG_ERROR("%s has no robots\n", scenefilename.c_str());
+        return 3;
+    }
+    string robotname = vrobots.at(0)->GetName();
+
+    for(int numthreads = 1; numthreads <= maxthreads; numthreads *= 2) {
+        vector<EnvironmentBasePtr> vclonedenvs(numthreads);
+        for(int i = 0; i < numthreads; ++i) {
+            vclonedenvs[i] = penv->CloneSelf(Clone_Bodies);
+            vclonedenvs[i]->SetCollisionChecker(RaveCreateCollisionChecker(vclonedenvs[i], collisionchecker));
+        }
+        vector<uint64_t> vnumchecks(numthreads,0);
+        vector<boost::shared_ptr<boost::thread> > vthreads(numthreads);
+        for(int i = 0; i < numthreads; ++i) {
+            vthreads[i].reset(new boost::thread(boost::bind(CheckingThread, vclonedenvs[i], robotname, ftime, &vnumchecks[i])));
+        }
+        uint64_t totalchecks = 0;
+        for(int i = 0; i < numthreads; ++i) {
+            vthreads[i]->join();
+            totalchecks += vnumchecks[i];
+        }
+        RAVELOG_INFO("%s: %d threads, %f checks/s\n", collisionchecker.c_str(), numthreads, totalchecks/ftime);
+        for(int i = 0; i < numthreads; ++i) {
+            vclonedenvs[i]->Destroy();
+        }
+    }
+
+    RaveDestroy();
+    return 0;
+}
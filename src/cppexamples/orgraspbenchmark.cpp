@@ -0,0 +1,107 @@
+/** \example orgraspbenchmark.cpp
+
+    Compares the grasps per second of the Grasper module with fixed coarse/fine steps and with conservative
+    advancement, where the steps are lengthened using the clearance given by the collision checker's distance queries.
+    Both modes are run on the same random approach directions and the number of grasps with contacts is printed.
+
+    Usage:
+    \verbatim
+    orgraspbenchmark [--robot robot] [--target target] [--checker checker_name] [--num N]
+    \endverbatim
+
+    Example:
+    \verbatim
+    orgraspbenchmark --robot robots/barretthand.robot.xml --target data/mug1.kinbody.xml --num 200
+    \endverbatim
+
+    <b>Full Example Code:</b>
+ */
+#include <openrave-core.h>
+#include <openrave/utils.h>
+#include <vector>
+#include <cstring>
+#include <sstream>
+
+using namespace OpenRAVE;
+using namespace std;
+
+int main(int argc, char ** argv)
+{
+    string robotfilename = "robots/barretthand.robot.xml", targetfilename = "data/mug1.kinbody.xml", collisionchecker = "ode";
+    int numgrasps = 200;
+    for(int i = 1; i < argc; ++i) {
+        if( strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-?") == 0 || strcmp(argv[i], "/?") == 0 || strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-help") == 0 ) {
+            RAVELOG_INFO("orgraspbenchmark [--robot robot] [--target target] [--checker checker_name] [--num N]\n");
+            return 0;
+        }
+        else if( strcmp(argv[i], "--robot") == 0 && i+1 < argc ) {
+            robotfilename = argv[++i];
+        }
+        else if( strcmp(argv[i], "--target") == 0 && i+1 < argc ) {
+            targetfilename = argv[++i];
+        }
+        else if( strcmp(argv[i], "--checker") == 0 && i+1 < argc ) {
+            collisionchecker = argv[++i];
+        }
+        else if( strcmp(argv[i], "--num") == 0 && i+1 < argc ) {
+            numgrasps = atoi(argv[++i]);
+        }
+    }
+
+    RaveInitialize(true);
+    EnvironmentBasePtr penv = RaveCreateEnvironment();
+    penv->SetCollisionChecker(RaveCreateCollisionChecker(penv, collisionchecker));
+    RobotBasePtr probot = penv->ReadRobotURI(robotfilename);
+    KinBodyPtr ptarget = penv->ReadKinBodyURI(targetfilename);
+    if( !probot || !ptarget ) {
+        RAVELOG_ERROR("failed to load %s or %s\n", robotfilename.c_str(), targetfilename.c_str());
+        return 1;
+    }
+    penv->Add(probot);
+    penv->Add(ptarget);
+
+    ModuleBasePtr pgrasper = RaveCreateModule(penv, "Grasper");
+    if( !pgrasper ) {
+        RAVELOG_ERROR("failed to create Grasper module\n");
+        return 2;
+    }
+    {
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        penv->AddModule(pgrasper, probot->GetName());
+        probot->SetActiveDOFs(probot->GetActiveManipulator()->GetGripperIndices(), DOF_X|DOF_Y|DOF_Z);
+    }
+
+    // approach the target center from random directions in the target coordinate system
+    Vector vcenter = ptarget->GetTransform().inverse()*ptarget->ComputeAABB().pos;
+    vector<Vector> vdirections(numgrasps);
+    vector<dReal> vrolls(numgrasps);
+    for(int i = 0; i < numgrasps; ++i) {
+        do {
+            vdirections[i] = Vector(2*RaveRandomFloat()-1, 2*RaveRandomFloat()-1, 2*RaveRandomFloat()-1);
+        } while(vdirections[i].lengthsqr3() > 1 || vdirections[i].lengthsqr3() < 1e-4);
+        vdirections[i].normalize3();
+        vrolls[i] = 2*PI*RaveRandomFloat();
+    }
+
+    Vector vmanipdir = probot->GetActiveManipulator()->GetLocalToolDirection();
+    for(int conservative = 0; conservative < 2; ++conservative) {
+        int numcontacts = 0;
+        uint64_t starttime = utils::GetMicroTime();
+        for(int i = 0; i < numgrasps; ++i) {
+            stringstream sout, sinput;
+            sinput << "Grasp target " << ptarget->GetName() << " execute 0 ";
+            sinput << "direction " << vdirections[i].x << " " << vdirections[i].y << " " << vdirections[i].z << " ";
+            sinput << "roll " << vrolls[i] << " position " << vcenter.x << " " << vcenter.y << " " << vcenter.z << " ";
+            sinput << "manipulatordirection " << vmanipdir.x << " " << vmanipdir.y << " " << vmanipdir.z << " ";
+            sinput << "conservativeadvancement " << conservative;
+            if( pgrasper->SendCommand(sout, sinput) && sout.str().size() > 0 ) {
+                ++numcontacts;
+            }
+        }
+        dReal felapsed = (utils::GetMicroTime()-starttime)*1e-6;
+        RAVELOG_INFO("%s: conservativeadvancement=%d, %f grasps/s, %d/%d grasps with contacts\n", collisionchecker.c_str(), conservative, numgrasps/felapsed, numcontacts, numgrasps);
+    }
+
+    RaveDestroy();
+    return 0;
+}
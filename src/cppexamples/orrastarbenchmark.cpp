@@ -0,0 +1,97 @@
+/** \example orrastarbenchmark.cpp
+
+    Measures the planning time of the RAStar planner as its search tree grows. A robot translates in the plane towards a
+    goal that cannot be reached, so every query expands exactly the given number of nodes. The time of each query is
+    printed for every node count.
+
+    Usage:
+    \verbatim
+    orrastarbenchmark [--robot robot] [--nodes N0,N1,...]
+    \endverbatim
+
+    Example:
+    \verbatim
+    orrastarbenchmark --robot robots/pr2-beta-static.zae --nodes 10000,100000
+    \endverbatim
+
+    <b>Full Example Code:</b>
+ */
+#include <openrave-core.h>
+#include <openrave/utils.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <boost/bind.hpp>
+
+using namespace OpenRAVE;
+using namespace std;
+
+/// distance to a goal outside of the limits, so the planner never terminates early
+dReal UnreachableGoal(const std::vector<dReal>& q, dReal fgoal)
+{
+    return RaveSqrt((q.at(0)-fgoal)*(q.at(0)-fgoal) + (q.at(1)-fgoal)*(q.at(1)-fgoal));
+}
+
+int main(int argc, char ** argv)
+{
+    string robotfilename = "robots/pr2-beta-static.zae", nodes = "10000,100000";
+    for(int i = 1; i < argc; ++i) {
+        if( strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-?") == 0 || strcmp(argv[i], "/?") == 0 || strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-help") == 0 ) {
+            RAVELOG_INFO("orrastarbenchmark [--robot robot] [--nodes N0,N1,...]\n");
+            return 0;
+        }
+        else if( strcmp(argv[i], "--robot") == 0 && i+1 < argc ) {
+            robotfilename = argv[++i];
+        }
+        else if( strcmp(argv[i], "--nodes") == 0 && i+1 < argc ) {
+            nodes = argv[++i];
+        }
+    }
+
+    RaveInitialize(true);
+    EnvironmentBasePtr penv = RaveCreateEnvironment();
+    RobotBasePtr probot = penv->ReadRobotURI(robotfilename);
+    if( !probot ) {
+        RAVELOG_ERROR("failed to load %s\n", robotfilename.c_str());
+        return 1;
+    }
+    penv->Add(probot);
+    PlannerBasePtr planner = RaveCreatePlanner(penv, "RAStar");
+    if( !planner ) {
+        RAVELOG_ERROR("failed to create RAStar planner\n");
+        return 2;
+    }
+
+    std::replace(nodes.begin(), nodes.end(), ',', ' ');
+    stringstream ssnodes(nodes);
+    int numnodes = 0;
+    while(ssnodes >> numnodes) {
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        // the area grows with the number of nodes so that the tree is not limited by the sampling threshold
+        dReal flimit = 0.05*RaveSqrt(dReal(numnodes));
+        probot->SetAffineTranslationLimits(Vector(-flimit,-flimit,-flimit), Vector(flimit,flimit,flimit));
+        probot->SetActiveDOFs(vector<int>(), DOF_X|DOF_Y);
+        probot->SetActiveDOFValues(vector<dReal>(2,0));
+
+        PlannerBase::PlannerParametersPtr params(new PlannerBase::PlannerParameters());
+        params->SetRobotActiveJoints(probot);
+        params->_goalfn = boost::bind(UnreachableGoal, _1, 2*flimit);
+        params->_nMaxIterations = numnodes;
+        params->_sExtraParameters = "<radius>0.1</radius><distthresh>0.03</distthresh>";
+        probot->GetActiveDOFValues(params->vinitialconfig);
+        TrajectoryBasePtr ptraj = RaveCreateTrajectory(penv, "");
+
+        uint64_t starttime = utils::GetMicroTime();
+        if( !planner->InitPlan(probot, params) ) {
+            RAVELOG_ERROR("failed to init RAStar\n");
+            continue;
+        }
+        planner->PlanPath(ptraj);
+        dReal felapsed = (utils::GetMicroTime()-starttime)*1e-6;
+        RAVELOG_INFO("RAStar: %d nodes, %fs\n", numnodes, felapsed);
+    }
+
+    RaveDestroy();
+    return 0;
+}
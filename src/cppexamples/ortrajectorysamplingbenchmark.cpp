@@ -0,0 +1,104 @@
+/** \example ortrajectorysamplingbenchmark.cpp
+
+    Measures the time to sample a trajectory when the output has to be converted to a different configuration
+    specification, which is what controllers and planners do when they only need some of the joints of a robot. The
+    trajectory holds the values and velocities of all the joints of the robot, and it is sampled for the values of
+    the joints of the active manipulator.
+
+    Every sample is timed twice: once with TrajectoryBase::Sample, which keeps a compiled conversion plan for the
+    requested specification, and once by sampling the internal specification and calling ConfigurationSpecification::ConvertData,
+    which parses the group names on every call.
+
+    Usage:
+    \verbatim
+    ortrajectorysamplingbenchmark [--robot robot] [--waypoints N] [--samples N]
+    \endverbatim
+
+    Example:
+    \verbatim
+    ortrajectorysamplingbenchmark --robot robots/barrettwam.robot.xml --samples 100000
+    \endverbatim
+
+    <b>Full Example Code:</b>
+ */
+#include <openrave-core.h>
+#include <openrave/utils.h>
+#include <vector>
+#include <cstring>
+#include <sstream>
+
+using namespace OpenRAVE;
+using namespace std;
+
+int main(int argc, char ** argv)
+{
+    string robotfilename = "robots/barrettwam.robot.xml";
+    int numwaypoints = 100, numsamples = 100000;
+    for(int i = 1; i < argc; ++i) {
+        if( strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-?") == 0 || strcmp(argv[i], "/?") == 0 || strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-help") == 0 ) {
+            RAVELOG_INFO("ortrajectorysamplingbenchmark [--robot robot] [--waypoints N] [--samples N]\n");
+            return 0;
+        }
+        else if( strcmp(argv[i], "--robot") == 0 && i+1 < argc ) {
+            robotfilename = argv[++i];
+        }
+        else if( strcmp(argv[i], "--waypoints") == 0 && i+1 < argc ) {
+            numwaypoints = atoi(argv[++i]);
+        }
+        else if( strcmp(argv[i], "--samples") == 0 && i+1 < argc ) {
+            numsamples = atoi(argv[++i]);
+        }
+    }
+
+    RaveInitialize(true);
+    EnvironmentBasePtr penv = RaveCreateEnvironment();
+    RobotBasePtr probot = penv->ReadRobotURI(robotfilename);
+    if( !probot ) {
+        RAVELOG_ERROR("failed to load %s\n", robotfilename.c_str());
+        return 1;
+    }
+    penv->Add(probot);
+
+    {
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        ConfigurationSpecification trajspec = probot->GetConfigurationSpecification("linear");
+        trajspec.AddDerivativeGroups(1,true);
+        TrajectoryBasePtr ptraj = RaveCreateTrajectory(penv, "");
+        ptraj->Init(trajspec);
+
+        std::vector<dReal> vlower, vupper, vwaypoint(trajspec.GetDOF(),0);
+        probot->GetDOFLimits(vlower, vupper);
+        std::vector<dReal> vvalues(probot->GetDOF());
+        for(int i = 0; i < numwaypoints; ++i) {
+            for(int j = 0; j < probot->GetDOF(); ++j) {
+                vvalues[j] = vlower[j] + (vupper[j]-vlower[j])*dReal((7*i+3*j)%11)/dReal(10);
+            }
+            ConfigurationSpecification::ConvertData(vwaypoint.begin(), trajspec, vvalues.begin(), probot->GetConfigurationSpecification(), 1, penv, false);
+            vwaypoint.at(trajspec.GetGroupFromName("deltatime").offset) = i > 0 ? 0.1 : 0;
+            ptraj->Insert(ptraj->GetNumWaypoints(), vwaypoint, trajspec);
+        }
+
+        ConfigurationSpecification samplespec = probot->GetConfigurationSpecificationIndices(probot->GetActiveManipulator()->GetArmIndices());
+        std::vector<dReal> vsample, vinternal;
+        dReal fduration = ptraj->GetDuration();
+
+        uint64_t starttime = utils::GetMicroTime();
+        for(int i = 0; i < numsamples; ++i) {
+            ptraj->Sample(vsample, fduration*i/numsamples, samplespec);
+        }
+        dReal fplantime = (utils::GetMicroTime()-starttime)*1e-6;
+
+        starttime = utils::GetMicroTime();
+        for(int i = 0; i < numsamples; ++i) {
+            ptraj->Sample(vinternal, fduration*i/numsamples);
+            vsample.resize(samplespec.GetDOF());
+            ConfigurationSpecification::ConvertData(vsample.begin(), samplespec, vinternal.begin(), ptraj->GetConfigurationSpecification(), 1, penv);
+        }
+        dReal fconverttime = (utils::GetMicroTime()-starttime)*1e-6;
+
+        RAVELOG_INFO("%d samples of %d values from %d: compiled plan %fus/sample, ConvertData %fus/sample\n", numsamples, samplespec.GetDOF(), trajspec.GetDOF(), 1e6*fplantime/numsamples, 1e6*fconverttime/numsamples);
+    }
+
+    RaveDestroy();
+    return 0;
+}
@@ -859,14 +859,18 @@ public:
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollision);
         CHECK_COLLISION_BODY(pbody1);
         return _pCurrentChecker->CheckCollision(pbody1,report);
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, KinBodyConstPtr pbody2, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollision);
         CHECK_COLLISION_BODY(pbody1);
         CHECK_COLLISION_BODY(pbody2);
         return _pCurrentChecker->CheckCollision(pbody1,pbody2,report);
@@ -874,14 +878,18 @@ public:
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report )
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollision);
         CHECK_COLLISION_BODY(plink->GetParent());
         return _pCurrentChecker->CheckCollision(plink,report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollision);
         CHECK_COLLISION_BODY(plink1->GetParent());
         CHECK_COLLISION_BODY(plink2->GetParent());
         return _pCurrentChecker->CheckCollision(plink1,plink2,report);
@@ -889,7 +897,9 @@ public:
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollision);
         CHECK_COLLISION_BODY(plink->GetParent());
         CHECK_COLLISION_BODY(pbody);
         return _pCurrentChecker->CheckCollision(plink,pbody,report);
@@ -897,38 +907,50 @@ public:
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollision);
         CHECK_COLLISION_BODY(plink->GetParent());
         return _pCurrentChecker->CheckCollision(plink,vbodyexcluded,vlinkexcluded,report);
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollision);
         CHECK_COLLISION_BODY(pbody);
         return _pCurrentChecker->CheckCollision(pbody,vbodyexcluded,vlinkexcluded,report);
     }
 
     virtual bool CheckCollision(const RAY& ray, KinBody::LinkConstPtr plink, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollisionRay");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollisionRay);
         CHECK_COLLISION_BODY(plink->GetParent());
         return _pCurrentChecker->CheckCollision(ray,plink,report);
     }
     virtual bool CheckCollision(const RAY& ray, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollisionRay");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckCollisionRay);
         CHECK_COLLISION_BODY(pbody);
         return _pCurrentChecker->CheckCollision(ray,pbody,report);
     }
     virtual bool CheckCollision(const RAY& ray, CollisionReportPtr report)
     {
+        PerformanceCounterTimer timer(PCT_CheckCollisionRay);
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckCollisionRay");
         return _pCurrentChecker->CheckCollision(ray,report);
     }
 
     virtual bool CheckStandaloneSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report)
     {
+        RAVE_TRACE_SCOPE("EnvironmentBase::CheckStandaloneSelfCollision");
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        PerformanceCounterTimer timer(PCT_CheckSelfCollision);
         CHECK_COLLISION_BODY(pbody);
         return _pCurrentChecker->CheckStandaloneSelfCollision(pbody,report);
     }
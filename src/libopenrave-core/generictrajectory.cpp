@@ -177,6 +177,7 @@ public:
 
     void Sample(std::vector<dReal>& data, dReal time) const
     {
+        PerformanceCounterTimer timer(PCT_TrajectorySample);
         BOOST_ASSERT(_bInit);
         BOOST_ASSERT(_timeoffset>=0);
         BOOST_ASSERT(time >= 0);
@@ -210,6 +211,7 @@ public:
 
     void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec) const
     {
+        PerformanceCounterTimer timer(PCT_TrajectorySample);
         BOOST_ASSERT(_bInit);
         BOOST_ASSERT(_timeoffset>=0);
         BOOST_ASSERT(time >= -g_fEpsilon);
@@ -219,25 +221,27 @@ public:
         }
         data.resize(0);
         data.resize(spec.GetDOF(),0);
+        boost::mutex::scoped_lock lock(_mutexconversion);
+        const ConfigurationSpecification::ConversionPlan& plan = _GetConversionPlan(spec);
         if( time >= GetDuration() ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.end()-_spec.GetDOF(),_spec,1,GetEnv());
+            plan.Convert(data.begin(),_vtrajdata.end()-_spec.GetDOF(),1,GetEnv());
         }
         else {
             std::vector<dReal>::iterator it = std::lower_bound(_vaccumtime.begin(),_vaccumtime.end(),time);
             if( it == _vaccumtime.begin() ) {
-                ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin(),_spec,1,GetEnv());
+                plan.Convert(data.begin(),_vtrajdata.begin(),1,GetEnv());
             }
             else {
-                // could be faster
-                vector<dReal> vinternaldata(_spec.GetDOF(),0);
+                _vinternaldata.resize(0);
+                _vinternaldata.resize(_spec.GetDOF(),0);
                 size_t index = it-_vaccumtime.begin();
                 dReal deltatime = time-_vaccumtime.at(index-1);
                 for(size_t i = 0; i < _vgroupinterpolators.size(); ++i) {
                     if( !!_vgroupinterpolators[i] ) {
-                        _vgroupinterpolators[i](index-1,deltatime,vinternaldata);
+                        _vgroupinterpolators[i](index-1,deltatime,_vinternaldata);
                     }
                 }
-                ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,1,GetEnv());
+                plan.Convert(data.begin(),_vinternaldata.begin(),1,GetEnv());
             }
         }
     }
@@ -267,7 +271,8 @@ public:
         BOOST_ASSERT(startindex<=endindex && startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
         data.resize(spec.GetDOF()*(endindex-startindex),0);
         if( startindex < endindex ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin()+startindex*_spec.GetDOF(),_spec,endindex-startindex,GetEnv());
+            boost::mutex::scoped_lock lock(_mutexconversion);
+            _GetConversionPlan(spec).Convert(data.begin(),_vtrajdata.begin()+startindex*_spec.GetDOF(),endindex-startindex,GetEnv());
         }
     }
 
@@ -347,6 +352,17 @@ public:
     }
 
 protected:
+    /// \brief returns the plan converting from the trajectory specification to spec, only compiled when spec changes
+    ///
+    /// The caller has to hold _mutexconversion until it is done with the plan.
+    const ConfigurationSpecification::ConversionPlan& _GetConversionPlan(const ConfigurationSpecification& spec) const
+    {
+        if( !_conversionplan.IsCompiledFor(spec,_spec) ) {
+            _conversionplan = ConfigurationSpecification::ConversionPlan(spec,_spec);
+        }
+        return _conversionplan;
+    }
+
     void _ConvertData(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, const std::vector< std::vector<ConfigurationSpecification::Group>::const_iterator >& vconvertgroups, const ConfigurationSpecification& spec, size_t numelements, bool filluninitialized)
     {
         for(size_t igroup = 0; igroup < vconvertgroups.size(); ++igroup) {
@@ -1015,6 +1031,9 @@ protected:
 
     std::vector<dReal> _vtrajdata;
     mutable std::vector<dReal> _vaccumtime, _vdeltainvtime;
+    mutable ConfigurationSpecification::ConversionPlan _conversionplan; ///< cached by _GetConversionPlan for the last requested specification
+    mutable std::vector<dReal> _vinternaldata; ///< temporary sample used when sampling with a different specification
+    mutable boost::mutex _mutexconversion; ///< protects _conversionplan and _vinternaldata so that the const Sample and GetWaypoints can be called from several threads once _ComputeInternal has run
     bool _bInit;
     mutable bool _bChanged; ///< if true, then _ComputeInternal() has to be called in order to compute _vaccumtime and _vdeltainvtime
     mutable bool _bSamplingVerified; ///< if false, then _VerifySampling() has not be called yet to verify that all points can be sampled.
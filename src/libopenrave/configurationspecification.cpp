@@ -1633,6 +1633,58 @@ void ConfigurationSpecification::ConvertGroupData(std::vector<dReal>::iterator i
     }
 }
 
+/// \brief fills the values of a target group that is not in the source with the current state of its body, or zeros
+static void _FillDefaultGroupValues(std::vector<dReal>::iterator ittargetdata, size_t targetstride, const ConfigurationSpecification::Group& gtarget, size_t numpoints, EnvironmentBaseConstPtr penv)
+{
+    vector<dReal> vdefaultvalues(gtarget.dof,0);
+    const string& name = gtarget.name;
+    if( name.size() >= 12 && name.substr(0,12) == "joint_values" ) {
+        string bodyname;
+        stringstream ss(name.substr(12));
+        ss >> bodyname;
+        if( !!ss ) {
+            if( !!penv ) {
+                KinBodyPtr body = penv->GetKinBody(bodyname);
+                if( !!body ) {
+                    vector<dReal> values;
+                    body->GetDOFValues(values);
+                    std::vector<int> indices((istream_iterator<int>(ss)), istream_iterator<int>());
+                    for(size_t i = 0; i < indices.size(); ++i) {
+                        vdefaultvalues.at(i) = values.at(indices[i]);
+                    }
+                }
+            }
+        }
+    }
+    else if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
+        string bodyname;
+        int affinedofs;
+        stringstream ss(name.substr(16));
+        ss >> bodyname >> affinedofs;
+        if( !!ss ) {
+            Transform tdefault;
+            if( !!penv ) {
+                KinBodyPtr body = penv->GetKinBody(bodyname);
+                if( !!body ) {
+                    tdefault = body->GetTransform();
+                }
+            }
+            BOOST_ASSERT((int)vdefaultvalues.size() == RaveGetAffineDOF(affinedofs));
+            RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),tdefault,affinedofs);
+        }
+    }
+    else if( name != "deltatime" ) {
+        // messages are too frequent
+        //RAVELOG_VERBOSE(str(boost::format("cannot initialize unknown group '%s'")%name));
+    }
+    size_t offset = 0;
+    for(size_t i = 0; i < numpoints; ++i, offset += targetstride) {
+        for(size_t j = 0; j < vdefaultvalues.size(); ++j) {
+            *(ittargetdata+offset+j) = vdefaultvalues[j];
+        }
+    }
+}
+
 void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification &targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification &sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
 {
     for(size_t igroup = 0; igroup < targetspec._vgroups.size(); ++igroup) {
@@ -1641,57 +1693,166 @@ void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittarg
             ConfigurationSpecification::ConvertGroupData(ittargetdata+targetspec._vgroups[igroup].offset, targetspec.GetDOF(), targetspec._vgroups[igroup], itsourcedata+itcompatgroup->offset, sourcespec.GetDOF(), *itcompatgroup,numpoints,penv,filluninitialized);
         }
         else if( filluninitialized ) {
-            vector<dReal> vdefaultvalues(targetspec._vgroups[igroup].dof,0);
-            const string& name = targetspec._vgroups[igroup].name;
-            if( name.size() >= 12 && name.substr(0,12) == "joint_values" ) {
-                string bodyname;
-                stringstream ss(name.substr(12));
-                ss >> bodyname;
-                if( !!ss ) {
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            vector<dReal> values;
-                            body->GetDOFValues(values);
-                            std::vector<int> indices((istream_iterator<int>(ss)), istream_iterator<int>());
-                            for(size_t i = 0; i < indices.size(); ++i) {
-                                vdefaultvalues.at(i) = values.at(indices[i]);
-                            }
-                        }
-                    }
+            _FillDefaultGroupValues(ittargetdata+targetspec._vgroups[igroup].offset, targetspec.GetDOF(), targetspec._vgroups[igroup], numpoints, penv);
+        }
+    }
+}
+
+/** \brief Computes the source value that each target value of two compatible groups is copied from, -1 if the target value is not in the source.
+
+    Mirrors the index computation of ConfigurationSpecification::ConvertGroupData.
+    \param[out] bzerodefaults true if the target values that are not in the source are filled with 0, otherwise they are filled with the current state of the body
+    \return false if the conversion cannot be expressed with copies, in which case ConvertGroupData has to be called
+ */
+static bool _GetGroupTransferIndices(const ConfigurationSpecification::Group& gtarget, const ConfigurationSpecification::Group& gsource, std::vector<int>& vtransferindices, bool& bzerodefaults)
+{
+    vtransferindices.resize(0);
+    bzerodefaults = false;
+    stringstream ss(gtarget.name);
+    std::vector<std::string> targettokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+    ss.clear();
+    ss.str(gsource.name);
+    std::vector<std::string> sourcetokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+    if( targettokens.size() == 0 || sourcetokens.size() == 0 || targettokens[0] != sourcetokens[0] ) {
+        return false;
+    }
+
+    bool bjoint = targettokens[0].size() >= 6 && targettokens[0].substr(0,6) == "joint_";
+    if( bjoint || targettokens[0] == "grab" ) {
+        // the indices are only guessed when they are missing, so leave those to ConvertGroupData
+        if( (int)sourcetokens.size() < gsource.dof+2 || (int)targettokens.size() < gtarget.dof+2 ) {
+            return false;
+        }
+        std::vector<int> vsourceindices(gsource.dof);
+        for(int i = 0; i < gsource.dof; ++i) {
+            vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
+        }
+        for(int i = 0; i < gtarget.dof; ++i) {
+            int targetindex = boost::lexical_cast<int>(targettokens.at(i+2));
+            std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),targetindex);
+            vtransferindices.push_back(it == vsourceindices.end() ? -1 : static_cast<int>(it-vsourceindices.begin()));
+        }
+        bzerodefaults = !bjoint;
+        return true;
+    }
+    else if( targettokens[0].size() >= 8 && targettokens[0].substr(0,8) == "ikparam_" ) {
+        if( sourcetokens.size() < 2 || targettokens.size() < 2 ) {
+            return false;
+        }
+        IkParameterizationType iktypesource = static_cast<IkParameterizationType>(boost::lexical_cast<int>(sourcetokens[1]));
+        IkParameterizationType iktypetarget = static_cast<IkParameterizationType>(boost::lexical_cast<int>(targettokens[1]));
+        if( iktypetarget != iktypesource ) {
+            return false;
+        }
+        vtransferindices.resize(IkParameterization::GetDOF(iktypetarget));
+        for(size_t i = 0; i < vtransferindices.size(); ++i) {
+            vtransferindices[i] = i;
+        }
+        return true;
+    }
+    // affine groups convert rotations
+    return false;
+}
+
+ConfigurationSpecification::ConversionPlan::ConversionPlan() : _targetdof(0), _sourcedof(0), _bFillUninitialized(true)
+{
+}
+
+ConfigurationSpecification::ConversionPlan::ConversionPlan(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, bool filluninitialized) : _vtargetgroups(targetspec._vgroups), _vsourcegroups(sourcespec._vgroups), _targetdof(targetspec.GetDOF()), _sourcedof(sourcespec.GetDOF()), _bFillUninitialized(filluninitialized)
+{
+    std::vector<int> vtransferindices;
+    for(size_t igroup = 0; igroup < targetspec._vgroups.size(); ++igroup) {
+        const Group& gtarget = targetspec._vgroups[igroup];
+        std::vector<Group>::const_iterator itcompatgroup = sourcespec.FindCompatibleGroup(gtarget);
+        if( itcompatgroup == sourcespec._vgroups.end() ) {
+            if( filluninitialized ) {
+                if( (gtarget.name.size() >= 12 && gtarget.name.substr(0,12) == "joint_values") || (gtarget.name.size() >= 16 && gtarget.name.substr(0,16) == "affine_transform") ) {
+                    // depends on the state of the body at the time of the conversion
+                    _vdynamicgroups.push_back(make_pair((int)igroup, -1));
                 }
-            }
-            else if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
-                string bodyname;
-                int affinedofs;
-                stringstream ss(name.substr(16));
-                ss >> bodyname >> affinedofs;
-                if( !!ss ) {
-                    Transform tdefault;
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            tdefault = body->GetTransform();
-                        }
+                else {
+                    for(int j = 0; j < gtarget.dof; ++j) {
+                        _vconstants.push_back(make_pair(gtarget.offset+j, dReal(0)));
                     }
-                    BOOST_ASSERT((int)vdefaultvalues.size() == RaveGetAffineDOF(affinedofs));
-                    RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),tdefault,affinedofs);
                 }
             }
-            else if( name != "deltatime" ) {
-                // messages are too frequent
-                //RAVELOG_VERBOSE(str(boost::format("cannot initialize unknown group '%s'")%name));
+            continue;
+        }
+
+        const Group& gsource = *itcompatgroup;
+        if( gsource.name == gtarget.name ) {
+            BOOST_ASSERT(gsource.dof==gtarget.dof);
+            for(int j = 0; j < gtarget.dof; ++j) {
+                _AddCopy(gtarget.offset+j, gsource.offset+j);
             }
-            int offset = targetspec._vgroups[igroup].offset;
-            for(size_t i = 0; i < numpoints; ++i, offset += targetspec.GetDOF()) {
-                for(size_t j = 0; j < vdefaultvalues.size(); ++j) {
-                    *(ittargetdata+offset+j) = vdefaultvalues[j];
-                }
+            continue;
+        }
+
+        bool bzerodefaults = false;
+        if( !_GetGroupTransferIndices(gtarget, gsource, vtransferindices, bzerodefaults) ) {
+            _vdynamicgroups.push_back(make_pair((int)igroup, (int)(itcompatgroup-sourcespec._vgroups.begin())));
+            continue;
+        }
+        if( filluninitialized && !bzerodefaults && find(vtransferindices.begin(),vtransferindices.end(),-1) != vtransferindices.end() ) {
+            _vdynamicgroups.push_back(make_pair((int)igroup, (int)(itcompatgroup-sourcespec._vgroups.begin())));
+            continue;
+        }
+        for(size_t j = 0; j < vtransferindices.size(); ++j) {
+            if( vtransferindices[j] >= 0 ) {
+                _AddCopy(gtarget.offset+j, gsource.offset+vtransferindices[j]);
             }
+            else if( filluninitialized ) {
+                _vconstants.push_back(make_pair(gtarget.offset+(int)j, dReal(0)));
+            }
+        }
+    }
+}
+
+bool ConfigurationSpecification::ConversionPlan::IsCompiledFor(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, bool filluninitialized) const
+{
+    return _bFillUninitialized == filluninitialized && _vtargetgroups == targetspec._vgroups && _vsourcegroups == sourcespec._vgroups;
+}
+
+void ConfigurationSpecification::ConversionPlan::Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints, EnvironmentBaseConstPtr penv) const
+{
+    size_t targetoffset = 0, sourceoffset = 0;
+    for(size_t i = 0; i < numpoints; ++i, targetoffset += _targetdof, sourceoffset += _sourcedof) {
+        FOREACHC(itrun, _vcopyruns) {
+            std::vector<dReal>::const_iterator itsource = itsourcedata+sourceoffset+itrun->sourceoffset;
+            std::copy(itsource, itsource+itrun->count, ittargetdata+targetoffset+itrun->targetoffset);
+        }
+        FOREACHC(itconstant, _vconstants) {
+            *(ittargetdata+targetoffset+itconstant->first) = itconstant->second;
+        }
+    }
+    FOREACHC(itgroup, _vdynamicgroups) {
+        const Group& gtarget = _vtargetgroups[itgroup->first];
+        if( itgroup->second >= 0 ) {
+            const Group& gsource = _vsourcegroups[itgroup->second];
+            ConfigurationSpecification::ConvertGroupData(ittargetdata+gtarget.offset, _targetdof, gtarget, itsourcedata+gsource.offset, _sourcedof, gsource, numpoints, penv, _bFillUninitialized);
+        }
+        else {
+            _FillDefaultGroupValues(ittargetdata+gtarget.offset, _targetdof, gtarget, numpoints, penv);
         }
     }
 }
 
+void ConfigurationSpecification::ConversionPlan::_AddCopy(int targetoffset, int sourceoffset)
+{
+    if( _vcopyruns.size() > 0 ) {
+        CopyRun& run = _vcopyruns.back();
+        if( run.targetoffset+run.count == targetoffset && run.sourceoffset+run.count == sourceoffset ) {
+            run.count++;
+            return;
+        }
+    }
+    CopyRun run;
+    run.targetoffset = targetoffset;
+    run.sourceoffset = sourceoffset;
+    run.count = 1;
+    _vcopyruns.push_back(run);
+}
+
 std::string ConfigurationSpecification::GetInterpolationDerivative(const std::string& interpolation, int deriv)
 {
     const static boost::array<std::string,7> s_InterpolationOrder = {{"next","linear","quadratic","cubic","quartic","quintic","sextic"}};
@@ -187,6 +187,7 @@ UserDataPtr IkSolverBase::RegisterFinishCallback(const IkFinishCallbackFn& finis
 
 IkReturnAction IkSolverBase::_CallFilters(std::vector<dReal>& solution, RobotBase::ManipulatorPtr manipulator, const IkParameterization& param, IkReturnPtr filterreturn, int32_t minpriority, int32_t maxpriority)
 {
+    RAVE_TRACE_SCOPE("IkSolverBase::_CallFilters");
     vector<dReal> vtestsolution,vtestsolution2;
     if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
         RobotBasePtr robot = manipulator->GetRobot();
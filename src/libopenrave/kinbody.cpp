@@ -58,8 +58,50 @@ protected:
     boost::function<void()> _fn;
 };
 
+/// \brief gives the shared temporaries of a const function if no other thread is using them, otherwise local temporaries
+template <typename T>
+class CacheBuffers
+{
+public:
+    CacheBuffers(T& cache, boost::mutex& mutex) : _lock(mutex, boost::try_to_lock), _cache(cache) {
+    }
+    T& Get() {
+        return _lock.owns_lock() ? _cache : _localcache;
+    }
+
+protected:
+    boost::unique_lock<boost::mutex> _lock;
+    T& _cache;
+    T _localcache;
+};
+
 typedef boost::shared_ptr<ChangeCallbackData> ChangeCallbackDataPtr;
 
+class UpdateStampCallbackData : public UserData
+{
+public:
+    UpdateStampCallbackData(const boost::function<void()>& callback, KinBodyConstPtr pbody) : _callback(callback), _pweakbody(pbody) {
+    }
+    virtual ~UpdateStampCallbackData() {
+        KinBodyConstPtr pbody = _pweakbody.lock();
+        if( !!pbody ) {
+            boost::unique_lock< boost::shared_mutex > lock(pbody->GetInterfaceMutex());
+            pbody->_listRegisteredUpdateStampCallbacks.erase(_iterator);
+            pbody->_bHasUpdateStampCallbacks = !pbody->_listRegisteredUpdateStampCallbacks.empty();
+            if( !pbody->_bHasUpdateStampCallbacks ) {
+                pbody->_bUpdateStampCallbacksArmed = false;
+            }
+        }
+    }
+
+    list<UserDataWeakPtr>::iterator _iterator;
+    boost::function<void()> _callback;
+protected:
+    boost::weak_ptr<KinBody const> _pweakbody;
+};
+
+typedef boost::shared_ptr<UpdateStampCallbackData> UpdateStampCallbackDataPtr;
+
 ElectricMotorActuatorInfo::ElectricMotorActuatorInfo()
 {
     gear_ratio = 0;
@@ -183,7 +225,10 @@ KinBody::KinBody(InterfaceType type, EnvironmentBasePtr penv) : InterfaceBase(ty
     _bMakeJoinedLinksAdjacent = true;
     _environmentid = 0;
     _nNonAdjacentLinkCache = 0x80000000;
+    _nNonAdjacentLinkStamp = 0;
     _nUpdateStampId = 0;
+    _bHasUpdateStampCallbacks = false;
+    _bUpdateStampCallbacksArmed = false;
 }
 
 KinBody::~KinBody()
@@ -1399,6 +1444,7 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, const Transfo
 
 void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t checklimits, const std::vector<int>& dofindices)
 {
+    PerformanceCounterTimer timer(PCT_SetDOFValues);
     CHECK_INTERNAL_COMPUTATION;
     if( vJointValues.size() == 0 || _veclinks.size() == 0) {
         return;
@@ -1413,6 +1459,7 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
             // user only set a certain number of indices, so have to fill the temporary array with the full set of values first
             // and then overwrite with the user set values
             GetDOFValues(_vTempJoints);
+            _vTempPrevJoints = _vTempJoints;
             for(size_t i = 0; i < dofindices.size(); ++i) {
                 _vTempJoints.at(dofindices[i]) = pJointValues[i];
             }
@@ -1528,6 +1575,28 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
     }
 
     std::vector<uint8_t> vlinkscomputed(_veclinks.size(),0);
+    if( dofindices.size() > 0 && _vClosedLoops.size() == 0 ) {
+        // only the links affected by the joints whose values changed have to be recomputed, the rest keep their transforms
+        std::fill(vlinkscomputed.begin(), vlinkscomputed.end(), 1);
+        for(size_t ijoint = 0; ijoint < _vecjoints.size(); ++ijoint) {
+            int dofindex = _vecjoints[ijoint]->GetDOFIndex();
+            bool bchanged = false;
+            for(int idof = 0; idof < _vecjoints[ijoint]->GetDOF(); ++idof) {
+                if( pJointValues[dofindex+idof] != _vTempPrevJoints.at(dofindex+idof) ) {
+                    bchanged = true;
+                    break;
+                }
+            }
+            if( bchanged ) {
+                const int8_t* paffected = &_vJointsAffectingLinks.at(ijoint*_veclinks.size());
+                for(size_t ilink = 0; ilink < _veclinks.size(); ++ilink) {
+                    if( paffected[ilink] ) {
+                        vlinkscomputed[ilink] = 0;
+                    }
+                }
+            }
+        }
+    }
     vlinkscomputed[0] = 1;
 
     for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
@@ -1535,6 +1604,10 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
         int jointindex = _vTopologicallySortedJointIndicesAll[ijoint];
         int dofindex = pjoint->GetDOFIndex();
         const dReal* pvalues=dofindex >= 0 ? pJointValues + dofindex : NULL;
+        if( dofindex >= 0 && vlinkscomputed[pjoint->GetHierarchyChildLink()->GetIndex()] ) {
+            // the values of passive mimic joints have to be computed since other mimic joints can refer to them
+            continue;
+        }
         if( pjoint->IsMimic() ) {
             for(int i = 0; i < pjoint->GetDOF(); ++i) {
                 if( pjoint->IsMimic(i) ) {
@@ -2616,8 +2689,11 @@ void KinBody::ComputeInverseDynamics(std::vector<dReal>& doftorques, const std::
     }
 
     Vector vgravity = GetEnv()->GetPhysicsEngine()->GetGravity();
-    std::vector<dReal> vDOFVelocities;
-    std::vector<pair<Vector, Vector> > vLinkVelocities, vLinkAccelerations; // linear, angular
+    CacheBuffers<InverseDynamicsCache> buffers(_inversedynamicscache, _mutexInverseDynamicsCache);
+    InverseDynamicsCache& cache = buffers.Get();
+    std::vector<dReal>& vDOFVelocities = cache.vDOFVelocities;
+    std::vector<pair<Vector, Vector> >& vLinkVelocities = cache.vLinkVelocities; // linear, angular
+    std::vector<pair<Vector, Vector> >& vLinkAccelerations = cache.vLinkAccelerations;
     _ComputeDOFLinkVelocities(vDOFVelocities, vLinkVelocities);
     // check if all velocities are 0, if yes, then can simplify some computations since only have contributions from dofacell and external forces
     bool bHasVelocity = false;
@@ -2630,51 +2706,70 @@ void KinBody::ComputeInverseDynamics(std::vector<dReal>& doftorques, const std::
     if( !bHasVelocity ) {
         vDOFVelocities.resize(0);
     }
-    AccelerationMap externalaccelerations;
-    externalaccelerations[0] = make_pair(-vgravity, Vector());
-    AccelerationMapPtr pexternalaccelerations(&externalaccelerations, utils::null_deleter());
+    // the map node is only allocated on the first call
+    cache.externalaccelerations[0] = make_pair(-vgravity, Vector());
+    AccelerationMapPtr pexternalaccelerations(&cache.externalaccelerations, utils::null_deleter());
+    // _ComputeLinkAccelerations accumulates into the accelerations, so start from zero
+    vLinkAccelerations.resize(0);
     _ComputeLinkAccelerations(vDOFVelocities, vDOFAccelerations, vLinkVelocities, vLinkAccelerations, pexternalaccelerations);
 
+    // cache the mass properties of the links for the current transforms since they are used several times in the recursions
+    size_t numlinks = _veclinks.size();
+    cache.vLinkMasses.resize(numlinks);
+    cache.vLinkGlobalCOMs.resize(numlinks);
+    cache.vLinkGlobalInertias.resize(numlinks);
+    for(size_t i = 0; i < numlinks; ++i) {
+        const Link& link = *_veclinks[i];
+        cache.vLinkMasses[i] = link.GetMass();
+        cache.vLinkGlobalCOMs[i] = link.GetGlobalCOM();
+        cache.vLinkGlobalInertias[i] = link.GetGlobalInertia();
+    }
+
     // all valuess are in the global coordinate system
     // Given the velocity/acceleration of the object is on point A, to change to B do:
     // v_B = v_A + angularvel x (B-A)
     // a_B = a_A + angularaccel x (B-A) + angularvel x (angularvel x (B-A))
     // forward recursion
-    std::vector<Vector> vLinkCOMLinearAccelerations(_veclinks.size()), vLinkCOMMomentOfInertia(_veclinks.size());
+    std::vector<Vector>& vLinkCOMLinearAccelerations = cache.vLinkCOMLinearAccelerations;
+    std::vector<Vector>& vLinkCOMMomentOfInertia = cache.vLinkCOMMomentOfInertia;
+    vLinkCOMLinearAccelerations.resize(numlinks);
+    vLinkCOMMomentOfInertia.resize(numlinks);
     for(size_t i = 0; i < vLinkVelocities.size(); ++i) {
-        Vector vglobalcomfromlink = _veclinks.at(i)->GetGlobalCOM() - _veclinks.at(i)->_info._t.trans;
-        Vector vangularaccel = vLinkAccelerations.at(i).second;
-        Vector vangularvelocity = vLinkVelocities.at(i).second;
-        vLinkCOMLinearAccelerations[i] = vLinkAccelerations.at(i).first + vangularaccel.cross(vglobalcomfromlink) + vangularvelocity.cross(vangularvelocity.cross(vglobalcomfromlink));
-        TransformMatrix tm = _veclinks.at(i)->GetGlobalInertia();
+        Vector vglobalcomfromlink = cache.vLinkGlobalCOMs[i] - _veclinks[i]->_info._t.trans;
+        const Vector& vangularaccel = vLinkAccelerations[i].second;
+        const Vector& vangularvelocity = vLinkVelocities[i].second;
+        vLinkCOMLinearAccelerations[i] = vLinkAccelerations[i].first + vangularaccel.cross(vglobalcomfromlink) + vangularvelocity.cross(vangularvelocity.cross(vglobalcomfromlink));
+        const TransformMatrix& tm = cache.vLinkGlobalInertias[i];
         vLinkCOMMomentOfInertia[i] = tm.rotate(vangularaccel) + vangularvelocity.cross(tm.rotate(vangularvelocity));
     }
 
     // backward recursion
-    std::vector< std::pair<Vector, Vector> > vLinkForceTorques(_veclinks.size());
+    std::vector< std::pair<Vector, Vector> >& vLinkForceTorques = cache.vLinkForceTorques;
+    vLinkForceTorques.resize(0);
+    vLinkForceTorques.resize(numlinks);
     FOREACHC(it,mapExternalForceTorque) {
         vLinkForceTorques.at(it->first) = it->second;
     }
     std::fill(doftorques.begin(),doftorques.end(),0);
 
-    std::vector<std::pair<int,dReal> > vpartials;
+    std::vector<std::pair<int,dReal> >& vpartials = cache.vpartials;
     std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
 
     // go backwards
     for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
-        JointPtr pjoint = _vTopologicallySortedJointsAll.at(_vTopologicallySortedJointsAll.size()-1-ijoint);
+        const JointPtr& pjoint = _vTopologicallySortedJointsAll[_vTopologicallySortedJointsAll.size()-1-ijoint];
         int childindex = pjoint->GetHierarchyChildLink()->GetIndex();
-        Vector vcomforce = vLinkCOMLinearAccelerations[childindex]*pjoint->GetHierarchyChildLink()->GetMass() + vLinkForceTorques.at(childindex).first;
-        Vector vjointtorque = vLinkForceTorques.at(childindex).second + vLinkCOMMomentOfInertia.at(childindex);
+        Vector vcomforce = vLinkCOMLinearAccelerations[childindex]*cache.vLinkMasses[childindex] + vLinkForceTorques[childindex].first;
+        Vector vjointtorque = vLinkForceTorques[childindex].second + vLinkCOMMomentOfInertia[childindex];
 
         if( !!pjoint->GetHierarchyParentLink() ) {
-            Vector vchildcomtoparentcom = pjoint->GetHierarchyChildLink()->GetGlobalCOM() - pjoint->GetHierarchyParentLink()->GetGlobalCOM();
             int parentindex = pjoint->GetHierarchyParentLink()->GetIndex();
-            vLinkForceTorques.at(parentindex).first += vcomforce;
-            vLinkForceTorques.at(parentindex).second += vjointtorque + vchildcomtoparentcom.cross(vcomforce);
+            Vector vchildcomtoparentcom = cache.vLinkGlobalCOMs[childindex] - cache.vLinkGlobalCOMs[parentindex];
+            vLinkForceTorques[parentindex].first += vcomforce;
+            vLinkForceTorques[parentindex].second += vjointtorque + vchildcomtoparentcom.cross(vcomforce);
         }
 
-        Vector vcomtoanchor = pjoint->GetHierarchyChildLink()->GetGlobalCOM() - pjoint->GetAnchor();
+        Vector vcomtoanchor = cache.vLinkGlobalCOMs[childindex] - pjoint->GetAnchor();
         if( pjoint->GetDOFIndex() >= 0 ) {
             if( pjoint->GetType() == JointHinge ) {
                 doftorques.at(pjoint->GetDOFIndex()) += pjoint->GetAxis(0).dot3(vjointtorque + vcomtoanchor.cross(vcomforce));
@@ -2968,7 +3063,9 @@ void KinBody::_ComputeLinkAccelerations(const std::vector<dReal>& vDOFVelocities
         return;
     }
 
-    vector<dReal> vtempvalues, veval;
+    CacheBuffers<LinkAccelerationsCache> buffers(_linkaccelerationscache, _mutexLinkAccelerationsCache);
+    LinkAccelerationsCache& cache = buffers.Get();
+    vector<dReal>& vtempvalues = cache.vtempvalues, &veval = cache.veval;
     boost::array<dReal,3> dummyvelocities = {{0,0,0}}, dummyaccelerations={{0,0,0}}; // dummy values for a joint
 
     // set accelerations of all links as if they were the base link
@@ -2985,24 +3082,34 @@ void KinBody::_ComputeLinkAccelerations(const std::vector<dReal>& vDOFVelocities
     }
 
     // have to compute the velocities and accelerations ahead of time since they are dependent on the link transformations
-    std::vector< std::vector<dReal> > vPassiveJointVelocities(_vPassiveJoints.size()), vPassiveJointAccelerations(_vPassiveJoints.size());
+    // the buffers are reused between calls, so every entry has to be reset
+    std::vector< std::vector<dReal> >& vPassiveJointVelocities = cache.vPassiveJointVelocities, &vPassiveJointAccelerations = cache.vPassiveJointAccelerations;
+    vPassiveJointVelocities.resize(_vPassiveJoints.size());
+    vPassiveJointAccelerations.resize(_vPassiveJoints.size());
     for(size_t i = 0; i <_vPassiveJoints.size(); ++i) {
         if( vDOFAccelerations.size() > 0 ) {
-            vPassiveJointAccelerations[i].resize(_vPassiveJoints[i]->GetDOF(),0);
+            vPassiveJointAccelerations[i].assign(_vPassiveJoints[i]->GetDOF(),0);
+        }
+        else {
+            vPassiveJointAccelerations[i].resize(0);
         }
         if( vDOFVelocities.size() > 0 ) {
             if( !_vPassiveJoints[i]->IsMimic() ) {
                 _vPassiveJoints[i]->GetVelocities(vPassiveJointVelocities[i]);
             }
             else {
-                vPassiveJointVelocities[i].resize(_vPassiveJoints[i]->GetDOF(),0);
+                vPassiveJointVelocities[i].assign(_vPassiveJoints[i]->GetDOF(),0);
             }
         }
+        else {
+            vPassiveJointVelocities[i].resize(0);
+        }
     }
 
     Transform tdelta;
     Vector vlocalaxis;
-    std::vector<uint8_t> vlinkscomputed(_veclinks.size(),0);
+    std::vector<uint8_t>& vlinkscomputed = cache.vlinkscomputed;
+    vlinkscomputed.assign(_veclinks.size(),0);
     vlinkscomputed[0] = 1;
 
     // compute the link accelerations going through topological order
@@ -3195,6 +3302,8 @@ CollisionCheckerBasePtr KinBody::GetSelfCollisionChecker() const
 
 bool KinBody::CheckSelfCollision(CollisionReportPtr report, CollisionCheckerBasePtr collisionchecker) const
 {
+    PerformanceCounterTimer timer(PCT_CheckSelfCollision);
+    RAVE_TRACE_SCOPE("KinBody::CheckSelfCollision");
     if( !collisionchecker ) {
         collisionchecker = _selfcollisionchecker;
         if( !collisionchecker ) {
@@ -4286,7 +4395,7 @@ private:
         for(size_t i = 0; i < _veclinks.size(); ++i) {
             boost::static_pointer_cast<Link>(_veclinks[i])->_info._t = _vInitialLinkTransformations.at(i);
         }
-        _nUpdateStampId++; // because transforms were modified
+        _IncrementUpdateStamp(); // because transforms were modified
         for(size_t i = 0; i < _veclinks.size(); ++i) {
             for(size_t j = i+1; j < _veclinks.size(); ++j) {
                 if((_setAdjacentLinks.find(i|(j<<16)) == _setAdjacentLinks.end())&& !collisionchecker->CheckCollision(LinkConstPtr(_veclinks[i]), LinkConstPtr(_veclinks[j])) ) {
@@ -4294,8 +4403,9 @@ private:
                 }
             }
         }
-        _nUpdateStampId++; // because transforms were modified
+        _IncrementUpdateStamp(); // because transforms were modified
         _nNonAdjacentLinkCache = 0;
+        ++_nNonAdjacentLinkStamp;
     }
     if( (_nNonAdjacentLinkCache&adjacentoptions) != adjacentoptions ) {
         int requestedoptions = (~_nNonAdjacentLinkCache)&adjacentoptions;
@@ -4309,6 +4419,7 @@ private:
                 }
             }
             _nNonAdjacentLinkCache |= AO_Enabled;
+            ++_nNonAdjacentLinkStamp;
         }
         else {
             throw OPENRAVE_EXCEPTION_FORMAT("no support for adjacentoptions %d", adjacentoptions,ORE_InvalidArguments);
@@ -4317,6 +4428,25 @@ private:
     return _setNonAdjacentLinks.at(adjacentoptions);
 }
 
+const KinBody::NonAdjacentLinkPairs& KinBody::GetNonAdjacentLinkPairs(int adjacentoptions) const
+{
+    const std::set<int>& setpairs = GetNonAdjacentLinks(adjacentoptions);
+    NonAdjacentLinkPairs& pairs = _vNonAdjacentLinkPairs.at(adjacentoptions);
+    if( pairs._nStamp != _nNonAdjacentLinkStamp || pairs._nLinks != (int)_veclinks.size() ) {
+        pairs._nLinks = _veclinks.size();
+        pairs._vpairs.resize(0);
+        pairs._vpairs.insert(pairs._vpairs.end(), setpairs.begin(), setpairs.end());
+        pairs._vmask.resize(0);
+        pairs._vmask.resize((pairs._nLinks*pairs._nLinks+63)>>6, 0);
+        FOREACHC(itpair, pairs._vpairs) {
+            size_t bit = (*itpair&0xffff)*pairs._nLinks + (*itpair>>16);
+            pairs._vmask[bit>>6] |= (uint64_t)1<<(bit&63);
+        }
+        pairs._nStamp = _nNonAdjacentLinkStamp;
+    }
+    return pairs;
+}
+
 const std::set<int>& KinBody::GetAdjacentLinks() const
 {
     CHECK_INTERNAL_COMPUTATION;
@@ -4431,12 +4561,12 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
 
     // cache
     _ResetInternalCollisionCache();
-    _nUpdateStampId++; // update the stamp instead of copying
+    _IncrementUpdateStamp(); // update the stamp instead of copying
 }
 
 void KinBody::_PostprocessChangedParameters(uint32_t parameters)
 {
-    _nUpdateStampId++;
+    _IncrementUpdateStamp();
     if( _nHierarchyComputed == 1 ) {
         _nParametersChanged |= parameters;
         return;
@@ -4592,4 +4722,40 @@ UserDataPtr KinBody::RegisterChangeCallback(uint32_t properties, const boost::fu
     return pdata;
 }
 
+UserDataPtr KinBody::RegisterUpdateStampCallback(const boost::function<void()>& callback) const
+{
+    UpdateStampCallbackDataPtr pdata(new UpdateStampCallbackData(callback,shared_kinbody_const()));
+    boost::unique_lock< boost::shared_mutex > lock(GetInterfaceMutex());
+    pdata->_iterator = _listRegisteredUpdateStampCallbacks.insert(_listRegisteredUpdateStampCallbacks.end(),pdata);
+    _bHasUpdateStampCallbacks = true;
+    _bUpdateStampCallbacksArmed = true;
+    return pdata;
+}
+
+void KinBody::_CallUpdateStampCallbacks() const
+{
+    // the callbacks are called without the lock since they can register or release handles, and releasing the last
+    // reference of a handle locks the interface mutex
+    std::vector<UpdateStampCallbackDataPtr> vcallbacks;
+    {
+        boost::unique_lock< boost::shared_mutex > lock(GetInterfaceMutex());
+        if( !_bUpdateStampCallbacksArmed ) {
+            // another thread called them since the last arming
+            return;
+        }
+        // disarm before calling so that the stamp changes made until the next ArmUpdateStampCallbacks do not call them again
+        _bUpdateStampCallbacksArmed = false;
+        vcallbacks.reserve(_listRegisteredUpdateStampCallbacks.size());
+        FOREACH(it, _listRegisteredUpdateStampCallbacks) {
+            UpdateStampCallbackDataPtr pdata = boost::dynamic_pointer_cast<UpdateStampCallbackData>(it->lock());
+            if( !!pdata ) {
+                vcallbacks.push_back(pdata);
+            }
+        }
+    }
+    FOREACH(it, vcallbacks) {
+        (*it)->_callback();
+    }
+}
+
 } // end namespace OpenRAVE
@@ -283,7 +283,7 @@ void KinBody::Link::SetStatic(bool bStatic)
 void KinBody::Link::SetTransform(const Transform& t)
 {
     _info._t = t;
-    GetParent()->_nUpdateStampId++;
+    GetParent()->_IncrementUpdateStamp();
 }
 
 void KinBody::Link::SetForce(const Vector& force, const Vector& pos, bool bAdd)
@@ -19,12 +19,18 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/utility.hpp>
 #include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/thread/condition.hpp>
+#if BOOST_VERSION >= 105300
+#include <boost/atomic.hpp>
+#endif
 
 #include <streambuf>
 
 #ifndef _WIN32
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <syslog.h>
 #endif
 
 #include <locale>
@@ -974,6 +980,8 @@ UserDataPtr RaveGlobalState()
 void RaveDestroy()
 {
     RaveGlobal::instance()->Destroy();
+    // write the messages logged by the destroyed environments and plugins
+    RaveFlushLog();
 }
 
 void RaveAddCallbackForDestroy(const boost::function<void()>& fn)
@@ -1160,6 +1168,924 @@ int RaveGetDataAccess()
     return RaveGlobal::instance()->GetDataAccess();
 }
 
+/// the counts of one thread, only the owning thread adds to them
+///
+/// With boost::atomic (boost 1.53 and later) adding is a relaxed atomic increment on counters that no other thread writes,
+/// so it never waits on readers. Older boost versions fall back to a mutex per block, which is only contended while the
+/// counters are queried or reset.
+class PerformanceCounterBlock
+{
+public:
+    PerformanceCounterBlock() {
+        Reset();
+    }
+    void Add(PerformanceCounterType type, uint64_t calls, uint64_t nanoseconds) {
+#if BOOST_VERSION >= 105300
+        _vcalls[type].fetch_add(calls, boost::memory_order_relaxed);
+        _vnanoseconds[type].fetch_add(nanoseconds, boost::memory_order_relaxed);
+#else
+        boost::mutex::scoped_lock lock(_mutex);
+        _vcalls[type] += calls;
+        _vnanoseconds[type] += nanoseconds;
+#endif
+    }
+    void Reset() {
+#if BOOST_VERSION >= 105300
+        for(int i = 0; i < PCT_NumCounters; ++i) {
+            _vcalls[i].store(0, boost::memory_order_relaxed);
+            _vnanoseconds[i].store(0, boost::memory_order_relaxed);
+        }
+#else
+        boost::mutex::scoped_lock lock(_mutex);
+        for(int i = 0; i < PCT_NumCounters; ++i) {
+            _vcalls[i] = 0;
+            _vnanoseconds[i] = 0;
+        }
+#endif
+    }
+    void AddTo(std::vector<uint64_t>& vcalls, std::vector<uint64_t>& vnanoseconds) const {
+#if BOOST_VERSION >= 105300
+        for(int i = 0; i < PCT_NumCounters; ++i) {
+            vcalls[i] += _vcalls[i].load(boost::memory_order_relaxed);
+            vnanoseconds[i] += _vnanoseconds[i].load(boost::memory_order_relaxed);
+        }
+#else
+        boost::mutex::scoped_lock lock(_mutex);
+        for(int i = 0; i < PCT_NumCounters; ++i) {
+            vcalls[i] += _vcalls[i];
+            vnanoseconds[i] += _vnanoseconds[i];
+        }
+#endif
+    }
+
+private:
+#if BOOST_VERSION >= 105300
+    boost::atomic<uint64_t> _vcalls[PCT_NumCounters], _vnanoseconds[PCT_NumCounters];
+#else
+    mutable boost::mutex _mutex;
+    uint64_t _vcalls[PCT_NumCounters], _vnanoseconds[PCT_NumCounters];
+#endif
+};
+
+/// holds the blocks of all threads that have added to the counters, the counts of exited threads are moved to _retired
+class PerformanceCounters
+{
+public:
+    PerformanceCounters() : _bEnabled(false), _threadblock(PerformanceCounters::_ReleaseThreadBlock) {
+    }
+
+    void Add(PerformanceCounterType type, uint64_t nanoseconds) {
+        PerformanceCounterBlock* pblock = _threadblock.get();
+        if( !pblock ) {
+            pblock = new PerformanceCounterBlock();
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                _listblocks.push_back(pblock);
+            }
+            _threadblock.reset(pblock);
+        }
+        pblock->Add(type, 1, nanoseconds);
+    }
+
+    void Get(std::vector<uint64_t>& vcalls, std::vector<uint64_t>& vnanoseconds) {
+        vcalls.resize(PCT_NumCounters);
+        vnanoseconds.resize(PCT_NumCounters);
+        std::fill(vcalls.begin(), vcalls.end(), 0);
+        std::fill(vnanoseconds.begin(), vnanoseconds.end(), 0);
+        boost::mutex::scoped_lock lock(_mutex);
+        _retired.AddTo(vcalls, vnanoseconds);
+        FOREACHC(itblock, _listblocks) {
+            (*itblock)->AddTo(vcalls, vnanoseconds);
+        }
+    }
+
+    void Reset() {
+        boost::mutex::scoped_lock lock(_mutex);
+        _retired.Reset();
+        FOREACH(itblock, _listblocks) {
+            (*itblock)->Reset();
+        }
+    }
+
+    volatile bool _bEnabled;
+
+private:
+    static void _ReleaseThreadBlock(PerformanceCounterBlock* pblock);
+
+    boost::mutex _mutex; ///< protects _listblocks and _retired
+    std::list<PerformanceCounterBlock*> _listblocks;
+    PerformanceCounterBlock _retired;
+    boost::thread_specific_ptr<PerformanceCounterBlock> _threadblock; ///< declared last so the block of the destroying thread is released while the list still exists
+};
+
+static PerformanceCounters s_performancecounters;
+
+void PerformanceCounters::_ReleaseThreadBlock(PerformanceCounterBlock* pblock)
+{
+    {
+        boost::mutex::scoped_lock lock(s_performancecounters._mutex);
+        s_performancecounters._listblocks.remove(pblock);
+        std::vector<uint64_t> vcalls(PCT_NumCounters,0), vnanoseconds(PCT_NumCounters,0);
+        pblock->AddTo(vcalls, vnanoseconds);
+        for(int i = 0; i < PCT_NumCounters; ++i) {
+            s_performancecounters._retired.Add((PerformanceCounterType)i, vcalls[i], vnanoseconds[i]);
+        }
+    }
+    delete pblock;
+}
+
+void RaveSetPerformanceCounters(bool bEnable)
+{
+    s_performancecounters._bEnabled = bEnable;
+}
+
+bool RaveIsPerformanceCountersEnabled()
+{
+    return s_performancecounters._bEnabled;
+}
+
+void RaveResetPerformanceCounters()
+{
+    s_performancecounters.Reset();
+}
+
+void RaveGetPerformanceCounters(std::vector<uint64_t>& vcalls, std::vector<uint64_t>& vnanoseconds)
+{
+    s_performancecounters.Get(vcalls, vnanoseconds);
+}
+
+const char* RaveGetPerformanceCounterName(PerformanceCounterType type)
+{
+    switch(type) {
+    case PCT_CheckCollision: return "CheckCollision";
+    case PCT_CheckCollisionRay: return "CheckCollisionRay";
+    case PCT_CheckSelfCollision: return "CheckSelfCollision";
+    case PCT_SetDOFValues: return "SetDOFValues";
+    case PCT_IkSolve: return "IkSolve";
+    case PCT_PlannerCallbacks: return "PlannerCallbacks";
+    case PCT_TrajectorySample: return "TrajectorySample";
+    default: return "";
+    }
+}
+
+void RaveWritePerformanceCounters(std::ostream& os)
+{
+    std::vector<uint64_t> vcalls, vnanoseconds;
+    s_performancecounters.Get(vcalls, vnanoseconds);
+    os << "# name calls total_s mean_us" << std::endl;
+    for(int i = 0; i < PCT_NumCounters; ++i) {
+        double fmean = vcalls[i] > 0 ? 1e-3*double(vnanoseconds[i])/double(vcalls[i]) : 0;
+        os << RaveGetPerformanceCounterName((PerformanceCounterType)i) << " " << vcalls[i] << " " << str(boost::format("%.6f %.3f")%(1e-9*double(vnanoseconds[i]))%fmean) << std::endl;
+    }
+}
+
+PerformanceCounterTimer::PerformanceCounterTimer(PerformanceCounterType type) : _starttime(0), _type(type)
+{
+    if( s_performancecounters._bEnabled ) {
+        _starttime = utils::GetNanoPerformanceTime();
+    }
+}
+
+PerformanceCounterTimer::~PerformanceCounterTimer()
+{
+    if( _starttime > 0 ) {
+        s_performancecounters.Add(_type, utils::GetNanoPerformanceTime()-_starttime);
+    }
+}
+
+/// a scope recorded by TraceScope
+struct TraceEvent
+{
+    const char* name;
+    uint64_t starttime, endtime;
+};
+
+/// the ring buffer of one thread, only the owning thread adds to it
+class TraceBuffer
+{
+public:
+    TraceBuffer(int threadid, int nevents) : _threadid(threadid), _nextindex(0), _bWrapped(false) {
+        _vevents.resize(max(nevents,1));
+    }
+    void Clear() {
+        _nextindex = 0;
+        _bWrapped = false;
+    }
+
+    boost::mutex _mutex; ///< only contended when the events are written or cleared
+    std::vector<TraceEvent> _vevents;
+    int _threadid;
+    size_t _nextindex; ///< where the next event is stored
+    bool _bWrapped; ///< if true, all events are valid and the oldest one is at _nextindex
+};
+
+/// holds the ring buffers of all threads. The buffers of exited threads are kept so that short lived worker threads
+/// still show up in the trace, up to a maximum number.
+class TraceBuffers
+{
+public:
+    TraceBuffers() : _bEnabled(false), _neventsperthread(65536), _nextthreadid(1), _threadbuffer(TraceBuffers::_ReleaseThreadBuffer) {
+    }
+
+    void Add(const char* name, uint64_t starttime, uint64_t endtime) {
+        TraceBuffer* pbuffer = _threadbuffer.get();
+        if( !pbuffer ) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                pbuffer = new TraceBuffer(_nextthreadid++, _neventsperthread);
+                _listbuffers.push_back(pbuffer);
+            }
+            _threadbuffer.reset(pbuffer);
+        }
+        boost::mutex::scoped_lock lock(pbuffer->_mutex);
+        TraceEvent& event = pbuffer->_vevents[pbuffer->_nextindex];
+        event.name = name;
+        event.starttime = starttime;
+        event.endtime = endtime;
+        if( ++pbuffer->_nextindex >= pbuffer->_vevents.size() ) {
+            pbuffer->_nextindex = 0;
+            pbuffer->_bWrapped = true;
+        }
+    }
+
+    void Clear() {
+        boost::mutex::scoped_lock lock(_mutex);
+        FOREACH(itbuffer, _listbuffers) {
+            boost::mutex::scoped_lock bufferlock((*itbuffer)->_mutex);
+            (*itbuffer)->Clear();
+        }
+        FOREACH(itbuffer, _listretired) {
+            delete *itbuffer;
+        }
+        _listretired.clear();
+    }
+
+    void Write(std::ostream& os) {
+        os << "{\"traceEvents\":[";
+        bool bfirst = true;
+        boost::mutex::scoped_lock lock(_mutex);
+        FOREACHC(itbuffer, _listretired) {
+            _WriteBuffer(os, **itbuffer, bfirst);
+        }
+        FOREACHC(itbuffer, _listbuffers) {
+            _WriteBuffer(os, **itbuffer, bfirst);
+        }
+        os << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+    }
+
+    volatile bool _bEnabled;
+    int _neventsperthread;
+
+private:
+    static void _ReleaseThreadBuffer(TraceBuffer* pbuffer);
+
+    static void _WriteBuffer(std::ostream& os, TraceBuffer& buffer, bool& bfirst) {
+        boost::mutex::scoped_lock lock(buffer._mutex);
+        size_t nevents = buffer._bWrapped ? buffer._vevents.size() : buffer._nextindex;
+        size_t startindex = buffer._bWrapped ? buffer._nextindex : 0;
+        for(size_t i = 0; i < nevents; ++i) {
+            const TraceEvent& event = buffer._vevents[(startindex+i)%buffer._vevents.size()];
+            if( !bfirst ) {
+                os << ",";
+            }
+            bfirst = false;
+            // chrome expects microseconds
+            os << "\n{\"name\":\"" << event.name << "\",\"cat\":\"openrave\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer._threadid << str(boost::format(",\"ts\":%.3f,\"dur\":%.3f}")%(1e-3*double(event.starttime))%(1e-3*double(event.endtime-event.starttime)));
+        }
+    }
+
+    boost::mutex _mutex; ///< protects the lists
+    std::list<TraceBuffer*> _listbuffers, _listretired;
+    int _nextthreadid;
+    boost::thread_specific_ptr<TraceBuffer> _threadbuffer; ///< declared last so the buffer of the destroying thread is retired while the lists still exist
+};
+
+static TraceBuffers s_tracebuffers;
+static const size_t s_nMaxRetiredTraceBuffers = 64;
+
+void TraceBuffers::_ReleaseThreadBuffer(TraceBuffer* pbuffer)
+{
+    boost::mutex::scoped_lock lock(s_tracebuffers._mutex);
+    s_tracebuffers._listbuffers.remove(pbuffer);
+    s_tracebuffers._listretired.push_back(pbuffer);
+    while( s_tracebuffers._listretired.size() > s_nMaxRetiredTraceBuffers ) {
+        delete s_tracebuffers._listretired.front();
+        s_tracebuffers._listretired.pop_front();
+    }
+}
+
+void RaveSetTracing(bool bEnable, int neventsperthread)
+{
+    s_tracebuffers._neventsperthread = neventsperthread;
+    s_tracebuffers._bEnabled = bEnable;
+}
+
+bool RaveIsTracingEnabled()
+{
+    return s_tracebuffers._bEnabled;
+}
+
+void RaveClearTrace()
+{
+    s_tracebuffers.Clear();
+}
+
+void RaveWriteChromeTrace(std::ostream& os)
+{
+    s_tracebuffers.Write(os);
+}
+
+TraceScope::TraceScope(const char* name) : _name(name), _starttime(0)
+{
+    if( s_tracebuffers._bEnabled ) {
+        _starttime = utils::GetNanoPerformanceTime();
+    }
+}
+
+TraceScope::~TraceScope()
+{
+    if( _starttime > 0 ) {
+        s_tracebuffers.Add(_name, _starttime, utils::GetNanoPerformanceTime());
+    }
+}
+
+#ifndef va_copy
+#define va_copy(dest,src) ((dest) = (src))
+#endif
+
+static const char* s_logLevelNames[] = { "FATAL", "ERROR", "WARN", "INFO", "DEBUG", "VERBOSE" };
+
+/// the messages logged by one thread waiting for the logging thread
+///
+/// A ring buffer with one producer, the owning thread, and one consumer, the thread holding AsyncLogger::_mutexdrain.
+/// The producer fills the record at _tail and then publishes it by advancing _tail, the consumer copies the records up
+/// to _tail and then hands their slots back by advancing _head. With boost::atomic (boost 1.53 and later) the indices
+/// are atomics and neither side ever waits. Older boost versions fall back to a mutex around the index accesses only.
+class LogQueue
+{
+public:
+    LogQueue(int threadid, size_t nrecords) : _threadid(threadid), _psourcefilename(NULL), _sourceline(0), _psourcefunction(NULL), _vrecords(nrecords), _head(0), _tail(0), _ndropped(0) {
+    }
+
+    /// \brief returns the record to fill for the next message, or NULL if the queue is full. Only called by the owning thread.
+    LogRecord* BeginPush() {
+        size_t tail = _LoadTail();
+        if( tail - _LoadHead() >= _vrecords.size() ) {
+            _AddDropped();
+            return NULL;
+        }
+        return &_vrecords[tail % _vrecords.size()];
+    }
+
+    /// \brief makes the record returned by BeginPush visible to the consumer, returns the number of queued records
+    size_t EndPush() {
+        size_t tail = _LoadTail()+1;
+        _StoreTail(tail);
+        return tail - _LoadHead();
+    }
+
+    /// \brief appends the queued records to vrecords and returns the number of messages dropped since the last call
+    size_t Pop(std::vector<LogRecord>& vrecords) {
+        size_t head = _LoadHead(), tail = _LoadTail();
+        for(size_t i = head; i != tail; ++i) {
+            vrecords.push_back(_vrecords[i % _vrecords.size()]);
+        }
+        _StoreHead(tail);
+        return _ExchangeDropped();
+    }
+
+    size_t GetCapacity() const {
+        return _vrecords.size();
+    }
+
+    int _threadid;
+    // source location set by RaveSetLogSource for the next message, only accessed by the owning thread
+    const char* _psourcefilename;
+    int _sourceline;
+    const char* _psourcefunction;
+
+private:
+#if BOOST_VERSION >= 105300
+    size_t _LoadHead() const {
+        return _head.load(boost::memory_order_acquire);
+    }
+    size_t _LoadTail() const {
+        return _tail.load(boost::memory_order_acquire);
+    }
+    void _StoreHead(size_t head) {
+        _head.store(head, boost::memory_order_release);
+    }
+    void _StoreTail(size_t tail) {
+        _tail.store(tail, boost::memory_order_release);
+    }
+    void _AddDropped() {
+        _ndropped.fetch_add(1, boost::memory_order_relaxed);
+    }
+    size_t _ExchangeDropped() {
+        return _ndropped.exchange(0, boost::memory_order_relaxed);
+    }
+#else
+    size_t _LoadHead() const {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _head;
+    }
+    size_t _LoadTail() const {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _tail;
+    }
+    void _StoreHead(size_t head) {
+        boost::mutex::scoped_lock lock(_mutex);
+        _head = head;
+    }
+    void _StoreTail(size_t tail) {
+        boost::mutex::scoped_lock lock(_mutex);
+        _tail = tail;
+    }
+    void _AddDropped() {
+        boost::mutex::scoped_lock lock(_mutex);
+        _ndropped++;
+    }
+    size_t _ExchangeDropped() {
+        boost::mutex::scoped_lock lock(_mutex);
+        size_t ndropped = _ndropped;
+        _ndropped = 0;
+        return ndropped;
+    }
+#endif
+
+    std::vector<LogRecord> _vrecords; ///< fixed size, record i is stored at i % size
+#if BOOST_VERSION >= 105300
+    boost::atomic<size_t> _head, _tail; ///< indices of the oldest queued record and of the next record to fill, never wrapped
+    boost::atomic<size_t> _ndropped; ///< number of messages dropped because the queue was full
+#else
+    mutable boost::mutex _mutex;
+    size_t _head, _tail, _ndropped;
+#endif
+};
+
+/// holds the queues of all threads and the logging thread that drains them
+class AsyncLogger
+{
+    /// the number of messages written from one log statement in the current second
+    struct RepeatState
+    {
+        RepeatState() : windowstart(0), count(0), nsuppressed(0), level(0) {
+        }
+        uint64_t windowstart;
+        int count, nsuppressed;
+        uint32_t level;
+    };
+
+public:
+    AsyncLogger() : _bEnabled(false), _nrepeatlimit(0), _nrecordsperthread(4096), _bStopThread(false), _bWakeThread(false), _nextthreadid(1), _threadqueue(AsyncLogger::_ReleaseThreadQueue) {
+    }
+    virtual ~AsyncLogger() {
+        SetEnabled(false, 0, _nrecordsperthread);
+    }
+
+    void SetEnabled(bool bEnable, int nrepeatlimit, int nrecordsperthread) {
+        boost::mutex::scoped_lock lock(_mutexthread);
+        _nrepeatlimit = nrepeatlimit;
+        _nrecordsperthread = max(nrecordsperthread,1);
+        if( bEnable ) {
+            if( !_threadlog ) {
+                _bStopThread = false;
+                _threadlog.reset(new boost::thread(boost::bind(&AsyncLogger::_LogThread, this)));
+            }
+            _bEnabled = true;
+        }
+        else {
+            _bEnabled = false;
+            if( !!_threadlog ) {
+                {
+                    boost::mutex::scoped_lock wakelock(_mutexwake);
+                    _bStopThread = true;
+                    _condwake.notify_one();
+                }
+                _threadlog->join();
+                _threadlog.reset();
+            }
+            Drain(true);
+        }
+    }
+
+    LogQueue* GetThreadQueue() {
+        LogQueue* pqueue = _threadqueue.get();
+        if( !pqueue ) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                pqueue = new LogQueue(_nextthreadid++, _nrecordsperthread);
+                _listqueues.push_back(pqueue);
+            }
+            _threadqueue.reset(pqueue);
+        }
+        return pqueue;
+    }
+
+    void Add(uint32_t level, const std::string& message) {
+        LogQueue* pqueue = GetThreadQueue();
+        const char* psourcefilename = pqueue->_psourcefilename;
+        pqueue->_psourcefilename = NULL;
+        LogRecord* precord = pqueue->BeginPush();
+        if( !precord ) {
+            return;
+        }
+        // the record is reused, so every field has to be set
+        precord->level = level;
+        precord->timestamp = utils::GetNanoPerformanceTime();
+        precord->threadid = pqueue->_threadid;
+        if( psourcefilename != NULL ) {
+            precord->sourcefilename = RaveGetSourceFilename(psourcefilename);
+            precord->line = pqueue->_sourceline;
+            precord->function = pqueue->_psourcefunction;
+        }
+        else {
+            precord->sourcefilename.resize(0);
+            precord->line = 0;
+            precord->function.resize(0);
+        }
+        precord->message = message;
+        size_t nqueued = pqueue->EndPush();
+        if( level <= Level_Error || nqueued == pqueue->GetCapacity()/2+1 ) {
+            // errors should show up right away and a filling queue should not wait for the backed off logging thread
+            boost::mutex::scoped_lock wakelock(_mutexwake);
+            _bWakeThread = true;
+            _condwake.notify_one();
+        }
+    }
+
+    /// \brief writes the queued messages to the sinks
+    ///
+    /// \param bFlush if true, the repeated messages suppressed so far are reported and the sinks are flushed
+    /// \return the number of messages taken from the queues
+    size_t Drain(bool bFlush) {
+        boost::mutex::scoped_lock drainlock(_mutexdrain);
+        std::list<LogSinkPtr> listsinks;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            FOREACH(itqueue, _listqueues) {
+                _SwapQueue(**itqueue);
+            }
+            FOREACH(itqueue, _listexited) {
+                _SwapQueue(**itqueue);
+                delete *itqueue;
+            }
+            _listexited.clear();
+            listsinks = _listsinks;
+        }
+        // each queue is ordered by time already
+        std::stable_sort(_vdrained.begin(), _vdrained.end(), AsyncLogger::_CompareTimestamp);
+        uint64_t curtime = utils::GetNanoPerformanceTime();
+        FOREACHC(itrecord, _vdrained) {
+            if( _nrepeatlimit > 0 ) {
+                std::string key = itrecord->sourcefilename.size() > 0 ? str(boost::format("%s:%d")%itrecord->sourcefilename%itrecord->line) : itrecord->message;
+                RepeatState& state = _maprepeats[key];
+                if( itrecord->timestamp >= state.windowstart + 1000000000ULL ) {
+                    _WriteSuppressed(listsinks, key, state);
+                    state.windowstart = itrecord->timestamp;
+                    state.count = 0;
+                }
+                if( ++state.count > _nrepeatlimit ) {
+                    state.nsuppressed++;
+                    state.level = itrecord->level;
+                    continue;
+                }
+            }
+            _Write(listsinks, *itrecord);
+        }
+        size_t ndrained = _vdrained.size();
+        _vdrained.resize(0);
+        // report the suppressed messages of the log statements that stopped repeating
+        std::map<std::string, RepeatState>::iterator itstate = _maprepeats.begin();
+        while( itstate != _maprepeats.end() ) {
+            if( bFlush || curtime >= itstate->second.windowstart + 1000000000ULL ) {
+                _WriteSuppressed(listsinks, itstate->first, itstate->second);
+                _maprepeats.erase(itstate++);
+            }
+            else {
+                ++itstate;
+            }
+        }
+        if( bFlush ) {
+            FOREACH(itsink, listsinks) {
+                (*itsink)->Flush();
+            }
+            fflush(stdout);
+        }
+        return ndrained;
+    }
+
+    volatile bool _bEnabled;
+    boost::mutex _mutex; ///< protects the lists
+    std::list<LogSinkPtr> _listsinks;
+
+private:
+    static void _ReleaseThreadQueue(LogQueue* pqueue);
+
+    static bool _CompareTimestamp(const LogRecord& r0, const LogRecord& r1) {
+        return r0.timestamp < r1.timestamp;
+    }
+
+    void _SwapQueue(LogQueue& queue) {
+        size_t nstart = _vdrained.size();
+        size_t ndropped = queue.Pop(_vdrained);
+        if( ndropped > 0 ) {
+            LogRecord record;
+            record.level = Level_Warn;
+            record.timestamp = _vdrained.size() > nstart ? _vdrained.back().timestamp : utils::GetNanoPerformanceTime();
+            record.threadid = queue._threadid;
+            record.message = str(boost::format("dropped %d log messages since the queue of the thread was full")%ndropped);
+            _vdrained.push_back(record);
+        }
+    }
+
+    void _Write(const std::list<LogSinkPtr>& listsinks, const LogRecord& record) {
+        if( listsinks.size() == 0 ) {
+            std::stringstream ss;
+            RaveWriteLogRecord(ss, record);
+#ifdef _WIN32
+            printf("%s", ss.str().c_str());
+#else
+            if( record.level == Level_Info ) {
+                printf("%s", ss.str().c_str());
+            }
+            else {
+                static const int s_colors[] = { OPENRAVECOLOR_FATALLEVEL, OPENRAVECOLOR_ERRORLEVEL, OPENRAVECOLOR_WARNLEVEL, OPENRAVECOLOR_INFOLEVEL, OPENRAVECOLOR_DEBUGLEVEL, OPENRAVECOLOR_VERBOSELEVEL };
+                printf("%s%s%s", ChangeTextColor(0, s_colors[min(record.level,(uint32_t)Level_Verbose)], 8).c_str(), ss.str().c_str(), ResetTextColor().c_str());
+            }
+#endif
+            return;
+        }
+        FOREACHC(itsink, listsinks) {
+            try {
+                (*itsink)->Write(record);
+            }
+            catch(const std::exception&) {
+                // a failing sink should not stop the others
+            }
+        }
+    }
+
+    void _WriteSuppressed(const std::list<LogSinkPtr>& listsinks, const std::string& key, RepeatState& state) {
+        if( state.nsuppressed > 0 ) {
+            LogRecord record;
+            record.level = state.level;
+            record.timestamp = utils::GetNanoPerformanceTime();
+            record.message = str(boost::format("suppressed %d repeated log messages from '%s'")%state.nsuppressed%boost::trim_right_copy(key));
+            _Write(listsinks, record);
+            state.nsuppressed = 0;
+        }
+    }
+
+    /// drains every 5ms while messages arrive and backs off to 100ms when idle. Add wakes the thread up early for errors
+    /// and for queues that are half full.
+    void _LogThread() {
+        int waitms = 5;
+        while( !_bStopThread ) {
+            if( Drain(false) > 0 ) {
+                waitms = 5;
+            }
+            else {
+                waitms = min(2*waitms, 100);
+            }
+            boost::mutex::scoped_lock wakelock(_mutexwake);
+            if( !_bStopThread && !_bWakeThread ) {
+                _condwake.timed_wait(wakelock, boost::posix_time::milliseconds(waitms));
+            }
+            _bWakeThread = false;
+        }
+    }
+
+    int _nrepeatlimit;
+    size_t _nrecordsperthread;
+    boost::mutex _mutexthread; ///< serializes enabling and disabling
+    boost::mutex _mutexdrain; ///< only one thread drains at a time
+    boost::shared_ptr<boost::thread> _threadlog;
+    volatile bool _bStopThread;
+    boost::mutex _mutexwake; ///< protects _bWakeThread and _bStopThread for _condwake
+    boost::condition _condwake;
+    bool _bWakeThread;
+    std::vector<LogRecord> _vdrained; ///< reused by Drain
+    std::map<std::string, RepeatState> _maprepeats; ///< indexed by the source location of the log statement, or by the message if there is none
+    std::list<LogQueue*> _listqueues, _listexited;
+    int _nextthreadid;
+    boost::thread_specific_ptr<LogQueue> _threadqueue; ///< declared last so the queue of the destroying thread is handed over while the lists still exist
+};
+
+static AsyncLogger s_asynclogger;
+
+void AsyncLogger::_ReleaseThreadQueue(LogQueue* pqueue)
+{
+    // the logging thread deletes it after writing its remaining messages
+    boost::mutex::scoped_lock lock(s_asynclogger._mutex);
+    s_asynclogger._listqueues.remove(pqueue);
+    s_asynclogger._listexited.push_back(pqueue);
+}
+
+bool RaveIsAsyncLogging()
+{
+    return s_asynclogger._bEnabled;
+}
+
+int RaveSetLogSource(const char* pfilename, int line, const char* pfunction)
+{
+    LogQueue* pqueue = s_asynclogger.GetThreadQueue();
+    pqueue->_psourcefilename = pfilename;
+    pqueue->_sourceline = line;
+    pqueue->_psourcefunction = pfunction;
+    return 1;
+}
+
+int RaveLogAsync(uint32_t level, const std::string& s)
+{
+    s_asynclogger.Add(level, s);
+    return s.size();
+}
+
+int RaveLogAsyncV(uint32_t level, const char* fmt, va_list list)
+{
+    std::vector<char> vbuffer(256);
+    while(true) {
+        va_list listcopy;
+        va_copy(listcopy, list);
+        int r = vsnprintf(&vbuffer[0], vbuffer.size(), fmt, listcopy);
+        va_end(listcopy);
+        if( r >= 0 && r < (int)vbuffer.size() ) {
+            s_asynclogger.Add(level, std::string(&vbuffer[0], r));
+            return r;
+        }
+        // older vsnprintf implementations return -1 when the buffer is too small
+        vbuffer.resize(r >= 0 ? r+1 : 2*vbuffer.size());
+    }
+}
+
+int RaveLogAsyncW(uint32_t level, const wchar_t* fmt, va_list list)
+{
+    std::vector<wchar_t> vbuffer(256);
+    while(true) {
+        va_list listcopy;
+        va_copy(listcopy, list);
+        int r = vswprintf(&vbuffer[0], vbuffer.size(), fmt, listcopy);
+        va_end(listcopy);
+        if( r >= 0 ) {
+            std::string s(wcstombs(NULL, &vbuffer[0], 0)+1, '\0');
+            size_t len = wcstombs(&s[0], &vbuffer[0], s.size());
+            if( len == (size_t)-1 ) {
+                len = 0;
+            }
+            s.resize(len);
+            s_asynclogger.Add(level, s);
+            return r;
+        }
+        if( vbuffer.size() >= 0x100000 ) {
+            // vswprintf also fails on invalid formats, so give up eventually
+            return 0;
+        }
+        vbuffer.resize(2*vbuffer.size());
+    }
+}
+
+void RaveSetAsyncLogging(bool bEnable, int nrepeatlimit, int nrecordsperthread)
+{
+    s_asynclogger.SetEnabled(bEnable, nrepeatlimit, nrecordsperthread);
+}
+
+void RaveAddLogSink(LogSinkPtr psink)
+{
+    boost::mutex::scoped_lock lock(s_asynclogger._mutex);
+    s_asynclogger._listsinks.push_back(psink);
+}
+
+void RaveRemoveLogSink(LogSinkPtr psink)
+{
+    boost::mutex::scoped_lock lock(s_asynclogger._mutex);
+    s_asynclogger._listsinks.remove(psink);
+}
+
+void RaveClearLogSinks()
+{
+    boost::mutex::scoped_lock lock(s_asynclogger._mutex);
+    s_asynclogger._listsinks.clear();
+}
+
+void RaveGetLogSinks(std::list<LogSinkPtr>& listsinks)
+{
+    boost::mutex::scoped_lock lock(s_asynclogger._mutex);
+    listsinks = s_asynclogger._listsinks;
+}
+
+void RaveFlushLog()
+{
+    s_asynclogger.Drain(true);
+}
+
+void RaveWriteLogRecord(std::ostream& os, const LogRecord& record)
+{
+    os << s_logLevelNames[min(record.level,(uint32_t)Level_Verbose)] << " " << record.threadid << " ";
+    if( record.sourcefilename.size() > 0 ) {
+        os << "[" << record.sourcefilename << ":" << record.line << " " << record.function << "] ";
+    }
+    if( record.message.size() > 0 && record.message[record.message.size()-1] == '\n' ) {
+        os.write(record.message.c_str(), record.message.size()-1);
+    }
+    else {
+        os << record.message;
+    }
+    os << "\n";
+}
+
+MemoryLogSink::MemoryLogSink(size_t maxrecords) : _maxrecords(maxrecords)
+{
+}
+
+MemoryLogSink::~MemoryLogSink()
+{
+}
+
+void MemoryLogSink::Write(const LogRecord& record)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _listrecords.push_back(record);
+    while( _listrecords.size() > _maxrecords ) {
+        _listrecords.pop_front();
+    }
+}
+
+void MemoryLogSink::GetRecords(std::list<LogRecord>& listrecords) const
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    listrecords = _listrecords;
+}
+
+void MemoryLogSink::Clear()
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _listrecords.clear();
+}
+
+class FileLogSink : public LogSink
+{
+public:
+    FileLogSink(const std::string& filename) : _filename(filename) {
+        _ofstream.open(filename.c_str(), std::ios::out|std::ios::app);
+        if( !_ofstream ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("failed to open log file %s", filename, ORE_InvalidArguments);
+        }
+    }
+
+    virtual void Write(const LogRecord& record) {
+        RaveWriteLogRecord(_ofstream, record);
+    }
+
+    virtual void Flush() {
+        _ofstream.flush();
+    }
+
+private:
+    std::string _filename;
+    std::ofstream _ofstream;
+};
+
+class SyslogLogSink : public LogSink
+{
+public:
+    SyslogLogSink(const std::string& ident) : _ident(ident) {
+#ifndef _WIN32
+        // openlog keeps the pointer, so _ident has to outlive the sink
+        openlog(_ident.c_str(), LOG_PID, LOG_USER);
+#endif
+    }
+    virtual ~SyslogLogSink() {
+#ifndef _WIN32
+        closelog();
+#endif
+    }
+
+    virtual void Write(const LogRecord& record) {
+        std::stringstream ss;
+        RaveWriteLogRecord(ss, record);
+#ifndef _WIN32
+        static const int s_priorities[] = { LOG_CRIT, LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG, LOG_DEBUG };
+        syslog(s_priorities[min(record.level,(uint32_t)Level_Verbose)], "%s", ss.str().c_str());
+#else
+        fprintf(stderr, "%s: %s", _ident.c_str(), ss.str().c_str());
+#endif
+    }
+
+private:
+    std::string _ident;
+};
+
+LogSinkPtr RaveCreateFileLogSink(const std::string& filename)
+{
+    return LogSinkPtr(new FileLogSink(filename));
+}
+
+LogSinkPtr RaveCreateSyslogLogSink(const std::string& ident)
+{
+    return LogSinkPtr(new SyslogLogSink(ident));
+}
+
 const std::map<IkParameterizationType,std::string>& IkParameterization::GetIkParameterizationMap(int alllowercase)
 {
     return RaveGlobal::instance()->GetIkParameterizationMap(alllowercase);
@@ -1960,6 +2886,114 @@ EnvironmentBase::~EnvironmentBase()
     RaveGlobal::instance()->UnregisterEnvironment(this);
 }
 
+bool EnvironmentBase::SendCommand(std::ostream& sout, std::istream& sinput)
+{
+    string cmd;
+    sinput >> cmd;
+    if( !sinput ) {
+        throw openrave_exception("invalid command",ORE_InvalidArguments);
+    }
+    if( _stricmp(cmd.c_str(), "SetPerformanceCounters") == 0 ) {
+        int enable = 0;
+        sinput >> enable;
+        if( !sinput ) {
+            return false;
+        }
+        RaveSetPerformanceCounters(enable != 0);
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "GetPerformanceCounters") == 0 ) {
+        RaveWritePerformanceCounters(sout);
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "ResetPerformanceCounters") == 0 ) {
+        RaveResetPerformanceCounters();
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "SetTracing") == 0 ) {
+        int enable = 0, neventsperthread = 65536;
+        sinput >> enable;
+        if( !sinput ) {
+            return false;
+        }
+        sinput >> neventsperthread;
+        if( !sinput ) {
+            neventsperthread = 65536;
+        }
+        RaveSetTracing(enable != 0, neventsperthread);
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "GetChromeTrace") == 0 ) {
+        RaveWriteChromeTrace(sout);
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "ClearTrace") == 0 ) {
+        RaveClearTrace();
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "SetAsyncLogging") == 0 ) {
+        int enable = 0, nrepeatlimit = 0, nrecordsperthread = 4096;
+        sinput >> enable;
+        if( !sinput ) {
+            return false;
+        }
+        sinput >> nrepeatlimit >> nrecordsperthread;
+        if( !sinput ) {
+            nrecordsperthread = 4096;
+        }
+        RaveSetAsyncLogging(enable != 0, nrepeatlimit, nrecordsperthread);
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "AddLogSink") == 0 ) {
+        string type;
+        sinput >> type;
+        if( _stricmp(type.c_str(), "file") == 0 || _stricmp(type.c_str(), "syslog") == 0 ) {
+            string arg;
+            getline(sinput, arg);
+            boost::trim(arg);
+            if( arg.size() == 0 ) {
+                return false;
+            }
+            RaveAddLogSink(_stricmp(type.c_str(), "file") == 0 ? RaveCreateFileLogSink(arg) : RaveCreateSyslogLogSink(arg));
+            return true;
+        }
+        else if( _stricmp(type.c_str(), "memory") == 0 ) {
+            size_t maxrecords = 1000;
+            sinput >> maxrecords;
+            if( !sinput ) {
+                return false;
+            }
+            RaveAddLogSink(LogSinkPtr(new MemoryLogSink(maxrecords)));
+            return true;
+        }
+        return false;
+    }
+    else if( _stricmp(cmd.c_str(), "ClearLogSinks") == 0 ) {
+        RaveClearLogSinks();
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "FlushLog") == 0 ) {
+        RaveFlushLog();
+        return true;
+    }
+    else if( _stricmp(cmd.c_str(), "GetLog") == 0 ) {
+        std::list<LogSinkPtr> listsinks;
+        RaveGetLogSinks(listsinks);
+        std::list<LogRecord> listrecords;
+        FOREACHC(itsink, listsinks) {
+            boost::shared_ptr<MemoryLogSink> pmemorysink = boost::dynamic_pointer_cast<MemoryLogSink>(*itsink);
+            if( !!pmemorysink ) {
+                pmemorysink->GetRecords(listrecords);
+                FOREACHC(itrecord, listrecords) {
+                    RaveWriteLogRecord(sout, *itrecord);
+                }
+            }
+        }
+        return true;
+    }
+    throw openrave_exception(str(boost::format("failed to find command '%s' in environment\n")%cmd.c_str()),ORE_CommandNotSupported);
+}
+
 
 bool SensorBase::SensorData::serialize(std::ostream& O) const
 {
@@ -831,7 +831,7 @@ void PlannerBase::PlannerParameters::Validate() const
     }
 }
 
-PlannerBase::PlannerProgress::PlannerProgress() : _iteration(0)
+PlannerBase::PlannerProgress::PlannerProgress() : _iteration(0), _stageduration(0)
 {
 }
 
@@ -876,6 +876,7 @@ UserDataPtr PlannerBase::RegisterPlanCallback(const PlanCallbackFn& callbackfn)
 
 PlannerStatus PlannerBase::_ProcessPostPlanners(RobotBasePtr probot, TrajectoryBasePtr ptraj)
 {
+    RAVE_TRACE_SCOPE("PlannerBase::_ProcessPostPlanners");
     if( GetParameters()->_sPostProcessingPlanner.size() == 0 ) {
         __cachePostProcessPlanner.reset();
         return PS_HasSolution;
@@ -906,6 +907,7 @@ PlannerStatus PlannerBase::_ProcessPostPlanners(RobotBasePtr probot, TrajectoryB
     params->_sPostProcessingParameters = "";
     params->_nMaxIterations = 0; // have to reset since path optimizers also use it and new parameters could be in extra parameters
     if( __cachePostProcessPlanner->InitPlan(probot, params) ) {
+        RAVE_TRACE_SCOPE("PlannerBase::_ProcessPostPlanners::PlanPath");
         return __cachePostProcessPlanner->PlanPath(ptraj);
     }
 
@@ -915,6 +917,7 @@ PlannerStatus PlannerBase::_ProcessPostPlanners(RobotBasePtr probot, TrajectoryB
 
 PlannerAction PlannerBase::_CallCallbacks(const PlannerProgress& progress)
 {
+    PerformanceCounterTimer timer(PCT_PlannerCallbacks);
     FOREACHC(it,__listRegisteredCallbacks) {
         CustomPlannerCallbackDataPtr pitdata = boost::dynamic_pointer_cast<CustomPlannerCallbackData>(it->lock());
         if( !!pitdata) {
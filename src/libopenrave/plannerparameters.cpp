@@ -21,7 +21,7 @@
 
 namespace OpenRAVE {
 
-WorkspaceTrajectoryParameters::WorkspaceTrajectoryParameters(EnvironmentBasePtr penv) : maxdeviationangle(0.15*PI), maintaintiming(false), greedysearch(true), ignorefirstcollision(0), ignorefirstcollisionee(0), ignorelastcollisionee(0), minimumcompletetime(0), _penv(penv), _bProcessing(false) {
+WorkspaceTrajectoryParameters::WorkspaceTrajectoryParameters(EnvironmentBasePtr penv) : maxdeviationangle(0.15*PI), maintaintiming(false), greedysearch(true), ignorefirstcollision(0), ignorefirstcollisionee(0), ignorelastcollisionee(0), minimumcompletetime(0), numthreads(0), predictiksolution(false), _penv(penv), _bProcessing(false) {
     _vXMLParameters.push_back("maxdeviationangle");
     _vXMLParameters.push_back("maintaintiming");
     _vXMLParameters.push_back("greedysearch");
@@ -29,6 +29,8 @@ WorkspaceTrajectoryParameters::WorkspaceTrajectoryParameters(EnvironmentBasePtr
     _vXMLParameters.push_back("ignorefirstcollisionee");
     _vXMLParameters.push_back("ignorelastcollisionee");
     _vXMLParameters.push_back("minimumcompletetime");
+    _vXMLParameters.push_back("numthreads");
+    _vXMLParameters.push_back("predictiksolution");
     _vXMLParameters.push_back("workspacetraj"); // back-compat
     _vXMLParameters.push_back("workspacetrajectory");
 }
@@ -46,6 +48,8 @@ bool WorkspaceTrajectoryParameters::serialize(std::ostream& O, int options) cons
     O << "<ignorefirstcollisionee>" << ignorefirstcollisionee << "</ignorefirstcollisionee>" << std::endl;
     O << "<ignorelastcollisionee>" << ignorelastcollisionee << "</ignorelastcollisionee>" << std::endl;
     O << "<minimumcompletetime>" << minimumcompletetime << "</minimumcompletetime>" << std::endl;
+    O << "<numthreads>" << numthreads << "</numthreads>" << std::endl;
+    O << "<predictiksolution>" << predictiksolution << "</predictiksolution>" << std::endl;
     if( !!workspacetraj ) {
         O << "<workspacetrajectory>";
         workspacetraj->serialize(O);
@@ -78,7 +82,7 @@ BaseXMLReader::ProcessElement WorkspaceTrajectoryParameters::startElement(const
         _bProcessing = false;
         return PE_Support;
     }
-    _bProcessing = name=="maxdeviationangle" || name=="maintaintiming" || name=="greedysearch" || name=="ignorefirstcollision" || name=="ignorefirstcollisionee" || name=="ignorelastcollisionee" || name=="minimumcompletetime" || name=="workspacetraj";
+    _bProcessing = name=="maxdeviationangle" || name=="maintaintiming" || name=="greedysearch" || name=="ignorefirstcollision" || name=="ignorefirstcollisionee" || name=="ignorelastcollisionee" || name=="minimumcompletetime" || name=="numthreads" || name=="predictiksolution" || name=="workspacetraj";
     return _bProcessing ? PE_Support : PE_Pass;
 }
 
@@ -118,6 +122,12 @@ bool WorkspaceTrajectoryParameters::endElement(const std::string& name)
         else if( name == "minimumcompletetime" ) {
             _ss >> minimumcompletetime;
         }
+        else if( name == "numthreads" ) {
+            _ss >> numthreads;
+        }
+        else if( name == "predictiksolution" ) {
+            _ss >> predictiksolution;
+        }
         else if( name == "workspacetraj" ) {
             if( !workspacetraj ) {
                 workspacetraj = RaveCreateTrajectory(_penv,"");
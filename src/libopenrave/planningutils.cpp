@@ -746,6 +746,227 @@ void ActiveDOFTrajectoryRetimer::_UpdateParameters()
     _parameters=params; // necessary because SetRobotActiveJoints builds functions that hold weak_ptr to the parameters
 }
 
+class ActiveDOFTrajectoryBatchPlanner::BatchWork
+{
+public:
+    BatchWork(const std::vector<TrajectoryBasePtr>& vtrajectories, std::vector<PlannerStatus>& vstatuses) : _vtrajectories(vtrajectories), _vstatuses(vstatuses), _nexttrajectory(0) {
+    }
+    const std::vector<TrajectoryBasePtr>& _vtrajectories;
+    std::vector<PlannerStatus>& _vstatuses;
+    size_t _nexttrajectory; ///< first trajectory that was not handed to a thread yet
+    boost::mutex _mutex;
+};
+
+/// \brief true if the planner is one of the retimers of rplanners, which only compute the timing and never set the state of the robot
+static bool _IsStatelessRetimer(const std::string& plannername)
+{
+    static const char* s_retimers[] = { "parabolicretimer", "parabolictrajectoryretimer", "lineartrajectoryretimer", "cubictrajectoryretimer" };
+    for(size_t i = 0; i < sizeof(s_retimers)/sizeof(s_retimers[0]); ++i) {
+        if( _stricmp(plannername.c_str(), s_retimers[i]) == 0 ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ActiveDOFTrajectoryBatchPlanner::ActiveDOFTrajectoryBatchPlanner(RobotBasePtr robot, int numthreads, bool bsmooth, const std::string& plannername, const std::string& plannerparameters)
+{
+    _robot = robot;
+    _bsmooth = bsmooth;
+    _plannername = plannername.size() > 0 ? plannername : (bsmooth ? "parabolicsmoother" : "parabolicretimer");
+    // any other planner could set the state of the robot, so it is only safe in its own environment
+    _bCloneEnvironments = bsmooth || !_IsStatelessRetimer(_plannername);
+    _plannerparameters = plannerparameters;
+    _hastimestamps = false;
+    _bParametersChanged = true;
+    EnvironmentMutex::scoped_lock lockenv(robot->GetEnv()->GetMutex());
+    _vRobotActiveIndices = _robot->GetActiveDOFIndices();
+    _nRobotAffineDOF = _robot->GetAffineDOF();
+    _vRobotRotationAxis = _robot->GetAffineRotationAxis();
+    _vworkers.resize(max(1,numthreads));
+    FOREACH(itworker, _vworkers) {
+        itworker->reset(new PlannerWorker());
+    }
+    _InitPlanners();
+    _changehandler = robot->RegisterChangeCallback(KinBody::Prop_JointAccelerationVelocityTorqueLimits|KinBody::Prop_JointLimits|KinBody::Prop_JointProperties, boost::bind(&ActiveDOFTrajectoryBatchPlanner::_OnRobotChanged, this));
+}
+
+ActiveDOFTrajectoryBatchPlanner::~ActiveDOFTrajectoryBatchPlanner()
+{
+    _changehandler.reset();
+    FOREACH(itworker, _vworkers) {
+        if( !!(*itworker)->penv ) {
+            (*itworker)->penv->Destroy();
+        }
+    }
+}
+
+void ActiveDOFTrajectoryBatchPlanner::PlanPaths(const std::vector<TrajectoryBasePtr>& vtrajectories, std::vector<PlannerStatus>& vstatuses, bool hastimestamps)
+{
+    vstatuses.resize(0);
+    vstatuses.resize(vtrajectories.size(), PS_Failed);
+    if( vtrajectories.size() == 0 ) {
+        return;
+    }
+
+    EnvironmentBasePtr env = _robot->GetEnv();
+    EnvironmentMutex::scoped_lock lockenv(env->GetMutex());
+    if( !_bsmooth && _hastimestamps != hastimestamps ) {
+        _hastimestamps = hastimestamps;
+        _bParametersChanged = true;
+    }
+    _InitPlanners();
+
+    // the calling thread plans with the first worker
+    BatchWorkPtr work(new BatchWork(vtrajectories, vstatuses));
+    std::vector<boost::shared_ptr<boost::thread> > listthreads(min(_vworkers.size(), vtrajectories.size())-1);
+    for(size_t ithread = 0; ithread < listthreads.size(); ++ithread) {
+        listthreads[ithread].reset(new boost::thread(boost::bind(&ActiveDOFTrajectoryBatchPlanner::_PlanWorker, this, _vworkers[ithread+1], work)));
+    }
+    {
+        boost::shared_ptr<CollisionOptionsStateSaver> optionstate;
+        if( _bsmooth ) {
+            optionstate.reset(new CollisionOptionsStateSaver(env->GetCollisionChecker(),env->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false));
+        }
+        _PlanWorker(_vworkers[0], work);
+    }
+    FOREACH(itthread, listthreads) {
+        (*itthread)->join();
+    }
+}
+
+void ActiveDOFTrajectoryBatchPlanner::_InitPlanners()
+{
+    for(size_t i = 0; i < _vworkers.size(); ++i) {
+        PlannerWorkerPtr worker = _vworkers[i];
+        RobotBasePtr probot = _robot;
+        if( _bCloneEnvironments && i > 0 ) {
+            // collisions have to be checked against the current state of the environment
+            if( !worker->penv ) {
+                worker->penv = _robot->GetEnv()->CloneSelf(Clone_Bodies);
+            }
+            else {
+                worker->penv->Clone(_robot->GetEnv(), Clone_Bodies);
+            }
+            probot = worker->penv->GetRobot(_robot->GetName());
+            if( !probot ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("failed to find robot %s in the cloned environment", _robot->GetName(), ORE_InvalidState);
+            }
+        }
+        if( _bParametersChanged || probot != worker->probot ) {
+            _InitPlanner(worker, probot);
+        }
+    }
+    _bParametersChanged = false;
+}
+
+void ActiveDOFTrajectoryBatchPlanner::_InitPlanner(PlannerWorkerPtr worker, RobotBasePtr probot)
+{
+    EnvironmentMutex::scoped_lock lockenv(probot->GetEnv()->GetMutex());
+    RobotBase::RobotStateSaver saver(probot, KinBody::Save_ActiveDOF);
+    probot->SetActiveDOFs(_vRobotActiveIndices, _nRobotAffineDOF, _vRobotRotationAxis);
+    if( !worker->planner || worker->planner->GetEnv() != probot->GetEnv() ) {
+        worker->planner = RaveCreatePlanner(probot->GetEnv(),_plannername);
+        if( !worker->planner ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("failed to create planner %s", _plannername, ORE_InvalidArguments);
+        }
+    }
+    TrajectoryTimingParametersPtr params(new TrajectoryTimingParameters());
+    params->SetRobotActiveJoints(probot);
+    params->_sPostProcessingPlanner = ""; // have to turn off the second post processing stage
+    params->_hastimestamps = _hastimestamps;
+    if( !_bsmooth ) {
+        params->_setstatevaluesfn.clear();
+        params->_setstatefn.clear();
+        params->_checkpathconstraintsfn.clear();
+        params->_checkpathvelocityconstraintsfn.clear();
+    }
+    params->_sExtraParameters = _plannerparameters;
+    if( !worker->planner->InitPlan(probot,params) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to init planner %s with robot %s", _plannername%probot->GetName(), ORE_InvalidArguments);
+    }
+    worker->parameters = params;
+    worker->probot = probot;
+}
+
+void ActiveDOFTrajectoryBatchPlanner::_PlanWorker(PlannerWorkerPtr worker, BatchWorkPtr work)
+{
+    // the known retimers do not touch the environment, the calling thread already holds the lock of the original environment
+    boost::shared_ptr<EnvironmentMutex::scoped_lock> lockenv;
+    boost::shared_ptr<CollisionOptionsStateSaver> optionstate;
+    boost::shared_ptr<RobotBase::RobotStateSaver> saver;
+    if( !!worker->penv ) {
+        lockenv.reset(new EnvironmentMutex::scoped_lock(worker->penv->GetMutex()));
+        optionstate.reset(new CollisionOptionsStateSaver(worker->penv->GetCollisionChecker(),worker->penv->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false));
+    }
+    if( _bCloneEnvironments ) {
+        // the planner can change the state of the robot
+        saver.reset(new RobotBase::RobotStateSaver(worker->probot, KinBody::Save_ActiveDOF|KinBody::Save_LinkTransformation));
+        worker->probot->SetActiveDOFs(_vRobotActiveIndices, _nRobotAffineDOF, _vRobotRotationAxis);
+    }
+
+    while(1) {
+        size_t index;
+        {
+            boost::mutex::scoped_lock lock(work->_mutex);
+            if( work->_nexttrajectory >= work->_vtrajectories.size() ) {
+                break;
+            }
+            index = work->_nexttrajectory++;
+        }
+        TrajectoryBasePtr traj = work->_vtrajectories[index];
+        try {
+            if( traj->GetNumWaypoints() == 1 ) {
+                // don't need velocities, but should at least add a time group
+                ConfigurationSpecification spec = traj->GetConfigurationSpecification();
+                spec.AddDeltaTimeGroup();
+                vector<dReal> data;
+                traj->GetWaypoints(0,traj->GetNumWaypoints(),data,spec);
+                traj->Init(spec);
+                traj->Insert(0,data);
+                work->_vstatuses[index] = PS_HasSolution;
+                continue;
+            }
+
+            TrajectoryBasePtr ptraj = traj;
+            if( !!worker->penv ) {
+                if( !worker->ptrajclone || worker->ptrajclone->GetXMLId() != traj->GetXMLId() ) {
+                    worker->ptrajclone = RaveCreateTrajectory(worker->penv, traj->GetXMLId());
+                }
+                worker->ptrajclone->Clone(traj, 0);
+                ptraj = worker->ptrajclone;
+            }
+            PlannerStatus status = worker->planner->PlanPath(ptraj);
+            if( status & PS_HasSolution ) {
+                if( _bsmooth && (RaveGetDebugLevel() & Level_VerifyPlans) ) {
+                    RobotBase::RobotStateSaver verifysaver(worker->probot);
+                    planningutils::VerifyTrajectory(worker->parameters,ptraj);
+                }
+                if( ptraj != traj ) {
+                    traj->Clone(ptraj, 0);
+                }
+            }
+            work->_vstatuses[index] = status;
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN(str(boost::format("failed to plan trajectory %d: %s\n")%index%ex.what()));
+            work->_vstatuses[index] = PS_Failed;
+        }
+    }
+}
+
+void ActiveDOFTrajectoryBatchPlanner::_OnRobotChanged()
+{
+    _bParametersChanged = true;
+    // reused robots of the cloned environments only get the state of the original robot, so clone again
+    FOREACH(itworker, _vworkers) {
+        if( !!(*itworker)->penv ) {
+            (*itworker)->penv->Destroy();
+            (*itworker)->penv.reset();
+        }
+    }
+}
+
 PlannerStatus _PlanTrajectory(TrajectoryBasePtr traj, bool hastimestamps, dReal fmaxvelmult, dReal fmaxaccelmult, const std::string& plannername, bool bsmooth, const std::string& plannerparameters)
 {
     if( traj->GetNumWaypoints() == 1 ) {
@@ -2119,7 +2340,207 @@ void DynamicsCollisionConstraint::_PrintOnFailure(const std::string& prefix)
     }
 }
 
+EdgeValidityCache::EdgeValidityCache(size_t maxedges) : _bEnvironmentChanged(true), _maxedges(maxedges), _nHits(0), _nMisses(0)
+{
+}
+
+EdgeValidityCachePtr EdgeValidityCache::GetBodyCache(KinBodyConstPtr pbody)
+{
+    return boost::dynamic_pointer_cast<EdgeValidityCache>(pbody->GetUserData("edgevaliditycache"));
+}
+
+void EdgeValidityCache::Clear()
+{
+    _mapedges.clear();
+}
+
+void EdgeValidityCache::UpdateEnvironmentState(EnvironmentBasePtr penv, const std::list<KinBodyPtr>& listCheckBodies)
+{
+    // the results depend on the checkers and their options, there are only a few so they are compared on every call
+    _vnewcheckers.resize(0);
+    _vnewcheckers.push_back(penv->GetCollisionChecker());
+    _vnewcheckstamps.resize(0);
+    FOREACHC(itbody, listCheckBodies) {
+        _vnewcheckers.push_back((*itbody)->GetSelfCollisionChecker());
+        _vnewcheckstamps.push_back((*itbody)->GetEnvironmentId());
+    }
+    bool bCheckersChanged = _vnewcheckers.size() != _vcheckers.size();
+    for(size_t i = 0; i < _vnewcheckers.size(); ++i) {
+        _vnewcheckstamps.push_back(!!_vnewcheckers[i] ? _vnewcheckers[i]->GetCollisionOptions() : 0);
+        if( !bCheckersChanged && _vcheckers[i].lock() != _vnewcheckers[i] ) {
+            bCheckersChanged = true;
+        }
+    }
+    bool bEnvironmentChanged = false;
+    {
+        boost::mutex::scoped_lock lock(_mutexchanged);
+        bEnvironmentChanged = _bEnvironmentChanged;
+        _bEnvironmentChanged = false;
+    }
+    if( !bEnvironmentChanged && !bCheckersChanged && _vnewcheckstamps == _vcheckstamps && _penv.lock() == penv ) {
+        // none of the callbacks fired, so no other body moved and the bodies, grabbed bodies and enable states are the same
+        _vnewcheckers.resize(0);
+        return;
+    }
+    _vcheckstamps.swap(_vnewcheckstamps);
+
+    // grabbed bodies move with the checked bodies, so only the set of grabbed bodies matters
+    _vgrabbed.resize(0);
+    std::vector<KinBodyPtr> vgrabbed;
+    FOREACHC(itbody, listCheckBodies) {
+        if( (*itbody)->IsRobot() ) {
+            RaveInterfaceCast<RobotBase>(*itbody)->GetGrabbed(vgrabbed);
+            _vgrabbed.insert(_vgrabbed.end(), vgrabbed.begin(), vgrabbed.end());
+        }
+    }
+    // register the callbacks before reading the state so that no change is missed
+    _listcallbackhandles.clear();
+    _penv = penv;
+    _listcallbackhandles.push_back(penv->RegisterBodyCallback(boost::bind(&EdgeValidityCache::_SetEnvironmentChanged,this)));
+    penv->GetBodies(_vbodies);
+    _vnewstamps.resize(0);
+    FOREACHC(itbody, _vbodies) {
+        KinBodyPtr pbody = *itbody;
+        // enabling links does not change the update stamp
+        _listcallbackhandles.push_back(pbody->RegisterChangeCallback(KinBody::Prop_LinkEnable|KinBody::Prop_RobotGrabbed, boost::bind(&EdgeValidityCache::_SetEnvironmentChanged,this)));
+        if( find(listCheckBodies.begin(), listCheckBodies.end(), pbody) != listCheckBodies.end() ) {
+            _vnewstamps.push_back(pbody->GetEnvironmentId());
+        }
+        else if( find(_vgrabbed.begin(), _vgrabbed.end(), pbody) != _vgrabbed.end() ) {
+            _vnewstamps.push_back(-pbody->GetEnvironmentId());
+        }
+        else {
+            _listcallbackhandles.push_back(pbody->RegisterUpdateStampCallback(boost::bind(&EdgeValidityCache::_SetEnvironmentChanged,this)));
+            _vnewstamps.push_back(pbody->GetEnvironmentId());
+            _vnewstamps.push_back(pbody->GetUpdateStamp());
+        }
+        pbody->GetLinkEnableStates(_venablestates);
+        _vnewstamps.insert(_vnewstamps.end(), _venablestates.begin(), _venablestates.end());
+    }
+    _vnewstamps.insert(_vnewstamps.end(), _vcheckstamps.begin(), _vcheckstamps.end());
+    if( bCheckersChanged || _vnewstamps != _vstamps ) {
+        _mapedges.clear();
+        _vstamps.swap(_vnewstamps);
+        _vcheckers.resize(_vnewcheckers.size());
+        for(size_t i = 0; i < _vnewcheckers.size(); ++i) {
+            _vcheckers[i] = _vnewcheckers[i];
+        }
+    }
+    _vnewcheckers.resize(0);
+    _vbodies.resize(0);
+    _vgrabbed.resize(0);
+}
+
+void EdgeValidityCache::_SetEnvironmentChanged()
+{
+    boost::mutex::scoped_lock lock(_mutexchanged);
+    _bEnvironmentChanged = true;
+}
+
+int EdgeValidityCache::_GetIntervalMask(IntervalType interval)
+{
+    switch(interval) {
+    case IT_Open: return 0;
+    case IT_OpenStart: return 2;
+    case IT_OpenEnd: return 1;
+    case IT_Closed: return 3;
+    default:
+        BOOST_ASSERT(0);
+    }
+    return 3;
+}
+
+bool EdgeValidityCache::Find(const std::vector<dReal>& vedgekey, IntervalType interval, bool bValidOnly, int& ret)
+{
+    std::map<std::vector<dReal>, EdgeResult>::const_iterator it = _mapedges.find(vedgekey);
+    if( it != _mapedges.end() ) {
+        int mask = _GetIntervalMask(interval);
+        // a valid interval is valid for any of its sub-intervals, an invalid one for any interval containing it
+        if( it->second.validmask >= 0 && (it->second.validmask & mask) == mask ) {
+            ret = 0;
+            ++_nHits;
+            return true;
+        }
+        if( !bValidOnly && it->second.invalidmask >= 0 && (it->second.invalidmask & mask) == it->second.invalidmask ) {
+            ret = it->second.ret;
+            ++_nHits;
+            return true;
+        }
+    }
+    ++_nMisses;
+    return false;
+}
+
+void EdgeValidityCache::Insert(const std::vector<dReal>& vedgekey, IntervalType interval, int ret)
+{
+    if( _mapedges.size() >= _maxedges ) {
+        _mapedges.clear();
+    }
+    EdgeResult& result = _mapedges[vedgekey];
+    int mask = _GetIntervalMask(interval);
+    if( ret == 0 ) {
+        // the interior steps are the same for every interval, so the checked end points can be merged
+        result.validmask = result.validmask >= 0 ? (result.validmask|mask) : mask;
+    }
+    else if( result.invalidmask < 0 || (result.invalidmask & mask) == mask ) {
+        result.invalidmask = mask;
+        result.ret = ret;
+    }
+}
+
 int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn)
+{
+    int maskoptions = options&_filtermask;
+    EdgeValidityCachePtr pedgecache;
+    if( _listCheckBodies.size() > 0 && !(options & CFO_FillCheckedConfiguration) ) {
+        pedgecache = EdgeValidityCache::GetBodyCache(_listCheckBodies.front());
+    }
+    if( !!pedgecache && (maskoptions & CFO_CheckUserConstraints) && (!!_usercheckfns[0] || !!_usercheckfns[1]) ) {
+        // user functions can depend on anything
+        pedgecache.reset();
+    }
+    PlannerBase::PlannerParametersPtr params = _parameters.lock();
+    if( !pedgecache || !params || params->SetStateValues(q0, 0) != 0 ) {
+        return _Check(q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+    }
+
+    pedgecache->UpdateEnvironmentState(_listCheckBodies.front()->GetEnv(), _listCheckBodies);
+    // the state of the bodies at q0 also captures all DOFs that are not part of the configuration
+    _vedgekey.resize(0);
+    _vedgekey.push_back(maskoptions);
+    _vedgekey.push_back((maskoptions & CFO_CheckWithPerturbation) ? _perturbation : dReal(0));
+    _vedgekey.push_back(timeelapsed);
+    _vedgekey.push_back(q0.size());
+    _vedgekey.insert(_vedgekey.end(), q0.begin(), q0.end());
+    _vedgekey.insert(_vedgekey.end(), q1.begin(), q1.end());
+    _vedgekey.push_back(dq0.size());
+    _vedgekey.insert(_vedgekey.end(), dq0.begin(), dq0.end());
+    _vedgekey.push_back(dq1.size());
+    _vedgekey.insert(_vedgekey.end(), dq1.begin(), dq1.end());
+    _vedgekey.insert(_vedgekey.end(), params->_vConfigResolution.begin(), params->_vConfigResolution.end());
+    FOREACHC(itbody, _listCheckBodies) {
+        (*itbody)->GetDOFValues(_vbodyvalues);
+        _vedgekey.insert(_vedgekey.end(), _vbodyvalues.begin(), _vbodyvalues.end());
+        Transform t = (*itbody)->GetTransform();
+        _vedgekey.push_back(t.rot.x); _vedgekey.push_back(t.rot.y); _vedgekey.push_back(t.rot.z); _vedgekey.push_back(t.rot.w);
+        _vedgekey.push_back(t.trans.x); _vedgekey.push_back(t.trans.y); _vedgekey.push_back(t.trans.z);
+    }
+
+    // invalid edges cannot fill out the failure information
+    int ret = 0;
+    bool bValidOnly = !!filterreturn || (options & CFO_FillCollisionReport);
+    if( pedgecache->Find(_vedgekey, interval, bValidOnly, ret) ) {
+        if( !!filterreturn ) {
+            filterreturn->Clear();
+        }
+        return ret;
+    }
+    ret = _Check(q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+    pedgecache->Insert(_vedgekey, interval, ret);
+    return ret;
+}
+
+int DynamicsCollisionConstraint::_Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn)
 {
     int maskoptions = options&_filtermask;
     if( !!filterreturn ) {
@@ -2276,6 +2697,16 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
         return 0;
     }
     
+    if( (maskoptions & CFO_CheckContinuousCollisions) && (maskoptions & (CFO_CheckEnvCollisions|CFO_CheckSelfCollisions)) && !(options & CFO_FillCheckedConfiguration) && !(maskoptions & (CFO_CheckTimeBasedConstraints|CFO_CheckWithPerturbation)) ) {
+        // only straight lines without user functions, since the skipped states are only known to be collision free
+        bool bHasUserFns = (maskoptions & CFO_CheckUserConstraints) && (!!_usercheckfns[0] || !!_usercheckfns[1]);
+        bool bHasVelocities = timeelapsed > 0 && dq0.size() == q0.size() && dq1.size() == q0.size();
+        int ret = 0;
+        if( !bHasUserFns && !bHasVelocities && _CheckContinuous(params, q0, dReal(1.0)/numSteps, maskoptions, filterreturn, ret) ) {
+            return ret;
+        }
+    }
+
     for (i = 0; i < params->GetDOF(); i++) {
         _vtempconfig.at(i) = q0.at(i);
     }
@@ -2450,6 +2881,217 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
     return 0;
 }
 
+/// fraction of the resolution step that conservative advancement always advances
+static const dReal g_fContinuousCollisionTolerance = 0.01;
+
+bool DynamicsCollisionConstraint::_CheckContinuous(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& q0, dReal fminstep, int options, ConstraintFilterReturnPtr filterreturn, int& ret)
+{
+    // dQ is the full delta from q0 to q1
+    if( params->SetStateValues(q0, 0) != 0 || !_ComputeMotionBounds(params, dQ, _vmotionbounds) ) {
+        return false;
+    }
+    dReal ftotalbound = 0;
+    FOREACHC(itbound, _vmotionbounds) {
+        ftotalbound += *itbound;
+    }
+    if( ftotalbound <= g_fEpsilon ) {
+        return false;
+    }
+
+    // every checker queried has to fill the distances, otherwise nothing can be skipped
+    EnvironmentBasePtr penv = _listCheckBodies.front()->GetEnv();
+    CollisionCheckerBasePtr pchecker = penv->GetCollisionChecker();
+    if( !pchecker ) {
+        return false;
+    }
+    std::vector<CollisionCheckerBasePtr> vcheckers;
+    std::vector<CollisionOptionsStateSaverPtr> voptionsavers;
+    vcheckers.push_back(pchecker);
+    FOREACHC(itbody, _listCheckBodies) {
+        CollisionCheckerBasePtr pselfchecker = (*itbody)->GetSelfCollisionChecker();
+        if( (options & CFO_CheckSelfCollisions) && !!pselfchecker && find(vcheckers.begin(), vcheckers.end(), pselfchecker) == vcheckers.end() ) {
+            vcheckers.push_back(pselfchecker);
+        }
+    }
+    FOREACHC(itchecker, vcheckers) {
+        voptionsavers.push_back(CollisionOptionsStateSaverPtr(new CollisionOptionsStateSaver(*itchecker, (*itchecker)->GetCollisionOptions()|CO_Distance, false)));
+        if( !((*itchecker)->GetCollisionOptions() & CO_Distance) ) {
+            return false;
+        }
+    }
+
+    _vtempconfig.resize(q0.size());
+    dReal fstep = 0; // the fraction of the segment that is advanced
+    while(fstep < 1) {
+        for(size_t i = 0; i < q0.size(); ++i) {
+            _vtempconfig[i] = q0[i] + fstep*dQ[i];
+        }
+        int nstateret = 0;
+        if( params->SetStateValues(_vtempconfig, 0) != 0 ) {
+            nstateret = CFO_StateSettingError;
+        }
+        // no point of the bodies moves further than the bound times the advance, so advance until the closest obstacle could be reached
+        dReal fadvance = 1;
+        std::vector<dReal>::const_iterator itbound = _vmotionbounds.begin();
+        FOREACHC(itbody, _listCheckBodies) {
+            if( nstateret != 0 ) {
+                break;
+            }
+            if( options & CFO_CheckEnvCollisions ) {
+                if( penv->CheckCollision(KinBodyConstPtr(*itbody),_report) ) {
+                    nstateret = CFO_CheckEnvCollisions;
+                    break;
+                }
+                fadvance = min(fadvance, _report->minDistance/ftotalbound);
+            }
+            if( options & CFO_CheckSelfCollisions ) {
+                if( (*itbody)->CheckSelfCollision(_report) ) {
+                    nstateret = CFO_CheckSelfCollisions;
+                    break;
+                }
+                // both links of a pair can move
+                if( *itbound > 0 ) {
+                    fadvance = min(fadvance, _report->minDistance/(2*(*itbound)));
+                }
+            }
+            ++itbound;
+        }
+        if( nstateret != 0 ) {
+            if( fstep == 0 ) {
+                // the start was not required to be valid, so step through the segment instead
+                return false;
+            }
+            if( (options & CFO_FillCollisionReport) && !!filterreturn && (nstateret & (CFO_CheckEnvCollisions|CFO_CheckSelfCollisions)) ) {
+                filterreturn->_report = *_report;
+            }
+            if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                _PrintOnFailure(std::string("continuous collision failed ")+_report->__str__());
+            }
+            if( !!filterreturn ) {
+                filterreturn->_returncode = nstateret;
+                filterreturn->_invalidvalues = _vtempconfig;
+                filterreturn->_fTimeWhenInvalid = fstep;
+            }
+            ret = nstateret;
+            return true;
+        }
+        // the clearance decides the step. When touching an obstacle the clearance goes to 0, so always advance at least
+        // a small fraction of the resolution step, which is the tolerance of the check.
+        fstep += max(fadvance, fminstep*g_fContinuousCollisionTolerance);
+    }
+    // the end was checked before if the interval requires it
+    ret = 0;
+    return true;
+}
+
+bool DynamicsCollisionConstraint::_ComputeMotionBounds(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& vdelta, std::vector<dReal>& vbounds)
+{
+    const ConfigurationSpecification& spec = params->_configurationspecification;
+    FOREACHC(itgroup, spec._vgroups) {
+        if( itgroup->name.size() < 12 || itgroup->name.substr(0,12) != "joint_values" ) {
+            return false;
+        }
+    }
+
+    vbounds.resize(0);
+    std::vector<int> vdofindices;
+    std::vector<KinBody::JointPtr> vchain;
+    std::vector<dReal> vlower, vupper;
+    FOREACHC(itbody, _listCheckBodies) {
+        KinBodyPtr pbody = *itbody;
+        vdofindices.resize(pbody->GetDOF());
+        for(int i = 0; i < pbody->GetDOF(); ++i) {
+            vdofindices[i] = i;
+        }
+        _vbodydofdelta.resize(pbody->GetDOF());
+        std::fill(_vbodydofdelta.begin(), _vbodydofdelta.end(), dReal(0));
+        if( pbody->GetDOF() > 0 ) {
+            spec.ExtractJointValues(_vbodydofdelta.begin(), vdelta.begin(), pbody, vdofindices, 0);
+        }
+        // the motion of mimic joints is not bounded, so they can only be skipped if none of the DOFs they depend on moves
+        vchain = pbody->GetJoints();
+        vchain.insert(vchain.end(), pbody->GetPassiveJoints().begin(), pbody->GetPassiveJoints().end());
+        FOREACHC(itjoint, vchain) {
+            for(int idof = 0; idof < (*itjoint)->GetDOF(); ++idof) {
+                if( (*itjoint)->IsMimic(idof) ) {
+                    (*itjoint)->GetMimicDOFIndices(vdofindices, idof);
+                    FOREACHC(itdofindex, vdofindices) {
+                        if( _vbodydofdelta.at(*itdofindex) != 0 ) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+
+        // grabbed bodies move with the grabbing link, so grow its box to contain them
+        _vlinkboxes.resize(pbody->GetLinks().size());
+        FOREACHC(itlink, pbody->GetLinks()) {
+            _vlinkboxes[(*itlink)->GetIndex()] = (*itlink)->ComputeAABB();
+        }
+        if( pbody->IsRobot() ) {
+            RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+            std::vector<KinBodyPtr> vgrabbed;
+            probot->GetGrabbed(vgrabbed);
+            FOREACHC(itgrabbed, vgrabbed) {
+                KinBody::LinkPtr plink = probot->IsGrabbing(*itgrabbed);
+                if( !plink ) {
+                    continue;
+                }
+                AABB& ab = _vlinkboxes.at(plink->GetIndex());
+                AABB abgrabbed = (*itgrabbed)->ComputeAABB();
+                Vector vmin = ab.pos - ab.extents, vmax = ab.pos + ab.extents;
+                for(int j = 0; j < 3; ++j) {
+                    vmin[j] = min(vmin[j], abgrabbed.pos[j]-abgrabbed.extents[j]);
+                    vmax[j] = max(vmax[j], abgrabbed.pos[j]+abgrabbed.extents[j]);
+                }
+                ab.pos = 0.5*(vmin+vmax);
+                ab.extents = 0.5*(vmax-vmin);
+            }
+        }
+
+        // a joint on the chain from the base moves the points of the link by at most the DOF delta times the distance to its
+        // anchor. That distance is bounded by the rigid distances between the consecutive anchors and the prismatic ranges.
+        dReal fbodybound = 0;
+        FOREACHC(itlink, pbody->GetLinks()) {
+            if( !pbody->GetChain(0, (*itlink)->GetIndex(), vchain) ) {
+                return false;
+            }
+            const AABB& ab = _vlinkboxes[(*itlink)->GetIndex()];
+            dReal freach = 0, flinkbound = 0;
+            for(int ichain = (int)vchain.size()-1; ichain >= 0; --ichain) {
+                KinBody::JointPtr pjoint = vchain[ichain];
+                if( ichain+1 == (int)vchain.size() ) {
+                    freach = RaveSqrt((ab.pos-pjoint->GetAnchor()).lengthsqr3()) + RaveSqrt(ab.extents.lengthsqr3());
+                }
+                else {
+                    KinBody::JointPtr pchild = vchain[ichain+1];
+                    freach += RaveSqrt((pchild->GetAnchor()-pjoint->GetAnchor()).lengthsqr3());
+                    pchild->GetLimits(vlower, vupper);
+                    for(int idof = 0; idof < pchild->GetDOF(); ++idof) {
+                        if( pchild->IsPrismatic(idof) ) {
+                            freach += vupper.at(idof) - vlower.at(idof);
+                        }
+                    }
+                }
+                if( pjoint->GetDOFIndex() < 0 ) {
+                    continue;
+                }
+                for(int idof = 0; idof < pjoint->GetDOF(); ++idof) {
+                    if( pjoint->IsMimic(idof) ) {
+                        continue;
+                    }
+                    dReal fdelta = RaveFabs(_vbodydofdelta.at(pjoint->GetDOFIndex()+idof));
+                    flinkbound += pjoint->IsPrismatic(idof) ? fdelta : fdelta*freach;
+                }
+            }
+            fbodybound = max(fbodybound, flinkbound);
+        }
+        vbounds.push_back(fbodybound);
+    }
+    return true;
+}
+
 SimpleDistanceMetric::SimpleDistanceMetric(RobotBasePtr robot) : _robot(robot)
 {
     _robot->GetActiveDOFWeights(weights2);
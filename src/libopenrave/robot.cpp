@@ -632,15 +632,16 @@ void RobotBase::SetActiveDOFValues(const std::vector<dReal>& values, uint32_t bC
     }
 
     if( _vActiveDOFIndices.size() > 0 ) {
-        GetDOFValues(_vTempRobotJoints);
-        for(size_t i = 0; i < _vActiveDOFIndices.size(); ++i) {
-            _vTempRobotJoints[_vActiveDOFIndices[i]] = values[i];
-        }
         if( (int)_vActiveDOFIndices.size() < _nActiveDOF ) {
+            GetDOFValues(_vTempRobotJoints);
+            for(size_t i = 0; i < _vActiveDOFIndices.size(); ++i) {
+                _vTempRobotJoints[_vActiveDOFIndices[i]] = values[i];
+            }
             SetDOFValues(_vTempRobotJoints, t, bCheckLimits);
         }
         else {
-            SetDOFValues(_vTempRobotJoints, bCheckLimits);
+            // only the links downstream of the active DOFs are recomputed
+            SetDOFValues(values, bCheckLimits, _vActiveDOFIndices);
         }
     }
 }
@@ -1412,6 +1413,7 @@ const std::set<int>& RobotBase::GetNonAdjacentLinks(int adjacentoptions) const
             }
         }
         _nNonAdjacentLinkCache |= requestedoptions;
+        ++_nNonAdjacentLinkStamp;
     }
     return _setNonAdjacentLinks.at(adjacentoptions);
 }
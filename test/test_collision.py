@@ -194,6 +194,31 @@ class RunCollision(EnvironmentSetup):
         assert(env.CheckCollision(env.GetKinBody('mug1')))
         assert(len(reports)==1)
 
+    def test_multienvironmentthreads(self):
+        self.log.debug('test checking collisions from several threads, each on its own cloned environment')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        target=env.GetKinBody('mug1')
+        with env:
+            gmodel = databases.grasping.GraspingModel(robot=robot,target=target)
+            approachrays = gmodel.computeBoxApproachRays(delta=0.04)[0:24]
+            approachrays[:,3:6] = -approachrays[:,3:6]
+            manip = robot.GetActiveManipulator()
+            robot.SetTransform(eye(4))
+            robot.SetActiveDOFs(manip.GetGripperIndices())
+            grasper = interfaces.Grasper(robot)
+            allresults = []
+            for numthreads in [1,4]:
+                # every thread of GraspThreaded works on its own clone of the environment
+                nextid, results = grasper.GraspThreaded(approachrays=approachrays, rolls=array([0,pi/2]), standoffs=array([0,0.025]), preshapes=array([robot.GetDOFValues(manip.GetGripperIndices())]), manipulatordirections=array([manip.GetLocalToolDirection()]), target=target, numthreads=numthreads)
+                assert(nextid == len(approachrays)*4)
+                allresults.append(sorted([(tuple(r[0]),tuple(r[1]),r[2],r[3],poseFromMatrix(r[8])) for r in results]))
+            assert(len(allresults[0]) == len(allresults[1]))
+            for r0, r1 in zip(allresults[0],allresults[1]):
+                assert(r0[0:4] == r1[0:4])
+                assert(transdist(r0[4],r1[4]) <= g_epsilon)
+
     def test_activedofdistance(self):
         self.log.debug('test distance computation with active dofs')
         env=self.env
@@ -222,6 +247,40 @@ class RunCollision(EnvironmentSetup):
             assert(report.plink1 == robot.GetLink('wam1'))
             assert(report.plink2 == env.GetKinBody('pole').GetLinks()[0])
 
+    def test_distance(self):
+        self.log.debug('test distance and penetration depth between convex hulls')
+        env=self.env
+        with env:
+            body1=RaveCreateKinBody(env,'')
+            body1.InitFromBoxes(array([[0,0,0,0.1,0.1,0.1]]),True)
+            body1.SetName('body1')
+            env.Add(body1,True)
+            body2=RaveCreateKinBody(env,'')
+            body2.InitFromSpheres(array([[0,0,0,0.1]]),True)
+            body2.SetName('body2')
+            env.Add(body2,True)
+            body2.SetTransform(matrixFromPose([1,0,0,0,0.5,0.05,0]))
+            
+            env.GetCollisionChecker().SetCollisionOptions(CollisionOptions.Distance)
+            report = CollisionReport()
+            assert(not env.CheckCollision(body1,body2,report=report))
+            assert(abs(report.minDistance-0.3) < 1e-5)
+            assert(report.plink1 == body1.GetLinks()[0])
+            assert(report.plink2 == body2.GetLinks()[0])
+            assert(len(report.contacts)==1)
+            assert(transdist(report.contacts[0].pos,[0.1,0.05,0]) < 1e-5)
+            assert(transdist(report.contacts[0].norm,[1,0,0]) < 1e-5)
+            
+            assert(not env.CheckCollision(body1,report=report))
+            assert(abs(report.minDistance-0.3) < 1e-5)
+            
+            body2.SetTransform(matrixFromPose([1,0,0,0,0.15,0.05,0]))
+            assert(env.CheckCollision(body1,body2,report=report))
+            assert(report.minDistance == 0)
+            assert(len(report.contacts)==1)
+            assert(abs(report.contacts[0].depth-0.05) < 1e-5)
+            env.GetCollisionChecker().SetCollisionOptions(0)
+
     def test_multiplecontacts(self):
         env=self.env
         env.GetCollisionChecker().SetCollisionOptions(CollisionOptions.AllLinkCollisions)
@@ -248,6 +307,146 @@ class test_ode(RunCollision):
     def __init__(self):
         RunCollision.__init__(self, 'ode')
 
+    def test_convexdecomposition(self):
+        self.log.debug('test colliding the convex decompositions of meshes')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            body1 = env.GetKinBody('mug1')
+            body2 = env.GetKinBody('mug2')
+            checker = env.GetCollisionChecker()
+            assert(checker.SendCommand('SetConvexDecomposition 1 usediskcache 0') is not None)
+            try:
+                body2.SetTransform(body1.GetTransform())
+                assert(env.CheckCollision(body1,body2))
+                report = CollisionReport()
+                checker.SetCollisionOptions(CollisionOptions.Contacts)
+                assert(env.CheckCollision(body1,body2,report=report))
+                assert(len(report.contacts)==1)
+                checker.SetCollisionOptions(0)
+
+                T = body1.GetTransform()
+                T[2,3] += 1.0
+                body2.SetTransform(T)
+                assert(not env.CheckCollision(body1,body2))
+            finally:
+                checker.SetCollisionOptions(0)
+                assert(checker.SendCommand('SetConvexDecomposition 0') is not None)
+
+    def test_selfcollisionpairorder(self):
+        self.log.debug('test that the link pairs that collided most are checked first')
+        testbody_xml="""<KinBody name="pairs">
+  <Body name="base" type="dynamic">
+    <Geom type="box"><extents>0.1 0.1 0.1</extents></Geom>
+  </Body>
+  <Body name="a" type="dynamic">
+    <Geom type="box"><translation>1 0 0</translation><extents>0.1 0.1 0.1</extents></Geom>
+  </Body>
+  <Body name="b" type="dynamic">
+    <Geom type="box"><translation>2 0 0</translation><extents>0.1 0.1 0.1</extents></Geom>
+  </Body>
+  <Body name="m" type="dynamic">
+    <Geom type="box"><translation>1.5 0 1</translation><extents>0.7 0.1 0.1</extents></Geom>
+  </Body>
+  <Joint name="ja" type="slider">
+    <Body>base</Body><Body>a</Body>
+    <axis>0 1 0</axis><limits>0 2</limits>
+  </Joint>
+  <Joint name="jb" type="slider">
+    <Body>base</Body><Body>b</Body>
+    <axis>0 1 0</axis><limits>0 2</limits>
+  </Joint>
+  <Joint name="jm" type="slider">
+    <Body>base</Body><Body>m</Body>
+    <axis>0 0 1</axis><limits>-1 0</limits>
+  </Joint>
+</KinBody>
+"""
+        env=self.env
+        with env:
+            body=env.ReadKinBodyData(testbody_xml)
+            env.Add(body)
+            assert(not body.CheckSelfCollision())
+            report = CollisionReport()
+            # m collides with both a and b
+            body.SetDOFValues([0,0,-1])
+            assert(body.CheckSelfCollision(report))
+            firstpair = set([report.plink1.GetName(),report.plink2.GetName()])
+            assert(firstpair == set(['a','m']) or firstpair == set(['b','m']))
+            otherlink = 'b' if 'a' in firstpair else 'a'
+            # only the other pair collides for a while
+            for i in range(3):
+                body.SetDOFValues([1.5 if otherlink == 'b' else 0, 1.5 if otherlink == 'a' else 0, -1])
+                assert(body.CheckSelfCollision(report))
+                assert(set([report.plink1.GetName(),report.plink2.GetName()]) == set([otherlink,'m']))
+            body.SetDOFValues([0,0,-1])
+            assert(body.CheckSelfCollision(report))
+            assert(set([report.plink1.GetName(),report.plink2.GetName()]) == set([otherlink,'m']))
+
+    def test_softwarerasterizer(self):
+        self.log.debug('test that the depth of the software renderer of the camera matches the rays of the flash lidar')
+        # the lidar casts its rays through the pixel corners, so its principal point is shifted by half a pixel to hit the pixel centers
+        sensors_xml="""<Robot name="sensors">
+  <KinBody>
+    <Body name="base" type="dynamic"/>
+  </KinBody>
+  <AttachedSensor name="camera">
+    <link>base</link>
+    <sensor type="BaseCamera">
+      <KK>60 60 32 24</KK>
+      <width>64</width>
+      <height>48</height>
+      <framerate>10</framerate>
+      <renderer>software</renderer>
+      <renderthreads>%d</renderthreads>
+    </sensor>
+  </AttachedSensor>
+  <AttachedSensor name="lidar">
+    <link>base</link>
+    <sensor type="BaseFlashLidar3D">
+      <KK>60 60 31.5 23.5</KK>
+      <width>64</width>
+      <height>48</height>
+      <maxrange>10</maxrange>
+      <scantime>0.1</scantime>
+    </sensor>
+  </AttachedSensor>
+</Robot>
+"""
+        scene_xml="""<KinBody name="boxes">
+  <Body name="front" type="static">
+    <Geom type="box"><translation>0 0 1</translation><rotationaxis>0 1 0 20</rotationaxis><extents>0.2 0.15 0.2</extents></Geom>
+  </Body>
+  <Body name="back" type="static">
+    <Geom type="box"><translation>0.2 0.1 2</translation><extents>0.5 0.5 0.05</extents></Geom>
+  </Body>
+</KinBody>
+"""
+        env=self.env
+        with env:
+            env.Add(env.ReadKinBodyData(scene_xml))
+            for renderthreads in [1,4]:
+                robot=self.LoadRobotData(sensors_xml%renderthreads)
+                camera = robot.GetAttachedSensor('camera').GetSensor()
+                lidar = robot.GetAttachedSensor('lidar').GetSensor()
+                for sensor in [camera,lidar]:
+                    sensor.Configure(Sensor.ConfigureCommand.PowerOn)
+                    sensor.SimulationStep(0.1)
+                depth = camera.GetSensorData(Sensor.Type.Camera).depthdata
+                assert(depth is not None and depth.shape == (48,64))
+                laserdata = lidar.GetSensorData(Sensor.Type.Laser)
+                # the lidar data is ordered by columns
+                ranges = reshape(laserdata.ranges,(64,48,3)).transpose(1,0,2)
+                hits = reshape(laserdata.intensity,(64,48)).transpose() > 0
+                raydepth = dot(ranges,lidar.GetTransform()[0:3,2])
+                rasterhits = depth > 0
+                assert(sum(hits) > 0.2*hits.size)
+                # only pixels on the silhouettes can disagree
+                assert(sum(hits != rasterhits) <= 0.05*hits.size)
+                bothhits = hits & rasterhits
+                assert(numpy.max(abs(depth[bothhits]-raydepth[bothhits])) <= 1e-3)
+                env.Remove(robot)
+
 # class test_bullet(RunCollision):
 #     def __init__(self):
 #         RunCollision.__init__(self, 'bullet')
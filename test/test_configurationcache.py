@@ -320,3 +320,96 @@ class TestConfigurationCache(EnvironmentSetup):
                 cachedcollisions, cachedcollisionhits, cachedfreehits, cachesize = cachechecker.SendCommand('GetSelfCacheStatistics').split()
                 assert(int(cachesize)==0)
                 self.log.info('self cache reset test passed')
+
+    def _LoadRobotInPlate(self):
+        """loads lab1 with the arm of the robot active and adds a plate that the bottom of the hand sinks into by 5mm. the caller has to lock the environment
+        """
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        manip=robot.GetActiveManipulator()
+        robot.SetActiveDOFs(manip.GetArmIndices())
+        lower = numpy.min([link.ComputeAABB().pos()-link.ComputeAABB().extents() for link in manip.GetChildLinks()],0)
+        upper = numpy.max([link.ComputeAABB().pos()+link.ComputeAABB().extents() for link in manip.GetChildLinks()],0)
+        plate = RaveCreateKinBody(env,'')
+        plate.SetName('plate')
+        plate.InitFromBoxes(array([[0.5*(lower[0]+upper[0]),0.5*(lower[1]+upper[1]),lower[2]-0.005,0.5*(upper[0]-lower[0]),0.5*(upper[1]-lower[1]),0.01]]),True)
+        env.Add(plate)
+        assert(env.CheckCollision(robot))
+        return robot,manip
+
+    def test_jitterthreads(self):
+        env=self.env
+        with env:
+            robot,manip = self._LoadRobotInPlate()
+            dofvalues = robot.GetDOFValues()
+
+            jitterer = RaveCreateSpaceSampler(env,'ConfigurationJitterer %s'%robot.GetName())
+            for biasdir in [[0,0,0.02],[0.02,0,0]]:
+                assert(jitterer.SendCommand('SetManipulatorBias %s %f %f %f'%(manip.GetName(),biasdir[0],biasdir[1],biasdir[2])) is not None)
+                for seed in range(3):
+                    # every batch is sampled on the calling thread, so the thread count does not change the result
+                    allvalues = []
+                    for numthreads in [1,4]:
+                        assert(jitterer.SendCommand('SetNumThreads %d 8'%numthreads) is not None)
+                        jitterer.SetSeed(seed)
+                        robot.SetDOFValues(dofvalues)
+                        allvalues.append(jitterer.SampleSequence(SampleDataType.Real,1))
+                    assert(len(allvalues[0]) == len(allvalues[1]))
+                    if len(allvalues[0]) > 0:
+                        assert(transdist(allvalues[0],allvalues[1]) <= g_epsilon)
+                        robot.SetActiveDOFValues(allvalues[0])
+                        assert(not env.CheckCollision(robot))
+                    elif biasdir[2] > 0:
+                        raise ValueError('failed to lift the hand out of the plate')
+            robot.SetDOFValues(dofvalues)
+
+    def test_jitterunbiased(self):
+        env=self.env
+        with env:
+            robot,manip = self._LoadRobotInPlate()
+            dofvalues = robot.GetDOFValues()
+
+            # without a bias only the random deltas of the joints move the robot
+            jitterer = RaveCreateSpaceSampler(env,'ConfigurationJitterer %s'%robot.GetName())
+            assert(jitterer.SendCommand('SetMaxLinkDistThresh 0.05') is not None)
+            for numthreads in [0,4]:
+                assert(jitterer.SendCommand('SetNumThreads %d'%numthreads) is not None)
+                jitterer.SetSeed(0)
+                robot.SetDOFValues(dofvalues)
+                values = jitterer.SampleSequence(SampleDataType.Real,1)
+                assert(len(values) == len(manip.GetArmIndices()))
+                robot.SetActiveDOFValues(values)
+                assert(not env.CheckCollision(robot))
+            robot.SetDOFValues(dofvalues)
+
+    def test_jitternullspace(self):
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot=env.GetRobots()[0]
+            manip=robot.GetActiveManipulator()
+            robot.SetActiveDOFs(manip.GetArmIndices())
+            assert(not env.CheckCollision(robot))
+            dofvalues = robot.GetDOFValues()
+            Tmanip = manip.GetTransform()
+
+            # the current configuration is only invalid because the tool direction has to turn by 0.02 radians
+            localdir = manip.GetLocalToolDirection()
+            globaldir = dot(dot(Tmanip[0:3,0:3],rotationMatrixFromAxisAngle([0.02,0,0])),localdir)
+            jitterer = RaveCreateSpaceSampler(env,'ConfigurationJitterer %s'%robot.GetName())
+            assert(jitterer.SendCommand('SetConstraintToolDirection %s %f %f %f %f %f %f %f'%(manip.GetName(),localdir[0],localdir[1],localdir[2],globaldir[0],globaldir[1],globaldir[2],cos(0.015))) is not None)
+            # only sample in the nullspace of the translation jacobian, the small bias keeps the first samples along the bias close
+            assert(jitterer.SendCommand('SetManipulatorBias %s 0 0 0.001 1 0 0'%manip.GetName()) is not None)
+            numfound = 0
+            for seed in range(5):
+                jitterer.SetSeed(seed)
+                robot.SetDOFValues(dofvalues)
+                values = jitterer.SampleSequence(SampleDataType.Real,1)
+                if len(values) > 0:
+                    numfound += 1
+                    robot.SetActiveDOFValues(values)
+                    # every nullspace vector only moves the end effector to second order
+                    assert(linalg.norm(manip.GetTransform()[0:3,3]-Tmanip[0:3,3]) <= 0.006)
+            assert(numfound > 0)
+            robot.SetDOFValues(dofvalues)
@@ -38,5 +38,46 @@ class TestDatabases(EnvironmentSetup):
             assert(out is not None)
             assert(manip.GetIkSolver() is not None)
             
+    def test_reachabilitythreads(self):
+        env=self.env
+        self.LoadEnv('robots/barrettwam.robot.xml')
+        robot=env.GetRobots()[0]
+        ikmodel = databases.inversekinematics.InverseKinematicsModel(robot=robot,iktype=IkParameterization.Type.Transform6D)
+        if not ikmodel.load():
+            ikmodel.autogenerate()
+        results = []
+        for numthreads in [1,4]:
+            rmodel = databases.kinematicreachability.ReachabilityModel(robot=robot)
+            rmodel.numthreads = numthreads
+            rmodel.generate(xyzdelta=0.2,quatdelta=1.0)
+            results.append(rmodel)
+        # every pose is solved independently, so the threads do not change the result
+        assert(results[0].reachability3d.shape == results[1].reachability3d.shape)
+        assert(all(results[0].reachability3d == results[1].reachability3d))
+        assert(all(results[0].reachabilitydensity3d == results[1].reachabilitydensity3d))
+        assert(sum(results[0].reachability3d) > 0)
+
+    def test_reachabilitygridcounts(self):
+        env=self.env
+        self.LoadEnv('robots/barrettwam.robot.xml')
+        robot=env.GetRobots()[0]
+        rmodel = databases.kinematicreachability.ReachabilityModel(robot=robot)
+        # a free joint can give more than 255 solutions, which the uint8 counts of version 1 could not hold
+        filename = 'test_reachabilitygridcounts.bin'
+        with open(filename,'wb') as f:
+            array([0x4d52524f,2,2,1],uint32).tofile(f)
+            array([1],int32).tofile(f)
+            array([0.1,0,0,0],float64).tofile(f)
+            array([[1,0,0,0],[0,1,0,0]],float64).tofile(f)
+            array([3],int32).tofile(f)
+            array([[300,0]],uint32).tofile(f)
+        try:
+            rmodel.LoadReachabilityGrid(filename)
+        finally:
+            os.remove(filename)
+        assert(rmodel.reachabilitydensity3d.flat[3] == 150)
+        assert(rmodel.reachability3d.flat[3] == 0.5)
+        assert(len(rmodel.reachabilitystats) == 1 and rmodel.reachabilitystats[0][-1] == 300)
+
 #     def test_database_paths(self):
 #         pass
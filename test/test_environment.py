@@ -262,3 +262,194 @@ class TestEnvironment(EnvironmentSetup):
         # thread is done, so should be able to lock
         assert(env.Lock(1.0))
         env.Unlock()
+
+    def test_textserverbinary(self):
+        import socket, struct
+        env=self.env
+        robot=self.LoadRobot('robots/barrettwam.robot.xml')
+        port = 4767
+        server=RaveCreateModule(env,'textserver')
+        env.Add(server,True,'%d'%port)
+        s = None
+        for i in range(50):
+            try:
+                s = socket.create_connection(('localhost',port),10)
+                break
+            except socket.error:
+                time.sleep(0.1)
+        assert(s is not None)
+        try:
+            def recvall(size):
+                data = ''
+                while len(data) < size:
+                    chunk = s.recv(size-len(data))
+                    assert(len(chunk) > 0)
+                    data += chunk
+                return data
+            def recvreply():
+                size = struct.unpack('=i',recvall(4))[0]
+                return None if size < 0 else recvall(size)
+            def sendframe(cmd,args):
+                frame = cmd+'\0'+args
+                s.sendall(struct.pack('=i',len(frame))+frame)
+
+            s.sendall('setprotocol binary\n')
+            assert(recvreply() == 'binary')
+            lower,upper = robot.GetDOFLimits()
+            newvalues = lower+0.5*(upper-lower)
+            sendframe('bodies_setjoints',struct.pack('=iii',1,robot.GetEnvironmentId(),len(newvalues))+struct.pack('=%dd'%len(newvalues),*newvalues))
+            assert(struct.unpack('=i',recvreply())[0] == 1)
+            sendframe('bodies_getjoints',struct.pack('=ii',1,robot.GetEnvironmentId()))
+            reply = recvreply()
+            num,bodyid,dof = struct.unpack('=iii',reply[0:12])
+            assert(num == 1 and bodyid == robot.GetEnvironmentId() and dof == robot.GetDOF())
+            assert(transdist(array(struct.unpack('=%dd'%dof,reply[12:])),newvalues) <= g_epsilon)
+            with env:
+                assert(transdist(robot.GetDOFValues(),newvalues) <= g_epsilon)
+            # errors are replies of size -1
+            sendframe('bodies_getjoints',struct.pack('=ii',1,100000))
+            assert(recvreply() is None)
+            # failing set commands also reply so that the client does not wait forever
+            sendframe('bodies_setjoints',struct.pack('=iii',1,robot.GetEnvironmentId(),robot.GetDOF()+1))
+            assert(recvreply() is None)
+            sendframe('bodies_settransforms',struct.pack('=ii',1,100000)+struct.pack('=7d',1,0,0,0,0,0,0))
+            assert(recvreply() is None)
+            # text commands are still available
+            sendframe('body_getdof','%d'%robot.GetEnvironmentId())
+            assert(int(recvreply()) == robot.GetDOF())
+        finally:
+            s.close()
+            env.Remove(server)
+
+    def test_sharedscene(self):
+        import ctypes, ctypes.util
+        from openravepy import __version__ as openraveversion
+        env=self.env
+        robot=self.LoadRobot('robots/barrettwam.robot.xml')
+        libname = ctypes.util.find_library('openrave%s-sharedscene'%'.'.join(openraveversion.split('.')[0:2]))
+        assert(libname is not None)
+        lib = ctypes.CDLL(libname)
+        # structures of sharedscene.h
+        class orss_frame(ctypes.Structure):
+            _fields_ = [('publishindex',ctypes.c_uint64),('simulationtime',ctypes.c_uint64),('numbodies',ctypes.c_uint32),('reserved',ctypes.c_uint32)]
+        class orss_body(ctypes.Structure):
+            _fields_ = [('environmentid',ctypes.c_int32),('updatestamp',ctypes.c_int32),('numlinks',ctypes.c_uint32),('numdof',ctypes.c_uint32),('linkoffset',ctypes.c_uint64),('dofoffset',ctypes.c_uint64),('name',ctypes.c_char*64)]
+        class orss_reader(ctypes.Structure):
+            _fields_ = [('fd',ctypes.c_int),('pdata',ctypes.c_void_p),('size',ctypes.c_size_t),('header',ctypes.c_void_p)]
+        lib.orss_open.argtypes = [ctypes.POINTER(orss_reader),ctypes.c_char_p]
+        lib.orss_close.argtypes = [ctypes.POINTER(orss_reader)]
+        lib.orss_read_begin.argtypes = [ctypes.POINTER(orss_reader),ctypes.POINTER(ctypes.c_uint64)]
+        lib.orss_read_begin.restype = ctypes.c_void_p
+        lib.orss_read_end.argtypes = [ctypes.POINTER(orss_reader),ctypes.c_uint64]
+
+        segmentname = '/openrave_test_sharedscene'
+        server=RaveCreateModule(env,'SharedSceneServer')
+        env.Add(server,True,'name %s period 0.001'%segmentname)
+        try:
+            with env:
+                lower,upper = robot.GetDOFLimits()
+                values = lower+0.3*(upper-lower)
+                robot.SetDOFValues(values)
+                env.UpdatePublishedBodies()
+                linkposes = [poseFromMatrix(link.GetTransform()) for link in robot.GetLinks()]
+            reader = orss_reader()
+            assert(lib.orss_open(ctypes.byref(reader),segmentname) == 0)
+            try:
+                token = ctypes.c_uint64()
+                bread = False
+                for itry in range(1000):
+                    pframe = lib.orss_read_begin(ctypes.byref(reader),ctypes.byref(token))
+                    frame = orss_frame.from_address(pframe)
+                    bodies = [orss_body.from_address(pframe+ctypes.sizeof(orss_frame)+i*ctypes.sizeof(orss_body)) for i in range(frame.numbodies)]
+                    robotbodies = [body for body in bodies if body.environmentid == robot.GetEnvironmentId()]
+                    if len(robotbodies) == 1 and robotbodies[0].updatestamp == robot.GetUpdateStamp():
+                        body = robotbodies[0]
+                        readvalues = array((ctypes.c_double*body.numdof).from_address(pframe+body.dofoffset))
+                        readposes = reshape(array((ctypes.c_double*(7*body.numlinks)).from_address(pframe+body.linkoffset)),(body.numlinks,7))
+                        name = body.name
+                        if lib.orss_read_end(ctypes.byref(reader),token.value):
+                            bread = True
+                            break
+                    time.sleep(0.01)
+                assert(bread)
+                assert(name == robot.GetName())
+                assert(transdist(readvalues,values) <= g_epsilon)
+                assert(transdist(readposes,array(linkposes)) <= g_epsilon)
+            finally:
+                lib.orss_close(ctypes.byref(reader))
+        finally:
+            env.Remove(server)
+
+    def test_performancecounters(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        def GetCounters():
+            counters = {}
+            for line in env.SendCommand('GetPerformanceCounters').splitlines():
+                if not line.startswith('#'):
+                    name,calls,totaltime,meantime = line.split()
+                    counters[name] = int(calls)
+            return counters
+        
+        assert(env.SendCommand('SetPerformanceCounters 1') is not None)
+        assert(env.SendCommand('ResetPerformanceCounters') is not None)
+        with env:
+            for i in range(10):
+                robot.SetDOFValues(robot.GetDOFValues())
+                env.CheckCollision(robot)
+                robot.CheckSelfCollision()
+        counters = GetCounters()
+        assert(counters['SetDOFValues'] >= 10)
+        assert(counters['CheckCollision'] >= 10)
+        assert(counters['CheckSelfCollision'] >= 10)
+        assert(env.SendCommand('ResetPerformanceCounters') is not None)
+        assert(GetCounters()['SetDOFValues'] == 0)
+        
+        # disabled counters do not count
+        assert(env.SendCommand('SetPerformanceCounters 0') is not None)
+        with env:
+            env.CheckCollision(robot)
+        assert(GetCounters()['CheckCollision'] == 0)
+
+    def test_chrometrace(self):
+        import json
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        assert(env.SendCommand('SetTracing 1 16') is not None)
+        assert(env.SendCommand('ClearTrace') is not None)
+        try:
+            with env:
+                for i in range(20):
+                    env.CheckCollision(robot)
+            events = json.loads(env.SendCommand('GetChromeTrace'))['traceEvents']
+            checkevents = [event for event in events if event['name'] == 'EnvironmentBase::CheckCollision']
+            # ring buffer only keeps the last events
+            assert(len(checkevents) > 0 and len(events) <= 16*10)
+            for event in checkevents:
+                assert(event['ph'] == 'X' and event['dur'] >= 0)
+            assert(env.SendCommand('ClearTrace') is not None)
+            assert(len(json.loads(env.SendCommand('GetChromeTrace'))['traceEvents']) == 0)
+        finally:
+            env.SendCommand('SetTracing 0')
+
+    def test_asynclogging(self):
+        env=self.env
+        assert(env.SendCommand('AddLogSink memory 100') is not None)
+        assert(env.SendCommand('SetAsyncLogging 1 5') is not None)
+        try:
+            for i in range(3):
+                RaveLogWarn('asynclogging message %d'%i)
+            # repeated messages are limited to 5 per second
+            for i in range(20):
+                RaveLogWarn('asynclogging repeated')
+            assert(env.SendCommand('FlushLog') is not None)
+            lines = [line for line in env.SendCommand('GetLog').splitlines() if line.find('asynclogging') >= 0]
+            for i in range(3):
+                assert(len([line for line in lines if line.endswith('asynclogging message %d'%i)]) == 1)
+            assert(len([line for line in lines if line.endswith('asynclogging repeated')]) == 5)
+            assert(len([line for line in lines if line.find('suppressed 15 repeated log messages') >= 0]) == 1)
+        finally:
+            env.SendCommand('SetAsyncLogging 0')
+            env.SendCommand('ClearLogSinks')
@@ -733,6 +733,39 @@ class TestKinematics(EnvironmentSetup):
             assert( transdist(anchors, [j.GetAnchor() for j in robot.GetJoints()]) <= g_epsilon )
             assert( transdist(axes, [j.GetAxis(0) for j in robot.GetJoints()]) <= g_epsilon )
 
+    def test_updatestampcallback(self):
+        env=self.env
+        robot=self.LoadRobot('robots/barrettwam.robot.xml')
+        with env:
+            calls = []
+            handle = robot.RegisterUpdateStampCallback(lambda: calls.append(robot.GetUpdateStamp()))
+            stamp = robot.GetUpdateStamp()
+            robot.SetDOFValues([0.5],[0])
+            # called once on the first change after registering even though every link moved
+            assert(len(calls) == 1 and calls[0] > stamp)
+            robot.SetDOFValues([0.2],[0])
+            assert(len(calls) == 1)
+            robot.ArmUpdateStampCallbacks()
+            robot.GetLinks()[1].SetTransform(robot.GetLinks()[1].GetTransform())
+            assert(len(calls) == 2 and calls[-1] == robot.GetUpdateStamp())
+            robot.ArmUpdateStampCallbacks()
+            del handle
+            robot.SetDOFValues([0.5],[0])
+            assert(len(calls) == 2)
+
+            # a callback releasing its own handle and registering a new one must not deadlock on the interface mutex
+            handles = []
+            def releaseandregister():
+                calls.append(robot.GetUpdateStamp())
+                del handles[:]
+                handles.append(robot.RegisterUpdateStampCallback(lambda: calls.append(robot.GetUpdateStamp())))
+            handles.append(robot.RegisterUpdateStampCallback(releaseandregister))
+            robot.GetLinks()[1].SetTransform(robot.GetLinks()[1].GetTransform())
+            assert(len(calls) == 3 and len(handles) == 1)
+            # the new callback is armed when registered
+            robot.SetDOFValues([0.2],[0])
+            assert(len(calls) == 4)
+
     def test_jointoffset(self):
         env=self.env
         with env:
@@ -875,6 +908,32 @@ class TestKinematics(EnvironmentSetup):
         assert(J0a.GetMimicDOFIndices() == [0])
         assert(J0b.GetMimicDOFIndices() == [0])
 
+    def test_partialdofvalues(self):
+        self.log.info('check that setting a subset of the DOFs gives the same link transforms as setting all of them')
+        env=self.env
+        robot=self.LoadRobot('robots/pr2-beta-static.zae')
+        with env:
+            lower,upper = robot.GetDOFLimits()
+            manip=robot.GetManipulator('leftarm')
+            armindices = manip.GetArmIndices()
+            for itry in range(20):
+                values = lower+random.rand(len(lower))*(upper-lower)
+                robot.SetDOFValues(values)
+                armvalues = lower[armindices]+random.rand(len(armindices))*(upper[armindices]-lower[armindices])
+                robot.SetDOFValues(armvalues,armindices)
+                Tlinks = robot.GetLinkTransformations()
+                values[armindices] = armvalues
+                robot.SetDOFValues(values)
+                assert(all([transdist(T0,T1) <= g_epsilon for T0,T1 in izip(Tlinks,robot.GetLinkTransformations())]))
+
+                robot.SetActiveDOFs(armindices)
+                armvalues = lower[armindices]+random.rand(len(armindices))*(upper[armindices]-lower[armindices])
+                robot.SetActiveDOFValues(armvalues)
+                Tlinks = robot.GetLinkTransformations()
+                values[armindices] = armvalues
+                robot.SetDOFValues(values)
+                assert(all([transdist(T0,T1) <= g_epsilon for T0,T1 in izip(Tlinks,robot.GetLinkTransformations())]))
+
     def test_specification(self):
         env=self.env
         self.LoadEnv('data/lab1.env.xml')
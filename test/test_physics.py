@@ -267,6 +267,31 @@ class RunPhysics(EnvironmentSetup):
             for i in range(10):
                 env.StepSimulation(0.01)
 
+    def test_contactthreads(self):
+        if self.physicsenginename != 'ode':
+            return
+        log.info('test that contact generation threads do not change the simulation')
+        self.LoadEnv('data/hanoi.env.xml')
+        env=self.env
+        env2=env.CloneSelf(CloningOptions.Bodies)
+        try:
+            results = []
+            for curenv, numthreads in [(env,1),(env2,4)]:
+                with curenv:
+                    curenv.SetPhysicsEngine(RaveCreatePhysicsEngine(curenv,self.physicsenginename))
+                    physics = curenv.GetPhysicsEngine()
+                    physics.SetGravity([0,0,-9.81])
+                    physics.SendCommand('SetContactThreads %d'%numthreads)
+                    physics.SendCommand('ResetTimings')
+                    for i in range(100):
+                        curenv.StepSimulation(0.01)
+                    timings = [float(f) for f in physics.SendCommand('GetTimings').split()]
+                    assert(len(timings) == 7 and timings[0] == 100)
+                    results.append([body.GetTransform() for body in curenv.GetBodies()])
+            assert(transdist(results[0],results[1]) <= g_epsilon)
+        finally:
+            env2.Destroy()
+
 #generate_classes(RunPhysics, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunPhysics):
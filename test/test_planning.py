@@ -50,6 +50,107 @@ class RunPlanning(EnvironmentSetup):
             useddofindices, usedconfigindices = spec.ExtractUsedIndices(robot)
             assert(sorted(useddofindices) == sorted(manip.GetArmIndices()))
             
+    def test_edgevaliditycache(self):
+        env = self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            manip = robot.GetActiveManipulator()
+            robot.SetActiveDOFs(manip.GetArmIndices())
+            basemanip = interfaces.BaseManipulation(robot)
+            assert(basemanip.SetEdgeValidityCache(1000))
+            parameters = Planner.PlannerParameters()
+            parameters.SetRobotActiveJoints(robot)
+            lower,upper = robot.GetActiveDOFLimits()
+            zero = zeros(robot.GetActiveDOF())
+            edges = [(lower+random.rand(len(lower))*(upper-lower), lower+random.rand(len(lower))*(upper-lower)) for i in range(10)]
+            with robot:
+                results = [parameters.CheckPathAllConstraints(q0,q1,zero,zero,0,Interval.Closed) for q0,q1 in edges]
+                hits,misses,numedges = basemanip.GetEdgeValidityCacheStatistics()
+                assert(hits == 0 and misses == len(edges) and numedges == len(edges))
+                # same edges and any of their sub-intervals are reused
+                assert([parameters.CheckPathAllConstraints(q0,q1,zero,zero,0,Interval.Closed) for q0,q1 in edges] == results)
+                for (q0,q1),result in zip(edges,results):
+                    if result == 0:
+                        assert(parameters.CheckPathAllConstraints(q0,q1,zero,zero,0,Interval.OpenStart) == 0)
+                hits,misses,numedges = basemanip.GetEdgeValidityCacheStatistics()
+                assert(misses == len(edges) and hits >= len(edges))
+
+                # moving any other body discards all edges
+                body = [body for body in env.GetBodies() if body != robot][0]
+                body.SetTransform(body.GetTransform())
+                parameters.CheckPathAllConstraints(edges[0][0],edges[0][1],zero,zero,0,Interval.Closed)
+                hits,misses,numedges = basemanip.GetEdgeValidityCacheStatistics()
+                assert(numedges == 1)
+
+                # so does disabling a link or changing the checker options
+                link = robot.GetLinks()[-1]
+                link.Enable(False)
+                parameters.CheckPathAllConstraints(edges[0][0],edges[0][1],zero,zero,0,Interval.Closed)
+                link.Enable(True)
+                parameters.CheckPathAllConstraints(edges[0][0],edges[0][1],zero,zero,0,Interval.Closed)
+                hits,misses,numedges = basemanip.GetEdgeValidityCacheStatistics()
+                assert(numedges == 1 and misses == len(edges)+3)
+                with CollisionOptionsStateSaver(env.GetCollisionChecker(),CollisionOptions.Contacts):
+                    parameters.CheckPathAllConstraints(edges[0][0],edges[0][1],zero,zero,0,Interval.Closed)
+                hits,misses,numedges = basemanip.GetEdgeValidityCacheStatistics()
+                assert(numedges == 1 and misses == len(edges)+4)
+                parameters.CheckPathAllConstraints(edges[0][0],edges[0][1],zero,zero,0,Interval.Closed)
+                parameters.CheckPathAllConstraints(edges[0][0],edges[0][1],zero,zero,0,Interval.Closed)
+                hits,misses,numedges = basemanip.GetEdgeValidityCacheStatistics()
+                assert(numedges == 1 and misses == len(edges)+5)
+
+                # adding a body is noticed through the environment callback
+                newbody = RaveCreateKinBody(env,'')
+                newbody.InitFromBoxes(array([[5,5,5,0.1,0.1,0.1]]),True)
+                newbody.SetName('edgevaliditycachebox')
+                env.Add(newbody)
+                parameters.CheckPathAllConstraints(edges[0][0],edges[0][1],zero,zero,0,Interval.Closed)
+                hits,misses,numedges = basemanip.GetEdgeValidityCacheStatistics()
+                assert(numedges == 1 and misses == len(edges)+6)
+                env.Remove(newbody)
+            assert(basemanip.SetEdgeValidityCache(0))
+
+    def test_continuouscollision(self):
+        env = self.env
+        with env:
+            robot = self.LoadRobot('robots/barrettwam.robot.xml')
+            robot.SetActiveDOFs([1])
+            resolutions = robot.GetDOFResolutions()
+            resolutions[1] = 1.0
+            robot.SetDOFResolutions(resolutions)
+            link = robot.GetLinks()[4]
+            robot.SetActiveDOFValues([0.2])
+            pdelta = link.GetTransform()[0:3,3]
+            robot.SetActiveDOFValues([0])
+            pcenter = link.GetTransform()[0:3,3]
+            pdelta -= pcenter
+            # thin plate that the elbow sweeps through between the two resolution steps. It is thicker than the smallest
+            # advance of conservative advancement, which is a fraction of the resolution step
+            plate = RaveCreateKinBody(env,'')
+            plate.SetName('plate')
+            plate.InitFromBoxes(array([[0,0,0,0.01,0.1,0.1]]),True)
+            T = matrixFromQuat(quatRotateDirection([1,0,0],pdelta/linalg.norm(pdelta)))
+            T[0:3,3] = pcenter
+            plate.SetTransform(T)
+            env.Add(plate)
+            assert(env.CheckCollision(robot,plate))
+            q0 = array([-0.8])
+            q1 = array([0.8])
+            zero = zeros(1)
+            for q in [q0,q1]:
+                robot.SetActiveDOFValues(q)
+                assert(not env.CheckCollision(robot) and not robot.CheckSelfCollision())
+            parameters = Planner.PlannerParameters()
+            parameters.SetRobotActiveJoints(robot)
+            with robot:
+                # only the endpoints are checked at this resolution
+                assert(parameters.CheckPathAllConstraints(q0,q1,zero,zero,0,Interval.Closed) == 0)
+                # CFO_CheckContinuousCollisions
+                assert(parameters.CheckPathAllConstraints(q0,q1,zero,zero,0,Interval.Closed,0xffff|0x80000) != 0)
+                env.Remove(plate)
+                assert(parameters.CheckPathAllConstraints(q0,q1,zero,zero,0,Interval.Closed,0xffff|0x80000) == 0)
+
     def test_ikplanning(self):
         env = self.env
         self.LoadEnv('data/lab1.env.xml')
@@ -186,7 +287,31 @@ class RunPlanning(EnvironmentSetup):
             env2 = Environment()
             env2.Clone(env,CloningOptions.Bodies|CloningOptions.Simulation)
             misc.CompareEnvironments(env,env2,epsilon=g_epsilon)
-            
+
+    def test_grasperconservativeadvancement(self):
+        env = self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        target=env.GetKinBody('mug1')
+        with env:
+            gmodel = databases.grasping.GraspingModel(robot=robot,target=target)
+            approachrays = gmodel.computeBoxApproachRays(delta=0.04)[0:16]
+            approachrays[:,3:6] = -approachrays[:,3:6]
+            manip = robot.GetActiveManipulator()
+            robot.SetTransform(eye(4))
+            robot.SetActiveDOFs(manip.GetGripperIndices())
+            grasper = interfaces.Grasper(robot)
+            allresults = []
+            for conservativeadvancement in [False,True]:
+                nextid, results = grasper.GraspThreaded(approachrays=approachrays, rolls=array([0]), standoffs=array([0]), preshapes=array([robot.GetDOFValues(manip.GetGripperIndices())]), manipulatordirections=array([manip.GetLocalToolDirection()]), target=target, numthreads=2, conservativeadvancement=conservativeadvancement)
+                allresults.append(sorted([(tuple(r[0]),tuple(r[1]),poseFromMatrix(r[8]),r[9]) for r in results]))
+            # only the coarse steps away from contact are longer, so the same grasps are found
+            assert(len(allresults[0]) == len(allresults[1]))
+            for r0, r1 in zip(allresults[0],allresults[1]):
+                assert(r0[0:2] == r1[0:2])
+                assert(transdist(r0[2],r1[2]) <= 0.01)
+                assert(transdist(r0[3],r1[3]) <= 0.05)
+
     def test_movehandstraight(self):
         env = self.env
         with env:
@@ -615,6 +740,90 @@ class RunPlanning(EnvironmentSetup):
             assert(success)
             assert(not env.CheckCollision(collisionbody))
 
+    def test_visibilitythreads(self):
+        env=self.env
+        robot=self.LoadRobot('robots/pa10schunk.robot.xml')
+        target=env.ReadKinBodyURI('data/box_frootloops.kinbody.xml')
+        env.Add(target,True)
+        vmodel = databases.visibilitymodel.VisibilityModel(robot=robot,target=target)
+        with env:
+            results = []
+            # the last call is the same as the first and comes from the cache
+            for numthreads in [1,4,1]:
+                results.append(vmodel.visualprob.ProcessVisibilityExtents(sphere=[3,0.1,0.2],numthreads=numthreads))
+            assert(len(results[0]) > 0)
+            for result in results[1:]:
+                assert(result.shape == results[0].shape)
+                assert(transdist(result,results[0]) <= g_epsilon)
+
+    def test_randomizedastar(self):
+        env=self.env
+        robot=self.LoadRobot('robots/barrettwam.robot.xml')
+        with env:
+            manip = robot.GetActiveManipulator()
+            # the default goal of RAStar is the manipulator at the origin, so move the robot so that it is reachable in the plane
+            Tgoal = eye(4)
+            Tgoal[0:3,3] = -manip.GetTransform()[0:3,3]
+            robot.SetActiveDOFs([],DOFAffine.X|DOFAffine.Y)
+            planner = RaveCreatePlanner(env,'RAStar')
+            # the same planner plans several times to reuse its node pool
+            for i in range(3):
+                T = array(Tgoal)
+                T[0:2,3] += 0.2+0.2*random.rand(2)
+                robot.SetTransform(T)
+                params = Planner.PlannerParameters()
+                params.SetRobotActiveJoints(robot)
+                params.SetExtraParameters('<radius>0.05</radius><distthresh>0.01</distthresh>')
+                assert(planner.InitPlan(robot,params))
+                traj = RaveCreateTrajectory(env,'')
+                assert(planner.PlanPath(traj) == PlannerStatus.HasSolution)
+                assert(transdist(traj.GetWaypoint(0),T[0:2,3]) <= g_epsilon)
+                robot.SetActiveDOFValues(traj.GetWaypoint(-1))
+                assert(transdist(manip.GetTransform()[0:3,3],zeros(3)) <= 0.01)
+                planningutils.VerifyTrajectory(params,traj,samplingstep=0.005)
+
+    def test_workspacetrackerthreads(self):
+        env = self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            ikmodel = databases.inversekinematics.InverseKinematicsModel(robot=robot,iktype=IkParameterization.Type.Transform6D)
+            if not ikmodel.load():
+                ikmodel.autogenerate()
+            manip = robot.GetActiveManipulator()
+            robot.SetDOFValues([-0.26085414,  1.37967815,  0.        ,  0.60871186, -3.14159265, -1.15320264, -0.26085414,  0.        ,  0.        ,  0.        ,  0.        ])
+            robot.SetActiveDOFs(manip.GetArmIndices())
+            assert(not env.CheckCollision(robot))
+            # move the hand straight down, there are more poses than one batch of the threads
+            Tee = manip.GetTransform()
+            workspacetraj = RaveCreateTrajectory(env,'')
+            workspacetraj.Init(IkParameterization.GetConfigurationSpecificationFromType(IkParameterizationType.Transform6D,'linear'))
+            for i in range(40):
+                T = array(Tee)
+                T[2,3] -= 0.001*i
+                workspacetraj.Insert(workspacetraj.GetNumWaypoints(),poseFromMatrix(T))
+            planningutils.RetimeAffineTrajectory(workspacetraj,maxvelocities=ones(7),maxaccelerations=5*ones(7))
+            spec = robot.GetActiveConfigurationSpecification()
+            planner = RaveCreatePlanner(env,'workspacetrajectorytracker')
+            allvalues = []
+            # the environment clones of the threads are kept across PlanPath calls, so 4 threads are run twice
+            for numthreads,predictiksolution in [(0,0),(1,0),(4,0),(4,0),(0,1),(4,1)]:
+                params = Planner.PlannerParameters()
+                params.SetRobotActiveJoints(robot)
+                params.SetExtraParameters('<numthreads>%d</numthreads><predictiksolution>%d</predictiksolution><workspacetrajectory>%s</workspacetrajectory>'%(numthreads,predictiksolution,workspacetraj.serialize(0)))
+                assert(planner.InitPlan(robot,params))
+                outputtraj = RaveCreateTrajectory(env,'')
+                assert(planner.PlanPath(outputtraj) == PlannerStatus.HasSolution)
+                values = spec.ExtractJointValues(outputtraj.GetWaypoint(-1),robot,manip.GetArmIndices(),0)
+                with robot:
+                    robot.SetActiveDOFValues(values)
+                    assert(transdist(manip.GetTransform(),T) <= 1e-3)
+                allvalues.append(values)
+            # the batched collision checks only change when the poses are checked, so the same solution is found
+            for values in allvalues[1:4]:
+                assert(transdist(values,allvalues[0]) <= g_epsilon)
+            assert(transdist(allvalues[5],allvalues[4]) <= g_epsilon)
+
 #generate_classes(RunPlanning, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunPlanning):
@@ -56,3 +56,21 @@ class TestSampling(EnvironmentSetup):
         robot.SetActiveDOFs(range(robot.GetDOF()-4),Robot.DOFAffine.X|Robot.DOFAffine.Y|Robot.DOFAffine.RotationAxis,[0,0,1])
         values = sp.SampleSequence(SampleDataType.Real,1)
         assert(len(values[0]) == robot.GetActiveDOF())
+
+    def test_philox(self):
+        sp=RaveCreateSpaceSampler(self.env,'Philox')
+        sp.SetSeed(10)
+        values = sp.SampleSequence(SampleDataType.Uint32,11)
+        # sequence is independent of the request sizes
+        sp.SetSeed(10)
+        values2 = r_[sp.SampleSequence(SampleDataType.Uint32,3),sp.SampleSequence(SampleDataType.Uint32,8)]
+        assert(all(values==values2))
+        # jump ahead
+        sp.SetSeed(10)
+        sp.SendCommand('Skip 5')
+        assert(int(sp.SendCommand('GetCounter'))==5)
+        assert(all(sp.SampleSequence(SampleDataType.Uint32,6)==values[5:]))
+        # streams of the same seed differ
+        sp2=RaveCreateSpaceSampler(self.env,'Philox 1')
+        sp2.SetSeed(10)
+        assert(any(sp2.SampleSequence(SampleDataType.Uint32,11)!=values))
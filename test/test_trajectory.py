@@ -363,6 +363,45 @@ class TestTrajectory(EnvironmentSetup):
             ret=planningutils.RetimeActiveDOFTrajectory(traj,robot,False,maxvelmult=1,maxaccelmult=1,plannername='parabolictrajectoryretimer',plannerparameters='<multidofinterp>1</multidofinterp>')
             assert(ret==PlannerStatus.HasSolution)
 
+    def test_batchretiming(self):
+        env=self.env
+        env.Load('robots/barrettwam.robot.xml')
+        with env:
+            robot=env.GetRobots()[0]
+            robot.SetActiveDOFs(range(7))
+            lower,upper = robot.GetActiveDOFLimits()
+            parameters = Planner.PlannerParameters()
+            parameters.SetRobotActiveJoints(robot)
+            trajs = []
+            for i in range(20):
+                traj = RaveCreateTrajectory(env,'')
+                traj.Init(robot.GetActiveConfigurationSpecification())
+                traj.Insert(0,zeros(robot.GetActiveDOF()))
+                traj.Insert(1,numpy.minimum(0.05*(i+1),upper))
+                trajs.append(traj)
+            # a single waypoint only gets a time group
+            traj = RaveCreateTrajectory(env,'')
+            traj.Init(robot.GetActiveConfigurationSpecification())
+            traj.Insert(0,zeros(robot.GetActiveDOF()))
+            trajs.append(traj)
+
+            expectedtrajs = [RaveClone(traj,0) for traj in trajs]
+            for traj in expectedtrajs:
+                assert(planningutils.RetimeActiveDOFTrajectory(traj,robot,False,plannername='parabolictrajectoryretimer')==PlannerStatus.HasSolution)
+
+            for numthreads in [1,4]:
+                batchretimer = planningutils.ActiveDOFTrajectoryBatchPlanner(robot,numthreads,False,'parabolictrajectoryretimer','')
+                assert(batchretimer.GetNumThreads()==numthreads)
+                # call twice to reuse the planners
+                for itry in range(2):
+                    testtrajs = [RaveClone(traj,0) for traj in trajs]
+                    statuses = batchretimer.PlanPaths(testtrajs,False)
+                    assert(len(statuses)==len(testtrajs))
+                    for status,testtraj,expectedtraj in izip(statuses,testtrajs,expectedtrajs):
+                        assert(status==PlannerStatus.HasSolution)
+                        assert(abs(testtraj.GetDuration()-expectedtraj.GetDuration()) <= g_epsilon)
+                        planningutils.VerifyTrajectory(parameters,testtraj,samplingstep=0.002)
+
     def test_simpleretiming(self):
         env=self.env
         robot=self.LoadRobot('robots/pumaarm.zae')
@@ -834,3 +873,37 @@ class TestTrajectory(EnvironmentSetup):
             assert( sum(abs(traj.GetWaypoint(-1, robot.GetActiveConfigurationSpecification())-jitteredgoal)) <= g_epsilon)
             planningutils.VerifyTrajectory(parameters, traj,0.01)
             
+
+    def test_samplespecconversion(self):
+        self.log.debug('sampling with a different specification uses a cached conversion plan')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            trajspec = robot.GetConfigurationSpecification('linear')
+            trajspec.AddDeltaTimeGroup()
+            traj = RaveCreateTrajectory(env,'')
+            traj.Init(trajspec)
+            lower,upper = robot.GetDOFLimits()
+            for i in range(3):
+                waypoint = zeros(trajspec.GetDOF())
+                trajspec.InsertJointValues(waypoint,lower+(upper-lower)*(0.2+0.3*i),robot,range(robot.GetDOF()),0)
+                trajspec.InsertDeltaTime(waypoint,0.5 if i > 0 else 0)
+                traj.Insert(i,waypoint,trajspec)
+            
+            indices = [5,2,0]
+            samplespec = robot.GetConfigurationSpecificationIndices(indices)
+            # the velocities are not in the trajectory, so they are filled with zeros
+            velspec = samplespec + robot.GetConfigurationSpecificationIndices([1,3]).ConvertToDerivativeSpecification(1)
+            fullspec = traj.GetConfigurationSpecification()
+            for t in [0,0.3,0.5,0.9,1.0,2.0]:
+                full = traj.Sample(t)
+                expected = fullspec.ExtractJointValues(full,robot,indices,0)
+                for spec in [samplespec,velspec,samplespec]:
+                    data = traj.Sample(t,spec)
+                    assert(transdist(spec.ExtractJointValues(data,robot,indices,0),expected) <= g_epsilon)
+                data = traj.Sample(t,velspec)
+                assert(transdist(velspec.ExtractJointValues(data,robot,[1,3],1),[0,0]) <= g_epsilon)
+            waypoints = traj.GetWaypoints(0,traj.GetNumWaypoints(),samplespec)
+            for i in range(traj.GetNumWaypoints()):
+                assert(transdist(waypoints[i*3:(i+1)*3],fullspec.ExtractJointValues(traj.GetWaypoint(i),robot,indices,0)) <= g_epsilon)